@@ -0,0 +1,44 @@
+#ifndef GRADIENT_ACCUMULATION_H
+#define GRADIENT_ACCUMULATION_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+/**
+ * @typedef gradient_accumulation_fn
+ * @brief Forward of the micro-batch made of the samples [start, end) of the batch, tracking gradients.
+ *
+ * Must output the mean loss over the micro-batch, a scalar, and free every other tensor it allocates,
+ * the graph keeping what backward needs. The loss is freed after its backward.
+ */
+typedef cgrad_error (*gradient_accumulation_fn)(const size_t start, const size_t end, struct tensor **const loss, void *args);
+
+/**
+ * @brief Computes the gradient of a batch of batch_size samples as n_micro_batches forward and
+ * backward passes, one micro-batch at a time.
+ *
+ * Micro-batches are contiguous and of sizes differing by at most one. The gradient of the loss of each
+ * micro-batch is seeded with its share of the batch, so that gradients accumulated into the gradients
+ * of the parameters are those of the mean loss of the batch, without scaling the losses nor the
+ * gradients. Operations that support it, e.g. products, add their gradients straight into those of
+ * their operands. Only one micro-batch is alive at a time, so that activations take as much memory as
+ * for a batch of batch_size / n_micro_batches samples.
+ *
+ * Gradients are not zeroed, so that zero_grad and a single optimizer step surround the call, as around
+ * backward with a single batch.
+ *
+ * @param batch_size Number of samples of the batch.
+ * @param n_micro_batches Number of micro-batches, between 1 and batch_size.
+ * @param fn Forward of a micro-batch.
+ * @param args Arguments forwarded to fn.
+ * @param allocs Allocators of the graphs built by fn.
+ * @param loss Mean loss of the batch, the losses of the micro-batches weighted by their size. May be NULL.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - GRADIENT_ACCUMULATION_INVALID_MICRO_BATCHES if n_micro_batches is out of range.
+ *         - GRADIENT_ACCUMULATION_INVALID_LOSS if fn outputs no loss or a loss that is not a scalar.
+ */
+cgrad_error gradient_accumulation_step(const size_t batch_size, const size_t n_micro_batches, const gradient_accumulation_fn fn, void *const args, struct allocators *const allocs, double *const loss);
+
+#endif
@@ -10,4 +10,57 @@
 
 cgrad_error backward(struct tensor* t, struct allocators *allocs);
 
+/**
+ * @brief Backpropagates a given gradient from a tensor of any shape.
+ *
+ * Unlike backward, which seeds the gradient of a scalar loss with 1, the gradient of t is set to a
+ * copy of grad before propagating it. Used to backpropagate through subgraphs, e.g. recomputed
+ * checkpoint segments.
+ *
+ * @param t Pointer to the tensor to backpropagate from.
+ * @param grad Gradient of the final output with respect to t, with the same shape as t.
+ * @param allocs Allocators used for the graph and the temporary gradients.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error backward_with_gradient(struct tensor *t, const struct tensor *const grad, struct allocators *allocs);
+
+/**
+ * @brief Backpropagates from a loss whose gradient is seeded with scale instead of 1.
+ *
+ * Used when the loss is one of several terms of a larger objective, e.g. the mean loss of a micro-batch
+ * weighted by its share of the batch, so that gradients accumulated over the terms are those of the
+ * objective, without scaling the loss itself or the gradients afterwards.
+ *
+ * @param t Pointer to the loss, every element of its gradient being set to scale.
+ * @param scale Gradient of the objective with respect to each element of t.
+ * @param allocs Allocators used for the graph and the temporary gradients.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error backward_scaled(struct tensor *t, const double scale, struct allocators *allocs);
+
+/**
+ * @brief Registers fn to be called during every backward, as soon as nothing else will be added to the
+ * gradient of the leaf t, i.e. once every operation that used t pushed its gradient. Earlier parts of
+ * the graph are still to be backpropagated, so that work on the final gradient, e.g. an optimizer
+ * update or communication, can start at once instead of after backward.
+ *
+ * Hooks run on the thread calling backward, in registration order, both in graph and in tape mode. They
+ * fire on leaves that backward reaches: tensors that require grad and were not produced by an operation.
+ *
+ * @param t Pointer to the leaf tensor, e.g. a parameter.
+ * @param fn Hook, which must not free t nor its gradient.
+ * @param args Arguments forwarded to fn.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - AUTOGRAD_MAX_GRAD_HOOKS_EXCEEDED if t already has AUTOGRAD_MAX_GRAD_HOOKS hooks.
+ */
+cgrad_error backward_register_grad_hook(struct tensor *const t, const tensor_grad_hook_fn fn, void *const args);
+
+/**
+ * @brief Removes the hook registered on t with the same fn and args.
+ *
+ * @return cgrad_error Error code indicating success or failure.
+ *         - AUTOGRAD_GRAD_HOOK_NOT_FOUND if no such hook is registered on t.
+ */
+cgrad_error backward_remove_grad_hook(struct tensor *const t, const tensor_grad_hook_fn fn, void *const args);
+
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "cgrad/config.h"
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * @typedef context_id
@@ -20,7 +21,9 @@ typedef uint8_t context_id;
  * This context stores intermediate tensors required by backpropagation functions.
  *
  * - `operands`: An array where each element points to a tensor allocated by the caller of the operation.
- *   The caller is responsible for deallocating these tensors.
+ *   The caller is responsible for deallocating these tensors. Only the operands an operation declares
+ *   as needed by its backward (see context_save_operand) are stored here; every other operand is free
+ *   to be released as soon as its forward consumers have run.
  *
  * - `owned`: An array where each element points to a tensor allocated by the forward function.
  *   These tensors are needed for backpropagation when they cannot be recomputed solely from the operands
@@ -29,15 +32,27 @@ typedef uint8_t context_id;
  *   The structure assumes that the first `n_owned` positions of the array
  *   contain the owned tensors; otherwise, behavior is undefined.
  *
+ * - `operands_ptr`: An array of opaque pointers for operations whose backward needs non-tensor state
+ *   (e.g., the description of a checkpointed segment). The context never dereferences nor frees them.
+ *
  * - `n_owned`: The number of owned tensors currently stored in the context.
+ *
+ * - `owned_allocator`: The allocator of the tensors referenced by the context, used both to free the
+ *   owned tensors and to drop the references taken on saved operands.
+ *
+ * - `backward_has_side_effects`: Set by operations whose backward accumulates gradients outside of the
+ *   graph (e.g. checkpointed segments), so that it runs even if no operand needs a gradient. Its backward
+ *   is then called with a NULL grad_wrt_operand for an operand without gradient, and only has its effects.
  */
 struct backpropagation_context
 {
     struct tensor *operands[AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE];
     size_t operands_size_t[AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE];
+    void *operands_ptr[AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE];
     struct tensor *owned[AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE];
     size_t n_owned;
     struct tensor_allocator *owned_allocator;
+    bool backward_has_side_effects;
 };
 
 // --- Function declarations ---
@@ -75,11 +90,46 @@ static inline cgrad_error context_init(struct backpropagation_context *const ctx
  */
 static inline cgrad_error context_set_operand(struct backpropagation_context *const ctx, struct tensor *t, const context_id ctx_id);
 
+/**
+ * @brief Declares that the backward of an operation needs the data of a tensor, and stores it.
+ *
+ * Works like context_set_operand, but also marks the tensor as saved for backward by incrementing
+ * its saved_count, and takes a reference on it. Saved tensors keep their data until the context is
+ * cleaned up, even if their owner frees them earlier, while tensors no context saved can release their
+ * data right after their forward consumers run.
+ *
+ * @param ctx Pointer to the backpropagation context.
+ * @param t Pointer to the tensor to save.
+ * @param ctx_id Index at which to store the tensor (must be less than AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE).
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success.
+ *         - AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL if ctx is NULL.
+ *         - AUTOGRAD_INVALID_CONTEXT_ID if ctx_id is out of bounds.
+ *         - AUTOGRAD_CONTEXT_ID_ALREADY_TAKEN if a tensor is already saved at ctx_id.
+ *         - TENSOR_NULL if t is NULL.
+ */
+static inline cgrad_error context_save_operand(struct backpropagation_context *const ctx, struct tensor *t, const context_id ctx_id);
+
 /**
  * TODO add docs
  */
 static inline cgrad_error context_set_operand_size_t(struct backpropagation_context *const ctx, const size_t op, const context_id ctx_id);
 
+/**
+ * @brief Stores an opaque pointer in the context at the given index.
+ *
+ * The context does not take ownership of the pointed object, which must outlive the backward pass.
+ *
+ * @param ctx Pointer to the backpropagation context.
+ * @param ptr Pointer to store.
+ * @param ctx_id Index at which to store the pointer (must be less than AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE).
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success.
+ *         - AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL if ctx is NULL.
+ *         - AUTOGRAD_INVALID_CONTEXT_ID if ctx_id is out of bounds.
+ */
+static inline cgrad_error context_set_operand_ptr(struct backpropagation_context *const ctx, void *const ptr, const context_id ctx_id);
+
 /**
  * @brief Stores a tensor pointer as an owned tensor in the context at the given index.
  *
@@ -91,6 +141,7 @@ static inline cgrad_error context_set_operand_size_t(struct backpropagation_cont
  * @param ctx_id Index at which to store the tensor (must be less than AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE).
  * @return cgrad_error Error code indicating success or failure.
  *         - NO_ERROR on success.
+ *         - AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL if ctx is NULL.
  *         - AUTOGRAD_INVALID_CONTEXT_ID if ctx_id is out of bounds.
  *         - AUTOGRAD_CONTEXT_ID_ALREADY_TAKEN if the slot is already occupied.
  */
@@ -106,6 +157,17 @@ static inline cgrad_error context_set_owned(struct backpropagation_context *cons
  */
 static inline void context_cleanup_owned(struct backpropagation_context *const ctx);
 
+/**
+ * @brief Drops the saved marks and references taken by context_save_operand.
+ *
+ * Decrements the saved_count of every operand stored in the context, releases the reference held on
+ * it and clears the operand slots. Operands whose owner already freed them are deallocated here.
+ * Does nothing if ctx is NULL.
+ *
+ * @param ctx Pointer to the backpropagation context.
+ */
+static inline void context_release_saved(struct backpropagation_context *const ctx);
+
 
 // --- Function definitions ---
 
@@ -123,8 +185,10 @@ static inline cgrad_error context_init(struct backpropagation_context *const ctx
     memset(ctx->operands, 0, sizeof(ctx->operands));
     memset(ctx->owned, 0, sizeof(ctx->owned));
     memset(ctx->operands_size_t, 0, sizeof(ctx->operands_size_t));
+    memset(ctx->operands_ptr, 0, sizeof(ctx->operands_ptr));
     ctx->n_owned = 0;
     ctx->owned_allocator = autograd_tensor_allocator;
+    ctx->backward_has_side_effects = false;
 
     return NO_ERROR;
 }
@@ -148,6 +212,31 @@ static inline cgrad_error context_set_operand(struct backpropagation_context *co
     return NO_ERROR;
 }
 
+static inline cgrad_error context_save_operand(struct backpropagation_context *const ctx, struct tensor *t, const context_id ctx_id)
+{
+    if (!ctx)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL;
+    }
+    if (ctx_id >= AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE)
+    {
+        return AUTOGRAD_INVALID_CONTEXT_ID;
+    }
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (ctx->operands[ctx_id])
+    {
+        return AUTOGRAD_CONTEXT_ID_ALREADY_TAKEN;
+    }
+
+    ctx->operands[ctx_id] = t;
+    t->saved_count++;
+    t->ref_count++;
+    return NO_ERROR;
+}
+
 static inline cgrad_error context_set_operand_size_t(struct backpropagation_context *const ctx, const size_t op, const context_id ctx_id)
 {
     if (!ctx)
@@ -163,8 +252,27 @@ static inline cgrad_error context_set_operand_size_t(struct backpropagation_cont
     return NO_ERROR;
 }
 
+static inline cgrad_error context_set_operand_ptr(struct backpropagation_context *const ctx, void *const ptr, const context_id ctx_id)
+{
+    if (!ctx)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL;
+    }
+    if (ctx_id >= AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE)
+    {
+        return AUTOGRAD_INVALID_CONTEXT_ID;
+    }
+
+    ctx->operands_ptr[ctx_id] = ptr;
+    return NO_ERROR;
+}
+
 static inline cgrad_error context_set_owned(struct backpropagation_context *const ctx, struct tensor *t, const context_id ctx_id)
 {
+    if (!ctx)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL;
+    }
     if (ctx_id >= AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE)
     {
         return AUTOGRAD_INVALID_CONTEXT_ID;
@@ -192,4 +300,23 @@ static inline void context_cleanup_owned(struct backpropagation_context *const c
     }
 }
 
+static inline void context_release_saved(struct backpropagation_context *const ctx)
+{
+    if (!ctx)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE; i++)
+    {
+        struct tensor *t = ctx->operands[i];
+        if (t)
+        {
+            t->saved_count--;
+            ctx->operands[i] = NULL;
+            tensor_allocator_release(ctx->owned_allocator, t);
+        }
+    }
+}
+
 #endif
\ No newline at end of file
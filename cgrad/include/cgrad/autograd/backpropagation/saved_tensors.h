@@ -0,0 +1,58 @@
+#ifndef SAVED_TENSORS_H
+#define SAVED_TENSORS_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/error.h"
+#include <stdbool.h>
+
+/**
+ * @brief Tells whether some backpropagation context saved the tensor for backward.
+ *
+ * @param t Pointer to the tensor.
+ * @return true if at least one operation declared that its backward needs the data of t.
+ */
+static inline bool tensor_is_saved(const struct tensor *const t);
+
+/**
+ * @brief Releases the data of a forward activation that no backward needs.
+ *
+ * Meant to be called once every forward consumer of t has run. If no operation saved t for backward,
+ * its data buffer is returned to the allocator right away, while the tensor, its gradient and its
+ * computational graph node stay alive, since gradients still flow through them. Saved tensors are
+ * left untouched. The tensor must still be freed as usual afterwards.
+ *
+ * @param t Pointer to the tensor.
+ * @param tensor_alloc Allocator the tensor was allocated with.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success, whether or not the data was released.
+ *         - TENSOR_NULL if t is NULL.
+ *         - TENSOR_ALLOCATOR_NULL if tensor_alloc is NULL.
+ */
+static inline cgrad_error tensor_release_if_unsaved(struct tensor *const t, struct tensor_allocator *const tensor_alloc);
+
+static inline bool tensor_is_saved(const struct tensor *const t)
+{
+    return t->saved_count > 0;
+}
+
+static inline cgrad_error tensor_release_if_unsaved(struct tensor *const t, struct tensor_allocator *const tensor_alloc)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!tensor_alloc)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+
+    if (!tensor_is_saved(t))
+    {
+        tensor_allocator_free_data(tensor_alloc, t);
+    }
+
+    return NO_ERROR;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/datastructures/tensor_list.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/error.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @typedef checkpoint_segment_fn
+ * @brief Forward of a checkpointed segment, i.e. a sequence of layer calls.
+ *
+ * Must compute out from x, honoring track_grad, and add to intermediates every tensor it allocates
+ * except out. It is called once during the forward pass and once more during backward, hence it must
+ * be deterministic.
+ */
+typedef cgrad_error (*checkpoint_segment_fn)(void *args, struct tensor *const x, struct tensor **const out, struct tensor_list *const intermediates, const bool track_grad);
+
+/**
+ * @struct checkpoint
+ * @brief Activation checkpoint around a segment of the network.
+ *
+ * Only the segment input is kept for backward. The intermediates of the segment are discarded right
+ * after the forward pass and recomputed, with gradient tracking, when backward reaches the segment.
+ * Parameters used by the segment must not be used outside of it in the same forward pass.
+ */
+struct checkpoint
+{
+    checkpoint_segment_fn segment;
+    void *args;
+    struct tensor_list *intermediates;
+    struct allocators *allocs;
+};
+
+cgrad_error checkpoint_init(struct checkpoint *const ckpt, checkpoint_segment_fn segment, void *const args, const size_t max_intermediates, struct allocators *const allocs);
+cgrad_error checkpoint_forward(struct checkpoint *const ckpt, struct tensor *const x, struct tensor **const out, const bool track_grad);
+void checkpoint_cleanup(struct checkpoint *const ckpt);
+
+#endif
@@ -5,31 +5,49 @@
 #include "cgrad/error.h"
 #include "cgrad/config.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 struct computational_graph_node;
 
+/**
+ * @struct computational_graph_edge
+ * @brief Link from the node of a result to the node of one of its operands.
+ *
+ * Edges are allocated from the graph pool one per operand, and chained in operand order.
+ */
+struct computational_graph_edge
+{
+    struct computational_graph_node *child;        /**< Node of the operand. */
+    backpropagation_function function;             /**< Computes the gradient with respect to the operand. */
+    backpropagation_function accumulate;           /**< Adds it to the gradient of the operand instead, NULL if the operation has no such variant. */
+    struct computational_graph_edge *next;         /**< Next operand of the same result, NULL if last. */
+    size_t operand;                                /**< Id of the operand in the operation. */
+};
+
 /**
  * @struct computational_graph_node
  * @brief Represents a node in the computational graph used for automatic differentiation.
  *
  * This structure holds information about a node in the computational graph, including its tensor,
- * parents, children, and backpropagation functions. It is used to track the flow of data and
+ * the edges to its children and the backpropagation context. It is used to track the flow of data and
  * gradients during forward and backward passes in neural networks.
+ *
+ * Only what backward reads for every node lives here, so that a node fits in a cache line. The edges
+ * and the context are separate blocks of the graph pool: a node has as many edges as operands, and a
+ * context only if its operation stores something for backward.
  */
 struct computational_graph_node
 {
     struct tensor *t;                            /**< Pointer to the tensor associated with this node. */
-    size_t n_parents;                            /**< Number of parent nodes. */
-    size_t n_children;                           /**< Number of child nodes. */
-    struct computational_graph_node *parents[AUTOGRAD_MAX_PARENTS];  /**< Array of parent nodes. */
-    // size_t parents_operands[AUTOGRAD_MAX_PARENTS];            /**< Operands associated with each parent. */
-    size_t children_operands[AUTOGRAD_MAX_CHILDREN];
-    struct computational_graph_node *children[AUTOGRAD_MAX_CHILDREN];/**< Array of child nodes. */
-    backpropagation_function function[AUTOGRAD_MAX_CHILDREN]; /**< Backpropagation functions for each child. */
-    struct backpropagation_context ctx;              /**< Context needed during backpropagation for computing gradients. */
+    struct computational_graph_edge *children;   /**< Edges to the child nodes, i.e. the operands. */
+    struct computational_graph_edge *last_child; /**< Last edge, where the next operand is appended. */
+    struct backpropagation_context *ctx;         /**< Context needed during backpropagation for computing gradients, NULL if unused. */
+    struct tensor_allocator *tensor_alloc;       /**< Allocator of the tensor, whose reference is dropped when the node is freed. */
+    uint32_t n_parents;                          /**< Number of parent nodes. */
+    uint32_t n_children;                         /**< Number of child nodes. */
+    uint32_t pushed_gradients_count;
     bool is_involved_in_backprop;                /**< Flag indicating if the node is involved in backpropagation. */
-    bool is_grad_computed;                       /**< Flag indicating if the gradient has been computed. */
-    size_t pushed_gradients_count;
+    bool is_visited;                             /**< Flag used by graph traversals to visit each node once. */
 };
 
 /**
@@ -40,10 +58,10 @@ struct computational_graph_node
 void print_computational_graph_node(const struct computational_graph_node *node);
 
 /**
- * @brief Sets a tensor in the context of a computational graph node at the specified context id.
+ * @brief Saves a tensor needed for backward in the context of a computational graph node at the specified context id.
  *
  * @param node Pointer to the computational graph node.
- * @param t Pointer to the tensor to set.
+ * @param t Pointer to the tensor to save.
  * @param ctx_id Index at which to store the tensor in the node's context.
  * @return cgrad_error Error code indicating success or failure.
  */
@@ -51,7 +69,7 @@ static inline cgrad_error computational_graph_node_set_context_tensor(struct com
 
 static inline cgrad_error computational_graph_node_set_context_tensor(struct computational_graph_node *const node, struct tensor *t, const context_id ctx_id)
 {
-    return context_set_operand(&node->ctx, t, ctx_id);
+    return context_save_operand(node->ctx, t, ctx_id);
 }
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "cgrad/memory/allocators.h"
 #include "cgrad/error.h"
+#include <stdbool.h>
 
 /**
  * @brief Adds a link between two tensors in the computational graph.
@@ -16,4 +17,41 @@
  */
 cgrad_error add_computational_graph_link(struct tensor* operand, size_t operand_id, struct tensor* result, backpropagation_function backprop_function, struct allocators *allocs);
 
+/**
+ * @brief Adds a link whose operation can also add its gradient to the gradient of the operand directly.
+ *
+ * Backward then skips the temporary gradient and the sum into the gradient of the operand, e.g. a
+ * product accumulates with a single GEMM (beta = 1). Tapes always use backprop_function.
+ *
+ * @param accumulate_function Same as backprop_function, adding to grad_wrt_operand instead of overwriting it.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error add_computational_graph_accumulating_link(struct tensor* operand, size_t operand_id, struct tensor* result, backpropagation_function backprop_function, backpropagation_function accumulate_function, struct allocators *allocs);
+
+/**
+ * @brief Returns the backpropagation context of the operation producing result.
+ *
+ * Operations store there what their backward needs, right after linking their operands. Works both
+ * when the operations build the computational graph and when they are recorded on a tape.
+ *
+ * @param result The result tensor, already linked to its operands.
+ * @param allocs The allocators passed to add_computational_graph_link.
+ * @return Pointer to the context, NULL if result is not linked.
+ */
+struct backpropagation_context *computational_graph_link_context(struct tensor *const result, struct allocators *const allocs);
+
+/**
+ * @brief Whether an operation on lhs and rhs must be linked to its operands, i.e. whether a gradient
+ * flows to at least one of them.
+ *
+ * Results of operations that are not linked need no gradient and no node.
+ *
+ * @param track_grad Whether the operation is tracked.
+ * @param rhs Second operand, NULL for unary operations.
+ */
+static inline bool computational_graph_link_is_needed(const bool track_grad, const struct tensor *const lhs, const struct tensor *const rhs)
+{
+    return track_grad && (lhs->requires_grad || (rhs && rhs->requires_grad));
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef AUTOGRAD_TAPE_H
+#define AUTOGRAD_TAPE_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/autograd/backpropagation/backpropagation_function.h"
+#include "cgrad/autograd/backpropagation/backpropagation_context.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/error.h"
+#include "cgrad/config.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct autograd_tape
+ * @brief Wengert list recording the operations of a forward pass, an alternative to the computational graph.
+ *
+ * Every tracked operation appends one variable-length record to a contiguous arena: its result, one
+ * entry per operand with the operand backpropagation function, and only the context entries the
+ * operation actually set. Backward walks the arena in reverse, so that no node is allocated during
+ * forward and the backward traversal reads memory sequentially.
+ *
+ * The record of the last operation is staged in a full backpropagation context, which operations fill
+ * as usual, and it is encoded in the arena as soon as the next operation starts or backward runs.
+ *
+ * - `arena`: Contiguous buffer holding the encoded records, grown on demand.
+ * - `size`, `capacity`: Bytes used and allocated in the arena.
+ * - `recorded`: The distinct tensors referenced by the records. The tape holds one reference on each
+ *   of them, dropped when the tape is cleared.
+ *
+ * Each record flags the operands it refers to first, which are leaves: once backward processed that
+ * record, their gradients are final and their grad hooks run, as in graph mode.
+ */
+struct autograd_tape
+{
+    unsigned char *arena;
+    size_t size;
+    size_t capacity;
+
+    struct tensor **recorded;
+    size_t n_recorded;
+    size_t recorded_capacity;
+
+    struct tensor *staged_result;
+    struct tensor *staged_operands[AUTOGRAD_MAX_CHILDREN];
+    size_t staged_operand_ids[AUTOGRAD_MAX_CHILDREN];
+    backpropagation_function staged_functions[AUTOGRAD_MAX_CHILDREN];
+    bool staged_first_uses[AUTOGRAD_MAX_CHILDREN];
+    size_t staged_n_operands;
+    struct backpropagation_context staged_ctx;
+
+    struct tensor_allocator *tensor_alloc;
+};
+
+/**
+ * @brief Initializes an empty tape. Set it as the tape of an allocators struct to record operations on it.
+ *
+ * @param tape Pointer to the tape.
+ * @param tensor_alloc Allocator of the recorded tensors.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success.
+ *         - AUTOGRAD_TAPE_NULL if tape is NULL.
+ *         - TENSOR_ALLOCATOR_NULL if tensor_alloc is NULL.
+ *         - AUTOGRAD_TAPE_ALLOCATION_FAILED if the arena cannot be allocated.
+ */
+cgrad_error autograd_tape_init(struct autograd_tape *const tape, struct tensor_allocator *const tensor_alloc);
+
+/**
+ * @brief Records that operand is the operand_id-th operand of the operation producing result.
+ *
+ * Called by add_computational_graph_link when a tape is set. Consecutive calls with the same result
+ * add operands to the same record.
+ */
+cgrad_error autograd_tape_record_link(struct autograd_tape *const tape, struct tensor *const operand, const size_t operand_id, struct tensor *const result, backpropagation_function backprop_function);
+
+/**
+ * @brief Returns the context of the operation producing result, NULL if it is not the last recorded one.
+ */
+struct backpropagation_context *autograd_tape_context(struct autograd_tape *const tape, const struct tensor *const result);
+
+/**
+ * @brief Backpropagates the gradient of root, which must already be set, through the recorded operations.
+ *
+ * Records are visited from the last to the first, starting from the one producing root. Backward consumes
+ * the tape: each record is released as soon as it is processed, and the tape is cleared at the end.
+ *
+ * @return cgrad_error Error code indicating success or failure.
+ *         - AUTOGRAD_TAPE_RESULT_NOT_RECORDED if no recorded operation produced root.
+ */
+cgrad_error autograd_tape_backward(struct autograd_tape *const tape, struct tensor *const root, struct allocators *const allocs);
+
+/**
+ * @brief Drops every record, together with the saved tensors and the references they hold.
+ */
+void autograd_tape_clear(struct autograd_tape *const tape);
+
+void autograd_tape_cleanup(struct autograd_tape *const tape);
+
+#endif
@@ -6,13 +6,73 @@
 
 // Model
 #define MODEL_MAX_PARAMS 128
+#define MODEL_PARAMS_FLAT_ALIGNMENT 64
+// Alignment in bytes of the tensor payloads in checkpoint files
+#define MODEL_CHECKPOINT_ALIGNMENT 64
+#define MODEL_CHECKPOINT_MAX_PATH 4096
+
+// Optimizers
+#define OPTIMIZER_MAX_THREADS 8
+#define OPTIMIZER_CHUNK_SIZE (64 * 1024)
+#define OPTIMIZER_PARALLEL_MIN_SIZE (256 * 1024)
+// Elements sharing a scale in 8-bit optimizer states, must divide OPTIMIZER_CHUNK_SIZE
+#define OPTIMIZER_STATE_BLOCK_SIZE 256
+
+// Data parallel
+#define DATA_PARALLEL_MAX_WORKERS 64
+// Elements summed at once across the gradients of every worker, small enough for all of them to stay in L2 cache
+#define DATA_PARALLEL_REDUCE_CHUNK_SIZE (2 * 1024)
+// Floor of the tensor pool chunks of each worker, which otherwise share MEMORY_TENSOR_POOL_N_CHUNKS
+#define DATA_PARALLEL_MIN_WORKER_POOL_CHUNKS 64
+
+// Communicators
+// Bytes exchanged at once, i.e. size of each shared-memory slot and of the transfer buffers
+#define COMMUNICATOR_CHUNK_SIZE (4 * 1024 * 1024)
+#define COMMUNICATOR_TCP_CONNECT_RETRIES 1000
+#define COMMUNICATOR_TCP_RETRY_DELAY_MS 10
+
+// Distributed
+// Gradient elements all-reduced together, buckets are filled in reverse parameter order
+#define DISTRIBUTED_BUCKET_SIZE (128 * 1024)
+
+// Pipeline
+#define PIPELINE_MAX_STAGES 16
+// Messages waiting between two stages, must be a power of two
+#define PIPELINE_QUEUE_CAPACITY 64
+
+// Gradient compressors
+// Elements sharing a scale in 8-bit gradient messages
+#define GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE 256
 
 // Autograd
 #define AUTOGRAD_MAX_NODES 128
 #define AUTOGRAD_MAX_PARENTS 8
 #define AUTOGRAD_MAX_CHILDREN 8
 #define AUTOGRAD_MAX_TARGETS 128
+// Gradient-ready hooks registered on a single tensor
+#define AUTOGRAD_MAX_GRAD_HOOKS 4
 #define AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE 8
+#define AUTOGRAD_TAPE_INITIAL_CAPACITY 64 * 1024
+
+// Stash the left operand of float32 matrix products in bfloat16 for backward (0 to keep full precision)
+#ifndef AUTOGRAD_GEMM_STASH_BF16
+#define AUTOGRAD_GEMM_STASH_BF16 0
+#endif
+
+// Captured graph
+#define CAPTURED_GRAPH_MAX_NODES 256
+#define CAPTURED_GRAPH_MAX_OUTPUTS 8
+#define CAPTURED_GRAPH_MAX_FUSIONS 32
+
+// Pointwise kernels
+#define POINTWISE_PROGRAM_MAX_INPUTS 4
+#define POINTWISE_PROGRAM_MAX_INSTRUCTIONS 16
+#define POINTWISE_INTERPRETER_BLOCK_SIZE 256
+#define POINTWISE_KERNEL_CACHE_SUBDIR "cgrad-kernels"
+#ifndef POINTWISE_KERNEL_CC
+#define POINTWISE_KERNEL_CC "cc"
+#endif
+#define POINTWISE_KERNEL_CFLAGS "-O3", "-march=native", "-std=c11", "-fPIC", "-shared"
 
 // Dataset
 #define DATASET_CSV_MAX_LINE_CHAR_LENGTH 8192
@@ -20,5 +80,10 @@
 // Memory
 #define MEMORY_TENSOR_POOL_N_CHUNKS 512
 #define MEMORY_TENSOR_POOL_DATA_CHUNK_SIZE 1024 * 1024 * 8
+#define MEMORY_GRAPH_POOL_N_EDGES 1024
+#define MEMORY_GRAPH_POOL_N_CONTEXTS 512
+#define MEMORY_GRAPH_NODE_ALIGNMENT 64
+#define MEMORY_TENSOR_SPILL_MAX_ENTRIES 128
+#define MEMORY_TENSOR_SPILL_PREFETCH_DEPTH 2
 
 #endif
@@ -3,15 +3,25 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <string.h>
 
 typedef enum 
 {
     DTYPE_FLOAT64,
     DTYPE_FLOAT32,
     DTYPE_INT32,
+    DTYPE_BFLOAT16,
 } cgrad_dtype;
 
+/**
+ * @typedef bfloat16
+ * @brief Storage type of DTYPE_BFLOAT16: the upper 16 bits of an IEEE-754 float.
+ */
+typedef uint16_t bfloat16;
+
 static inline size_t dtype_sizeof(cgrad_dtype dtype);
+static inline bfloat16 bfloat16_from_float(const float value);
+static inline float bfloat16_to_float(const bfloat16 value);
 
 static inline size_t dtype_sizeof(cgrad_dtype dtype)
 {
@@ -23,9 +33,35 @@ static inline size_t dtype_sizeof(cgrad_dtype dtype)
             return sizeof(double);
         case DTYPE_INT32:
             return sizeof(int32_t);
+        case DTYPE_BFLOAT16:
+            return sizeof(bfloat16);
         default:
             return 0;
     }
 }
 
+static inline bfloat16 bfloat16_from_float(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    // Keep NaNs quiet, as rounding could turn them into infinities
+    if ((bits & 0x7fffffffu) > 0x7f800000u)
+    {
+        return (bfloat16)((bits >> 16) | 0x0040u);
+    }
+
+    // Round to nearest, ties to even
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return (bfloat16)(bits >> 16);
+}
+
+static inline float bfloat16_to_float(const bfloat16 value)
+{
+    uint32_t bits = (uint32_t)value << 16;
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
 #endif
\ No newline at end of file
@@ -26,9 +26,56 @@ typedef enum
     // Model errors
     MODEL_MAX_PARAMS_EXCEEDED,
     MODEL_PARAMS_NULL,
+    MODEL_PARAMS_ALREADY_FLAT,
+    MODEL_PARAMS_ALLOCATION_FAILED,
+
+    // Model checkpoint
+    MODEL_CHECKPOINT_NULL,
+    MODEL_CHECKPOINT_FILE_ERROR,
+    MODEL_CHECKPOINT_FORMAT_ERROR,
+    MODEL_CHECKPOINT_MISMATCH,
+    MODEL_CHECKPOINT_ALLOCATION_FAILED,
+    MODEL_CHECKPOINT_WRITER_NULL,
 
     // Optimizers
     OPTIMIZER_NULL,
+    OPTIMIZER_STATE_ALLOCATION_FAILED,
+    OPTIMIZER_ALLOCATION_FAILED,
+
+    // Data parallel
+    DATA_PARALLEL_NULL,
+    DATA_PARALLEL_INVALID_WORKERS,
+    DATA_PARALLEL_ALLOCATION_FAILED,
+    DATA_PARALLEL_THREAD_CREATION_FAILED,
+
+    // Communicators
+    COMMUNICATOR_NULL,
+    COMMUNICATOR_INVALID_RANK,
+    COMMUNICATOR_ALLOCATION_FAILED,
+    COMMUNICATOR_SHARED_MEMORY_FAILED,
+    COMMUNICATOR_CONNECTION_FAILED,
+    COMMUNICATOR_TRANSFER_FAILED,
+
+    // Distributed
+    DISTRIBUTED_NULL,
+    DISTRIBUTED_PARAMS_NOT_FLAT,
+    DISTRIBUTED_THREAD_CREATION_FAILED,
+    DISTRIBUTED_ALLOCATION_FAILED,
+
+    // Pipeline
+    PIPELINE_NULL,
+    PIPELINE_INVALID_STAGES,
+    PIPELINE_INVALID_MICRO_BATCHES,
+    PIPELINE_INVALID_OUTPUT,
+    PIPELINE_ALLOCATION_FAILED,
+    PIPELINE_THREAD_CREATION_FAILED,
+    PIPELINE_ABORTED,
+
+    // Gradient compressors
+    GRADIENT_COMPRESSOR_NULL,
+    GRADIENT_COMPRESSOR_INVALID_RATIO,
+    GRADIENT_COMPRESSOR_ALLOCATION_FAILED,
+    GRADIENT_COMPRESSOR_OUT_OF_RANGE,
 
     // Allocator
     ALLOCATORS_NULL,
@@ -41,6 +88,8 @@ typedef enum
     AUTOGRAD_MAX_PARENTS_EXCEEDED,
     AUTOGRAD_MAX_CHILDREN_EXCEEDED,
     AUTOGRAD_MAX_TARGETS_EXCEEDED,
+    AUTOGRAD_MAX_GRAD_HOOKS_EXCEEDED,
+    AUTOGRAD_GRAD_HOOK_NOT_FOUND,
     AUTOGRAD_INVALID_CONTEXT_ID,
     AUTOGRAD_CONTEXT_ID_ALREADY_TAKEN,
     AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR,
@@ -81,6 +130,10 @@ typedef enum
     // Memory
     MEMORY_POOL_NULL,
     MEMORY_POOL_CHUNK_ALLOCATION_FAILED,
+    TENSOR_SPILL_STORE_NULL,
+    TENSOR_SPILL_FILE_ERROR,
+    TENSOR_SPILL_STORE_FULL,
+    TENSOR_SPILL_ENTRY_NOT_FOUND,
 
     // General
     INPUT_NULL,
@@ -95,7 +148,34 @@ typedef enum
 
     // Conv2d
     CONV2D_NULL,
-    CONV2D_CHANNELS_MISMATCH
+    CONV2D_CHANNELS_MISMATCH,
+
+    // Checkpoint
+    CHECKPOINT_NULL,
+    CHECKPOINT_SEGMENT_NULL,
+
+    // Gradient accumulation
+    GRADIENT_ACCUMULATION_INVALID_MICRO_BATCHES,
+    GRADIENT_ACCUMULATION_INVALID_LOSS,
+
+    // Tape
+    AUTOGRAD_TAPE_NULL,
+    AUTOGRAD_TAPE_ALLOCATION_FAILED,
+    AUTOGRAD_TAPE_RESULT_NOT_RECORDED,
+
+    // Captured graph
+    CAPTURED_GRAPH_NULL,
+    CAPTURED_GRAPH_FULL,
+    CAPTURED_GRAPH_INVALID_NODE,
+    CAPTURED_GRAPH_INVALID_OPERATION,
+
+    // Pointwise kernels
+    POINTWISE_PROGRAM_NULL,
+    POINTWISE_PROGRAM_FULL,
+    POINTWISE_PROGRAM_INVALID_REGISTER,
+    POINTWISE_KERNEL_NULL,
+    POINTWISE_KERNEL_COMPILATION_FAILED,
+    POINTWISE_KERNEL_LOADING_FAILED
 
 } cgrad_error;
 
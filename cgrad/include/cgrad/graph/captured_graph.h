@@ -0,0 +1,135 @@
+#ifndef CAPTURED_GRAPH_H
+#define CAPTURED_GRAPH_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/datastructures/tensor_list.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/graph/pointwise_kernel.h"
+#include "cgrad/error.h"
+#include "cgrad/config.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CAPTURED_NODE_MAX_OPERANDS 2
+
+/**
+ * @typedef captured_node_id
+ * @brief Index of a node in a captured graph. Operands always have a smaller id than their users.
+ */
+typedef size_t captured_node_id;
+
+typedef enum captured_op
+{
+    CAPTURED_OP_INPUT,
+    CAPTURED_OP_RESHAPE,
+    CAPTURED_OP_TRANS2D,
+    CAPTURED_OP_TRANS,
+    CAPTURED_OP_MULT,
+    CAPTURED_OP_IM2ROW,
+    CAPTURED_OP_ADD_ROW_VECTOR,
+    CAPTURED_OP_RELU,
+    CAPTURED_OP_ADD,
+} captured_op;
+
+/**
+ * @struct captured_node
+ * @brief Symbolic operation of a captured graph.
+ *
+ * Only the attributes of its operation are meaningful: axis_1 and axis_2 for CAPTURED_OP_TRANS, the
+ * transposition flags for CAPTURED_OP_MULT, and input_index for CAPTURED_OP_INPUT.
+ */
+struct captured_node
+{
+    captured_op op;
+    captured_node_id operands[CAPTURED_NODE_MAX_OPERANDS];
+    size_t n_operands;
+    size_t shape[TENSOR_MAX_SHAPE_SIZE]; /**< Shape of the result, inferred at capture. */
+    size_t shape_size;
+    size_t axis_1;
+    size_t axis_2;
+    size_t input_index;                  /**< Position of the tensor in the inputs of captured_graph_run. */
+    bool trans_lhs;                      /**< Whether the product reads the left operand transposed. */
+    bool trans_rhs;                      /**< Whether the product reads the right operand transposed. */
+    bool is_live;                        /**< False once a pass made the node unreachable from the outputs. */
+    bool is_fused;                       /**< Whether untracked runs compute the node within the fusion of a later node. */
+    bool is_fusion_root;                 /**< Whether untracked runs compute the node with the kernel of fusion_index. */
+    size_t fusion_index;
+};
+
+/**
+ * @struct captured_fusion
+ * @brief Pointwise nodes computed by a single kernel, see captured_graph_fuse_pointwise.
+ */
+struct captured_fusion
+{
+    struct pointwise_kernel kernel;
+    captured_node_id inputs[POINTWISE_PROGRAM_MAX_INPUTS]; /**< Nodes bound to the inputs of the kernel program. */
+};
+
+/**
+ * @struct captured_graph
+ * @brief Forward computation captured as a list of symbolic operations, in execution order.
+ *
+ * A captured graph is built once through the captured_graph_* builders, can be rewritten by the passes
+ * in captured_graph_passes.h, and is then run any number of times on concrete tensors. Running it calls
+ * the regular operations, so that tracked runs build the autograd graph as usual. Shapes are fixed at
+ * capture: inputs of a different shape require a new capture.
+ */
+struct captured_graph
+{
+    struct captured_node nodes[CAPTURED_GRAPH_MAX_NODES];
+    size_t n_nodes;
+    size_t n_inputs;
+    captured_node_id outputs[CAPTURED_GRAPH_MAX_OUTPUTS];
+    size_t n_outputs;
+    struct captured_fusion fusions[CAPTURED_GRAPH_MAX_FUSIONS];
+    size_t n_fusions;
+};
+
+cgrad_error captured_graph_init(struct captured_graph *const graph);
+
+/**
+ * @brief Unloads the compiled kernels of the graph. Required before capturing again in the same graph.
+ */
+void captured_graph_cleanup(struct captured_graph *const graph);
+
+/**
+ * @brief Adds an input of the graph, e.g. a batch or a parameter. Inputs are bound to tensors at run
+ * time, in the order they were added.
+ */
+cgrad_error captured_graph_input(struct captured_graph *const graph, const size_t *const shape, const size_t shape_size, captured_node_id *const id);
+cgrad_error captured_graph_reshape(struct captured_graph *const graph, const captured_node_id x, const size_t *const shape, const size_t shape_size, captured_node_id *const id);
+cgrad_error captured_graph_trans2d(struct captured_graph *const graph, const captured_node_id x, captured_node_id *const id);
+cgrad_error captured_graph_trans(struct captured_graph *const graph, const captured_node_id x, const size_t axis_1, const size_t axis_2, captured_node_id *const id);
+cgrad_error captured_graph_mult(struct captured_graph *const graph, const captured_node_id lhs, const captured_node_id rhs, captured_node_id *const id);
+cgrad_error captured_graph_im2row(struct captured_graph *const graph, const captured_node_id x, const captured_node_id kernel, captured_node_id *const id);
+cgrad_error captured_graph_add_row_vector(struct captured_graph *const graph, const captured_node_id x, const captured_node_id v, captured_node_id *const id);
+cgrad_error captured_graph_relu(struct captured_graph *const graph, const captured_node_id x, captured_node_id *const id);
+cgrad_error captured_graph_add(struct captured_graph *const graph, const captured_node_id x, const captured_node_id y, captured_node_id *const id);
+
+/**
+ * @brief Marks a node as an output of the graph. Outputs are returned by captured_graph_run in the
+ * order they were marked, and every pass preserves them.
+ */
+cgrad_error captured_graph_mark_output(struct captured_graph *const graph, const captured_node_id id);
+
+/**
+ * @brief Runs the live nodes of the graph.
+ *
+ * Every tensor allocated by the run, except the outputs, is added to intermediates. As in the layers,
+ * the data of an intermediate is released right after its last consumer ran, unless that consumer
+ * saved it for backward. Untracked runs compute fused pointwise nodes with their kernel, in a single
+ * pass and without their intermediate tensors. Tracked runs ignore fusions, as kernels have no backward.
+ *
+ * @param graph Pointer to the captured graph.
+ * @param inputs Tensors bound to the inputs of the graph, in the order the inputs were added.
+ * @param outputs Array receiving the outputs of the graph, in the order they were marked.
+ * @param intermediates List receiving the intermediate tensors, to be freed by the caller.
+ * @param track_grad Whether the operations are tracked for backward.
+ * @param allocs Allocators of the tensors and of the autograd graph.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - TENSOR_SHAPE_MISMATCH if an input does not have its captured shape.
+ */
+cgrad_error captured_graph_run(const struct captured_graph *const graph, struct tensor **const inputs, struct tensor **const outputs, struct tensor_list *const intermediates, const bool track_grad, struct allocators *const allocs);
+
+#endif
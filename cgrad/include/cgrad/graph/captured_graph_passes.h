@@ -0,0 +1,79 @@
+#ifndef CAPTURED_GRAPH_PASSES_H
+#define CAPTURED_GRAPH_PASSES_H
+
+#include "cgrad/graph/captured_graph.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+/**
+ * @struct captured_graph_report
+ * @brief What the passes changed in a captured graph.
+ *
+ * Layout operations (reshapes and transpositions) copy their whole input in this library, hence the
+ * copies and copied elements of the live graph before and after the passes.
+ */
+struct captured_graph_report
+{
+    size_t transposes_cancelled;      /**< Pairs of inverse transpositions removed. */
+    size_t transposes_folded;         /**< Transpositions replaced by transposition flags of a product. */
+    size_t reshapes_merged;           /**< Reshapes of reshapes, or to the same shape, bypassed. */
+    size_t subexpressions_eliminated; /**< Nodes replaced by an identical earlier node. */
+    size_t dead_nodes_eliminated;     /**< Nodes no longer reachable from the outputs. */
+    size_t copies_before;
+    size_t copies_after;
+    size_t copied_elements_before;
+    size_t copied_elements_after;
+};
+
+/**
+ * @brief Runs every pass until none applies anymore, then removes the dead nodes.
+ *
+ * @param graph Pointer to the captured graph, rewritten in place. Outputs are preserved.
+ * @param report Pointer to the report to fill, may be NULL.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error captured_graph_optimize(struct captured_graph *const graph, struct captured_graph_report *const report);
+
+/**
+ * @brief Bypasses transpositions of transpositions over the same axes.
+ */
+size_t captured_graph_cancel_transposes(struct captured_graph *const graph);
+
+/**
+ * @brief Reads transposed operands of products through their transposition flags, and turns the
+ * transposition of a product used only there into the transposed product, (A*B)^T = B^T*A^T.
+ */
+size_t captured_graph_fold_transposes(struct captured_graph *const graph);
+
+/**
+ * @brief Reshapes the source of a reshape of a reshape directly, and bypasses reshapes to the same shape.
+ */
+size_t captured_graph_merge_reshapes(struct captured_graph *const graph);
+
+/**
+ * @brief Replaces every node by the first identical node, i.e. same operation, operands and attributes.
+ */
+size_t captured_graph_eliminate_common_subexpressions(struct captured_graph *const graph);
+
+/**
+ * @brief Marks as dead the nodes that no output depends on. Inputs are never removed.
+ */
+size_t captured_graph_eliminate_dead_nodes(struct captured_graph *const graph);
+
+/**
+ * @brief Groups chains of pointwise nodes (additions, bias additions, ReLUs) into fusions, each
+ * computed by a single kernel in untracked runs.
+ *
+ * A fusion grows from its last node through the operands of the same shape that only it uses. Its
+ * kernel is compiled, or loaded from the cache, right away; if that fails the kernel is interpreted.
+ * Must run after the other passes, which do not preserve fusions.
+ *
+ * @param graph Pointer to the captured graph.
+ * @param cache_dir Directory of the compiled kernels, see pointwise_kernel_compile.
+ * @return size_t Number of nodes fused.
+ */
+size_t captured_graph_fuse_pointwise(struct captured_graph *const graph, const char *const cache_dir);
+
+void captured_graph_print_report(const struct captured_graph_report *const report);
+
+#endif
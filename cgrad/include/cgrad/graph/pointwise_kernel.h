@@ -0,0 +1,109 @@
+#ifndef POINTWISE_KERNEL_H
+#define POINTWISE_KERNEL_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/error.h"
+#include "cgrad/config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum pointwise_input_kind
+{
+    POINTWISE_INPUT_FULL, /**< Tensor of the shape of the output, read at the same index. */
+    POINTWISE_INPUT_ROW,  /**< Row vector broadcast over the rows of the output, read at the same column. */
+} pointwise_input_kind;
+
+typedef enum pointwise_opcode
+{
+    POINTWISE_OP_LOAD,
+    POINTWISE_OP_ADD,
+    POINTWISE_OP_RELU,
+} pointwise_opcode;
+
+/**
+ * @struct pointwise_instruction
+ * @brief Instruction of a pointwise program. Its result is the register of the same index.
+ *
+ * A load reads the input of index a, an addition adds the registers a and b, a ReLU reads the register a.
+ */
+struct pointwise_instruction
+{
+    pointwise_opcode op;
+    size_t a;
+    size_t b;
+};
+
+/**
+ * @struct pointwise_program
+ * @brief Chain of elementwise operations computing one output element from one element of each input.
+ *
+ * The output is the register of the last instruction. Rows and columns refer to the output seen as a
+ * matrix whose rows have the length of its last dimension.
+ */
+struct pointwise_program
+{
+    struct pointwise_instruction instructions[POINTWISE_PROGRAM_MAX_INSTRUCTIONS];
+    size_t n_instructions;
+    pointwise_input_kind input_kinds[POINTWISE_PROGRAM_MAX_INPUTS];
+    size_t n_inputs;
+};
+
+typedef void (*pointwise_kernel_f64_fn)(double *out, const double *const *in, const size_t rows, const size_t cols);
+typedef void (*pointwise_kernel_f32_fn)(float *out, const float *const *in, const size_t rows, const size_t cols);
+
+/**
+ * @struct pointwise_kernel
+ * @brief Pointwise program with its compiled code, if any.
+ *
+ * pointwise_kernel_compile generates a single C loop for the program, compiles it with the system C
+ * compiler into a shared object and loads it. Shared objects are cached on disk under the hash of the
+ * generated source, the compiler and the host, so that a program is compiled once across runs. Without
+ * compiled code, the kernel runs on an interpreter, one instruction at a time over blocks of elements.
+ */
+struct pointwise_kernel
+{
+    struct pointwise_program program;
+    pointwise_kernel_f64_fn f64;
+    pointwise_kernel_f32_fn f32;
+    void *handle;
+    uint64_t hash;
+};
+
+cgrad_error pointwise_program_init(struct pointwise_program *const program);
+cgrad_error pointwise_program_load(struct pointwise_program *const program, const pointwise_input_kind kind, size_t *const reg);
+cgrad_error pointwise_program_add(struct pointwise_program *const program, const size_t a, const size_t b, size_t *const reg);
+cgrad_error pointwise_program_relu(struct pointwise_program *const program, const size_t a, size_t *const reg);
+
+cgrad_error pointwise_kernel_init(struct pointwise_kernel *const kernel, const struct pointwise_program *const program);
+
+/**
+ * @brief Compiles the kernel, or loads it from the cache.
+ *
+ * @param kernel Pointer to the kernel.
+ * @param cache_dir Directory of the cached shared objects, $XDG_CACHE_HOME/cgrad-kernels or else
+ *        $HOME/.cache/cgrad-kernels if NULL. It must be owned by the effective user and writable by
+ *        nobody else, and so must the shared objects loaded from it. The compiler is taken from the
+ *        CC environment variable, POINTWISE_KERNEL_CC if unset, and run without a shell: CC names a
+ *        single program.
+ * @return cgrad_error Error code indicating success or failure. On failure the kernel is still usable,
+ *         on the interpreter.
+ *         - POINTWISE_KERNEL_COMPILATION_FAILED if no compiler is available or the compilation failed.
+ *         - POINTWISE_KERNEL_LOADING_FAILED if the shared object could not be loaded, or if the cached
+ *           one is not private to the effective user.
+ */
+cgrad_error pointwise_kernel_compile(struct pointwise_kernel *const kernel, const char *const cache_dir);
+bool pointwise_kernel_is_compiled(const struct pointwise_kernel *const kernel);
+
+/**
+ * @brief Runs the kernel over the output, in a single pass over the inputs.
+ *
+ * @param kernel Pointer to the kernel.
+ * @param inputs Inputs of the program, of the dtype of out.
+ * @param out Pre-allocated output tensor.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error pointwise_kernel_run(const struct pointwise_kernel *const kernel, struct tensor *const *const inputs, struct tensor *const out);
+void pointwise_kernel_cleanup(struct pointwise_kernel *const kernel);
+
+#endif
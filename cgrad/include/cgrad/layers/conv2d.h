@@ -7,6 +7,7 @@
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/memory/allocators.h"
+#include "cgrad/graph/captured_graph.h"
 #include <stddef.h>
 
 struct conv2d 
@@ -20,6 +21,21 @@ struct conv2d
 
 cgrad_error conv2d_init(struct conv2d *const layer, const size_t in_channels, const size_t out_channels, const size_t kernel_size, const cgrad_dtype dtype, struct allocators *const allocs);
 cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, struct tensor **const out, struct tensor_list *const intermediates, const bool track_grad);
+
+/**
+ * @brief Emits the operations of conv2d_forward into a captured graph.
+ *
+ * The layer is lowered as in conv2d_forward, transpositions included, and the graph passes are left to
+ * simplify them. The weight is not bound here: it is an input of the graph like x.
+ *
+ * @param layer Pointer to the convolutional layer.
+ * @param graph Pointer to the captured graph.
+ * @param x Node of the input batch, of shape (N, C, H, W).
+ * @param weight Node bound to the weight of the layer at run time.
+ * @param out Pointer receiving the node of the output, of shape (N, K, H_out, W_out).
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error conv2d_capture(const struct conv2d *const layer, struct captured_graph *const graph, const captured_node_id x, const captured_node_id weight, captured_node_id *const out);
 cgrad_error conv2d_xavier_init(struct conv2d *const layer);
 void conv2d_cleanup(struct conv2d *const layer);
 
@@ -7,6 +7,7 @@
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/memory/allocators.h"
+#include "cgrad/graph/captured_graph.h"
 #include <stddef.h>
 
 struct linear
@@ -20,6 +21,12 @@ struct linear
 
 cgrad_error linear_init(struct linear *const layer, const size_t in_dim, const size_t out_dim, const cgrad_dtype dtype, struct allocators *const allocs);
 cgrad_error linear_forward(struct linear *const layer, struct tensor *const x, struct tensor **const out, struct tensor_list *const intermediates, const bool track_grad);
+
+/**
+ * @brief Emits the operations of linear_forward into a captured graph, with the weight and the bias
+ * as inputs of the graph.
+ */
+cgrad_error linear_capture(const struct linear *const layer, struct captured_graph *const graph, const captured_node_id x, const captured_node_id weight, const captured_node_id bias, captured_node_id *const out);
 cgrad_error linear_xavier_init(struct linear *const layer);
 void linear_cleanup(struct linear *const layer);
 
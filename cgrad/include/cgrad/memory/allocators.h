@@ -4,10 +4,13 @@
 #include "cgrad/memory/tensor/tensor_allocator.h"
 #include "cgrad/memory/computational_graph/computational_graph_allocator.h"
 
+struct autograd_tape;
+
 struct allocators
 {
     struct tensor_allocator *tensor_alloc;
     struct computational_graph_allocator *graph_alloc;
+    struct autograd_tape *tape; /**< Optional tape recording the operations instead of the graph, NULL to build the graph. */
 };
 
 static inline cgrad_error allocators_is_valid(struct allocators *allocs);
@@ -5,18 +5,35 @@
 
 typedef struct computational_graph_node *(*computational_graph_alloc_fn)(void *, struct tensor *const);
 typedef void (*computational_graph_free_fn)(void *, struct computational_graph_node *);
+typedef struct computational_graph_edge *(*computational_graph_edge_alloc_fn)(void *);
+typedef struct backpropagation_context *(*computational_graph_context_alloc_fn)(void *);
+typedef void (*computational_graph_context_free_fn)(void *, struct backpropagation_context *);
 
 struct computational_graph_allocator
 {
     computational_graph_alloc_fn alloc;
     computational_graph_free_fn free;
+    computational_graph_edge_alloc_fn alloc_edge;
+    computational_graph_context_alloc_fn alloc_context;
+    computational_graph_context_free_fn free_context;
     void *pool;
 };
 
 static inline struct computational_graph_node *computational_graph_allocator_alloc(struct computational_graph_allocator *graph_alloc, struct tensor *const t);
 
+/**
+ * Frees a node together with its edges and its context.
+ */
 static inline void computational_graph_allocator_free(struct computational_graph_allocator *allocator, struct computational_graph_node *ptr);
 
+static inline struct computational_graph_edge *computational_graph_allocator_alloc_edge(struct computational_graph_allocator *graph_alloc);
+static inline struct backpropagation_context *computational_graph_allocator_alloc_context(struct computational_graph_allocator *graph_alloc);
+
+/**
+ * Gives back a context that was never attached to a node, e.g. when its initialization failed.
+ */
+static inline void computational_graph_allocator_free_context(struct computational_graph_allocator *graph_alloc, struct backpropagation_context *ptr);
+
 static inline struct computational_graph_node *computational_graph_allocator_alloc(struct computational_graph_allocator *graph_alloc, struct tensor *const t)
 {
     return graph_alloc->alloc(graph_alloc->pool, t);
@@ -27,4 +44,19 @@ static inline void computational_graph_allocator_free(struct computational_graph
     graph_alloc->free(graph_alloc->pool, ptr);
 }
 
-#endif
\ No newline at end of file
+static inline struct computational_graph_edge *computational_graph_allocator_alloc_edge(struct computational_graph_allocator *graph_alloc)
+{
+    return graph_alloc->alloc_edge(graph_alloc->pool);
+}
+
+static inline struct backpropagation_context *computational_graph_allocator_alloc_context(struct computational_graph_allocator *graph_alloc)
+{
+    return graph_alloc->alloc_context(graph_alloc->pool);
+}
+
+static inline void computational_graph_allocator_free_context(struct computational_graph_allocator *graph_alloc, struct backpropagation_context *ptr)
+{
+    graph_alloc->free_context(graph_alloc->pool, ptr);
+}
+
+#endif
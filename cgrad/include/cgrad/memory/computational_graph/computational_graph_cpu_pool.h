@@ -4,34 +4,51 @@
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include <stdlib.h>
 
-struct computational_graph_chunk;
-struct computational_graph_chunk
+/**
+ * @struct computational_graph_cpu_block_list
+ * @brief Free list of fixed-size blocks carved from a single allocation.
+ *
+ * A free block stores the address of the next free block in its first bytes.
+ */
+struct computational_graph_cpu_block_list
 {
-    struct computational_graph_chunk *next;
-    struct computational_graph_node node;
+    void *head;
+    void *memory;
 };
 
+/**
+ * @struct computational_graph_cpu_pool
+ * @brief Pool of the graph blocks: cache-line aligned nodes, edges and backpropagation contexts.
+ */
 struct computational_graph_cpu_pool
 {
-    struct computational_graph_chunk* chunk_head;
-    void *memory;
+    struct computational_graph_cpu_block_list nodes;
+    struct computational_graph_cpu_block_list edges;
+    struct computational_graph_cpu_block_list contexts;
 };
 
 cgrad_error computational_graph_cpu_pool_init(struct computational_graph_cpu_pool *pool);
 void *computational_graph_cpu_pool_alloc(struct computational_graph_cpu_pool *pool);
 void computational_graph_cpu_pool_free(struct computational_graph_cpu_pool *pool, void *ptr);
+void *computational_graph_cpu_pool_edge_alloc(struct computational_graph_cpu_pool *pool);
+void computational_graph_cpu_pool_edge_free(struct computational_graph_cpu_pool *pool, void *ptr);
+void *computational_graph_cpu_pool_context_alloc(struct computational_graph_cpu_pool *pool);
+void computational_graph_cpu_pool_context_free(struct computational_graph_cpu_pool *pool, void *ptr);
 static inline void computational_graph_cpu_pool_cleanup(struct computational_graph_cpu_pool *pool);
 
 static inline void computational_graph_cpu_pool_cleanup(struct computational_graph_cpu_pool *pool)
 {
-    if (!pool->memory)
+    if (!pool->nodes.memory)
     {
         return;
     }
 
-    free(pool->memory);
-    pool->memory = NULL;
-    pool->chunk_head = NULL;
+    free(pool->nodes.memory);
+    free(pool->edges.memory);
+    free(pool->contexts.memory);
+    pool->nodes = (struct computational_graph_cpu_block_list){NULL, NULL};
+    pool->edges = (struct computational_graph_cpu_block_list){NULL, NULL};
+    pool->contexts = (struct computational_graph_cpu_block_list){NULL, NULL};
 }
 
 #endif
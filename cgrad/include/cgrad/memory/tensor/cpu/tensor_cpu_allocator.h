@@ -5,6 +5,8 @@
 #include "cgrad/memory/tensor/cpu/tensor_cpu_pool.h"
 
 cgrad_error tensor_cpu_allocator_init(struct tensor_allocator *const tensor_alloc);
+// Allocator whose pool holds n_chunks chunks instead of MEMORY_TENSOR_POOL_N_CHUNKS
+cgrad_error tensor_cpu_allocator_init_with_chunks(struct tensor_allocator *const tensor_alloc, const size_t n_chunks);
 void tensor_cpu_allocator_cleanup(struct tensor_allocator *const tensor_alloc);
 
 #endif
\ No newline at end of file
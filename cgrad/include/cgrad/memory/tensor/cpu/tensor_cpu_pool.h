@@ -34,6 +34,8 @@ struct tensor_cpu_pool
 };
 
 cgrad_error tensor_cpu_pool_init(struct tensor_cpu_pool *pool);
+// Pool of n_chunks chunks instead of MEMORY_TENSOR_POOL_N_CHUNKS, e.g. for one of several workers
+cgrad_error tensor_cpu_pool_init_with_chunks(struct tensor_cpu_pool *pool, const size_t n_chunks);
 void *tensor_cpu_pool_tensor_alloc(struct tensor_cpu_pool *pool, const size_t size);
 void *tensor_cpu_pool_data_alloc(struct tensor_cpu_pool *pool, const size_t size);
 void *tensor_cpu_pool_data_zero_alloc(struct tensor_cpu_pool *pool, const size_t size);
@@ -0,0 +1,121 @@
+#ifndef TENSOR_SPILL_STORE_H
+#define TENSOR_SPILL_STORE_H
+
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/autograd/backpropagation/backpropagation_context.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct tensor_spill_entry
+ * @brief A tensor whose data currently lives in the scratch file.
+ */
+struct tensor_spill_entry
+{
+    struct tensor *t;
+    size_t offset;
+    size_t bytes;
+};
+
+/**
+ * @struct tensor_spill_job
+ * @brief A region of the scratch file waiting to be written back to disk.
+ */
+struct tensor_spill_job
+{
+    size_t offset;
+    size_t bytes;
+};
+
+/**
+ * @struct tensor_spill_store
+ * @brief File-backed store for tensors saved for backward.
+ *
+ * Once attached to a tensor allocator, the data of a saved tensor at least `threshold` bytes large is
+ * moved to a memory-mapped scratch file as soon as its owner frees it while backward still needs it,
+ * which is when the forward pass is done with it. References dropped by graph nodes, tapes and
+ * contexts never spill it, so that a tensor saved twice is not written back halfway through backward. Its buffer goes back to the pool right away,
+ * while a worker thread writes the pages back to disk and drops them from memory.
+ *
+ * Entries are kept in offload order. Backward restores them roughly in reverse order, so each restore
+ * asks the kernel to read ahead the MEMORY_TENSOR_SPILL_PREFETCH_DEPTH entries offloaded before it,
+ * overlapping the I/O with the computation of the gradients in between.
+ */
+struct tensor_spill_store
+{
+    int fd;
+    char *map;
+    size_t capacity;
+    size_t used;
+    size_t threshold;
+    size_t page_size;
+
+    struct tensor_spill_entry entries[MEMORY_TENSOR_SPILL_MAX_ENTRIES];
+    size_t n_entries;
+
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct tensor_spill_job jobs[MEMORY_TENSOR_SPILL_MAX_ENTRIES];
+    size_t jobs_head;
+    size_t jobs_size;
+    size_t pending;
+    bool stop;
+};
+
+/**
+ * @brief Creates the scratch file in dir and starts the writeback worker.
+ *
+ * The file is unlinked right after creation, so that it disappears with the process.
+ *
+ * @param store Pointer to the store to initialize.
+ * @param dir Directory of the scratch file, preferably on a local disk.
+ * @param capacity Size in bytes of the scratch file.
+ * @param threshold Minimum size in bytes of the tensors to offload.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success.
+ *         - TENSOR_SPILL_STORE_NULL if store is NULL.
+ *         - TENSOR_SPILL_FILE_ERROR if the scratch file cannot be created or mapped.
+ */
+cgrad_error tensor_spill_store_init(struct tensor_spill_store *const store, const char *const dir, const size_t capacity, const size_t threshold);
+
+/**
+ * @brief Enables the spill policy of a tensor allocator.
+ */
+cgrad_error tensor_spill_store_attach(struct tensor_spill_store *const store, struct tensor_allocator *const tensor_alloc);
+
+/**
+ * @brief Moves the data of t to the scratch file and releases its buffer.
+ *
+ * Afterwards the data of t is NULL until tensor_spill_store_restore is called.
+ *
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success.
+ *         - TENSOR_SPILL_STORE_FULL if the scratch file or the entry table is full.
+ */
+cgrad_error tensor_spill_store_offload(struct tensor_spill_store *const store, struct tensor *const t, struct tensor_allocator *const tensor_alloc);
+
+/**
+ * @brief Brings the data of an offloaded tensor back into a buffer of tensor_alloc.
+ *
+ * @return cgrad_error Error code indicating success or failure.
+ *         - NO_ERROR on success.
+ *         - TENSOR_SPILL_ENTRY_NOT_FOUND if t was not offloaded.
+ */
+cgrad_error tensor_spill_store_restore(struct tensor_spill_store *const store, struct tensor *const t, struct tensor_allocator *const tensor_alloc);
+
+/**
+ * @brief Restores every offloaded tensor saved in a backpropagation context.
+ */
+cgrad_error tensor_spill_store_restore_context(struct tensor_spill_store *const store, const struct backpropagation_context *const ctx, struct tensor_allocator *const tensor_alloc);
+
+/**
+ * @brief Waits for the pending writebacks, stops the worker and removes the scratch file.
+ */
+void tensor_spill_store_cleanup(struct tensor_spill_store *const store);
+
+#endif
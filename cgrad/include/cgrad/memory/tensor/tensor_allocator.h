@@ -4,11 +4,15 @@
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/dtypes.h"
 #include "cgrad/error.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 typedef struct tensor *(*alloc_fn)(void*, const size_t *const, const size_t, const cgrad_dtype);
 typedef void (*free_fn)(void*, struct tensor*);
 typedef struct tensor *(*clone_fn)(void*, const struct tensor *const);
+typedef cgrad_error (*alloc_data_fn)(void*, struct tensor*);
+
+struct tensor_spill_store;
 
 struct tensor_allocator
 {
@@ -17,15 +21,28 @@ struct tensor_allocator
     alloc_fn no_grad_zero_alloc;
     free_fn free;
     free_fn no_grad_free;
+    free_fn free_data;
+    alloc_data_fn alloc_data;
     clone_fn clone;
     void *pool;
+    struct tensor_spill_store *spill; /**< Optional store where saved tensors are offloaded, NULL if disabled. */
 };
 
+/**
+ * Spill policy hook, defined with the spill store. Called when a reference to t is dropped, is_owner
+ * telling whether it is the reference of its owner rather than one held by the autograd machinery.
+ */
+void tensor_spill_store_on_free(struct tensor_spill_store *const store, struct tensor *const t, struct tensor_allocator *const tensor_alloc, const bool is_owner);
+
 static inline struct tensor *tensor_allocator_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype);
 static inline struct tensor *tensor_allocator_no_grad_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype);
 static inline struct tensor *tensor_allocator_no_grad_zero_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype);
+static inline struct tensor *tensor_allocator_result_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype, const bool requires_grad);
 static inline void tensor_allocator_free(struct tensor_allocator *allocator, struct tensor *ptr);
+static inline void tensor_allocator_release(struct tensor_allocator *allocator, struct tensor *ptr);
 static inline void tensor_allocator_no_grad_free(struct tensor_allocator *allocator, struct tensor *ptr);
+static inline void tensor_allocator_free_data(struct tensor_allocator *allocator, struct tensor *ptr);
+static inline cgrad_error tensor_allocator_alloc_data(struct tensor_allocator *allocator, struct tensor *ptr);
 static inline struct tensor* tensor_allocator_clone(struct tensor_allocator *allocator, struct tensor *src);
 
 static inline struct tensor *tensor_allocator_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype)
@@ -43,8 +60,34 @@ static inline struct tensor *tensor_allocator_no_grad_zero_alloc(struct tensor_a
     return allocator->no_grad_zero_alloc(allocator->pool, shape, shape_size, dtype);
 }
 
+/**
+ * Allocates the result of an operation, with a gradient only if requires_grad. Results that no
+ * gradient flows to, e.g. of untracked operations or of operations on data, skip the gradient buffer.
+ */
+static inline struct tensor *tensor_allocator_result_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype, const bool requires_grad)
+{
+    return requires_grad ? tensor_allocator_alloc(allocator, shape, shape_size, dtype) : tensor_allocator_no_grad_alloc(allocator, shape, shape_size, dtype);
+}
+
 static inline void tensor_allocator_free(struct tensor_allocator *allocator, struct tensor *ptr)
 {
+    if (allocator->spill && ptr)
+    {
+        tensor_spill_store_on_free(allocator->spill, ptr, allocator, true);
+    }
+    allocator->free(allocator->pool, ptr);
+}
+
+/**
+ * Drops a reference held by a graph node, a tape or a context that saved the tensor. Unlike
+ * tensor_allocator_free, it never spills the tensor, whose owner may still use its data.
+ */
+static inline void tensor_allocator_release(struct tensor_allocator *allocator, struct tensor *ptr)
+{
+    if (allocator->spill && ptr)
+    {
+        tensor_spill_store_on_free(allocator->spill, ptr, allocator, false);
+    }
     allocator->free(allocator->pool, ptr);
 }
 
@@ -53,6 +96,24 @@ static inline void tensor_allocator_no_grad_free(struct tensor_allocator *alloca
     allocator->no_grad_free(allocator->pool, ptr);
 }
 
+/**
+ * Releases only the data buffer of the tensor, leaving the tensor itself, its gradient and
+ * its computational graph node in place. Afterwards data is NULL.
+ */
+static inline void tensor_allocator_free_data(struct tensor_allocator *allocator, struct tensor *ptr)
+{
+    allocator->free_data(allocator->pool, ptr);
+}
+
+/**
+ * Allocates a new data buffer for a tensor whose data was released, sized after its shape and dtype.
+ * The content of the buffer is undefined.
+ */
+static inline cgrad_error tensor_allocator_alloc_data(struct tensor_allocator *allocator, struct tensor *ptr)
+{
+    return allocator->alloc_data(allocator->pool, ptr);
+}
+
 static inline struct tensor* tensor_allocator_clone(struct tensor_allocator *allocator, struct tensor *src)
 {
     return allocator->clone(allocator->pool, src);
@@ -0,0 +1,136 @@
+#ifndef MODEL_CHECKPOINT_H
+#define MODEL_CHECKPOINT_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MODEL_CHECKPOINT_MAGIC "CGRADCKP"
+#define MODEL_CHECKPOINT_VERSION 1
+
+/**
+ * @struct model_checkpoint_header
+ * @brief First bytes of a checkpoint file.
+ *
+ * A checkpoint is the header, followed by a directory of n_tensors entries, followed by the payloads.
+ * Every payload starts at a MODEL_CHECKPOINT_ALIGNMENT aligned offset, so that once the file is mapped
+ * tensors use their payloads in place. Integers are stored in the byte order of the host, i.e. little
+ * endian on every supported platform.
+ */
+struct model_checkpoint_header
+{
+    char magic[8];      /**< MODEL_CHECKPOINT_MAGIC, without the terminator. */
+    uint32_t version;
+    uint32_t n_tensors;
+    uint64_t file_size; /**< Size in bytes of the whole file, padding included. */
+};
+
+/**
+ * @struct model_checkpoint_entry
+ * @brief Directory entry describing a tensor of a checkpoint.
+ */
+struct model_checkpoint_entry
+{
+    uint64_t offset;    /**< Offset in bytes of the payload from the start of the file. */
+    uint64_t data_size; /**< Number of elements of the tensor. */
+    uint32_t dtype;
+    uint32_t shape_size;
+    uint64_t shape[TENSOR_MAX_SHAPE_SIZE];
+};
+
+/**
+ * @struct model_checkpoint
+ * @brief Checkpoint file mapped in memory.
+ */
+struct model_checkpoint
+{
+    void *map;
+    size_t map_size;
+    size_t n_tensors;
+    const struct model_checkpoint_entry *entries;
+};
+
+/**
+ * @brief Writes tensors to a checkpoint file, in order.
+ *
+ * The file is written next to path and renamed once synced, so that path always holds a complete
+ * checkpoint, either the previous one or the new one.
+ *
+ * @param tensors Tensors to write, with data.
+ * @param n_tensors Number of tensors.
+ * @param path Path of the checkpoint file.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - MODEL_CHECKPOINT_FILE_ERROR if the file could not be written.
+ */
+cgrad_error model_checkpoint_save_tensors(struct tensor *const *const tensors, const size_t n_tensors, const char *const path);
+
+/**
+ * @brief Writes the parameters to a checkpoint file, in the order they were added.
+ */
+cgrad_error model_checkpoint_save(const struct model_params *const params, const char *const path);
+
+/**
+ * @brief Size in bytes of the checkpoint of the tensors, i.e. of its file and of its image in memory.
+ */
+cgrad_error model_checkpoint_image_size(struct tensor *const *const tensors, const size_t n_tensors, size_t *const size);
+
+/**
+ * @brief Lays out the checkpoint of the tensors in memory, byte for byte as model_checkpoint_save_tensors
+ * would write it, so that the tensors may change while the image is written.
+ *
+ * @param image Buffer of at least model_checkpoint_image_size bytes, at least 8-byte aligned.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - MODEL_CHECKPOINT_MISMATCH if image_size is too small.
+ */
+cgrad_error model_checkpoint_serialize(struct tensor *const *const tensors, const size_t n_tensors, void *const image, const size_t image_size);
+
+/**
+ * @brief Writes an image from model_checkpoint_serialize to a checkpoint file, replacing it atomically
+ * as model_checkpoint_save_tensors does.
+ */
+cgrad_error model_checkpoint_write_image(const void *const image, const size_t image_size, const char *const path);
+
+/**
+ * @brief Maps a checkpoint file and validates its directory. Payloads are read lazily by the page cache.
+ *
+ * Read-only checkpoints are mapped shared, so that processes opening the same file share a single
+ * physical copy of the payloads. Writable checkpoints are mapped private: pages are copied on the
+ * first write, e.g. by an optimizer step, and writes never reach the file.
+ *
+ * @param ckpt Checkpoint to open.
+ * @param path Path of the checkpoint file.
+ * @param is_writable Whether the tensors loaded from the checkpoint may be modified.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - MODEL_CHECKPOINT_FILE_ERROR if the file could not be mapped.
+ *         - MODEL_CHECKPOINT_FORMAT_ERROR if the file is not a valid checkpoint.
+ */
+cgrad_error model_checkpoint_open(struct model_checkpoint *const ckpt, const char *const path, const bool is_writable);
+
+/**
+ * @brief Makes the data of the parameters point to the payloads of the first params->size tensors of
+ * the checkpoint, without copying.
+ *
+ * Parameters become views on the mapping, their former buffers go back to tensor_alloc, and the
+ * checkpoint must stay open as long as they are used. Flat parameters keep their buffer, payloads are
+ * copied into it instead.
+ *
+ * @param ckpt Open checkpoint.
+ * @param params Parameters to load, in the order they were saved.
+ * @param tensor_alloc Allocator of the parameters.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - MODEL_CHECKPOINT_MISMATCH if the checkpoint has too few tensors, or tensors of a different
+ *           shape or dtype than the parameters.
+ */
+cgrad_error model_checkpoint_load(const struct model_checkpoint *const ckpt, struct model_params *const params, struct tensor_allocator *const tensor_alloc);
+
+/**
+ * @brief Unmaps the checkpoint. Tensors loaded from it must not be used afterwards.
+ */
+void model_checkpoint_close(struct model_checkpoint *const ckpt);
+
+#endif
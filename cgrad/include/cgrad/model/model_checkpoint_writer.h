@@ -0,0 +1,67 @@
+#ifndef MODEL_CHECKPOINT_WRITER_H
+#define MODEL_CHECKPOINT_WRITER_H
+
+#include "cgrad/model/model_checkpoint.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct model_checkpoint_writer
+ * @brief Writes checkpoints in the background while training goes on.
+ *
+ * A snapshot copies the tensors into a staging image between two steps, which takes as long as a
+ * memcpy of the model. A worker thread then writes the image to disk and syncs it, the slow part,
+ * while the next steps update the tensors. A single image is staged: a snapshot taken while the
+ * previous one is still being written waits for it, so that checkpoints are never dropped and memory
+ * stays bounded by one extra copy of the tensors.
+ */
+struct model_checkpoint_writer
+{
+    void *staging;                          /**< Image of the checkpoint being written, MODEL_CHECKPOINT_ALIGNMENT aligned. */
+    size_t staging_capacity;
+    size_t staging_size;
+    char path[MODEL_CHECKPOINT_MAX_PATH];
+
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool is_pending;                        /**< Whether the staging image waits to be written or is being written. */
+    bool stop;
+    cgrad_error error;                      /**< First failure of a write since the last model_checkpoint_writer_wait. */
+};
+
+cgrad_error model_checkpoint_writer_init(struct model_checkpoint_writer *const writer);
+
+/**
+ * @brief Copies the tensors into the staging image and hands it to the worker, to be written to path.
+ *
+ * Returns once the copy is done, the tensors may then change. Waits first for the previous checkpoint
+ * to be written, if it still is.
+ *
+ * @param writer Pointer to the writer.
+ * @param tensors Tensors to checkpoint, e.g. the parameters followed by the optimizer states.
+ * @param n_tensors Number of tensors.
+ * @param path Path of the checkpoint file, replaced atomically once written.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - MODEL_CHECKPOINT_FILE_ERROR if a previous write failed, the snapshot is then not taken.
+ *         - MODEL_CHECKPOINT_ALLOCATION_FAILED if the staging image could not grow.
+ */
+cgrad_error model_checkpoint_writer_snapshot(struct model_checkpoint_writer *const writer, struct tensor *const *const tensors, const size_t n_tensors, const char *const path);
+
+/**
+ * @brief Waits for the pending checkpoint to be on disk.
+ *
+ * @return cgrad_error The first failure of a write since the last call, which is cleared, NO_ERROR otherwise.
+ */
+cgrad_error model_checkpoint_writer_wait(struct model_checkpoint_writer *const writer);
+
+/**
+ * @brief Waits for the pending checkpoint, stops the worker and frees the staging image.
+ */
+void model_checkpoint_writer_cleanup(struct model_checkpoint_writer *const writer);
+
+#endif
@@ -2,26 +2,85 @@
 #define MODEL_PARAMS_H
 
 #include "cgrad/tensor/tensor.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
 #include "cgrad/config.h"
 #include <string.h>
 
+/**
+ * @struct model_params
+ * @brief Parameters of a model.
+ *
+ * Parameters are independent tensors until model_params_flatten moves all of them into one contiguous
+ * buffer, and all of their gradients into another one. The tensors then become views on the buffers,
+ * so that whole-model operations (zeroing the gradients, optimizer steps) run as one large operation.
+ */
 struct model_params
 {
     struct tensor *params[MODEL_MAX_PARAMS];
     size_t size;
+    void *flat_data;                          /**< Buffer of every parameter once flattened, NULL otherwise. */
+    void *flat_grad;                          /**< Buffer of every gradient once flattened, NULL otherwise. */
+    size_t flat_size;                         /**< Number of elements of each flat buffer, padding included. */
+    size_t flat_offsets[MODEL_MAX_PARAMS];    /**< Offset in elements of each parameter in the flat buffers. */
+    cgrad_dtype flat_dtype;
 };
 
 void model_params_init(struct model_params *const params);
 cgrad_error add_model_param(struct model_params *const params, struct tensor *const t);
+
+/**
+ * @brief Moves the parameters and their gradients into two contiguous buffers.
+ *
+ * Each parameter starts at a MODEL_PARAMS_FLAT_ALIGNMENT aligned offset, padding is zero. Values are
+ * preserved. Parameters must share a dtype, and must be flattened before creating the optimizers.
+ *
+ * @param params Pointer to the parameters.
+ * @param tensor_alloc Allocator of the parameters, which gets their former buffers back.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - MODEL_PARAMS_ALREADY_FLAT if the parameters were already flattened.
+ *         - TENSOR_DTYPE_MISMATCH if the parameters do not share a dtype.
+ */
+cgrad_error model_params_flatten(struct model_params *const params, struct tensor_allocator *const tensor_alloc);
+static inline bool model_params_is_flat(const struct model_params *const params);
+
+/**
+ * @brief Allocates a zeroed buffer laid out as the flat buffers, e.g. for optimizer states. Released with free.
+ *
+ * @param params Pointer to the flat parameters.
+ * @param dtype Dtype of the elements of the buffer, which may differ from the dtype of the parameters,
+ *        e.g. for float32 states of bfloat16 parameters. Offsets in elements are the same.
+ * @return void* The buffer, NULL if the parameters are not flat or on allocation failure.
+ */
+void *model_params_alloc_flat_buffer(const struct model_params *const params, const cgrad_dtype dtype);
+
+/**
+ * @brief Frees the flat buffers. The parameters must not be used afterwards.
+ */
+void model_params_cleanup(struct model_params *const params);
 static inline void zero_grad(struct model_params *const params);
 
+static inline bool model_params_is_flat(const struct model_params *const params)
+{
+    return params->flat_data != NULL;
+}
+
 static inline void zero_grad(struct model_params *const params)
 {
+    if (model_params_is_flat(params))
+    {
+        memset(params->flat_grad, 0, params->flat_size * dtype_sizeof(params->flat_dtype));
+        return;
+    }
+
     for (size_t i = 0; i < params->size; i++)
     {
         struct tensor *grad = params->params[i]->grad;
-        memset(grad->data, 0, grad->data_size * sizeof(double));
+        if (!grad)
+        {
+            continue;
+        }
+        memset(grad->data, 0, grad->data_size * dtype_sizeof(grad->dtype));
     }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,59 @@
+#ifndef ADAM_H
+#define ADAM_H
+
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/optimizers/quantized_state.h"
+
+/**
+ * @struct adam_optimizer
+ * @brief Adam optimizer, AdamW when the weight decay is decoupled.
+ *
+ * Moments are float64 for float64 parameters and float32 otherwise. bfloat16 parameters are updated
+ * through a float32 master copy, which the optimizer owns and rounds back into the parameters after
+ * each step, so that small updates are not lost to the 8-bit mantissa.
+ */
+struct adam_optimizer
+{
+    size_t size;
+    struct model_params *params;
+    struct tensor *first_moments[MODEL_MAX_PARAMS];  /**< NULL for flat parameters. */
+    struct tensor *second_moments[MODEL_MAX_PARAMS]; /**< NULL for flat parameters. */
+    struct tensor *master_params[MODEL_MAX_PARAMS];  /**< float32 copy of bfloat16 parameters, NULL otherwise or for flat parameters. */
+    void *flat_first_moment;                         /**< Moments laid out as the flat buffers of flat parameters, NULL otherwise. */
+    void *flat_second_moment;
+    float *flat_master_params;                       /**< float32 copy of flat bfloat16 parameters, NULL otherwise. */
+    struct quantized_state quantized_first_moments[MODEL_MAX_PARAMS];  /**< Moments of 8-bit optimizers, which have no other moments. */
+    struct quantized_state quantized_second_moments[MODEL_MAX_PARAMS];
+    bool is_quantized;
+    double beta1;
+    double beta2;
+    double eps;
+    double weight_decay;                             /**< 0 after init. */
+    double grad_scale;                               /**< Factor of the gradients, e.g. from grad_clip_global_norm, 1 after init. */
+    bool decoupled_weight_decay;                     /**< Decays the parameters directly (AdamW) instead of adding an L2 penalty to the gradients. true after init. */
+    size_t step_count;
+    struct tensor_allocator *allocator;
+};
+
+cgrad_error adam_optimizer_init(struct adam_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator);
+
+/**
+ * @brief Same as adam_optimizer_init, but stores both moments on 8 bits per element, in blocks with
+ * their own scale (see quantized_state), i.e. a quarter of the float32 memory. Blocks are decoded and
+ * encoded back inside the fused update, which sweeps the parameters one at a time.
+ */
+cgrad_error adam_optimizer_init_8bit(struct adam_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator);
+
+/**
+ * @brief Updates every trainable parameter.
+ *
+ * Gradient scaling, weight decay, both moments, bias correction and the update are computed by a single fused kernel,
+ * in one read-modify-write pass over each parameter, gradient and moment, and the parameters are swept
+ * together by multi_tensor_apply, as a single buffer if they were flattened. Nothing is allocated.
+ */
+cgrad_error adam_optimizer_step(struct adam_optimizer *opt, double lr);
+void adam_optimizer_cleanup(struct adam_optimizer *opt);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef GRAD_CLIP_H
+#define GRAD_CLIP_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/error.h"
+
+/**
+ * @brief Computes the L2 norm of the gradients of all trainable parameters, seen as a single vector.
+ *
+ * The squares are summed in one parallel, vectorized sweep of multi_tensor_apply. Each chunk writes its
+ * partial sum to its own slot and slots are added in order, so that the result does not depend on the
+ * number of threads.
+ *
+ * @param params Pointer to the parameters.
+ * @param norm Output norm.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error model_params_grad_norm(const struct model_params *const params, double *const norm);
+
+/**
+ * @brief Computes the factor that clips the global norm of the gradients to max_norm.
+ *
+ * Gradients are left untouched: the factor is meant for the grad_scale of the optimizers, which fold it
+ * into their update kernels instead of running a separate scaling pass.
+ *
+ * @param params Pointer to the parameters.
+ * @param max_norm Largest global norm of the gradients.
+ * @param scale Output factor, 1 if the norm does not exceed max_norm, max_norm / norm otherwise.
+ * @param norm Output norm before clipping, ignored if NULL.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error grad_clip_global_norm(const struct model_params *const params, const double max_norm, double *const scale, double *const norm);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LAMB_H
+#define LAMB_H
+
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/optimizers/multi_tensor.h"
+
+/**
+ * @struct lamb_optimizer
+ * @brief Adam with layer-wise adaptive trust ratios, for very large batches.
+ *
+ * Each parameter takes the Adam direction with decoupled weight decay
+ *   r = m_hat / (sqrt(v_hat) + eps) + weight_decay * w
+ * rescaled by its own trust ratio ||w|| / ||r|| (1 if either norm is zero):
+ *   w <- w - lr * trust * r
+ */
+struct lamb_optimizer
+{
+    size_t size;
+    struct model_params *params;
+    struct tensor *first_moments[MODEL_MAX_PARAMS];  /**< NULL for flat parameters. */
+    struct tensor *second_moments[MODEL_MAX_PARAMS]; /**< NULL for flat parameters. */
+    void *flat_first_moment;                         /**< Moments laid out as the flat buffers of flat parameters, NULL otherwise. */
+    void *flat_second_moment;
+    double beta1;
+    double beta2;
+    double eps;
+    double weight_decay;                             /**< 0 after init. */
+    double grad_scale;                               /**< Factor of the gradients, e.g. from grad_clip_global_norm, 1 after init. */
+    size_t step_count;
+    struct multi_tensor_slots slots;
+    double *partial_sums;                            /**< Squared norms of the weights and of the updates of each chunk, two per slot. */
+    size_t partial_sums_capacity;
+    double trust_ratios[MODEL_MAX_PARAMS];
+    struct tensor_allocator *allocator;
+};
+
+cgrad_error lamb_optimizer_init(struct lamb_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator);
+
+/**
+ * @brief Updates every trainable parameter.
+ *
+ * A first sweep updates both moments and reduces the norms of the weights and of the Adam directions
+ * of every chunk in parallel, in one pass, into slots that are summed per parameter into its trust
+ * ratio. A second sweep recomputes the directions from the moments, which is cheaper than storing
+ * them, and applies the update. Both sweep the parameters one at a time through
+ * multi_tensor_apply_per_param. Nothing is allocated, unless parameters were unfrozen since the
+ * previous step.
+ */
+cgrad_error lamb_optimizer_step(struct lamb_optimizer *opt, double lr);
+void lamb_optimizer_cleanup(struct lamb_optimizer *opt);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LARS_H
+#define LARS_H
+
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/optimizers/multi_tensor.h"
+
+/**
+ * @struct lars_optimizer
+ * @brief SGD with momentum and layer-wise adaptive rate scaling, for very large batches.
+ *
+ * Each parameter gets its own trust ratio
+ *   trust = trust_coefficient * ||w|| / (||g|| + weight_decay * ||w|| + eps)
+ * (1 if either norm is zero), which scales its gradient before the momentum update:
+ *   g <- trust * (grad_scale * grad + weight_decay * w)
+ *   b <- momentum * b + g
+ *   w <- w - lr * b
+ */
+struct lars_optimizer
+{
+    size_t size;
+    struct model_params *params;
+    struct tensor *momentum_buffers[MODEL_MAX_PARAMS]; /**< NULL for flat parameters. */
+    void *flat_momentum;                               /**< Momentum laid out as the flat buffers of flat parameters, NULL otherwise. */
+    double trust_coefficient;
+    double weight_decay;                               /**< 0 after init. */
+    double eps;                                        /**< 1e-8 after init. */
+    double grad_scale;                                 /**< Factor of the gradients, e.g. from grad_clip_global_norm, 1 after init. */
+    struct multi_tensor_slots slots;
+    double *partial_sums;                              /**< Squared norms of the weights and of the gradients of each chunk, two per slot. */
+    size_t partial_sums_capacity;
+    double trust_ratios[MODEL_MAX_PARAMS];
+    struct tensor_allocator *allocator;
+};
+
+cgrad_error lars_optimizer_init(struct lars_optimizer *opt, struct model_params *const params, const double trust_coefficient, struct tensor_allocator *allocator);
+
+/**
+ * @brief Updates every trainable parameter.
+ *
+ * A first sweep reduces the norms of the weights and of the gradients of every chunk in parallel, in one
+ * pass, into slots that are summed per parameter into its trust ratio. A second sweep applies the fused
+ * update. Both sweep the parameters one at a time through multi_tensor_apply_per_param, so that
+ * the cost is two passes over the parameters whatever the number of tensors. Nothing is allocated,
+ * unless parameters were unfrozen since the previous step.
+ */
+cgrad_error lars_optimizer_step(struct lars_optimizer *opt, double lr, double momentum);
+void lars_optimizer_cleanup(struct lars_optimizer *opt);
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef MULTI_TENSOR_H
+#define MULTI_TENSOR_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Parameter index of the chunks of a flat sweep, whose ranges refer to the flat buffers.
+ */
+#define MULTI_TENSOR_FLAT SIZE_MAX
+
+/**
+ * @brief Processes the elements [start, end) of the parameter of index param_index, or of the flat
+ * buffers of the parameters if param_index is MULTI_TENSOR_FLAT.
+ */
+typedef void (*multi_tensor_chunk_fn)(void *args, const size_t param_index, const size_t start, const size_t end);
+
+/**
+ * @brief Applies a kernel to every trainable parameter in a single sweep.
+ *
+ * The elements of all parameters that require grad and have a gradient are split in chunks of
+ * OPTIMIZER_CHUNK_SIZE elements, shared among up to OPTIMIZER_MAX_THREADS threads. The calling thread
+ * sweeps with a pool of threads started by the first sweep and reused by the next ones. Small models,
+ * below OPTIMIZER_PARALLEL_MIN_SIZE elements, and sweeps started while another thread sweeps, are
+ * swept by the calling thread alone. Chunks are
+ * disjoint, so that kernels updating their own range need no synchronization.
+ *
+ * Flattened parameters that are all trainable are swept as a whole, through their flat buffers, padding
+ * included. Padding is zero in the parameters and their gradients, kernels must keep it that way.
+ *
+ * @param params Pointer to the parameters.
+ * @param fn Kernel called on each chunk.
+ * @param args Arguments forwarded to the kernel.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error multi_tensor_apply(const struct model_params *const params, const multi_tensor_chunk_fn fn, void *const args);
+
+/**
+ * @brief Same as multi_tensor_apply, but always sweeps one parameter at a time, so that every chunk
+ * starts at a multiple of OPTIMIZER_CHUNK_SIZE within its parameter, e.g. for states stored in blocks.
+ */
+cgrad_error multi_tensor_apply_per_param(const struct model_params *const params, const multi_tensor_chunk_fn fn, void *const args);
+
+/**
+ * @struct multi_tensor_slots
+ * @brief One slot per chunk of a sweep, for kernels that reduce each chunk into its own slot.
+ *
+ * Slots of a parameter are contiguous and in order, so that summing them in order gives results that
+ * do not depend on the number of threads. size covers both flat and per-parameter sweeps.
+ */
+struct multi_tensor_slots
+{
+    size_t offsets[MODEL_MAX_PARAMS]; /**< Slot of the first chunk of each parameter. */
+    size_t size;
+};
+
+void multi_tensor_slots_init(struct multi_tensor_slots *const slots, const struct model_params *const params);
+
+/**
+ * @brief Sums, in order, the slots of each trainable parameter of a per-parameter sweep.
+ *
+ * @param slots Pointer to the slots.
+ * @param params Pointer to the parameters.
+ * @param partial_sums Values of the slots, width consecutive values per slot.
+ * @param width Number of values per slot.
+ * @param out Sums, width consecutive values per parameter. Frozen parameters get zeros.
+ */
+void multi_tensor_slots_sum_per_param(const struct multi_tensor_slots *const slots, const struct model_params *const params, const double *const partial_sums, const size_t width, double *const out);
+static inline size_t multi_tensor_slot(const struct multi_tensor_slots *const slots, const size_t param_index, const size_t start);
+
+static inline size_t multi_tensor_slot(const struct multi_tensor_slots *const slots, const size_t param_index, const size_t start)
+{
+    const size_t offset = param_index == MULTI_TENSOR_FLAT ? 0 : slots->offsets[param_index];
+    return offset + start / OPTIMIZER_CHUNK_SIZE;
+}
+
+#endif
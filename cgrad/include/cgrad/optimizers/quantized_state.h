@@ -0,0 +1,51 @@
+#ifndef QUANTIZED_STATE_H
+#define QUANTIZED_STATE_H
+
+#include "cgrad/error.h"
+#include "cgrad/config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct quantized_state
+ * @brief Optimizer state of one parameter, stored on 8 bits per element.
+ *
+ * Elements are split in blocks of OPTIMIZER_STATE_BLOCK_SIZE, each with a float scale, the largest
+ * magnitude of the block. Codes are companded so that small values keep some precision next to large
+ * ones: a signed state (e.g. momentum) stores x = scale * c * |c| with c = code / 127, an unsigned one
+ * (e.g. a second moment) stores x = scale * c^4 with c = code / 255, so that its square root is
+ * quantized quadratically.
+ */
+struct quantized_state
+{
+    uint8_t *codes;
+    float *scales;
+    size_t size;
+    bool is_signed;
+};
+
+/**
+ * @brief Allocates a zero state of size elements.
+ *
+ * @return cgrad_error Error code indicating success or failure.
+ *         - OPTIMIZER_STATE_ALLOCATION_FAILED on allocation failure.
+ */
+cgrad_error quantized_state_init(struct quantized_state *const state, const size_t size, const bool is_signed);
+void quantized_state_cleanup(struct quantized_state *const state);
+
+/**
+ * @brief Decodes the elements [start, start + size) of the state. start must be a multiple of
+ * OPTIMIZER_STATE_BLOCK_SIZE and size at most OPTIMIZER_STATE_BLOCK_SIZE, i.e. a single block.
+ */
+void quantized_state_load_block_f32(const struct quantized_state *const state, const size_t start, const size_t size, float *const out);
+void quantized_state_load_block_f64(const struct quantized_state *const state, const size_t start, const size_t size, double *const out);
+
+/**
+ * @brief Encodes the elements [start, start + size) of the state, a single block as for loading,
+ * rescaling the block to its new largest magnitude.
+ */
+void quantized_state_store_block_f32(struct quantized_state *const state, const size_t start, const size_t size, const float *const in);
+void quantized_state_store_block_f64(struct quantized_state *const state, const size_t start, const size_t size, const double *const in);
+
+#endif
@@ -4,17 +4,38 @@
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/model/model_params.h"
 #include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/optimizers/quantized_state.h"
 
 struct sgd_optimizer
 {
     size_t size;
     struct model_params *params;
-    struct tensor *prev_b_t[MODEL_MAX_PARAMS];
+    struct tensor *momentum_buffers[MODEL_MAX_PARAMS]; /**< Momentum of each parameter, updated in place. NULL for flat parameters. */
+    void *flat_momentum;                               /**< Momentum laid out as the flat buffers of flat parameters, NULL otherwise. */
+    struct quantized_state quantized_momentum_buffers[MODEL_MAX_PARAMS]; /**< Momentum of 8-bit optimizers, which have no other momentum. */
+    bool is_quantized;
+    double weight_decay;                               /**< L2 penalty added to the gradients, 0 after init. */
+    double grad_scale;                                 /**< Factor of the gradients, e.g. from grad_clip_global_norm, 1 after init. */
     struct tensor_allocator *allocator;
 };
 
+/**
+ * @brief Updates every trainable parameter.
+ *
+ * Gradient scaling, momentum, the Nesterov correction, weight decay and the update are computed by a single fused
+ * kernel, in one read-modify-write pass over each parameter, gradient and momentum buffer, and the
+ * parameters are swept together by multi_tensor_apply, as a single buffer if they were flattened.
+ * Nothing is allocated.
+ */
 cgrad_error sgd_optimizer_step(struct sgd_optimizer* opt, double lr, double momentum, bool nesterov);
 cgrad_error sgd_optimizer_init(struct sgd_optimizer *opt, struct model_params *const params, struct tensor_allocator *allocator);
+
+/**
+ * @brief Same as sgd_optimizer_init, but stores the momentum on 8 bits per element, in blocks with their
+ * own scale (see quantized_state). Blocks are decoded and encoded back inside the fused update, which
+ * sweeps the parameters one at a time.
+ */
+cgrad_error sgd_optimizer_init_8bit(struct sgd_optimizer *opt, struct model_params *const params, struct tensor_allocator *allocator);
 void sgd_optimizer_cleanup(struct sgd_optimizer *opt);
 
-#endif
\ No newline at end of file
+#endif
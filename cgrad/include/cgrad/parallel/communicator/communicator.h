@@ -0,0 +1,86 @@
+#ifndef COMMUNICATOR_H
+#define COMMUNICATOR_H
+
+#include "cgrad/dtypes.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+typedef cgrad_error (*communicator_all_reduce_fn)(void *, void *const, const size_t, const cgrad_dtype);
+typedef cgrad_error (*communicator_all_gather_fn)(void *, void *const, const size_t);
+typedef cgrad_error (*communicator_barrier_fn)(void *);
+typedef void (*communicator_cleanup_fn)(void *);
+
+/**
+ * @struct communicator
+ * @brief Collective operations among the ranks of a multi-process run, whatever the transport.
+ *
+ * Every rank must call the same collectives, in the same order, with the same sizes.
+ */
+struct communicator
+{
+    size_t rank;
+    size_t world_size;
+    communicator_all_reduce_fn all_reduce;
+    communicator_all_gather_fn all_gather;
+    communicator_barrier_fn barrier;
+    communicator_cleanup_fn cleanup;
+    void *state;
+};
+
+static inline cgrad_error communicator_all_reduce(struct communicator *const comm, void *const data, const size_t size, const cgrad_dtype dtype);
+static inline cgrad_error communicator_all_gather(struct communicator *const comm, void *const data, const size_t size);
+static inline cgrad_error communicator_barrier(struct communicator *const comm);
+static inline void communicator_cleanup(struct communicator *const comm);
+
+/**
+ * @brief Replaces size elements of data, on every rank, by their sum over all the ranks.
+ *
+ * Every rank gets the same bits: each element is summed once, in an order that does not depend on the rank.
+ */
+static inline cgrad_error communicator_all_reduce(struct communicator *const comm, void *const data, const size_t size, const cgrad_dtype dtype)
+{
+    if (!comm)
+    {
+        return COMMUNICATOR_NULL;
+    }
+
+    return comm->all_reduce(comm->state, data, size, dtype);
+}
+
+/**
+ * @brief Gathers a block of size bytes from every rank, in place. data holds world_size blocks, and the
+ * block of each rank, at offset rank * size, is filled before the call. Used to exchange data that
+ * cannot be summed as it is sent, e.g. compressed gradients.
+ */
+static inline cgrad_error communicator_all_gather(struct communicator *const comm, void *const data, const size_t size)
+{
+    if (!comm)
+    {
+        return COMMUNICATOR_NULL;
+    }
+
+    return comm->all_gather(comm->state, data, size);
+}
+
+static inline cgrad_error communicator_barrier(struct communicator *const comm)
+{
+    if (!comm)
+    {
+        return COMMUNICATOR_NULL;
+    }
+
+    return comm->barrier(comm->state);
+}
+
+static inline void communicator_cleanup(struct communicator *const comm)
+{
+    if (!comm || !comm->state)
+    {
+        return;
+    }
+
+    comm->cleanup(comm->state);
+    comm->state = NULL;
+}
+
+#endif
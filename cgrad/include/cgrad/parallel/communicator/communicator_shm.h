@@ -0,0 +1,26 @@
+#ifndef COMMUNICATOR_SHM_H
+#define COMMUNICATOR_SHM_H
+
+#include "cgrad/parallel/communicator/communicator.h"
+
+/**
+ * @brief Joins the ranks of one machine through a POSIX shared-memory region.
+ *
+ * The region holds a slot of COMMUNICATOR_CHUNK_SIZE bytes per rank. All-reduces go one chunk at a time:
+ * every rank copies its chunk into its slot, reduces its own segment of the chunk over all the slots
+ * (reduce-scatter), then copies back the whole reduced chunk (all-gather). Ranks synchronize through
+ * atomic counters in the region, without system calls.
+ *
+ * The name is unlinked once every rank is attached, so that nothing is left behind. It must be unique to
+ * the run, e.g. derived from the pid of the launcher, since a stale region would not be reset.
+ *
+ * @param comm Pointer to the communicator.
+ * @param name Name of the region, starting with a slash, shared by all the ranks.
+ * @param rank Rank of the calling process, below world_size.
+ * @param world_size Number of ranks.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - COMMUNICATOR_SHARED_MEMORY_FAILED if the region cannot be created or mapped.
+ */
+cgrad_error communicator_shm_init(struct communicator *const comm, const char *const name, const size_t rank, const size_t world_size);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef COMMUNICATOR_TCP_H
+#define COMMUNICATOR_TCP_H
+
+#include "cgrad/parallel/communicator/communicator.h"
+#include <stdint.h>
+
+/**
+ * @brief Joins the ranks in a ring of TCP connections, each rank sending to the next one.
+ *
+ * All-reduces are ring all-reduces over chunks of COMMUNICATOR_CHUNK_SIZE bytes: each chunk is split in
+ * one segment per rank, and world_size - 1 steps of reduce-scatter are followed by world_size - 1 steps
+ * of all-gather, sending to the next rank while receiving from the previous one. Each rank moves about
+ * twice the data, whatever the number of ranks.
+ *
+ * Rank r listens on base_port + r, and connects to the next rank, retrying while it is not listening yet.
+ *
+ * @param comm Pointer to the communicator.
+ * @param host IPv4 address shared by the ranks, e.g. "127.0.0.1".
+ * @param base_port Port of rank 0.
+ * @param rank Rank of the calling process, below world_size.
+ * @param world_size Number of ranks.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - COMMUNICATOR_CONNECTION_FAILED if the ring cannot be set up.
+ */
+cgrad_error communicator_tcp_init(struct communicator *const comm, const char *const host, const uint16_t base_port, const size_t rank, const size_t world_size);
+
+#endif
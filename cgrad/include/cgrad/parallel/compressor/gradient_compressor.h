@@ -0,0 +1,84 @@
+#ifndef GRADIENT_COMPRESSOR_H
+#define GRADIENT_COMPRESSOR_H
+
+#include "cgrad/error.h"
+#include <stddef.h>
+
+typedef size_t (*gradient_compressor_message_size_fn)(void *, const size_t);
+typedef cgrad_error (*gradient_compressor_compress_fn)(void *, const float *const, const size_t, const size_t, void *const);
+typedef void (*gradient_compressor_decompress_add_fn)(void *, const void *const, const size_t, float *const);
+typedef void (*gradient_compressor_cleanup_fn)(void *);
+
+/**
+ * @struct gradient_compressor
+ * @brief Lossy encoding of float32 gradients into messages smaller than the gradients, for exchange.
+ *
+ * Compressors keep an error-feedback residual over a whole flat gradient buffer: what a message leaves
+ * out of a range is added back to the same range before its next compression, so that no part of the
+ * gradient is lost, only delayed. Message sizes depend only on the number of elements, so that every
+ * rank sends messages of the same size.
+ */
+struct gradient_compressor
+{
+    gradient_compressor_message_size_fn message_size;
+    gradient_compressor_compress_fn compress;
+    gradient_compressor_decompress_add_fn decompress_add;
+    gradient_compressor_cleanup_fn cleanup;
+    void *state;
+};
+
+static inline size_t gradient_compressor_message_size(struct gradient_compressor *const comp, const size_t size);
+static inline cgrad_error gradient_compressor_compress(struct gradient_compressor *const comp, const float *const grad, const size_t offset, const size_t size, void *const message);
+static inline void gradient_compressor_decompress_add(struct gradient_compressor *const comp, const void *const message, const size_t size, float *const grad);
+static inline void gradient_compressor_cleanup(struct gradient_compressor *const comp);
+
+/**
+ * @brief Returns the size in bytes of the message of size elements.
+ */
+static inline size_t gradient_compressor_message_size(struct gradient_compressor *const comp, const size_t size)
+{
+    return comp->message_size(comp->state, size);
+}
+
+/**
+ * @brief Encodes grad plus the residual of the range [offset, offset + size) into message, and keeps in
+ * the residual what the message leaves out.
+ *
+ * @param comp Pointer to the compressor.
+ * @param grad Gradient of the range, size elements.
+ * @param offset Offset in elements of the range in the residual.
+ * @param size Number of elements of the range.
+ * @param message Output of gradient_compressor_message_size(comp, size) bytes.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - GRADIENT_COMPRESSOR_OUT_OF_RANGE if the range does not fit in the residual.
+ */
+static inline cgrad_error gradient_compressor_compress(struct gradient_compressor *const comp, const float *const grad, const size_t offset, const size_t size, void *const message)
+{
+    if (!comp)
+    {
+        return GRADIENT_COMPRESSOR_NULL;
+    }
+
+    return comp->compress(comp->state, grad, offset, size, message);
+}
+
+/**
+ * @brief Adds the decoded message of size elements to grad.
+ */
+static inline void gradient_compressor_decompress_add(struct gradient_compressor *const comp, const void *const message, const size_t size, float *const grad)
+{
+    comp->decompress_add(comp->state, message, size, grad);
+}
+
+static inline void gradient_compressor_cleanup(struct gradient_compressor *const comp)
+{
+    if (!comp || !comp->state)
+    {
+        return;
+    }
+
+    comp->cleanup(comp->state);
+    comp->state = NULL;
+}
+
+#endif
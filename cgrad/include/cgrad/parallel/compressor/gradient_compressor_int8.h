@@ -0,0 +1,21 @@
+#ifndef GRADIENT_COMPRESSOR_INT8_H
+#define GRADIENT_COMPRESSOR_INT8_H
+
+#include "cgrad/parallel/compressor/gradient_compressor.h"
+
+/**
+ * @brief Sends every element on 8 bits, with a float scale per block of GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE
+ * elements, the largest magnitude of the block.
+ *
+ * Values are rounded stochastically to one of the two nearest of 255 levels, with probabilities making
+ * the code unbiased, so that rounding errors average out over steps and ranks instead of accumulating.
+ * The residual catches the remaining error.
+ *
+ * @param comp Pointer to the compressor.
+ * @param size Number of elements of the residual, e.g. the flat size of the parameters.
+ * @param seed Seed of the rounding, which should differ across ranks.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error gradient_compressor_int8_init(struct gradient_compressor *const comp, const size_t size, const unsigned int seed);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef GRADIENT_COMPRESSOR_TOPK_H
+#define GRADIENT_COMPRESSOR_TOPK_H
+
+#include "cgrad/parallel/compressor/gradient_compressor.h"
+
+/**
+ * @brief Keeps the k elements of largest magnitude of each range, k = ceil(ratio * size), sent as pairs
+ * of 32-bit index and float value. Everything else stays in the residual until it grows large enough.
+ *
+ * The k-th magnitude is found by selection over a copy of the magnitudes, in linear time. Ties are
+ * broken by index, so that messages are always exactly k pairs.
+ *
+ * @param comp Pointer to the compressor.
+ * @param size Number of elements of the residual, e.g. the flat size of the parameters.
+ * @param ratio Share of the elements sent, in (0, 1].
+ * @return cgrad_error Error code indicating success or failure.
+ *         - GRADIENT_COMPRESSOR_INVALID_RATIO if ratio is out of range.
+ */
+cgrad_error gradient_compressor_topk_init(struct gradient_compressor *const comp, const size_t size, const double ratio);
+
+#endif
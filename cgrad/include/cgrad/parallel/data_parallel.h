@@ -0,0 +1,171 @@
+#ifndef DATA_PARALLEL_H
+#define DATA_PARALLEL_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_allocator.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct data_parallel_trainer;
+
+/**
+ * @struct data_parallel_worker
+ * @brief Worker thread of a data-parallel trainer, with its own allocators and its own copy of the gradients.
+ *
+ * Replicas are tensors whose data is the data of the shared parameters, read-only during a step, and
+ * whose gradients live in the private buffer of the worker. Forward and backward on replicas never
+ * touch the graph nodes nor the gradients of the shared parameters, nor those of other workers. The
+ * tensor pool of a worker holds its share of MEMORY_TENSOR_POOL_N_CHUNKS chunks, at least
+ * DATA_PARALLEL_MIN_WORKER_POOL_CHUNKS.
+ */
+struct data_parallel_worker
+{
+    size_t index;
+    struct data_parallel_trainer *trainer;
+    struct tensor_allocator tensor_alloc;
+    struct computational_graph_allocator graph_alloc;  /**< Owns the graph pool of the worker. */
+    struct allocators allocs;
+    struct tensor *replicas[MODEL_MAX_PARAMS];         /**< Replica of each shared parameter, in the same order. */
+    void *grad_buffer;                                 /**< Gradients of the replicas of trainable parameters, laid out by the grad offsets of the trainer. */
+    size_t shard_start;
+    size_t shard_end;
+    double loss;                                       /**< Loss of the shard, or of the last Hogwild step, set by the worker functions for reporting. */
+    size_t n_steps;                                    /**< Steps run by the worker in the last Hogwild run. */
+    cgrad_error error;
+};
+
+/**
+ * @brief Runs forward and backward on the samples [start, end) of the batch, with the replicas and the
+ * allocators of the worker, and releases what it allocated. Backward must go through
+ * data_parallel_worker_backward, so that the gradients of the shards add up to the gradient of the batch.
+ */
+typedef cgrad_error (*data_parallel_shard_fn)(struct data_parallel_worker *worker, const size_t start, const size_t end, void *args);
+
+/**
+ * @brief Runs forward and backward on a minibatch of its own choice, e.g. from step, with the replicas and
+ * the allocators of the worker, and releases what it allocated. Backward is a plain backward of the loss.
+ */
+typedef cgrad_error (*data_parallel_sample_fn)(struct data_parallel_worker *worker, const size_t step, void *args);
+
+/**
+ * @struct data_parallel_barrier
+ * @brief Reusable barrier, whose count can be lowered when threads fail to start.
+ */
+struct data_parallel_barrier
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t count;
+    size_t waiting;
+    size_t generation;
+};
+
+/**
+ * @struct data_parallel_trainer
+ * @brief Splits each batch across worker threads, and sums their gradients into the shared parameters.
+ *
+ * Workers are created once, at init, and reused by every step. The calling thread is worker 0. BLAS
+ * should be kept single-threaded, e.g. with OPENBLAS_NUM_THREADS=1, so that the products of the
+ * workers do not oversubscribe the cores.
+ */
+struct data_parallel_trainer
+{
+    struct model_params *params;
+    struct data_parallel_worker workers[DATA_PARALLEL_MAX_WORKERS];
+    size_t n_workers;
+    size_t grad_offsets[MODEL_MAX_PARAMS];  /**< Offset in elements of the gradient of each trainable parameter in the buffers of the workers. */
+    size_t grad_size;                       /**< Number of elements of each worker buffer, padding included. */
+    cgrad_dtype dtype;
+    double loss;                            /**< Loss of the last batch, the losses of the shards weighted by their size, or mean of the last losses of the workers after a Hogwild run. */
+    pthread_t threads[DATA_PARALLEL_MAX_WORKERS];
+    struct data_parallel_barrier barrier;
+    data_parallel_shard_fn fn;
+    void *args;
+    size_t batch_size;
+    data_parallel_sample_fn sample_fn;
+    size_t n_steps;
+    double lr;
+    atomic_size_t next_step;                /**< Next Hogwild step to be claimed by a worker. */
+    atomic_bool has_failed;
+    bool is_hogwild;
+    bool is_stopping;
+};
+
+/**
+ * @brief Creates the workers, their allocators and their replicas of the parameters.
+ *
+ * Parameters must be flattened, if they are, before init, and their trainability is fixed at init.
+ * Trainable parameters must share a float32 or float64 dtype.
+ *
+ * @param trainer Pointer to the trainer.
+ * @param params Pointer to the shared parameters.
+ * @param n_workers Number of workers, calling thread included, between 1 and DATA_PARALLEL_MAX_WORKERS.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - DATA_PARALLEL_INVALID_WORKERS if n_workers is out of range.
+ *         - TENSOR_DTYPE_MISMATCH if the trainable parameters do not share a supported dtype.
+ *         - DATA_PARALLEL_THREAD_CREATION_FAILED if a worker thread could not be started.
+ */
+cgrad_error data_parallel_init(struct data_parallel_trainer *trainer, struct model_params *const params, const size_t n_workers);
+
+/**
+ * @brief Computes the gradient of a batch of batch_size samples, in parallel.
+ *
+ * The batch is split in contiguous shards, one per worker, of sizes differing by at most one. Once every
+ * shard went through fn, the gradients of the workers are added to the gradients of the shared
+ * parameters, which are not zeroed, so that zero_grad and the optimizers are used as in a
+ * single-threaded loop. The sum is a pairwise tree over the workers, done one chunk of
+ * DATA_PARALLEL_REDUCE_CHUNK_SIZE elements at a time so that the chunks of all workers stay in cache,
+ * with chunks dealt among the workers. The order of the additions does not depend on scheduling.
+ *
+ * @param trainer Pointer to the trainer.
+ * @param batch_size Number of samples of the batch.
+ * @param fn Forward and backward of a shard.
+ * @param args Arguments forwarded to fn.
+ * @return cgrad_error The first error of the workers, in worker order. Gradients are left untouched on error.
+ */
+cgrad_error data_parallel_step(struct data_parallel_trainer *trainer, const size_t batch_size, const data_parallel_shard_fn fn, void *const args);
+
+/**
+ * @brief Trains asynchronously, without locks, for n_steps minibatches (Hogwild).
+ *
+ * Each worker claims the next step, runs fn on it and subtracts lr times its gradients from the shared
+ * parameters directly, in place, while the other workers read and update them too. Updates of
+ * different workers may interleave and overwrite each other: for sparse gradients they rarely
+ * collide, and the few lost updates cost less than synchronizing every step. Gradients of the shared
+ * parameters are neither read nor written, so that no optimizer is involved.
+ *
+ * @param trainer Pointer to the trainer.
+ * @param n_steps Number of minibatches over all the workers.
+ * @param lr Learning rate.
+ * @param fn Forward and backward of a minibatch.
+ * @param args Arguments forwarded to fn.
+ * @return cgrad_error The first error of the workers, in worker order. Workers stop claiming steps after an error.
+ */
+cgrad_error data_parallel_hogwild(struct data_parallel_trainer *trainer, const size_t n_steps, const double lr, const data_parallel_sample_fn fn, void *const args);
+
+/**
+ * @brief Returns the replica of a shared parameter in a worker, NULL if param is not a parameter of the trainer.
+ */
+struct tensor *data_parallel_worker_replica(const struct data_parallel_worker *const worker, const struct tensor *const param);
+
+/**
+ * @brief Backpropagates the mean loss of a shard, weighted by the share of the batch of the shard.
+ *
+ * @param worker Pointer to the worker.
+ * @param loss Mean loss over the samples of the shard.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+cgrad_error data_parallel_worker_backward(struct data_parallel_worker *const worker, struct tensor *const loss);
+
+/**
+ * @brief Stops the workers and frees their allocators and replicas. Shared parameters are left untouched.
+ */
+void data_parallel_cleanup(struct data_parallel_trainer *trainer);
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/parallel/communicator/communicator.h"
+#include "cgrad/parallel/compressor/gradient_compressor.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct distributed_bucket
+ * @brief Contiguous range of the flat gradients, all-reduced at once when all of its parameters are ready.
+ */
+struct distributed_bucket
+{
+    size_t offset;      /**< Offset in elements in the flat gradients. */
+    size_t size;        /**< Number of elements, padding between parameters included. */
+    size_t n_params;    /**< Trainable parameters of the bucket. */
+    size_t n_ready;     /**< Trainable parameters whose gradient is final, in the current backward. */
+};
+
+/**
+ * @struct distributed_trainer
+ * @brief Sums the gradients of the ranks of a multi-process run, overlapping communication with backward.
+ *
+ * Buckets are filled in reverse parameter order, so that the last layers, whose gradients are final first,
+ * are all-reduced while earlier layers are still being backpropagated. A communication thread all-reduces
+ * the buckets strictly in bucket order, the same on every rank, each one as soon as it is ready, i.e. once
+ * the gradient hooks of all of its parameters fired.
+ *
+ * With a compressor, each rank compresses its bucket into a message, the messages of all the ranks are
+ * all-gathered, and every rank sums their decoded contents, in rank order, into the bucket.
+ */
+struct distributed_trainer
+{
+    struct model_params *params;
+    struct communicator *comm;
+    struct distributed_bucket buckets[MODEL_MAX_PARAMS];
+    size_t n_buckets;
+    size_t param_buckets[MODEL_MAX_PARAMS];    /**< Bucket of each parameter. */
+    bool is_trainable[MODEL_MAX_PARAMS];
+    bool is_ready[MODEL_MAX_PARAMS];           /**< Whether the gradient of each parameter is final, in the current backward. */
+    size_t n_reduced;                          /**< Buckets all-reduced in the current backward. */
+    cgrad_error error;                         /**< First error of the communication thread in the current backward. */
+    struct gradient_compressor *compressor;    /**< Compresses the buckets before exchange, NULL for exact all-reduces. */
+    void *messages;                            /**< Compressed messages of every rank for one bucket. */
+    size_t payload_bytes;                      /**< Bytes of gradients, or of messages, handed to the collectives by the rank since init. */
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t ready_cond;
+    pthread_cond_t done_cond;
+    bool is_stopping;
+};
+
+/**
+ * @brief Splits the flat gradients in buckets of about DISTRIBUTED_BUCKET_SIZE elements and starts the
+ * communication thread.
+ *
+ * Parameters must be flattened, and their trainability is fixed at init. Every rank must use the same
+ * model, so that the buckets match. A gradient hook is registered on each trainable parameter, and
+ * removed by distributed_cleanup.
+ *
+ * @param dist Pointer to the trainer.
+ * @param params Pointer to the parameters of the rank.
+ * @param comm Pointer to the communicator, which must outlive the trainer.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - DISTRIBUTED_PARAMS_NOT_FLAT if the parameters are not flattened.
+ *         - AUTOGRAD_MAX_GRAD_HOOKS_EXCEEDED if a parameter has no room for the hook.
+ *         - DISTRIBUTED_THREAD_CREATION_FAILED if the communication thread could not be started.
+ */
+cgrad_error distributed_init(struct distributed_trainer *dist, struct model_params *const params, struct communicator *const comm);
+
+/**
+ * @brief Sets the compressor of the exchanges, NULL for exact all-reduces, between two backwards.
+ *
+ * The residual of the compressor must span the flat gradients, e.g. with a size of params->flat_size.
+ * Every rank must use the same kind of compressor with the same settings, so that messages match.
+ *
+ * @param dist Pointer to the trainer.
+ * @param compressor Pointer to the compressor, which must outlive its use by the trainer.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - OPERATION_INVALID_TENSOR_DTYPE if the parameters are not float32.
+ *         - DISTRIBUTED_ALLOCATION_FAILED if the message buffer could not be allocated.
+ */
+cgrad_error distributed_set_compressor(struct distributed_trainer *dist, struct gradient_compressor *const compressor);
+
+/**
+ * @brief Backpropagates the loss of the rank and sums the gradients of all the ranks.
+ *
+ * The gradient of the loss is seeded with loss_scale, e.g. the share of the global batch of the rank for
+ * a mean loss over its shard, so that the sum over the ranks is the gradient of the global batch.
+ * Gradients are added to the gradients of the parameters, which should be zeroed before, as in a
+ * single-process loop. On return, every rank holds the same gradients.
+ *
+ * @param dist Pointer to the trainer.
+ * @param loss Scalar loss of the rank, or NULL if the rank has no samples this step, which still takes part
+ *        in the all-reduce.
+ * @param loss_scale Gradient of the final objective with respect to loss.
+ * @param allocs Allocators used for the graph and the temporary gradients.
+ * @return cgrad_error The error of backward, or else the first error of the communication thread.
+ */
+cgrad_error distributed_backward(struct distributed_trainer *dist, struct tensor *const loss, const double loss_scale, struct allocators *allocs);
+
+/**
+ * @brief Stops the communication thread and removes the gradient hooks. Parameters, communicator and compressor are otherwise left untouched.
+ */
+void distributed_cleanup(struct distributed_trainer *dist);
+
+#endif
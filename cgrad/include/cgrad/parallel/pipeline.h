@@ -0,0 +1,125 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "cgrad/parallel/spsc_queue.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_allocator.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pipeline;
+struct pipeline_stage;
+
+/**
+ * @brief Forward of a stage on the micro-batch made of the samples [start, end) of the batch, with the
+ * allocators of the stage, tracking gradients.
+ *
+ * The first stage gets a NULL input and samples the micro-batch itself. Other stages get a copy of the
+ * output of the previous stage, which requires grad. The last stage outputs the mean loss over the
+ * micro-batch, a scalar. Intermediate tensors may be released as soon as forward is done, as the graph
+ * keeps what backward needs. The output is owned by the pipeline once returned.
+ */
+typedef cgrad_error (*pipeline_stage_fn)(struct pipeline_stage *stage, const size_t start, const size_t end, struct tensor *const input, struct tensor **const output, void *args);
+
+/**
+ * @struct pipeline_stage
+ * @brief Consecutive layers of a model run by a thread of their own, pinned to a group of cores.
+ *
+ * Each layer, and so each parameter, must belong to a single stage, whose thread alone builds graphs on
+ * it and accumulates its gradient.
+ */
+struct pipeline_stage
+{
+    size_t index;
+    struct pipeline *pipe;
+    pipeline_stage_fn fn;
+    void *args;
+    struct tensor_allocator tensor_alloc;
+    struct computational_graph_allocator graph_alloc;
+    struct allocators allocs;
+    struct tensor *inputs[PIPELINE_MAX_STAGES];   /**< Inputs of the micro-batches in flight, by micro-batch modulo PIPELINE_MAX_STAGES. */
+    struct tensor *outputs[PIPELINE_MAX_STAGES];  /**< Outputs of the micro-batches in flight, kept for backward. */
+    size_t first_cpu;                             /**< First of the cores of the stage, in the cores the process may run on. */
+    size_t n_cpus;
+    cgrad_error error;
+};
+
+/**
+ * @struct pipeline
+ * @brief Runs the stages of a model concurrently, on successive micro-batches of each batch.
+ *
+ * Activations go forward and their gradients backward through lock-free single-producer single-consumer
+ * queues between adjacent stages, as copies, so that stages never share tensors. Each stage follows a
+ * one-forward-one-backward (1F1B) schedule: stage s runs n_stages - s - 1 forwards ahead, then alternates
+ * one forward and one backward, then drains the remaining backwards. Stages keep at most n_stages - s
+ * micro-batches in flight, instead of all of them as with every forward before every backward.
+ *
+ * Threads are created once, at init, and reused by every step. BLAS should be kept single-threaded,
+ * e.g. with OPENBLAS_NUM_THREADS=1, so that stages stay on their cores.
+ */
+struct pipeline
+{
+    struct pipeline_stage stages[PIPELINE_MAX_STAGES];
+    size_t n_stages;
+    struct spsc_queue forward_queues[PIPELINE_MAX_STAGES];   /**< Activations from stage s to stage s + 1. */
+    struct spsc_queue backward_queues[PIPELINE_MAX_STAGES];  /**< Gradients from stage s + 1 to stage s. */
+    pthread_t threads[PIPELINE_MAX_STAGES];
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    size_t generation;
+    size_t n_done;
+    int *cpus;                                               /**< Cores the process may run on, split in consecutive groups among the stages. */
+    size_t n_cpus;
+    size_t batch_size;
+    size_t n_micro_batches;
+    double loss;                                             /**< Loss of the last batch, the losses of the micro-batches weighted by their size. */
+    atomic_bool has_failed;
+    bool is_stopping;
+};
+
+/**
+ * @brief Creates a thread per stage, with its own allocators, pinned to its share of the cores.
+ *
+ * Cores the process may run on are split in n_stages groups of consecutive cores, of sizes differing by
+ * at most one. With fewer cores than stages, stages share cores. Pinning is best effort, and skipped
+ * where the platform does not support it.
+ *
+ * @param pipe Pointer to the pipeline.
+ * @param n_stages Number of stages, between 1 and PIPELINE_MAX_STAGES.
+ * @param fns Forward of each stage.
+ * @param args Arguments forwarded to the forward of each stage.
+ * @return cgrad_error Error code indicating success or failure.
+ *         - PIPELINE_INVALID_STAGES if n_stages is out of range.
+ *         - PIPELINE_THREAD_CREATION_FAILED if a stage thread could not be started.
+ */
+cgrad_error pipeline_init(struct pipeline *pipe, const size_t n_stages, const pipeline_stage_fn *const fns, void *const *const args);
+
+/**
+ * @brief Computes the gradient of a batch of batch_size samples, split in n_micro_batches micro-batches.
+ *
+ * Micro-batches are contiguous and of sizes differing by at most one. The gradient of the loss of each
+ * micro-batch is seeded with its share of the batch, so that gradients, accumulated by each stage into
+ * the gradients of its parameters, add up to the gradient of the mean loss of the batch. Gradients are
+ * not zeroed, so that zero_grad and the optimizers are used as in a single-threaded loop.
+ *
+ * @param pipe Pointer to the pipeline.
+ * @param batch_size Number of samples of the batch.
+ * @param n_micro_batches Number of micro-batches, between 1 and batch_size.
+ * @return cgrad_error The first error of the stages, in stage order. After an error, gradients are
+ *         partial and the pipeline should be cleaned up.
+ */
+cgrad_error pipeline_step(struct pipeline *pipe, const size_t batch_size, const size_t n_micro_batches);
+
+/**
+ * @brief Stops the stage threads and frees their allocators.
+ */
+void pipeline_cleanup(struct pipeline *pipe);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "cgrad/config.h"
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct spsc_queue
+ * @brief Bounded lock-free queue of pointers between exactly one producer thread and one consumer thread.
+ *
+ * Head and tail only grow, and each is written by a single side, so that a release store publishing an
+ * item and an acquire load seeing it are the only synchronization. They live on separate cache lines,
+ * so that both sides do not invalidate each other on every operation.
+ */
+struct spsc_queue
+{
+    alignas(64) atomic_size_t head;  /**< Next item to pop, written by the consumer. */
+    alignas(64) atomic_size_t tail;  /**< Next free slot, written by the producer. */
+    void *items[PIPELINE_QUEUE_CAPACITY];
+};
+
+static inline void spsc_queue_init(struct spsc_queue *const queue);
+static inline bool spsc_queue_push(struct spsc_queue *const queue, void *const item);
+static inline bool spsc_queue_pop(struct spsc_queue *const queue, void **const item);
+
+static inline void spsc_queue_init(struct spsc_queue *const queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+}
+
+/**
+ * @brief Appends item, called by the producer only. Returns false if the queue is full.
+ */
+static inline bool spsc_queue_push(struct spsc_queue *const queue, void *const item)
+{
+    const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&queue->head, memory_order_acquire) == PIPELINE_QUEUE_CAPACITY)
+    {
+        return false;
+    }
+
+    queue->items[tail & (PIPELINE_QUEUE_CAPACITY - 1)] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Removes the oldest item, called by the consumer only. Returns false if the queue is empty.
+ */
+static inline bool spsc_queue_pop(struct spsc_queue *const queue, void **const item)
+{
+    const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&queue->tail, memory_order_acquire))
+    {
+        return false;
+    }
+
+    *item = queue->items[head & (PIPELINE_QUEUE_CAPACITY - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+#endif
@@ -10,6 +10,17 @@
 struct computational_graph_node;
 struct tensor;
 
+/**
+ * @brief Called during backward on a leaf tensor once its gradient is final.
+ */
+typedef void (*tensor_grad_hook_fn)(struct tensor *const t, void *args);
+
+struct tensor_grad_hook
+{
+    tensor_grad_hook_fn fn;
+    void *args;
+};
+
 /**
  * @struct tensor
  * @brief Represents a tensor with optional gradient tracking.
@@ -27,6 +38,13 @@ struct tensor
     size_t shape_size;                     /**< Number of dimensions in the tensor. */
     struct computational_graph_node *node; /**< Pointer to the computational graph node for gradient tracking. */
     struct tensor *grad;                   /**< Pointer to the gradient tensor. */
+    size_t saved_count;                    /**< Number of backpropagation contexts that saved this tensor's data for backward. */
+    size_t ref_count;                      /**< Number of references to the tensor: its owner, its graph node and the contexts that saved it. */
+    bool requires_grad;                    /**< Whether backward must compute the gradient of this tensor. False for input data and frozen parameters. */
+    bool is_recorded;                      /**< Whether an autograd tape refers to this tensor, and holds a reference on it. */
+    bool is_view;                          /**< Whether data points into a buffer owned elsewhere, e.g. the flat buffers of model_params. Never released by the allocator. */
+    struct tensor_grad_hook grad_hooks[AUTOGRAD_MAX_GRAD_HOOKS]; /**< Called in order during backward, once nothing else will be added to the gradient of this leaf. */
+    size_t n_grad_hooks;
 };
 
 #endif
\ No newline at end of file
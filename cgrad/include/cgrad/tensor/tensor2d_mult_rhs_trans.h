@@ -2,8 +2,24 @@
 #define TENSOR2D_MULT_RHS_TRANS_H 
 
 #include "cgrad/tensor/tensor.h"
+#include "cgrad/memory/allocators.h"
 #include "cgrad/error.h"
+#include <stdbool.h>
 
+/**
+ * @brief Computes lhs * rhs_trans^T without materializing the transpose.
+ *
+ * The tracked counterpart of tensor2d_mult_rhs_trans_into, used by graph passes that fold transpositions
+ * into the product.
+ */
+cgrad_error tensor2d_mult_rhs_trans(struct tensor *const lhs, struct tensor *const rhs_trans, struct tensor **const out, const bool track_grad, struct allocators *const allocs);
 cgrad_error tensor2d_mult_rhs_trans_into(const struct tensor *const lhs, const struct tensor *const rhs_trans, struct tensor *const out);
 
+/**
+ * @brief Adds the product to out instead of overwriting it, in the same GEMM (beta = 1).
+ *
+ * Used by backward to accumulate a gradient straight into the gradient of an operand.
+ */
+cgrad_error tensor2d_mult_rhs_trans_acc_into(const struct tensor *const lhs, const struct tensor *const rhs_trans, struct tensor *const out);
+
 #endif
\ No newline at end of file
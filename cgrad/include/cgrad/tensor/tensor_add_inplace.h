@@ -6,4 +6,9 @@
 
 cgrad_error tensor_add_inplace(struct tensor *A, const struct tensor *const B);
 
+/**
+ * @brief Adds size elements of src to dst, elementwise, e.g. over ranges of flat gradient buffers.
+ */
+cgrad_error tensor_data_add_inplace(void *const dst, const void *const src, const size_t size, const cgrad_dtype dtype);
+
 #endif
\ No newline at end of file
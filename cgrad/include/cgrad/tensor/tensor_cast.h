@@ -0,0 +1,18 @@
+#ifndef TENSOR_CAST_H
+#define TENSOR_CAST_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/error.h"
+
+/**
+ * @brief Converts the elements of src to the dtype of dest.
+ *
+ * Supports conversions between DTYPE_FLOAT32 and DTYPE_BFLOAT16, in both directions.
+ *
+ * @param src Pointer to the source tensor.
+ * @param dest Pointer to the destination tensor, with the same shape as src.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error tensor_cast_into(const struct tensor *const src, struct tensor *const dest);
+
+#endif
@@ -4,7 +4,15 @@
 #include "cgrad/error.h"
 #include "cgrad/tensor/tensor.h"
 
-static inline cgrad_error tensor_norm(const struct tensor *const t, double *const out);
+/**
+ * @brief Computes the L2 norm of a tensor, accumulated in double.
+ */
+cgrad_error tensor_norm(const struct tensor *const t, double *const out);
 
+/**
+ * @brief Computes the sum of the squares of size elements of the given dtype, accumulated in double,
+ * e.g. over a range of a tensor or of a flat buffer.
+ */
+cgrad_error tensor_data_squared_norm(const void *const data, const size_t size, const cgrad_dtype dtype, double *const out);
 
-#endif
\ No newline at end of file
+#endif
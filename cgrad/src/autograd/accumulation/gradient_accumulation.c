@@ -0,0 +1,84 @@
+#include "cgrad/autograd/accumulation/gradient_accumulation.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+
+static cgrad_error gradient_accumulation_micro_batch(const size_t start, const size_t end, const size_t batch_size, const gradient_accumulation_fn fn, void *const args, struct allocators *const allocs, double *const loss);
+
+cgrad_error gradient_accumulation_step(const size_t batch_size, const size_t n_micro_batches, const gradient_accumulation_fn fn, void *const args, struct allocators *const allocs, double *const loss)
+{
+    if (!fn)
+    {
+        return INPUT_NULL;
+    }
+    if (!allocs)
+    {
+        return ALLOCATORS_NULL;
+    }
+    if (batch_size == 0)
+    {
+        return INVALID_BATCH_SIZE;
+    }
+    if (n_micro_batches == 0 || n_micro_batches > batch_size)
+    {
+        return GRADIENT_ACCUMULATION_INVALID_MICRO_BATCHES;
+    }
+
+    double batch_loss = 0;
+    for (size_t m = 0; m < n_micro_batches; m++)
+    {
+        const size_t start = m * batch_size / n_micro_batches;
+        const size_t end = (m + 1) * batch_size / n_micro_batches;
+
+        cgrad_error err = NO_ERROR;
+        if ((err = gradient_accumulation_micro_batch(start, end, batch_size, fn, args, allocs, &batch_loss)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    if (loss)
+    {
+        *loss = batch_loss;
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error gradient_accumulation_micro_batch(const size_t start, const size_t end, const size_t batch_size, const gradient_accumulation_fn fn, void *const args, struct allocators *const allocs, double *const loss)
+{
+    struct tensor *micro_loss = NULL;
+    cgrad_error err = fn(start, end, &micro_loss, args);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if (!micro_loss)
+    {
+        return GRADIENT_ACCUMULATION_INVALID_LOSS;
+    }
+    if (micro_loss->data_size != 1)
+    {
+        tensor_allocator_free(allocs->tensor_alloc, micro_loss);
+        return GRADIENT_ACCUMULATION_INVALID_LOSS;
+    }
+
+    // Mean losses of the micro-batches, weighted by their share, add up to the mean loss of the batch
+    const double weight = (double)(end - start) / batch_size;
+    switch (micro_loss->dtype)
+    {
+    case DTYPE_FLOAT64:
+        *loss += ((double *)micro_loss->data)[0] * weight;
+        break;
+    case DTYPE_FLOAT32:
+        *loss += ((float *)micro_loss->data)[0] * weight;
+        break;
+    default:
+        tensor_allocator_free(allocs->tensor_alloc, micro_loss);
+        return GRADIENT_ACCUMULATION_INVALID_LOSS;
+    }
+
+    err = backward_scaled(micro_loss, weight, allocs);
+    tensor_allocator_free(allocs->tensor_alloc, micro_loss);
+
+    return err;
+}
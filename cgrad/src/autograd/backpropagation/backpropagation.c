@@ -1,22 +1,24 @@
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/backpropagation/backpropagation_queue.h"
+#include "cgrad/autograd/tape/autograd_tape.h"
 #include "cgrad/tensor/tensor_add_inplace.h"
 #include "cgrad/tensor/tensor_set.h"
+#include "cgrad/tensor/tensor_copy.h"
+#include "cgrad/memory/tensor/spill/tensor_spill_store.h"
 #include "cgrad/config.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
-struct backpropagation_targets
-{
-    struct computational_graph_node* targets[AUTOGRAD_MAX_TARGETS];
-    size_t size;
-};
-
-static cgrad_error build_gradients(struct computational_graph_node *loss_node, struct allocators *allocs, struct backpropagation_targets *targets);
-static cgrad_error add_target(struct backpropagation_targets* const targets, struct computational_graph_node* const node);
+static cgrad_error build_gradients(struct computational_graph_node *loss_node, struct allocators *allocs);
+static bool mark_involved_nodes(struct computational_graph_node *const node);
+static inline void release_node(struct computational_graph_node *const node, struct allocators *const allocs);
 static inline cgrad_error set_gradient_wrt_itself(struct tensor* const t);
+static inline void run_grad_hooks(struct computational_graph_node *const node);
+
+// Handed to the backward of operations that stored nothing in their context
+static const struct backpropagation_context empty_context;
 
 cgrad_error backward(struct tensor* t, struct allocators *allocs)
 {
@@ -24,36 +26,161 @@ cgrad_error backward(struct tensor* t, struct allocators *allocs)
     {
         return TENSOR_NULL;
     }
+    if (!t->grad)
+    {
+        return TENSOR_GRAD_NULL;
+    }
     if (!allocs)
     {
         return ALLOCATORS_NULL;
     }
 
-    struct backpropagation_targets targets;
-    targets.size = 0;
-
     cgrad_error err = NO_ERROR;
     if ((err = set_gradient_wrt_itself(t)) != NO_ERROR)
     {
         return err;
     }
 
-    if ((err = build_gradients(t->node, allocs, &targets)) != NO_ERROR)
+    if (allocs->tape && t->is_recorded)
+    {
+        return autograd_tape_backward(allocs->tape, t, allocs);
+    }
+
+    // Nothing to propagate if t does not depend on any tracked tensor
+    if (!t->node)
+    {
+        return NO_ERROR;
+    }
+
+    return build_gradients(t->node, allocs);
+}
+
+cgrad_error backward_with_gradient(struct tensor *t, const struct tensor *const grad, struct allocators *allocs)
+{
+    if (!t || !grad)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->grad)
+    {
+        return TENSOR_GRAD_NULL;
+    }
+    if (!allocs)
+    {
+        return ALLOCATORS_NULL;
+    }
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_copy(grad, t->grad)) != NO_ERROR)
     {
         return err;
     }
 
-    for (size_t i = 0; i < targets.size; i++)
+    if (allocs->tape && t->is_recorded)
+    {
+        return autograd_tape_backward(allocs->tape, t, allocs);
+    }
+
+    // Nothing to propagate if t does not depend on any tracked tensor
+    if (!t->node)
+    {
+        return NO_ERROR;
+    }
+
+    return build_gradients(t->node, allocs);
+}
+
+cgrad_error backward_scaled(struct tensor *t, const double scale, struct allocators *allocs)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->grad)
+    {
+        return TENSOR_GRAD_NULL;
+    }
+    if (!allocs)
+    {
+        return ALLOCATORS_NULL;
+    }
+
+    switch (t->grad->dtype)
+    {
+    case DTYPE_FLOAT64:
+        for (size_t i = 0; i < t->grad->data_size; i++)
+        {
+            ((double *)t->grad->data)[i] = scale;
+        }
+        break;
+    case DTYPE_FLOAT32:
+        for (size_t i = 0; i < t->grad->data_size; i++)
+        {
+            ((float *)t->grad->data)[i] = (float)scale;
+        }
+        break;
+    default:
+        return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
+    }
+
+    if (allocs->tape && t->is_recorded)
     {
-        struct computational_graph_node* node = targets.targets[i];
-        node->t->node = NULL;
-        computational_graph_allocator_free(allocs->graph_alloc, node);
+        return autograd_tape_backward(allocs->tape, t, allocs);
     }
 
+    // Nothing to propagate if t does not depend on any tracked tensor
+    if (!t->node)
+    {
+        return NO_ERROR;
+    }
+
+    return build_gradients(t->node, allocs);
+}
+
+cgrad_error backward_register_grad_hook(struct tensor *const t, const tensor_grad_hook_fn fn, void *const args)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!fn)
+    {
+        return INPUT_NULL;
+    }
+    if (t->n_grad_hooks == AUTOGRAD_MAX_GRAD_HOOKS)
+    {
+        return AUTOGRAD_MAX_GRAD_HOOKS_EXCEEDED;
+    }
+
+    t->grad_hooks[t->n_grad_hooks].fn = fn;
+    t->grad_hooks[t->n_grad_hooks].args = args;
+    t->n_grad_hooks++;
+
     return NO_ERROR;
 }
 
-static cgrad_error build_gradients(struct computational_graph_node *loss_node, struct allocators *allocs, struct backpropagation_targets *targets)
+cgrad_error backward_remove_grad_hook(struct tensor *const t, const tensor_grad_hook_fn fn, void *const args)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+
+    for (size_t i = 0; i < t->n_grad_hooks; i++)
+    {
+        if (t->grad_hooks[i].fn == fn && t->grad_hooks[i].args == args)
+        {
+            // Later hooks keep their order
+            memmove(&t->grad_hooks[i], &t->grad_hooks[i + 1], (t->n_grad_hooks - i - 1) * sizeof(struct tensor_grad_hook));
+            t->n_grad_hooks--;
+            return NO_ERROR;
+        }
+    }
+
+    return AUTOGRAD_GRAD_HOOK_NOT_FOUND;
+}
+
+static cgrad_error build_gradients(struct computational_graph_node *loss_node, struct allocators *allocs)
 {
     cgrad_error err = NO_ERROR;
 
@@ -68,80 +195,166 @@ static cgrad_error build_gradients(struct computational_graph_node *loss_node, s
         return err;
     }
 
+    const cgrad_dtype dtype = loss_node->t->dtype;
+
+    mark_involved_nodes(loss_node);
+
     while (!backpropagation_queue_is_empty(&queue))
     {
         struct computational_graph_node *node = NULL;
         backpropagation_queue_pop(&queue, &node);
-        if ((err = add_target(targets, node)) != NO_ERROR)
-        {
-            return err;
-        }
 
-        for (size_t i = 0; i < node->n_children; i++)
+        // Bring back the saved tensors that were offloaded during forward
+        if (node->is_involved_in_backprop && node->ctx && allocs->tensor_alloc->spill)
         {
-            struct computational_graph_node *child_node = node->children[i];
-            struct tensor *gradient = tensor_allocator_no_grad_alloc(allocs->tensor_alloc, child_node->t->shape, child_node->t->shape_size, loss_node->t->dtype);
-            if (!gradient)
+            if ((err = tensor_spill_store_restore_context(allocs->tensor_alloc->spill, node->ctx, allocs->tensor_alloc)) != NO_ERROR)
             {
-                return TENSOR_ALLOCATION_FAILED;
+                return err;
             }
+        }
 
-            struct backpropagation_context *ctx = &node->ctx;
-            size_t operand = node->children_operands[i];
+        const struct backpropagation_context *ctx = node->ctx ? node->ctx : &empty_context;
+        for (const struct computational_graph_edge *edge = node->children; edge; edge = edge->next)
+        {
+            struct computational_graph_node *child_node = edge->child;
 
-            if ((err = backpropagation_function_check_input(node->t->grad, gradient)) != NO_ERROR)
+            /**
+             * Edges leading to no trainable tensor are only walked, so that their nodes are released,
+             * and no gradient is computed for them.
+             */
+            if (!child_node->is_involved_in_backprop && !ctx->backward_has_side_effects)
             {
-                return err;
+                child_node->pushed_gradients_count++;
+                if (child_node->pushed_gradients_count == child_node->n_parents)
+                {
+                    if ((err = backpropagation_queue_push(&queue, child_node)) != NO_ERROR)
+                    {
+                        return err;
+                    }
+                }
+                continue;
             }
 
-            if ((err = node->function[operand](ctx, node->t->grad, gradient)) != NO_ERROR)
+            struct tensor *child_grad = child_node->t->grad;
+            if (!child_grad)
             {
-                return err;
+                // Only reached for the side effects of the backward, e.g. a checkpoint of no-grad inputs
+                if (ctx->backward_has_side_effects && (err = edge->function(ctx, node->t->grad, NULL)) != NO_ERROR)
+                {
+                    return err;
+                }
             }
+            else if (edge->accumulate && child_grad->dtype == dtype)
+            {
+                // Added straight to the gradient of the operand, with no temporary gradient nor extra pass
+                if ((err = backpropagation_function_check_input(node->t->grad, child_grad)) != NO_ERROR)
+                {
+                    return err;
+                }
 
-            if ((err = tensor_add_inplace(child_node->t->grad, gradient)) != NO_ERROR)
+                if ((err = edge->accumulate(ctx, node->t->grad, child_grad)) != NO_ERROR)
+                {
+                    return err;
+                }
+            }
+            else
             {
-                return err;
+                struct tensor *gradient = tensor_allocator_no_grad_alloc(allocs->tensor_alloc, child_node->t->shape, child_node->t->shape_size, dtype);
+                if (!gradient)
+                {
+                    return TENSOR_ALLOCATION_FAILED;
+                }
+
+                if ((err = backpropagation_function_check_input(node->t->grad, gradient)) != NO_ERROR)
+                {
+                    return err;
+                }
+
+                if ((err = edge->function(ctx, node->t->grad, gradient)) != NO_ERROR)
+                {
+                    return err;
+                }
+
+                if ((err = tensor_add_inplace(child_grad, gradient)) != NO_ERROR)
+                {
+                    return err;
+                }
+
+                tensor_allocator_no_grad_free(allocs->tensor_alloc, gradient);
             }
 
             child_node->pushed_gradients_count++;
 
-            tensor_allocator_free(allocs->tensor_alloc, gradient);
-
             if (child_node->pushed_gradients_count == child_node->n_parents)
             {
+                run_grad_hooks(child_node);
                 if ((err = backpropagation_queue_push(&queue, child_node)) != NO_ERROR)
                 {
                     return err;
                 }
             }
         }
+
+        // All gradients of the node have been pushed to its children
+        release_node(node, allocs);
     }
 
     return NO_ERROR;
 }
 
-static cgrad_error add_target(struct backpropagation_targets* const targets, struct computational_graph_node* const node)
+/**
+ * Marks the nodes on a path to a leaf that requires a gradient, e.g. a trainable parameter. Gradients
+ * are computed only along those paths, so that input data and frozen parameters cost nothing.
+ */
+static bool mark_involved_nodes(struct computational_graph_node *const node)
 {
-    if (!targets)
+    if (node->is_visited)
     {
-        return AUTOGRAD_BACKPROPAGATION_TARGET_NULL;
+        return node->is_involved_in_backprop;
     }
-    if (!node)
+    node->is_visited = true;
+
+    bool is_involved = (node->ctx && node->ctx->backward_has_side_effects) || (node->n_children == 0 && node->t->requires_grad);
+    for (const struct computational_graph_edge *edge = node->children; edge; edge = edge->next)
     {
-        return AUTOGRAD_BACKPROPAGATION_TARGET_COMP_GRAPH_NODE_NULL;
+        // Every child is visited, even after the node is known to be involved
+        is_involved = mark_involved_nodes(edge->child) || is_involved;
     }
 
-    size_t const size = targets->size;
-    if (size >= AUTOGRAD_MAX_TARGETS)
+    node->is_involved_in_backprop = is_involved;
+    return is_involved;
+}
+
+/**
+ * Releases what a processed node keeps alive. The upstream gradient of a non-leaf tensor is not
+ * needed anymore, while leaves (e.g. parameters) keep theirs. Freeing the node drops its saved
+ * activations and its reference on the tensor, deallocating whatever the user already freed.
+ */
+static inline void release_node(struct computational_graph_node *const node, struct allocators *const allocs)
+{
+    struct tensor *t = node->t;
+    if (node->n_children > 0 && t->grad)
     {
-        return AUTOGRAD_MAX_TARGETS_EXCEEDED;
+        tensor_allocator_no_grad_free(allocs->tensor_alloc, t->grad);
+        t->grad = NULL;
     }
 
-    targets->targets[size] = node;
-    targets->size++;
+    computational_graph_allocator_free(allocs->graph_alloc, node);
+}
 
-    return NO_ERROR;
+// Every gradient of the node was pushed, so a leaf has its final gradient
+static inline void run_grad_hooks(struct computational_graph_node *const node)
+{
+    struct tensor *t = node->t;
+    if (node->n_children > 0 || !t->requires_grad)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < t->n_grad_hooks; i++)
+    {
+        t->grad_hooks[i].fn(t, t->grad_hooks[i].args);
+    }
 }
 
 static inline cgrad_error set_gradient_wrt_itself(struct tensor* const t)
@@ -0,0 +1,196 @@
+#include "cgrad/autograd/checkpoint/checkpoint.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/tensor/tensor_copy.h"
+#include <stdlib.h>
+
+typedef enum checkpoint_operand
+{
+    CHECKPOINT_INPUT,
+} checkpoint_operand;
+
+typedef enum checkpoint_ptr_operand
+{
+    CHECKPOINT_SEGMENT,
+} checkpoint_ptr_operand;
+
+static inline cgrad_error checkpoint_forward_update_graph(struct checkpoint *const ckpt, struct tensor *const x, struct tensor **const out);
+static cgrad_error checkpoint_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error checkpoint_recompute_backward(struct checkpoint *const ckpt, struct tensor *const x_detached, const struct tensor *const grad_wrt_out);
+
+cgrad_error checkpoint_init(struct checkpoint *const ckpt, checkpoint_segment_fn segment, void *const args, const size_t max_intermediates, struct allocators *const allocs)
+{
+    if (!ckpt)
+    {
+        return CHECKPOINT_NULL;
+    }
+    if (!segment)
+    {
+        return CHECKPOINT_SEGMENT_NULL;
+    }
+
+    cgrad_error err = allocators_is_valid(allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    ckpt->intermediates = tensor_list_alloc(max_intermediates);
+    if (!ckpt->intermediates)
+    {
+        return TENSOR_LIST_NULL;
+    }
+
+    ckpt->segment = segment;
+    ckpt->args = args;
+    ckpt->allocs = allocs;
+
+    return NO_ERROR;
+}
+
+cgrad_error checkpoint_forward(struct checkpoint *const ckpt, struct tensor *const x, struct tensor **const out, const bool track_grad)
+{
+    if (!ckpt)
+    {
+        return CHECKPOINT_NULL;
+    }
+    if (!x)
+    {
+        return INPUT_NULL;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+
+    // The segment runs untracked, so none of its intermediates outlives the forward pass
+    cgrad_error err = ckpt->segment(ckpt->args, x, out, ckpt->intermediates, false);
+    tensor_list_free_all(ckpt->intermediates, ckpt->allocs->tensor_alloc);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad)
+    {
+        return checkpoint_forward_update_graph(ckpt, x, out);
+    }
+    return NO_ERROR;
+}
+
+void checkpoint_cleanup(struct checkpoint *const ckpt)
+{
+    if (!ckpt || !ckpt->intermediates)
+    {
+        return;
+    }
+
+    tensor_list_free_all(ckpt->intermediates, ckpt->allocs->tensor_alloc);
+    free(ckpt->intermediates->data);
+    free(ckpt->intermediates);
+    ckpt->intermediates = NULL;
+}
+
+static inline cgrad_error checkpoint_forward_update_graph(struct checkpoint *const ckpt, struct tensor *const x, struct tensor **const out)
+{
+    // The segment ran untracked, so its output was allocated without a gradient
+    if (!(*out)->grad)
+    {
+        (*out)->grad = tensor_allocator_no_grad_zero_alloc(ckpt->allocs->tensor_alloc, (*out)->shape, (*out)->shape_size, (*out)->dtype);
+        if (!(*out)->grad)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    // The whole segment is a single node of the graph, whose backward recomputes it
+    cgrad_error err = add_computational_graph_link(x, CHECKPOINT_INPUT, *out, &checkpoint_backpropagate, ckpt->allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct backpropagation_context *ctx = computational_graph_link_context(*out, ckpt->allocs);
+    err = context_save_operand(ctx, x, CHECKPOINT_INPUT);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The parameters of the segment are not part of the graph, backward must run anyway to reach them
+    ctx->backward_has_side_effects = true;
+    (*out)->requires_grad = true;
+
+    return context_set_operand_ptr(ctx, ckpt, CHECKPOINT_SEGMENT);
+}
+
+static cgrad_error checkpoint_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *const x = ctx->operands[CHECKPOINT_INPUT];
+    if (!x)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    struct checkpoint *const ckpt = (struct checkpoint *)ctx->operands_ptr[CHECKPOINT_SEGMENT];
+    if (!ckpt)
+    {
+        return CHECKPOINT_NULL;
+    }
+
+    /**
+     * The segment is recomputed from a detached copy of its input, so that the rebuilt subgraph
+     * ends at the copy and backpropagating through it does not walk into the outer graph.
+     */
+    struct tensor_allocator *const tensor_alloc = ckpt->allocs->tensor_alloc;
+    const bool needs_input_grad = x->requires_grad && grad_wrt_operand;
+    struct tensor *x_detached = needs_input_grad ? tensor_allocator_alloc(tensor_alloc, x->shape, x->shape_size, x->dtype)
+                                                 : tensor_allocator_no_grad_alloc(tensor_alloc, x->shape, x->shape_size, x->dtype);
+    if (!x_detached)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_copy(x, x_detached);
+    if (err == NO_ERROR)
+    {
+        err = checkpoint_recompute_backward(ckpt, x_detached, grad_wrt_out);
+    }
+
+    // Without a gradient for the input, the recomputation only served the segment parameters
+    if (err == NO_ERROR && needs_input_grad)
+    {
+        err = tensor_copy(x_detached->grad, grad_wrt_operand);
+    }
+
+    tensor_allocator_free(tensor_alloc, x_detached);
+    return err;
+}
+
+static cgrad_error checkpoint_recompute_backward(struct checkpoint *const ckpt, struct tensor *const x_detached, const struct tensor *const grad_wrt_out)
+{
+    // Recomputed activations are consumed right away, spilling them would only add I/O
+    struct tensor_allocator *const tensor_alloc = ckpt->allocs->tensor_alloc;
+    struct tensor_spill_store *const spill = tensor_alloc->spill;
+    tensor_alloc->spill = NULL;
+
+    // The tape is being walked, the segment is rebuilt as a graph of its own
+    struct autograd_tape *const tape = ckpt->allocs->tape;
+    ckpt->allocs->tape = NULL;
+
+    struct tensor *out = NULL;
+    cgrad_error err = ckpt->segment(ckpt->args, x_detached, &out, ckpt->intermediates, true);
+
+    // The rebuilt graph keeps alive whatever its backward saved
+    tensor_list_free_all(ckpt->intermediates, tensor_alloc);
+    if (err == NO_ERROR)
+    {
+        err = backward_with_gradient(out, grad_wrt_out, ckpt->allocs);
+    }
+
+    tensor_allocator_free(tensor_alloc, out);
+    ckpt->allocs->tape = tape;
+    tensor_alloc->spill = spill;
+    return err;
+}
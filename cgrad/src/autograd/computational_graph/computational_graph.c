@@ -14,17 +14,17 @@ void print_computational_graph_node(const struct computational_graph_node *node)
     }
 
     printf("Node: %p\n", (void *)node);
-    printf("├── Parents: %zu\n", node->n_parents);
+    printf("├── Parents: %u\n", node->n_parents);
     // for (size_t i = 0; i < node->n_parents; i++)
     // {
     //     printf("│   ├── Parent %zu: %p (operand %zu)\n",
     //            i, (void *)node->parents[i], node->parents_operands[i]);
     // }
-    printf("├── Children: %zu\n", node->n_children);
-    for (size_t i = 0; i < node->n_children; i++)
+    printf("├── Children: %u\n", node->n_children);
+    for (const struct computational_graph_edge *edge = node->children; edge; edge = edge->next)
     {
-        printf("│   ├── Child %zu: %p\n", i, (void *)node->children[i]);
+        printf("│   ├── Child %zu: %p, backprop function: %p\n", edge->operand, (void *)edge->child, (void *)edge->function);
     }
-    printf("└── Backprop Function: %p\n\n", (void *)node->function);
+    printf("└── Context: %p\n\n", (void *)node->ctx);
 }
 
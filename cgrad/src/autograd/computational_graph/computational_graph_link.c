@@ -1,31 +1,32 @@
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include "cgrad/autograd/tape/autograd_tape.h"
 
 /**
- * @brief Adds a child node to a computational graph node.
+ * @brief Appends an edge from a result node to one of its operand nodes.
  *
- * @param node The parent node.
- * @param child The child node to add.
+ * @param node The node of the result.
+ * @param child The node of the operand.
+ * @param operand The id of the operand in the operation.
+ * @param backprop_function The function computing the gradient with respect to the operand.
+ * @param accumulate_function The function adding it to the gradient of the operand, NULL if none.
+ * @param graph_alloc The allocator of the edge.
  * @return NO_ERROR if successful, otherwise an appropriate error code.
  */
-static cgrad_error add_child(struct computational_graph_node *const node, struct computational_graph_node *const child, const size_t operand);
-
-/**
- * @brief Adds a parent node to a computational graph node.
- *
- * @param node The child node.
- * @param parent The parent node to add.
- * @param operand The operand associated with the parent.
- * @return NO_ERROR if successful, otherwise an appropriate error code.
- */
-static cgrad_error add_parent(struct computational_graph_node *const node, struct computational_graph_node *const parent);
+static cgrad_error add_child(struct computational_graph_node *const node, struct computational_graph_node *const child, const size_t operand, backpropagation_function backprop_function, backpropagation_function accumulate_function, struct computational_graph_allocator *const graph_alloc);
 
 cgrad_error add_computational_graph_link(struct tensor *operand, size_t operand_id, struct tensor *result, backpropagation_function backprop_function, struct allocators *allocs)
+{
+    return add_computational_graph_accumulating_link(operand, operand_id, result, backprop_function, NULL, allocs);
+}
+
+cgrad_error add_computational_graph_accumulating_link(struct tensor *operand, size_t operand_id, struct tensor *result, backpropagation_function backprop_function, backpropagation_function accumulate_function, struct allocators *allocs)
 {
     if (!operand || !result)
     {
         return TENSOR_NULL;
     }
-    if (!operand->grad || !result->grad)
+    // Operands that do not require a gradient, e.g. input data, may come without one
+    if ((!operand->grad && operand->requires_grad) || !result->grad)
     {
         return TENSOR_GRAD_NULL;
     }
@@ -38,87 +39,116 @@ cgrad_error add_computational_graph_link(struct tensor *operand, size_t operand_
         return AUTOGRAD_BACKPROPAGATION_FUNCTION_NULL;
     }
 
-    cgrad_error err = NO_ERROR;
+    // In tape mode the operation is appended to the tape and no node is allocated
+    if (allocs->tape)
+    {
+        return autograd_tape_record_link(allocs->tape, operand, operand_id, result, backprop_function);
+    }
 
-    if (!operand->node)
+    // An existing operand node may already carry edges and saved tensors, only a new one is undone on failure
+    const bool is_new_operand_node = !operand->node;
+    if (is_new_operand_node)
     {
         operand->node = computational_graph_allocator_alloc(allocs->graph_alloc, operand);
         if (!operand->node)
         {
             return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR;
         }
-        if ((err = context_init(&operand->node->ctx, allocs->tensor_alloc)) != NO_ERROR)
-        {
-            return err;
-        }
+        operand->node->tensor_alloc = allocs->tensor_alloc;
     }
 
     if (!result->node)
     {
+        // The result requires a gradient as soon as one of its operands does
+        result->requires_grad = false;
+
         result->node = computational_graph_allocator_alloc(allocs->graph_alloc, result);
         if (!result->node)
         {
-            computational_graph_allocator_free(allocs->graph_alloc, operand->node);
+            if (is_new_operand_node)
+            {
+                computational_graph_allocator_free(allocs->graph_alloc, operand->node);
+            }
             return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR;
         }
-        if ((err = context_init(&result->node->ctx, allocs->tensor_alloc)) != NO_ERROR)
-        {
-            return err;
-        }
-    }
-
-    struct computational_graph_node *op_node = operand->node;
-    struct computational_graph_node *res_node = result->node;
-
-    // Setup connection
-    if ((err = add_parent(op_node, res_node)) != NO_ERROR)
-    {
-        computational_graph_allocator_free(allocs->graph_alloc, op_node);
-        computational_graph_allocator_free(allocs->graph_alloc, res_node);
-        return err;
+        result->node->tensor_alloc = allocs->tensor_alloc;
     }
 
-    if ((err = add_child(res_node, op_node, operand_id)) != NO_ERROR)
+    // Setup connection. The operand itself is not stored in the context:
+    // operations whose backward needs it declare so through context_save_operand.
+    cgrad_error err = add_child(result->node, operand->node, operand_id, backprop_function, accumulate_function, allocs->graph_alloc);
+    if (err != NO_ERROR)
     {
-        computational_graph_allocator_free(allocs->graph_alloc, op_node);
-        computational_graph_allocator_free(allocs->graph_alloc, res_node);
         return err;
     }
 
-    // Setup backpropagation function
-    result->node->function[operand_id] = backprop_function;
-
-    // Setup operand in the tensor operands pointer
-    context_set_operand(&res_node->ctx, operand, operand_id);
+    result->requires_grad = result->requires_grad || operand->requires_grad;
 
     return NO_ERROR;
 }
 
-static cgrad_error add_child(struct computational_graph_node *const node, struct computational_graph_node *const child, const size_t operand)
+struct backpropagation_context *computational_graph_link_context(struct tensor *const result, struct allocators *const allocs)
 {
-    size_t const n_children = node->n_children;
-    if (n_children >= AUTOGRAD_MAX_CHILDREN)
+    if (!result || !allocs)
     {
-        return AUTOGRAD_MAX_CHILDREN_EXCEEDED;
+        return NULL;
+    }
+    if (allocs->tape)
+    {
+        return autograd_tape_context(allocs->tape, result);
     }
 
-    node->children[n_children] = child;
-    node->children_operands[n_children] = operand;
-    node->n_children++;
+    struct computational_graph_node *node = result->node;
+    if (!node)
+    {
+        return NULL;
+    }
 
-    return NO_ERROR;
+    // The context is allocated the first time the operation stores something for backward
+    if (!node->ctx)
+    {
+        struct backpropagation_context *ctx = computational_graph_allocator_alloc_context(allocs->graph_alloc);
+        if (!ctx)
+        {
+            return NULL;
+        }
+        if (context_init(ctx, allocs->tensor_alloc) != NO_ERROR)
+        {
+            computational_graph_allocator_free_context(allocs->graph_alloc, ctx);
+            return NULL;
+        }
+        node->ctx = ctx;
+    }
+
+    return node->ctx;
 }
 
-static cgrad_error add_parent(struct computational_graph_node *const node, struct computational_graph_node *const parent)
+static cgrad_error add_child(struct computational_graph_node *const node, struct computational_graph_node *const child, const size_t operand, backpropagation_function backprop_function, backpropagation_function accumulate_function, struct computational_graph_allocator *const graph_alloc)
 {
-    size_t const n_parents = node->n_parents;
-    if (n_parents >= AUTOGRAD_MAX_PARENTS)
+    struct computational_graph_edge *edge = computational_graph_allocator_alloc_edge(graph_alloc);
+    if (!edge)
+    {
+        return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR;
+    }
+
+    edge->child = child;
+    edge->function = backprop_function;
+    edge->accumulate = accumulate_function;
+    edge->operand = operand;
+    edge->next = NULL;
+
+    if (node->last_child)
+    {
+        node->last_child->next = edge;
+    }
+    else
     {
-        return AUTOGRAD_MAX_PARENTS_EXCEEDED;
+        node->children = edge;
     }
+    node->last_child = edge;
 
-    node->parents[n_parents] = parent;
-    node->n_parents++;
+    node->n_children++;
+    child->n_parents++;
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
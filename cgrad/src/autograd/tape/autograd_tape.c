@@ -0,0 +1,545 @@
+#include "cgrad/autograd/tape/autograd_tape.h"
+#include "cgrad/tensor/tensor_add_inplace.h"
+#include "cgrad/memory/tensor/spill/tensor_spill_store.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Layout of a record in the arena. All the parts are multiples of 8 bytes, so that records stay aligned:
+ *
+ *   tape_record_header | n_operands x tape_record_operand | n_entries x tape_record_entry | trailer
+ *
+ * The trailer repeats the size of the record, so that the arena can be walked in reverse.
+ */
+struct tape_record_header
+{
+    struct tensor *result;
+    uint32_t size;
+    uint16_t n_operands;
+    uint8_t n_entries;
+    uint8_t flags;
+};
+
+struct tape_record_operand
+{
+    struct tensor *t;
+    backpropagation_function function;
+    uint32_t id;
+    uint32_t flags;
+};
+
+typedef enum tape_entry_kind
+{
+    TAPE_ENTRY_SAVED,
+    TAPE_ENTRY_SIZE_T,
+    TAPE_ENTRY_PTR,
+    TAPE_ENTRY_OWNED,
+} tape_entry_kind;
+
+struct tape_record_entry
+{
+    uint8_t kind;
+    context_id id;
+    union
+    {
+        struct tensor *t;
+        size_t size;
+        void *ptr;
+    } value;
+};
+
+typedef uint64_t tape_record_trailer;
+
+typedef enum tape_record_flag
+{
+    TAPE_RECORD_SIDE_EFFECTS = 1 << 0,
+    TAPE_RECORD_RELEASED = 1 << 1,
+} tape_record_flag;
+
+typedef enum tape_operand_flag
+{
+    TAPE_OPERAND_FIRST_USE = 1 << 0, /**< First record of the tape referring to the operand, i.e. the last one backward visits. */
+} tape_operand_flag;
+
+static cgrad_error autograd_tape_seal(struct autograd_tape *const tape);
+static cgrad_error autograd_tape_reserve(struct autograd_tape *const tape, const size_t bytes);
+static cgrad_error autograd_tape_hold(struct autograd_tape *const tape, struct tensor *const t);
+static cgrad_error autograd_tape_record_backward(struct autograd_tape *const tape, struct tape_record_header *const header, struct allocators *const allocs);
+static void autograd_tape_record_decode_context(const struct autograd_tape *const tape, const struct tape_record_header *const header, struct backpropagation_context *const ctx);
+static void autograd_tape_record_release(const struct autograd_tape *const tape, struct tape_record_header *const header);
+static inline void autograd_tape_run_grad_hooks(struct tensor *const t);
+static inline struct tape_record_operand *tape_record_operands(struct tape_record_header *const header);
+static inline struct tape_record_entry *tape_record_entries(struct tape_record_header *const header);
+static inline size_t tape_record_size(const size_t n_operands, const size_t n_entries);
+
+cgrad_error autograd_tape_init(struct autograd_tape *const tape, struct tensor_allocator *const tensor_alloc)
+{
+    if (!tape)
+    {
+        return AUTOGRAD_TAPE_NULL;
+    }
+    if (!tensor_alloc)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+
+    tape->arena = malloc(AUTOGRAD_TAPE_INITIAL_CAPACITY);
+    if (!tape->arena)
+    {
+        return AUTOGRAD_TAPE_ALLOCATION_FAILED;
+    }
+    tape->size = 0;
+    tape->capacity = AUTOGRAD_TAPE_INITIAL_CAPACITY;
+
+    tape->recorded = NULL;
+    tape->n_recorded = 0;
+    tape->recorded_capacity = 0;
+
+    tape->staged_result = NULL;
+    tape->staged_n_operands = 0;
+    tape->tensor_alloc = tensor_alloc;
+
+    return context_init(&tape->staged_ctx, tensor_alloc);
+}
+
+cgrad_error autograd_tape_record_link(struct autograd_tape *const tape, struct tensor *const operand, const size_t operand_id, struct tensor *const result, backpropagation_function backprop_function)
+{
+    if (!tape)
+    {
+        return AUTOGRAD_TAPE_NULL;
+    }
+    if (!operand || !result)
+    {
+        return TENSOR_NULL;
+    }
+
+    cgrad_error err = NO_ERROR;
+
+    // A new result means the previous operation is complete
+    if (result != tape->staged_result)
+    {
+        if ((err = autograd_tape_seal(tape)) != NO_ERROR)
+        {
+            return err;
+        }
+        if ((err = autograd_tape_hold(tape, result)) != NO_ERROR)
+        {
+            return err;
+        }
+        if ((err = context_init(&tape->staged_ctx, tape->tensor_alloc)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        tape->staged_result = result;
+        tape->staged_n_operands = 0;
+
+        // The result requires a gradient as soon as one of its operands does
+        result->requires_grad = false;
+    }
+
+    if (tape->staged_n_operands >= AUTOGRAD_MAX_CHILDREN)
+    {
+        return AUTOGRAD_MAX_CHILDREN_EXCEEDED;
+    }
+
+    // Results are held when they are recorded, so only leaves can be referred to for the first time here
+    const bool is_first_use = !operand->is_recorded;
+    if ((err = autograd_tape_hold(tape, operand)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    const size_t i = tape->staged_n_operands;
+    tape->staged_operands[i] = operand;
+    tape->staged_operand_ids[i] = operand_id;
+    tape->staged_functions[i] = backprop_function;
+    tape->staged_first_uses[i] = is_first_use;
+    tape->staged_n_operands++;
+
+    result->requires_grad = result->requires_grad || operand->requires_grad;
+
+    return NO_ERROR;
+}
+
+struct backpropagation_context *autograd_tape_context(struct autograd_tape *const tape, const struct tensor *const result)
+{
+    if (!tape || !result || result != tape->staged_result)
+    {
+        return NULL;
+    }
+
+    return &tape->staged_ctx;
+}
+
+cgrad_error autograd_tape_backward(struct autograd_tape *const tape, struct tensor *const root, struct allocators *const allocs)
+{
+    if (!tape)
+    {
+        return AUTOGRAD_TAPE_NULL;
+    }
+    if (!root)
+    {
+        return TENSOR_NULL;
+    }
+    if (!allocs)
+    {
+        return ALLOCATORS_NULL;
+    }
+
+    cgrad_error err = autograd_tape_seal(tape);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Operations recorded after root, e.g. metrics, do not contribute to its gradient
+    size_t end = tape->size;
+    while (end > 0)
+    {
+        const tape_record_trailer size = *(tape_record_trailer *)(tape->arena + end - sizeof(tape_record_trailer));
+        const struct tape_record_header *header = (struct tape_record_header *)(tape->arena + end - size);
+        if (header->result == root)
+        {
+            break;
+        }
+        end -= size;
+    }
+
+    if (end == 0)
+    {
+        autograd_tape_clear(tape);
+        return AUTOGRAD_TAPE_RESULT_NOT_RECORDED;
+    }
+
+    while (end > 0 && err == NO_ERROR)
+    {
+        const tape_record_trailer size = *(tape_record_trailer *)(tape->arena + end - sizeof(tape_record_trailer));
+        struct tape_record_header *header = (struct tape_record_header *)(tape->arena + end - size);
+
+        err = autograd_tape_record_backward(tape, header, allocs);
+        end -= size;
+    }
+
+    autograd_tape_clear(tape);
+    return err;
+}
+
+void autograd_tape_clear(struct autograd_tape *const tape)
+{
+    if (!tape)
+    {
+        return;
+    }
+
+    // The staged operation was never encoded, its context still holds what the operation saved
+    if (tape->staged_result)
+    {
+        context_release_saved(&tape->staged_ctx);
+        context_cleanup_owned(&tape->staged_ctx);
+        tape->staged_result = NULL;
+        tape->staged_n_operands = 0;
+    }
+
+    size_t offset = 0;
+    while (offset < tape->size)
+    {
+        struct tape_record_header *header = (struct tape_record_header *)(tape->arena + offset);
+        autograd_tape_record_release(tape, header);
+        offset += header->size;
+    }
+    tape->size = 0;
+
+    // Drop the references of the tape, deallocating whatever the user already freed
+    for (size_t i = 0; i < tape->n_recorded; i++)
+    {
+        struct tensor *t = tape->recorded[i];
+        t->is_recorded = false;
+        tensor_allocator_release(tape->tensor_alloc, t);
+    }
+    tape->n_recorded = 0;
+}
+
+void autograd_tape_cleanup(struct autograd_tape *const tape)
+{
+    if (!tape)
+    {
+        return;
+    }
+
+    autograd_tape_clear(tape);
+    free(tape->arena);
+    free(tape->recorded);
+    tape->arena = NULL;
+    tape->recorded = NULL;
+    tape->capacity = 0;
+    tape->recorded_capacity = 0;
+}
+
+/**
+ * Encodes the staged operation at the end of the arena. Only the context entries the operation set
+ * are stored, and the references taken by context_save_operand move to the record.
+ */
+static cgrad_error autograd_tape_seal(struct autograd_tape *const tape)
+{
+    if (!tape->staged_result)
+    {
+        return NO_ERROR;
+    }
+
+    const struct backpropagation_context *const ctx = &tape->staged_ctx;
+    size_t n_entries = 0;
+    for (size_t i = 0; i < AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE; i++)
+    {
+        n_entries += (ctx->operands[i] != NULL) + (ctx->operands_size_t[i] != 0) + (ctx->operands_ptr[i] != NULL) + (ctx->owned[i] != NULL);
+    }
+
+    const size_t size = tape_record_size(tape->staged_n_operands, n_entries);
+    cgrad_error err = autograd_tape_reserve(tape, size);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tape_record_header *header = (struct tape_record_header *)(tape->arena + tape->size);
+    header->result = tape->staged_result;
+    header->size = (uint32_t)size;
+    header->n_operands = (uint16_t)tape->staged_n_operands;
+    header->n_entries = (uint8_t)n_entries;
+    header->flags = ctx->backward_has_side_effects ? TAPE_RECORD_SIDE_EFFECTS : 0;
+
+    struct tape_record_operand *operands = tape_record_operands(header);
+    for (size_t i = 0; i < tape->staged_n_operands; i++)
+    {
+        operands[i].t = tape->staged_operands[i];
+        operands[i].function = tape->staged_functions[i];
+        operands[i].id = (uint32_t)tape->staged_operand_ids[i];
+        operands[i].flags = tape->staged_first_uses[i] ? TAPE_OPERAND_FIRST_USE : 0;
+    }
+
+    struct tape_record_entry *entry = tape_record_entries(header);
+    for (context_id i = 0; i < AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE; i++)
+    {
+        if (ctx->operands[i])
+        {
+            *entry++ = (struct tape_record_entry){.kind = TAPE_ENTRY_SAVED, .id = i, .value.t = ctx->operands[i]};
+        }
+        if (ctx->operands_size_t[i])
+        {
+            *entry++ = (struct tape_record_entry){.kind = TAPE_ENTRY_SIZE_T, .id = i, .value.size = ctx->operands_size_t[i]};
+        }
+        if (ctx->operands_ptr[i])
+        {
+            *entry++ = (struct tape_record_entry){.kind = TAPE_ENTRY_PTR, .id = i, .value.ptr = ctx->operands_ptr[i]};
+        }
+        if (ctx->owned[i])
+        {
+            *entry++ = (struct tape_record_entry){.kind = TAPE_ENTRY_OWNED, .id = i, .value.t = ctx->owned[i]};
+        }
+    }
+
+    *(tape_record_trailer *)(tape->arena + tape->size + size - sizeof(tape_record_trailer)) = size;
+    tape->size += size;
+
+    tape->staged_result = NULL;
+    tape->staged_n_operands = 0;
+
+    return NO_ERROR;
+}
+
+static cgrad_error autograd_tape_reserve(struct autograd_tape *const tape, const size_t bytes)
+{
+    if (tape->size + bytes <= tape->capacity)
+    {
+        return NO_ERROR;
+    }
+
+    size_t capacity = tape->capacity ? tape->capacity : AUTOGRAD_TAPE_INITIAL_CAPACITY;
+    while (tape->size + bytes > capacity)
+    {
+        capacity *= 2;
+    }
+
+    unsigned char *arena = realloc(tape->arena, capacity);
+    if (!arena)
+    {
+        return AUTOGRAD_TAPE_ALLOCATION_FAILED;
+    }
+
+    tape->arena = arena;
+    tape->capacity = capacity;
+    return NO_ERROR;
+}
+
+/**
+ * Takes a reference on a tensor the first time a record refers to it, so that its gradient outlives
+ * the user freeing it, as graph nodes do.
+ */
+static cgrad_error autograd_tape_hold(struct autograd_tape *const tape, struct tensor *const t)
+{
+    if (t->is_recorded)
+    {
+        return NO_ERROR;
+    }
+
+    if (tape->n_recorded == tape->recorded_capacity)
+    {
+        const size_t capacity = tape->recorded_capacity ? 2 * tape->recorded_capacity : 64;
+        struct tensor **recorded = realloc(tape->recorded, capacity * sizeof(struct tensor *));
+        if (!recorded)
+        {
+            return AUTOGRAD_TAPE_ALLOCATION_FAILED;
+        }
+        tape->recorded = recorded;
+        tape->recorded_capacity = capacity;
+    }
+
+    tape->recorded[tape->n_recorded++] = t;
+    t->is_recorded = true;
+    t->ref_count++;
+
+    return NO_ERROR;
+}
+
+static cgrad_error autograd_tape_record_backward(struct autograd_tape *const tape, struct tape_record_header *const header, struct allocators *const allocs)
+{
+    struct tensor *const result = header->result;
+    cgrad_error err = NO_ERROR;
+
+    struct backpropagation_context ctx;
+    autograd_tape_record_decode_context(tape, header, &ctx);
+
+    // A result without gradient got nothing from the records after it
+    if (result->grad)
+    {
+        // Bring back the saved tensors that were offloaded during forward
+        if (allocs->tensor_alloc->spill)
+        {
+            err = tensor_spill_store_restore_context(allocs->tensor_alloc->spill, &ctx, allocs->tensor_alloc);
+        }
+
+        const struct tape_record_operand *operands = tape_record_operands(header);
+        for (size_t i = 0; i < header->n_operands && err == NO_ERROR; i++)
+        {
+            struct tensor *operand = operands[i].t;
+            if (!operand->requires_grad && !(header->flags & TAPE_RECORD_SIDE_EFFECTS))
+            {
+                continue;
+            }
+
+            // Only run for the side effects of the backward, nothing to accumulate into
+            if (!operand->grad)
+            {
+                err = operands[i].function(&ctx, result->grad, NULL);
+                continue;
+            }
+
+            struct tensor *gradient = tensor_allocator_no_grad_alloc(allocs->tensor_alloc, operand->shape, operand->shape_size, result->grad->dtype);
+            if (!gradient)
+            {
+                err = TENSOR_ALLOCATION_FAILED;
+                break;
+            }
+
+            if ((err = backpropagation_function_check_input(result->grad, gradient)) == NO_ERROR &&
+                (err = operands[i].function(&ctx, result->grad, gradient)) == NO_ERROR)
+            {
+                err = tensor_add_inplace(operand->grad, gradient);
+            }
+
+            tensor_allocator_no_grad_free(allocs->tensor_alloc, gradient);
+        }
+
+        // The upstream gradient of a non-leaf tensor is not needed anymore
+        tensor_allocator_no_grad_free(allocs->tensor_alloc, result->grad);
+        result->grad = NULL;
+    }
+
+    // No record left to visit refers to the leaves first used here, their gradients are final
+    const struct tape_record_operand *operands = tape_record_operands(header);
+    for (size_t i = 0; i < header->n_operands && err == NO_ERROR; i++)
+    {
+        if (operands[i].flags & TAPE_OPERAND_FIRST_USE)
+        {
+            autograd_tape_run_grad_hooks(operands[i].t);
+        }
+    }
+
+    autograd_tape_record_release(tape, header);
+    return err;
+}
+
+// Same hooks as backward runs on the leaves of the graph
+static inline void autograd_tape_run_grad_hooks(struct tensor *const t)
+{
+    if (!t->requires_grad || !t->grad)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < t->n_grad_hooks; i++)
+    {
+        t->grad_hooks[i].fn(t, t->grad_hooks[i].args);
+    }
+}
+
+static void autograd_tape_record_decode_context(const struct autograd_tape *const tape, const struct tape_record_header *const header, struct backpropagation_context *const ctx)
+{
+    context_init(ctx, tape->tensor_alloc);
+    ctx->backward_has_side_effects = header->flags & TAPE_RECORD_SIDE_EFFECTS;
+
+    // The record already holds the references, entries are copied as they are
+    const struct tape_record_entry *entries = tape_record_entries((struct tape_record_header *)header);
+    for (size_t i = 0; i < header->n_entries; i++)
+    {
+        const struct tape_record_entry *entry = &entries[i];
+        switch (entry->kind)
+        {
+        case TAPE_ENTRY_SAVED:
+            ctx->operands[entry->id] = entry->value.t;
+            break;
+        case TAPE_ENTRY_SIZE_T:
+            ctx->operands_size_t[entry->id] = entry->value.size;
+            break;
+        case TAPE_ENTRY_PTR:
+            ctx->operands_ptr[entry->id] = entry->value.ptr;
+            break;
+        case TAPE_ENTRY_OWNED:
+            ctx->owned[entry->id] = entry->value.t;
+            ctx->n_owned++;
+            break;
+        }
+    }
+}
+
+static void autograd_tape_record_release(const struct autograd_tape *const tape, struct tape_record_header *const header)
+{
+    if (header->flags & TAPE_RECORD_RELEASED)
+    {
+        return;
+    }
+
+    struct backpropagation_context ctx;
+    autograd_tape_record_decode_context(tape, header, &ctx);
+    context_release_saved(&ctx);
+    context_cleanup_owned(&ctx);
+
+    header->flags |= TAPE_RECORD_RELEASED;
+}
+
+static inline struct tape_record_operand *tape_record_operands(struct tape_record_header *const header)
+{
+    return (struct tape_record_operand *)(header + 1);
+}
+
+static inline struct tape_record_entry *tape_record_entries(struct tape_record_header *const header)
+{
+    return (struct tape_record_entry *)(tape_record_operands(header) + header->n_operands);
+}
+
+static inline size_t tape_record_size(const size_t n_operands, const size_t n_entries)
+{
+    return sizeof(struct tape_record_header) + n_operands * sizeof(struct tape_record_operand) +
+           n_entries * sizeof(struct tape_record_entry) + sizeof(tape_record_trailer);
+}
@@ -133,7 +133,8 @@ cgrad_error csv_dataset_sample_batch(const struct csv_dataset *const dataset, st
     size_t cols = dataset->cols;
     
     size_t inputs_shape[] = {ixs_batch->size, cols - 1};
-    (*inputs) = tensor_allocator_alloc(tensor_alloc, inputs_shape, sizeof(inputs_shape) / sizeof(size_t), dtype);
+    // Input data never needs a gradient
+    (*inputs) = tensor_allocator_no_grad_alloc(tensor_alloc, inputs_shape, sizeof(inputs_shape) / sizeof(size_t), dtype);
     if (!(*inputs))
     {
         return TENSOR_ALLOCATION_FAILED;
@@ -141,7 +142,7 @@ cgrad_error csv_dataset_sample_batch(const struct csv_dataset *const dataset, st
 
     const size_t COLUMN_VECTOR_COLS = 1;
     size_t targets_shape[] = {ixs_batch->size, COLUMN_VECTOR_COLS};
-    (*targets) = tensor_allocator_alloc(tensor_alloc, targets_shape, sizeof(targets_shape) / sizeof(size_t), dtype);
+    (*targets) = tensor_allocator_no_grad_alloc(tensor_alloc, targets_shape, sizeof(targets_shape) / sizeof(size_t), dtype);
     if (!(*targets))
     {
         return TENSOR_ALLOCATION_FAILED;
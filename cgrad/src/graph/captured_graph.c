@@ -0,0 +1,534 @@
+#include "cgrad/graph/captured_graph.h"
+#include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor2d_mult_lhs_trans.h"
+#include "cgrad/tensor/tensor2d_mult_rhs_trans.h"
+#include "cgrad/tensor/tensor2d_trans.h"
+#include "cgrad/tensor/tensor_trans.h"
+#include "cgrad/tensor/tensor_reshape.h"
+#include "cgrad/tensor/tensor_im2row.h"
+#include "cgrad/tensor/tensor2d_add_row_vector.h"
+#include "cgrad/tensor/tensor_add.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/autograd/backpropagation/saved_tensors.h"
+#include <string.h>
+#include <stdint.h>
+
+static cgrad_error captured_graph_append(struct captured_graph *const graph, const captured_op op, const captured_node_id *const operands, const size_t n_operands, const size_t *const shape, const size_t shape_size, captured_node_id *const id);
+static inline bool captured_graph_is_valid_id(const struct captured_graph *const graph, const captured_node_id id);
+static size_t captured_graph_consumed(const struct captured_graph *const graph, const struct captured_node *const node, const bool use_fusions, const captured_node_id **const ids);
+static cgrad_error captured_graph_run_fusion(const struct captured_graph *const graph, const struct captured_node *const node, struct tensor *const *const values, struct tensor **const out, struct allocators *const allocs);
+static cgrad_error captured_graph_run_node(const struct captured_node *const node, struct tensor *const *const values, struct tensor **const out, const bool track_grad, struct allocators *const allocs);
+static cgrad_error captured_graph_run_mult(const struct captured_node *const node, struct tensor *const lhs, struct tensor *const rhs, struct tensor **const out, const bool track_grad, struct allocators *const allocs);
+static inline size_t shape_data_size(const size_t *const shape, const size_t shape_size);
+
+cgrad_error captured_graph_init(struct captured_graph *const graph)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+
+    graph->n_nodes = 0;
+    graph->n_inputs = 0;
+    graph->n_outputs = 0;
+    graph->n_fusions = 0;
+
+    return NO_ERROR;
+}
+
+void captured_graph_cleanup(struct captured_graph *const graph)
+{
+    if (!graph)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < graph->n_fusions; i++)
+    {
+        pointwise_kernel_cleanup(&graph->fusions[i].kernel);
+    }
+    graph->n_fusions = 0;
+}
+
+cgrad_error captured_graph_input(struct captured_graph *const graph, const size_t *const shape, const size_t shape_size, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!shape || shape_size == 0 || shape_size > TENSOR_MAX_SHAPE_SIZE)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+
+    cgrad_error err = captured_graph_append(graph, CAPTURED_OP_INPUT, NULL, 0, shape, shape_size, id);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    graph->nodes[*id].input_index = graph->n_inputs++;
+    return NO_ERROR;
+}
+
+cgrad_error captured_graph_reshape(struct captured_graph *const graph, const captured_node_id x, const size_t *const shape, const size_t shape_size, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+    if (!shape || shape_size == 0 || shape_size > TENSOR_MAX_SHAPE_SIZE)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+
+    const struct captured_node *node = &graph->nodes[x];
+    if (shape_data_size(shape, shape_size) != shape_data_size(node->shape, node->shape_size))
+    {
+        return TENSOR_RESHAPE_INVALID_SHAPE;
+    }
+
+    return captured_graph_append(graph, CAPTURED_OP_RESHAPE, &x, 1, shape, shape_size, id);
+}
+
+cgrad_error captured_graph_trans2d(struct captured_graph *const graph, const captured_node_id x, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *node = &graph->nodes[x];
+    if (node->shape_size != 2)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+
+    const size_t shape[] = {node->shape[1], node->shape[0]};
+    return captured_graph_append(graph, CAPTURED_OP_TRANS2D, &x, 1, shape, 2, id);
+}
+
+cgrad_error captured_graph_trans(struct captured_graph *const graph, const captured_node_id x, const size_t axis_1, const size_t axis_2, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *node = &graph->nodes[x];
+    if (axis_1 >= node->shape_size || axis_2 >= node->shape_size)
+    {
+        return TENSOR_INDEX_OUT_OF_BOUNDS;
+    }
+
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    memcpy(shape, node->shape, node->shape_size * sizeof(size_t));
+    shape[axis_1] = node->shape[axis_2];
+    shape[axis_2] = node->shape[axis_1];
+
+    cgrad_error err = captured_graph_append(graph, CAPTURED_OP_TRANS, &x, 1, shape, node->shape_size, id);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    graph->nodes[*id].axis_1 = axis_1;
+    graph->nodes[*id].axis_2 = axis_2;
+    return NO_ERROR;
+}
+
+cgrad_error captured_graph_mult(struct captured_graph *const graph, const captured_node_id lhs, const captured_node_id rhs, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, lhs) || !captured_graph_is_valid_id(graph, rhs))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *lhs_node = &graph->nodes[lhs];
+    const struct captured_node *rhs_node = &graph->nodes[rhs];
+    if (lhs_node->shape_size != 2 || rhs_node->shape_size != 2)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+    if (lhs_node->shape[1] != rhs_node->shape[0])
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const captured_node_id operands[] = {lhs, rhs};
+    const size_t shape[] = {lhs_node->shape[0], rhs_node->shape[1]};
+    return captured_graph_append(graph, CAPTURED_OP_MULT, operands, 2, shape, 2, id);
+}
+
+cgrad_error captured_graph_im2row(struct captured_graph *const graph, const captured_node_id x, const captured_node_id kernel, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x) || !captured_graph_is_valid_id(graph, kernel))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *x_node = &graph->nodes[x];
+    const struct captured_node *kernel_node = &graph->nodes[kernel];
+    if (x_node->shape_size != 4 || kernel_node->shape_size != 4)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+    if (x_node->shape[1] != kernel_node->shape[1])
+    {
+        return CONV2D_CHANNELS_MISMATCH;
+    }
+
+    const size_t H_out = x_node->shape[2] - kernel_node->shape[2] + 1;
+    const size_t W_out = x_node->shape[3] - kernel_node->shape[3] + 1;
+    const captured_node_id operands[] = {x, kernel};
+    const size_t shape[] = {H_out * W_out * x_node->shape[0], kernel_node->shape[1] * kernel_node->shape[2] * kernel_node->shape[3]};
+    return captured_graph_append(graph, CAPTURED_OP_IM2ROW, operands, 2, shape, 2, id);
+}
+
+cgrad_error captured_graph_add_row_vector(struct captured_graph *const graph, const captured_node_id x, const captured_node_id v, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x) || !captured_graph_is_valid_id(graph, v))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *x_node = &graph->nodes[x];
+    const struct captured_node *v_node = &graph->nodes[v];
+    if (x_node->shape_size != 2 || v_node->shape_size != 2 || v_node->shape[0] != 1)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+    if (x_node->shape[1] != v_node->shape[1])
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const captured_node_id operands[] = {x, v};
+    return captured_graph_append(graph, CAPTURED_OP_ADD_ROW_VECTOR, operands, 2, x_node->shape, 2, id);
+}
+
+cgrad_error captured_graph_relu(struct captured_graph *const graph, const captured_node_id x, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *node = &graph->nodes[x];
+    return captured_graph_append(graph, CAPTURED_OP_RELU, &x, 1, node->shape, node->shape_size, id);
+}
+
+cgrad_error captured_graph_add(struct captured_graph *const graph, const captured_node_id x, const captured_node_id y, captured_node_id *const id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, x) || !captured_graph_is_valid_id(graph, y))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const struct captured_node *x_node = &graph->nodes[x];
+    const struct captured_node *y_node = &graph->nodes[y];
+    if (x_node->shape_size != y_node->shape_size || memcmp(x_node->shape, y_node->shape, x_node->shape_size * sizeof(size_t)) != 0)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const captured_node_id operands[] = {x, y};
+    return captured_graph_append(graph, CAPTURED_OP_ADD, operands, 2, x_node->shape, x_node->shape_size, id);
+}
+
+cgrad_error captured_graph_mark_output(struct captured_graph *const graph, const captured_node_id id)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!captured_graph_is_valid_id(graph, id))
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+    if (graph->n_outputs >= CAPTURED_GRAPH_MAX_OUTPUTS)
+    {
+        return CAPTURED_GRAPH_FULL;
+    }
+
+    graph->outputs[graph->n_outputs++] = id;
+    return NO_ERROR;
+}
+
+cgrad_error captured_graph_run(const struct captured_graph *const graph, struct tensor **const inputs, struct tensor **const outputs, struct tensor_list *const intermediates, const bool track_grad, struct allocators *const allocs)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!inputs)
+    {
+        return INPUT_NULL;
+    }
+    if (!outputs)
+    {
+        return OUTPUT_NULL;
+    }
+    if (!intermediates)
+    {
+        return INTERMEDIATES_TENSOR_LIST_NULL;
+    }
+
+    cgrad_error err = allocators_is_valid(allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Position of the last live consumer of each node, outputs are never released
+    size_t last_use[CAPTURED_GRAPH_MAX_NODES];
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        last_use[i] = 0;
+        const struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live || (!track_grad && node->is_fused))
+        {
+            continue;
+        }
+
+        const captured_node_id *consumed = NULL;
+        const size_t n_consumed = captured_graph_consumed(graph, node, !track_grad, &consumed);
+        for (size_t j = 0; j < n_consumed; j++)
+        {
+            last_use[consumed[j]] = i;
+        }
+    }
+    for (size_t i = 0; i < graph->n_outputs; i++)
+    {
+        last_use[graph->outputs[i]] = SIZE_MAX;
+    }
+
+    // Dead and fused nodes keep no value
+    struct tensor *values[CAPTURED_GRAPH_MAX_NODES] = {NULL};
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        const struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live)
+        {
+            continue;
+        }
+
+        if (node->op == CAPTURED_OP_INPUT)
+        {
+            struct tensor *input = inputs[node->input_index];
+            if (!input)
+            {
+                return INPUT_NULL;
+            }
+            if (input->shape_size != node->shape_size || memcmp(input->shape, node->shape, node->shape_size * sizeof(size_t)) != 0)
+            {
+                return TENSOR_SHAPE_MISMATCH;
+            }
+            values[i] = input;
+            continue;
+        }
+
+        if (!track_grad && node->is_fused)
+        {
+            continue;
+        }
+
+        if (!track_grad && node->is_fusion_root)
+        {
+            err = captured_graph_run_fusion(graph, node, values, &values[i], allocs);
+        }
+        else
+        {
+            err = captured_graph_run_node(node, values, &values[i], track_grad, allocs);
+        }
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+        if (last_use[i] != SIZE_MAX && (err = tensor_list_add(intermediates, values[i])) != NO_ERROR)
+        {
+            return err;
+        }
+
+        const captured_node_id *consumed = NULL;
+        const size_t n_consumed = captured_graph_consumed(graph, node, !track_grad, &consumed);
+        for (size_t j = 0; j < n_consumed; j++)
+        {
+            const captured_node_id operand = consumed[j];
+            bool is_repeated = false;
+            for (size_t k = 0; k < j; k++)
+            {
+                is_repeated = is_repeated || consumed[k] == operand;
+            }
+            if (last_use[operand] == i && !is_repeated && graph->nodes[operand].op != CAPTURED_OP_INPUT)
+            {
+                if ((err = tensor_release_if_unsaved(values[operand], allocs->tensor_alloc)) != NO_ERROR)
+                {
+                    return err;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < graph->n_outputs; i++)
+    {
+        outputs[i] = values[graph->outputs[i]];
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error captured_graph_run_node(const struct captured_node *const node, struct tensor *const *const values, struct tensor **const out, const bool track_grad, struct allocators *const allocs)
+{
+    struct tensor *x = values[node->operands[0]];
+    struct tensor *y = node->n_operands > 1 ? values[node->operands[1]] : NULL;
+
+    switch (node->op)
+    {
+    case CAPTURED_OP_RESHAPE:
+        return tensor_reshape(x, node->shape, node->shape_size, out, track_grad, allocs);
+    case CAPTURED_OP_TRANS2D:
+        return tensor2d_trans(x, out, track_grad, allocs);
+    case CAPTURED_OP_TRANS:
+        return tensor_trans(x, node->axis_1, node->axis_2, out, track_grad, allocs);
+    case CAPTURED_OP_MULT:
+        return captured_graph_run_mult(node, x, y, out, track_grad, allocs);
+    case CAPTURED_OP_IM2ROW:
+        return tensor_im2row(x, y, out, track_grad, allocs);
+    case CAPTURED_OP_ADD_ROW_VECTOR:
+        return tensor2d_add_row_vector(x, y, out, track_grad, allocs);
+    case CAPTURED_OP_RELU:
+        return relu_forward(x, out, track_grad, allocs);
+    case CAPTURED_OP_ADD:
+        return tensor_add(x, y, out, track_grad, allocs);
+    default:
+        return CAPTURED_GRAPH_INVALID_OPERATION;
+    }
+}
+
+static cgrad_error captured_graph_run_fusion(const struct captured_graph *const graph, const struct captured_node *const node, struct tensor *const *const values, struct tensor **const out, struct allocators *const allocs)
+{
+    const struct captured_fusion *fusion = &graph->fusions[node->fusion_index];
+    const size_t n_inputs = fusion->kernel.program.n_inputs;
+
+    struct tensor *inputs[POINTWISE_PROGRAM_MAX_INPUTS];
+    for (size_t i = 0; i < n_inputs; i++)
+    {
+        inputs[i] = values[fusion->inputs[i]];
+    }
+
+    // Fusions only run untracked, no gradient ever flows to their result
+    *out = tensor_allocator_no_grad_alloc(allocs->tensor_alloc, node->shape, node->shape_size, inputs[0]->dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    return pointwise_kernel_run(&fusion->kernel, inputs, *out);
+}
+
+static cgrad_error captured_graph_run_mult(const struct captured_node *const node, struct tensor *const lhs, struct tensor *const rhs, struct tensor **const out, const bool track_grad, struct allocators *const allocs)
+{
+    if (node->trans_lhs && node->trans_rhs)
+    {
+        return CAPTURED_GRAPH_INVALID_OPERATION;
+    }
+    if (node->trans_lhs)
+    {
+        return tensor2d_mult_lhs_trans(lhs, rhs, out, track_grad, allocs);
+    }
+    if (node->trans_rhs)
+    {
+        return tensor2d_mult_rhs_trans(lhs, rhs, out, track_grad, allocs);
+    }
+
+    return tensor2d_mult(lhs, rhs, out, track_grad, allocs);
+}
+
+static cgrad_error captured_graph_append(struct captured_graph *const graph, const captured_op op, const captured_node_id *const operands, const size_t n_operands, const size_t *const shape, const size_t shape_size, captured_node_id *const id)
+{
+    if (!id)
+    {
+        return OUTPUT_NULL;
+    }
+    if (graph->n_nodes >= CAPTURED_GRAPH_MAX_NODES)
+    {
+        return CAPTURED_GRAPH_FULL;
+    }
+
+    struct captured_node *node = &graph->nodes[graph->n_nodes];
+    memset(node, 0, sizeof(struct captured_node));
+    node->op = op;
+    node->n_operands = n_operands;
+    for (size_t i = 0; i < n_operands; i++)
+    {
+        node->operands[i] = operands[i];
+    }
+    memcpy(node->shape, shape, shape_size * sizeof(size_t));
+    node->shape_size = shape_size;
+    node->is_live = true;
+
+    *id = graph->n_nodes++;
+    return NO_ERROR;
+}
+
+static inline bool captured_graph_is_valid_id(const struct captured_graph *const graph, const captured_node_id id)
+{
+    return id < graph->n_nodes && graph->nodes[id].is_live;
+}
+
+static size_t captured_graph_consumed(const struct captured_graph *const graph, const struct captured_node *const node, const bool use_fusions, const captured_node_id **const ids)
+{
+    // A fusion reads the inputs of its whole region instead of the operands of its root
+    if (use_fusions && node->is_fusion_root)
+    {
+        const struct captured_fusion *fusion = &graph->fusions[node->fusion_index];
+        *ids = fusion->inputs;
+        return fusion->kernel.program.n_inputs;
+    }
+
+    *ids = node->operands;
+    return node->n_operands;
+}
+
+static inline size_t shape_data_size(const size_t *const shape, const size_t shape_size)
+{
+    size_t data_size = 1;
+    for (size_t i = 0; i < shape_size; i++)
+    {
+        data_size *= shape[i];
+    }
+    return data_size;
+}
@@ -0,0 +1,511 @@
+#include "cgrad/graph/captured_graph_passes.h"
+#include <stdio.h>
+#include <string.h>
+
+static void captured_graph_replace_node(struct captured_graph *const graph, const captured_node_id old_id, const captured_node_id new_id);
+static void captured_graph_count_uses(const struct captured_graph *const graph, size_t *const uses);
+static void captured_graph_count_copies(const struct captured_graph *const graph, size_t *const copies, size_t *const copied_elements);
+static inline bool captured_node_is_layout(const struct captured_node *const node);
+static inline bool captured_node_is_pointwise(const struct captured_node *const node);
+static cgrad_error captured_graph_build_fusion(const struct captured_graph *const graph, const bool *const is_member, const captured_node_id root, struct pointwise_program *const program, captured_node_id *const inputs);
+static cgrad_error captured_fusion_input(struct pointwise_program *const program, captured_node_id *const inputs, const captured_node_id id, const pointwise_input_kind kind, size_t *const reg);
+static inline bool captured_nodes_are_identical(const struct captured_node *const a, const struct captured_node *const b);
+static inline bool captured_nodes_have_same_shape(const struct captured_node *const a, const struct captured_node *const b);
+
+cgrad_error captured_graph_optimize(struct captured_graph *const graph, struct captured_graph_report *const report)
+{
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+
+    struct captured_graph_report local_report;
+    struct captured_graph_report *r = report ? report : &local_report;
+    memset(r, 0, sizeof(struct captured_graph_report));
+
+    // Copies are counted on what would run, i.e. without the nodes that are dead already
+    r->dead_nodes_eliminated += captured_graph_eliminate_dead_nodes(graph);
+    captured_graph_count_copies(graph, &r->copies_before, &r->copied_elements_before);
+
+    // A rewrite may enable another one, e.g. CSE of two reshapes exposes a transposition of a transposition
+    size_t changes = 0;
+    do
+    {
+        const size_t cancelled = captured_graph_cancel_transposes(graph);
+        const size_t merged = captured_graph_merge_reshapes(graph);
+        const size_t eliminated = captured_graph_eliminate_common_subexpressions(graph);
+        const size_t folded = captured_graph_fold_transposes(graph);
+
+        r->transposes_cancelled += cancelled;
+        r->reshapes_merged += merged;
+        r->subexpressions_eliminated += eliminated;
+        r->transposes_folded += folded;
+        changes = cancelled + merged + eliminated + folded;
+    } while (changes > 0);
+
+    r->dead_nodes_eliminated += captured_graph_eliminate_dead_nodes(graph);
+    captured_graph_count_copies(graph, &r->copies_after, &r->copied_elements_after);
+
+    return NO_ERROR;
+}
+
+size_t captured_graph_cancel_transposes(struct captured_graph *const graph)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        const struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live || (node->op != CAPTURED_OP_TRANS2D && node->op != CAPTURED_OP_TRANS))
+        {
+            continue;
+        }
+
+        const struct captured_node *source = &graph->nodes[node->operands[0]];
+        if (source->op != node->op)
+        {
+            continue;
+        }
+
+        // Swapping the same two axes twice is the identity, in either order
+        const bool same_axes = node->op == CAPTURED_OP_TRANS2D ||
+                               (node->axis_1 == source->axis_1 && node->axis_2 == source->axis_2) ||
+                               (node->axis_1 == source->axis_2 && node->axis_2 == source->axis_1);
+        if (same_axes)
+        {
+            captured_graph_replace_node(graph, i, source->operands[0]);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+size_t captured_graph_fold_transposes(struct captured_graph *const graph)
+{
+    size_t uses[CAPTURED_GRAPH_MAX_NODES];
+    size_t count = 0;
+
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live)
+        {
+            continue;
+        }
+
+        if (node->op == CAPTURED_OP_MULT)
+        {
+            // op(T(A)) reads A with the opposite flag. Both flags set is not supported by the products.
+            const struct captured_node *lhs = &graph->nodes[node->operands[0]];
+            if (lhs->op == CAPTURED_OP_TRANS2D && !node->trans_rhs)
+            {
+                node->operands[0] = lhs->operands[0];
+                node->trans_lhs = !node->trans_lhs;
+                count++;
+            }
+
+            const struct captured_node *rhs = &graph->nodes[node->operands[1]];
+            if (rhs->op == CAPTURED_OP_TRANS2D && !node->trans_lhs)
+            {
+                node->operands[1] = rhs->operands[0];
+                node->trans_rhs = !node->trans_rhs;
+                count++;
+            }
+            continue;
+        }
+
+        if (node->op == CAPTURED_OP_TRANS2D)
+        {
+            captured_graph_count_uses(graph, uses);
+
+            // (op(A)*op(B))^T = op(B)^T*op(A)^T, worth it only if the product is not needed as it is
+            const captured_node_id source_id = node->operands[0];
+            const struct captured_node *source = &graph->nodes[source_id];
+            if (source->op != CAPTURED_OP_MULT || uses[source_id] != 1)
+            {
+                continue;
+            }
+
+            const bool trans_lhs = !source->trans_rhs;
+            const bool trans_rhs = !source->trans_lhs;
+            if (trans_lhs && trans_rhs)
+            {
+                continue;
+            }
+
+            const captured_node_id lhs = source->operands[1];
+            const captured_node_id rhs = source->operands[0];
+            node->op = CAPTURED_OP_MULT;
+            node->n_operands = 2;
+            node->operands[0] = lhs;
+            node->operands[1] = rhs;
+            node->trans_lhs = trans_lhs;
+            node->trans_rhs = trans_rhs;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+size_t captured_graph_merge_reshapes(struct captured_graph *const graph)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live || node->op != CAPTURED_OP_RESHAPE)
+        {
+            continue;
+        }
+
+        // Only the final shape matters
+        const struct captured_node *source = &graph->nodes[node->operands[0]];
+        if (source->op == CAPTURED_OP_RESHAPE)
+        {
+            node->operands[0] = source->operands[0];
+            source = &graph->nodes[node->operands[0]];
+            count++;
+        }
+
+        if (captured_nodes_have_same_shape(node, source))
+        {
+            captured_graph_replace_node(graph, i, node->operands[0]);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+size_t captured_graph_eliminate_common_subexpressions(struct captured_graph *const graph)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        const struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live || node->op == CAPTURED_OP_INPUT)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < i; j++)
+        {
+            if (graph->nodes[j].is_live && captured_nodes_are_identical(&graph->nodes[j], node))
+            {
+                captured_graph_replace_node(graph, i, j);
+                count++;
+                break;
+            }
+        }
+    }
+
+    return count;
+}
+
+size_t captured_graph_eliminate_dead_nodes(struct captured_graph *const graph)
+{
+    bool is_needed[CAPTURED_GRAPH_MAX_NODES] = {false};
+    for (size_t i = 0; i < graph->n_outputs; i++)
+    {
+        is_needed[graph->outputs[i]] = true;
+    }
+
+    // Operands precede their users, a single backward sweep reaches every needed node
+    for (size_t i = graph->n_nodes; i-- > 0;)
+    {
+        const struct captured_node *node = &graph->nodes[i];
+        if (!is_needed[i] || !node->is_live)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < node->n_operands; j++)
+        {
+            is_needed[node->operands[j]] = true;
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        struct captured_node *node = &graph->nodes[i];
+        if (node->is_live && !is_needed[i] && node->op != CAPTURED_OP_INPUT)
+        {
+            node->is_live = false;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+size_t captured_graph_fuse_pointwise(struct captured_graph *const graph, const char *const cache_dir)
+{
+    size_t uses[CAPTURED_GRAPH_MAX_NODES];
+    captured_graph_count_uses(graph, uses);
+
+    bool is_output[CAPTURED_GRAPH_MAX_NODES] = {false};
+    for (size_t i = 0; i < graph->n_outputs; i++)
+    {
+        is_output[graph->outputs[i]] = true;
+    }
+
+    size_t count = 0;
+    for (size_t root = graph->n_nodes; root-- > 0 && graph->n_fusions < CAPTURED_GRAPH_MAX_FUSIONS;)
+    {
+        struct captured_node *root_node = &graph->nodes[root];
+        if (!root_node->is_live || !captured_node_is_pointwise(root_node) || root_node->is_fused || root_node->is_fusion_root)
+        {
+            continue;
+        }
+
+        // Operands precede their users, members are found by a single backward sweep from the root
+        bool is_member[CAPTURED_GRAPH_MAX_NODES] = {false};
+        is_member[root] = true;
+        size_t n_members = 1;
+        for (size_t i = root + 1; i-- > 0 && n_members < POINTWISE_PROGRAM_MAX_INSTRUCTIONS / 2;)
+        {
+            if (!is_member[i])
+            {
+                continue;
+            }
+
+            // The row vector of a bias addition is broadcast, it is never computed within the fusion
+            const struct captured_node *member = &graph->nodes[i];
+            const size_t n_full_operands = member->op == CAPTURED_OP_ADD_ROW_VECTOR ? 1 : member->n_operands;
+            for (size_t j = 0; j < n_full_operands; j++)
+            {
+                const captured_node_id operand = member->operands[j];
+                const struct captured_node *operand_node = &graph->nodes[operand];
+                const bool can_fuse = captured_node_is_pointwise(operand_node) && !operand_node->is_fused && !operand_node->is_fusion_root &&
+                                      uses[operand] == 1 && !is_output[operand] && captured_nodes_have_same_shape(operand_node, root_node);
+                if (can_fuse && !is_member[operand])
+                {
+                    is_member[operand] = true;
+                    n_members++;
+                }
+            }
+        }
+
+        // A single node already makes a single pass
+        if (n_members < 2)
+        {
+            continue;
+        }
+
+        struct captured_fusion *fusion = &graph->fusions[graph->n_fusions];
+        struct pointwise_program program;
+        if (captured_graph_build_fusion(graph, is_member, root, &program, fusion->inputs) != NO_ERROR)
+        {
+            continue;
+        }
+        if (pointwise_kernel_init(&fusion->kernel, &program) != NO_ERROR)
+        {
+            continue;
+        }
+
+        // Without a compiler the kernel is interpreted, which still saves the intermediate tensors
+        pointwise_kernel_compile(&fusion->kernel, cache_dir);
+
+        for (size_t i = 0; i < root; i++)
+        {
+            graph->nodes[i].is_fused = graph->nodes[i].is_fused || is_member[i];
+        }
+        root_node->is_fusion_root = true;
+        root_node->fusion_index = graph->n_fusions++;
+        count += n_members;
+    }
+
+    return count;
+}
+
+void captured_graph_print_report(const struct captured_graph_report *const report)
+{
+    if (!report)
+    {
+        printf("[NULL REPORT]\n");
+        return;
+    }
+
+    printf("Captured graph passes:\n");
+    printf("├── Transposes cancelled: %zu\n", report->transposes_cancelled);
+    printf("├── Transposes folded into products: %zu\n", report->transposes_folded);
+    printf("├── Reshapes merged: %zu\n", report->reshapes_merged);
+    printf("├── Common subexpressions eliminated: %zu\n", report->subexpressions_eliminated);
+    printf("├── Dead nodes eliminated: %zu\n", report->dead_nodes_eliminated);
+    printf("└── Copies: %zu -> %zu (%zu removed), copied elements: %zu -> %zu\n",
+           report->copies_before, report->copies_after, report->copies_before - report->copies_after,
+           report->copied_elements_before, report->copied_elements_after);
+}
+
+static void captured_graph_replace_node(struct captured_graph *const graph, const captured_node_id old_id, const captured_node_id new_id)
+{
+    // Nothing reads the old node anymore
+    graph->nodes[old_id].is_live = false;
+
+    for (size_t i = old_id + 1; i < graph->n_nodes; i++)
+    {
+        struct captured_node *node = &graph->nodes[i];
+        for (size_t j = 0; j < node->n_operands; j++)
+        {
+            if (node->operands[j] == old_id)
+            {
+                node->operands[j] = new_id;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < graph->n_outputs; i++)
+    {
+        if (graph->outputs[i] == old_id)
+        {
+            graph->outputs[i] = new_id;
+        }
+    }
+}
+
+static void captured_graph_count_uses(const struct captured_graph *const graph, size_t *const uses)
+{
+    memset(uses, 0, graph->n_nodes * sizeof(size_t));
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        const struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live)
+        {
+            continue;
+        }
+        for (size_t j = 0; j < node->n_operands; j++)
+        {
+            uses[node->operands[j]]++;
+        }
+    }
+    for (size_t i = 0; i < graph->n_outputs; i++)
+    {
+        uses[graph->outputs[i]]++;
+    }
+}
+
+static void captured_graph_count_copies(const struct captured_graph *const graph, size_t *const copies, size_t *const copied_elements)
+{
+    *copies = 0;
+    *copied_elements = 0;
+    for (size_t i = 0; i < graph->n_nodes; i++)
+    {
+        const struct captured_node *node = &graph->nodes[i];
+        if (!node->is_live || !captured_node_is_layout(node))
+        {
+            continue;
+        }
+
+        size_t data_size = 1;
+        for (size_t j = 0; j < node->shape_size; j++)
+        {
+            data_size *= node->shape[j];
+        }
+
+        (*copies)++;
+        *copied_elements += data_size;
+    }
+}
+
+static inline bool captured_node_is_layout(const struct captured_node *const node)
+{
+    return node->op == CAPTURED_OP_RESHAPE || node->op == CAPTURED_OP_TRANS2D || node->op == CAPTURED_OP_TRANS;
+}
+
+static inline bool captured_node_is_pointwise(const struct captured_node *const node)
+{
+    return node->op == CAPTURED_OP_ADD || node->op == CAPTURED_OP_ADD_ROW_VECTOR || node->op == CAPTURED_OP_RELU;
+}
+
+static cgrad_error captured_graph_build_fusion(const struct captured_graph *const graph, const bool *const is_member, const captured_node_id root, struct pointwise_program *const program, captured_node_id *const inputs)
+{
+    cgrad_error err = pointwise_program_init(program);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Register holding the value of each member, in execution order
+    size_t registers[CAPTURED_GRAPH_MAX_NODES];
+    for (size_t i = 0; i <= root; i++)
+    {
+        if (!is_member[i])
+        {
+            continue;
+        }
+
+        const struct captured_node *node = &graph->nodes[i];
+        size_t operand_registers[CAPTURED_NODE_MAX_OPERANDS];
+        for (size_t j = 0; j < node->n_operands; j++)
+        {
+            const captured_node_id operand = node->operands[j];
+            const bool is_row = node->op == CAPTURED_OP_ADD_ROW_VECTOR && j == 1;
+            if (is_member[operand] && !is_row)
+            {
+                operand_registers[j] = registers[operand];
+                continue;
+            }
+
+            const pointwise_input_kind kind = is_row ? POINTWISE_INPUT_ROW : POINTWISE_INPUT_FULL;
+            if ((err = captured_fusion_input(program, inputs, operand, kind, &operand_registers[j])) != NO_ERROR)
+            {
+                return err;
+            }
+        }
+
+        if (node->op == CAPTURED_OP_RELU)
+        {
+            err = pointwise_program_relu(program, operand_registers[0], &registers[i]);
+        }
+        else
+        {
+            err = pointwise_program_add(program, operand_registers[0], operand_registers[1], &registers[i]);
+        }
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error captured_fusion_input(struct pointwise_program *const program, captured_node_id *const inputs, const captured_node_id id, const pointwise_input_kind kind, size_t *const reg)
+{
+    // A node read twice is loaded once
+    for (size_t k = 0; k < program->n_instructions; k++)
+    {
+        const struct pointwise_instruction *instruction = &program->instructions[k];
+        if (instruction->op == POINTWISE_OP_LOAD && inputs[instruction->a] == id && program->input_kinds[instruction->a] == kind)
+        {
+            *reg = k;
+            return NO_ERROR;
+        }
+    }
+
+    inputs[program->n_inputs] = id;
+    return pointwise_program_load(program, kind, reg);
+}
+
+static inline bool captured_nodes_are_identical(const struct captured_node *const a, const struct captured_node *const b)
+{
+    if (a->op != b->op || a->n_operands != b->n_operands || !captured_nodes_have_same_shape(a, b))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a->n_operands; i++)
+    {
+        if (a->operands[i] != b->operands[i])
+        {
+            return false;
+        }
+    }
+
+    return a->axis_1 == b->axis_1 && a->axis_2 == b->axis_2 && a->trans_lhs == b->trans_lhs && a->trans_rhs == b->trans_rhs;
+}
+
+static inline bool captured_nodes_have_same_shape(const struct captured_node *const a, const struct captured_node *const b)
+{
+    return a->shape_size == b->shape_size && memcmp(a->shape, b->shape, a->shape_size * sizeof(size_t)) == 0;
+}
@@ -0,0 +1,688 @@
+#include "cgrad/graph/pointwise_kernel.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define POINTWISE_SOURCE_CAPACITY 16384
+#define POINTWISE_PATH_CAPACITY 4096
+
+struct pointwise_source
+{
+    char text[POINTWISE_SOURCE_CAPACITY];
+    size_t length;
+    bool is_truncated;
+};
+
+static cgrad_error pointwise_program_append(struct pointwise_program *const program, const pointwise_opcode op, const size_t a, const size_t b, size_t *const reg);
+static void pointwise_source_append(struct pointwise_source *const source, const char *const format, ...);
+static void pointwise_source_generate(const struct pointwise_program *const program, struct pointwise_source *const source);
+static void pointwise_source_generate_function(const struct pointwise_program *const program, const char *const type, const char *const suffix, struct pointwise_source *const source);
+static uint64_t fnv1a_64(uint64_t hash, const char *const text, const size_t length);
+static cgrad_error pointwise_cache_dir_resolve(const char *const cache_dir, char *const dir, const size_t capacity);
+static bool pointwise_path_is_private(const char *const path, const mode_t type);
+static cgrad_error pointwise_compiler_run(const char *const cc, const char *const so_path, const char *const c_path);
+static cgrad_error pointwise_kernel_load(struct pointwise_kernel *const kernel, const char *const so_path);
+static void pointwise_interpret_f64(const struct pointwise_program *const program, const double *const *const in, double *const out, const size_t rows, const size_t cols);
+static void pointwise_interpret_f32(const struct pointwise_program *const program, const float *const *const in, float *const out, const size_t rows, const size_t cols);
+
+cgrad_error pointwise_program_init(struct pointwise_program *const program)
+{
+    if (!program)
+    {
+        return POINTWISE_PROGRAM_NULL;
+    }
+
+    program->n_instructions = 0;
+    program->n_inputs = 0;
+
+    return NO_ERROR;
+}
+
+cgrad_error pointwise_program_load(struct pointwise_program *const program, const pointwise_input_kind kind, size_t *const reg)
+{
+    if (!program)
+    {
+        return POINTWISE_PROGRAM_NULL;
+    }
+    if (program->n_inputs >= POINTWISE_PROGRAM_MAX_INPUTS)
+    {
+        return POINTWISE_PROGRAM_FULL;
+    }
+
+    cgrad_error err = pointwise_program_append(program, POINTWISE_OP_LOAD, program->n_inputs, 0, reg);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    program->input_kinds[program->n_inputs++] = kind;
+    return NO_ERROR;
+}
+
+cgrad_error pointwise_program_add(struct pointwise_program *const program, const size_t a, const size_t b, size_t *const reg)
+{
+    if (!program)
+    {
+        return POINTWISE_PROGRAM_NULL;
+    }
+    if (a >= program->n_instructions || b >= program->n_instructions)
+    {
+        return POINTWISE_PROGRAM_INVALID_REGISTER;
+    }
+
+    return pointwise_program_append(program, POINTWISE_OP_ADD, a, b, reg);
+}
+
+cgrad_error pointwise_program_relu(struct pointwise_program *const program, const size_t a, size_t *const reg)
+{
+    if (!program)
+    {
+        return POINTWISE_PROGRAM_NULL;
+    }
+    if (a >= program->n_instructions)
+    {
+        return POINTWISE_PROGRAM_INVALID_REGISTER;
+    }
+
+    return pointwise_program_append(program, POINTWISE_OP_RELU, a, 0, reg);
+}
+
+cgrad_error pointwise_kernel_init(struct pointwise_kernel *const kernel, const struct pointwise_program *const program)
+{
+    if (!kernel)
+    {
+        return POINTWISE_KERNEL_NULL;
+    }
+    if (!program)
+    {
+        return POINTWISE_PROGRAM_NULL;
+    }
+
+    kernel->program = *program;
+    kernel->f64 = NULL;
+    kernel->f32 = NULL;
+    kernel->handle = NULL;
+    kernel->hash = 0;
+
+    return NO_ERROR;
+}
+
+cgrad_error pointwise_kernel_compile(struct pointwise_kernel *const kernel, const char *const cache_dir)
+{
+    if (!kernel)
+    {
+        return POINTWISE_KERNEL_NULL;
+    }
+    if (pointwise_kernel_is_compiled(kernel))
+    {
+        return NO_ERROR;
+    }
+
+    const char *cc = getenv("CC");
+    if (!cc || cc[0] == '\0')
+    {
+        cc = POINTWISE_KERNEL_CC;
+    }
+
+    char dir[POINTWISE_PATH_CAPACITY];
+    cgrad_error err = pointwise_cache_dir_resolve(cache_dir, dir, sizeof(dir));
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct pointwise_source source;
+    source.length = 0;
+    source.is_truncated = false;
+    pointwise_source_generate(&kernel->program, &source);
+    if (source.is_truncated)
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    // The same source compiled differently is a different shared object
+    uint64_t hash = fnv1a_64(UINT64_C(14695981039346656037), source.text, source.length);
+    hash = fnv1a_64(hash, cc, strlen(cc) + 1);
+    const char *const cflags[] = {POINTWISE_KERNEL_CFLAGS};
+    for (size_t i = 0; i < sizeof(cflags) / sizeof(cflags[0]); i++)
+    {
+        hash = fnv1a_64(hash, cflags[i], strlen(cflags[i]) + 1);
+    }
+
+    // Objects are built for the CPU of the host, a cache shared with other hosts must not mix them
+    struct utsname host;
+    if (uname(&host) != 0)
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+    hash = fnv1a_64(hash, host.nodename, strlen(host.nodename) + 1);
+    hash = fnv1a_64(hash, host.machine, strlen(host.machine) + 1);
+    kernel->hash = hash;
+
+    char so_path[POINTWISE_PATH_CAPACITY];
+    char c_path[POINTWISE_PATH_CAPACITY];
+    char tmp_path[POINTWISE_PATH_CAPACITY];
+    const unsigned long long hash_value = (unsigned long long)hash;
+    if (snprintf(so_path, sizeof(so_path), "%s/pointwise_%016llx.so", dir, hash_value) >= (int)sizeof(so_path) ||
+        snprintf(c_path, sizeof(c_path), "%s/pointwise_%016llx.%ld.c", dir, hash_value, (long)getpid()) >= (int)sizeof(c_path) ||
+        snprintf(tmp_path, sizeof(tmp_path), "%s/pointwise_%016llx.%ld.tmp", dir, hash_value, (long)getpid()) >= (int)sizeof(tmp_path))
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    // Only objects we built ourselves and nobody else can have replaced are loaded
+    struct stat so_stat;
+    if (lstat(so_path, &so_stat) == 0)
+    {
+        if (!pointwise_path_is_private(so_path, S_IFREG))
+        {
+            return POINTWISE_KERNEL_LOADING_FAILED;
+        }
+        if (pointwise_kernel_load(kernel, so_path) == NO_ERROR)
+        {
+            return NO_ERROR;
+        }
+    }
+
+    const int fd = open(c_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    if (fd < 0)
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+    FILE *file = fdopen(fd, "w");
+    if (!file)
+    {
+        close(fd);
+        remove(c_path);
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+    const bool is_written = fwrite(source.text, 1, source.length, file) == source.length;
+    if (fclose(file) != 0 || !is_written)
+    {
+        remove(c_path);
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    err = pointwise_compiler_run(cc, tmp_path, c_path);
+    remove(c_path);
+    if (err != NO_ERROR)
+    {
+        remove(tmp_path);
+        return err;
+    }
+
+    // Processes compiling the same kernel concurrently each publish a complete shared object, which
+    // stays private whatever the umask
+    if (chmod(tmp_path, 0700) != 0 || rename(tmp_path, so_path) != 0)
+    {
+        remove(tmp_path);
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    return pointwise_kernel_load(kernel, so_path);
+}
+
+bool pointwise_kernel_is_compiled(const struct pointwise_kernel *const kernel)
+{
+    return kernel && kernel->handle != NULL;
+}
+
+cgrad_error pointwise_kernel_run(const struct pointwise_kernel *const kernel, struct tensor *const *const inputs, struct tensor *const out)
+{
+    if (!kernel)
+    {
+        return POINTWISE_KERNEL_NULL;
+    }
+    if (!inputs)
+    {
+        return INPUT_NULL;
+    }
+    if (!out)
+    {
+        return TENSOR_NULL;
+    }
+    if (!out->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+
+    const struct pointwise_program *program = &kernel->program;
+    if (program->n_instructions == 0)
+    {
+        return POINTWISE_PROGRAM_INVALID_REGISTER;
+    }
+
+    const size_t cols = out->shape[out->shape_size - 1];
+    const size_t rows = cols > 0 ? out->data_size / cols : 0;
+
+    const void *in[POINTWISE_PROGRAM_MAX_INPUTS];
+    for (size_t i = 0; i < program->n_inputs; i++)
+    {
+        const struct tensor *input = inputs[i];
+        if (!input)
+        {
+            return TENSOR_NULL;
+        }
+        if (!input->data)
+        {
+            return TENSOR_DATA_NULL;
+        }
+        if (input->dtype != out->dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+
+        const size_t expected_size = program->input_kinds[i] == POINTWISE_INPUT_ROW ? cols : out->data_size;
+        if (input->data_size != expected_size)
+        {
+            return TENSOR_SHAPE_MISMATCH;
+        }
+        in[i] = input->data;
+    }
+
+    switch (out->dtype)
+    {
+    case DTYPE_FLOAT64:
+        if (kernel->f64)
+        {
+            kernel->f64(out->data, (const double *const *)in, rows, cols);
+        }
+        else
+        {
+            pointwise_interpret_f64(program, (const double *const *)in, out->data, rows, cols);
+        }
+        return NO_ERROR;
+    case DTYPE_FLOAT32:
+        if (kernel->f32)
+        {
+            kernel->f32(out->data, (const float *const *)in, rows, cols);
+        }
+        else
+        {
+            pointwise_interpret_f32(program, (const float *const *)in, out->data, rows, cols);
+        }
+        return NO_ERROR;
+    default:
+        return TENSOR_DTYPE_MISMATCH;
+    }
+}
+
+void pointwise_kernel_cleanup(struct pointwise_kernel *const kernel)
+{
+    if (!kernel)
+    {
+        return;
+    }
+
+    if (kernel->handle)
+    {
+        dlclose(kernel->handle);
+    }
+    kernel->handle = NULL;
+    kernel->f64 = NULL;
+    kernel->f32 = NULL;
+}
+
+static cgrad_error pointwise_program_append(struct pointwise_program *const program, const pointwise_opcode op, const size_t a, const size_t b, size_t *const reg)
+{
+    if (!reg)
+    {
+        return OUTPUT_NULL;
+    }
+    if (program->n_instructions >= POINTWISE_PROGRAM_MAX_INSTRUCTIONS)
+    {
+        return POINTWISE_PROGRAM_FULL;
+    }
+
+    struct pointwise_instruction *instruction = &program->instructions[program->n_instructions];
+    instruction->op = op;
+    instruction->a = a;
+    instruction->b = b;
+
+    *reg = program->n_instructions++;
+    return NO_ERROR;
+}
+
+static void pointwise_source_append(struct pointwise_source *const source, const char *const format, ...)
+{
+    if (source->is_truncated)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    const size_t available = POINTWISE_SOURCE_CAPACITY - source->length;
+    const int written = vsnprintf(source->text + source->length, available, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= available)
+    {
+        source->is_truncated = true;
+        return;
+    }
+    source->length += (size_t)written;
+}
+
+static void pointwise_source_generate(const struct pointwise_program *const program, struct pointwise_source *const source)
+{
+    pointwise_source_append(source, "#include <stddef.h>\n");
+    pointwise_source_generate_function(program, "double", "f64", source);
+    pointwise_source_generate_function(program, "float", "f32", source);
+}
+
+static void pointwise_source_generate_function(const struct pointwise_program *const program, const char *const type, const char *const suffix, struct pointwise_source *const source)
+{
+    pointwise_source_append(source, "\nvoid cgrad_pointwise_%s(%s *restrict out, const %s *const *in, const size_t rows, const size_t cols)\n{\n", suffix, type, type);
+    for (size_t i = 0; i < program->n_inputs; i++)
+    {
+        pointwise_source_append(source, "    const %s *restrict in%zu = in[%zu];\n", type, i, i);
+    }
+
+    pointwise_source_append(source, "    for (size_t i = 0; i < rows; i++)\n    {\n");
+    pointwise_source_append(source, "        %s *restrict out_row = out + i * cols;\n", type);
+    for (size_t i = 0; i < program->n_inputs; i++)
+    {
+        if (program->input_kinds[i] == POINTWISE_INPUT_FULL)
+        {
+            pointwise_source_append(source, "        const %s *restrict in%zu_row = in%zu + i * cols;\n", type, i, i);
+        }
+        else
+        {
+            pointwise_source_append(source, "        const %s *restrict in%zu_row = in%zu;\n", type, i, i);
+        }
+    }
+
+    // Every operand is read once and every result written once, the loop vectorizes as a whole
+    pointwise_source_append(source, "#pragma GCC ivdep\n        for (size_t j = 0; j < cols; j++)\n        {\n");
+    for (size_t k = 0; k < program->n_instructions; k++)
+    {
+        const struct pointwise_instruction *instruction = &program->instructions[k];
+        switch (instruction->op)
+        {
+        case POINTWISE_OP_LOAD:
+            pointwise_source_append(source, "            const %s v%zu = in%zu_row[j];\n", type, k, instruction->a);
+            break;
+        case POINTWISE_OP_ADD:
+            pointwise_source_append(source, "            const %s v%zu = v%zu + v%zu;\n", type, k, instruction->a, instruction->b);
+            break;
+        case POINTWISE_OP_RELU:
+            pointwise_source_append(source, "            const %s v%zu = v%zu > 0 ? v%zu : 0;\n", type, k, instruction->a, instruction->a);
+            break;
+        }
+    }
+    pointwise_source_append(source, "            out_row[j] = v%zu;\n        }\n    }\n}\n", program->n_instructions - 1);
+}
+
+static uint64_t fnv1a_64(uint64_t hash, const char *const text, const size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)text[i];
+        hash *= UINT64_C(1099511628211);
+    }
+
+    return hash;
+}
+
+/**
+ * Resolves the cache directory, by default $XDG_CACHE_HOME/cgrad-kernels, else $HOME/.cache/cgrad-kernels,
+ * and creates it if needed. Shared objects are loaded into the process from there, so the directory
+ * must belong to the effective user and be writable by nobody else.
+ */
+static cgrad_error pointwise_cache_dir_resolve(const char *const cache_dir, char *const dir, const size_t capacity)
+{
+    if (cache_dir)
+    {
+        if (snprintf(dir, capacity, "%s", cache_dir) >= (int)capacity)
+        {
+            return POINTWISE_KERNEL_COMPILATION_FAILED;
+        }
+    }
+    else
+    {
+        char parent[POINTWISE_PATH_CAPACITY];
+        const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        int length = -1;
+        if (xdg_cache_home && xdg_cache_home[0] == '/')
+        {
+            length = snprintf(parent, sizeof(parent), "%s", xdg_cache_home);
+        }
+        else if (home && home[0] == '/')
+        {
+            length = snprintf(parent, sizeof(parent), "%s/.cache", home);
+        }
+        if (length < 0 || length >= (int)sizeof(parent))
+        {
+            return POINTWISE_KERNEL_COMPILATION_FAILED;
+        }
+
+        if (mkdir(parent, 0700) != 0 && errno != EEXIST)
+        {
+            return POINTWISE_KERNEL_COMPILATION_FAILED;
+        }
+        if (snprintf(dir, capacity, "%s/%s", parent, POINTWISE_KERNEL_CACHE_SUBDIR) >= (int)capacity)
+        {
+            return POINTWISE_KERNEL_COMPILATION_FAILED;
+        }
+    }
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST)
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    // An existing directory is only trusted if nobody else could have planted objects in it
+    if (!pointwise_path_is_private(dir, S_IFDIR))
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+// Whether path is of the given type, not a symbolic link, owned by the effective user and writable only by them
+static bool pointwise_path_is_private(const char *const path, const mode_t type)
+{
+    struct stat path_stat;
+    if (lstat(path, &path_stat) != 0)
+    {
+        return false;
+    }
+
+    return (path_stat.st_mode & S_IFMT) == type && path_stat.st_uid == geteuid() && (path_stat.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+// Runs the compiler directly, without a shell, so that neither CC nor the paths are ever interpreted
+static cgrad_error pointwise_compiler_run(const char *const cc, const char *const so_path, const char *const c_path)
+{
+    const char *const cflags[] = {POINTWISE_KERNEL_CFLAGS};
+    const size_t n_cflags = sizeof(cflags) / sizeof(cflags[0]);
+
+    char *argv[sizeof(cflags) / sizeof(cflags[0]) + 5];
+    size_t argc = 0;
+    argv[argc++] = (char *)cc;
+    for (size_t i = 0; i < n_cflags; i++)
+    {
+        argv[argc++] = (char *)cflags[i];
+    }
+    argv[argc++] = "-o";
+    argv[argc++] = (char *)so_path;
+    argv[argc++] = (char *)c_path;
+    argv[argc] = NULL;
+
+    // Diagnostics are not ours to print, a failed compilation falls back to the interpreter
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0)
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+    if (posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0) != 0 ||
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) != 0)
+    {
+        posix_spawn_file_actions_destroy(&actions);
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    pid_t pid;
+    const int spawn_err = posix_spawnp(&pid, cc, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (spawn_err != 0)
+    {
+        return POINTWISE_KERNEL_COMPILATION_FAILED;
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            return POINTWISE_KERNEL_COMPILATION_FAILED;
+        }
+    }
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? NO_ERROR : POINTWISE_KERNEL_COMPILATION_FAILED;
+}
+
+static cgrad_error pointwise_kernel_load(struct pointwise_kernel *const kernel, const char *const so_path)
+{
+    void *handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+    {
+        return POINTWISE_KERNEL_LOADING_FAILED;
+    }
+
+    // ISO C leaves conversions from void * to function pointers undefined, POSIX requires them to work
+    pointwise_kernel_f64_fn f64;
+    pointwise_kernel_f32_fn f32;
+    void *f64_symbol = dlsym(handle, "cgrad_pointwise_f64");
+    void *f32_symbol = dlsym(handle, "cgrad_pointwise_f32");
+    if (!f64_symbol || !f32_symbol)
+    {
+        dlclose(handle);
+        return POINTWISE_KERNEL_LOADING_FAILED;
+    }
+    memcpy(&f64, &f64_symbol, sizeof(f64));
+    memcpy(&f32, &f32_symbol, sizeof(f32));
+
+    kernel->handle = handle;
+    kernel->f64 = f64;
+    kernel->f32 = f32;
+
+    return NO_ERROR;
+}
+
+static void pointwise_interpret_f64(const struct pointwise_program *const program, const double *const *const in, double *const out, const size_t rows, const size_t cols)
+{
+    double registers[POINTWISE_PROGRAM_MAX_INSTRUCTIONS][POINTWISE_INTERPRETER_BLOCK_SIZE];
+    const size_t last = program->n_instructions - 1;
+
+    for (size_t i = 0; i < rows; i++)
+    {
+        for (size_t j0 = 0; j0 < cols; j0 += POINTWISE_INTERPRETER_BLOCK_SIZE)
+        {
+            const size_t n = cols - j0 < POINTWISE_INTERPRETER_BLOCK_SIZE ? cols - j0 : POINTWISE_INTERPRETER_BLOCK_SIZE;
+
+            // One instruction at a time over the whole block, so that dispatch is paid once per block
+            for (size_t k = 0; k < program->n_instructions; k++)
+            {
+                const struct pointwise_instruction *instruction = &program->instructions[k];
+                double *restrict dst = registers[k];
+                switch (instruction->op)
+                {
+                case POINTWISE_OP_LOAD:
+                {
+                    const size_t a = instruction->a;
+                    const double *src = program->input_kinds[a] == POINTWISE_INPUT_FULL ? in[a] + i * cols + j0 : in[a] + j0;
+                    memcpy(dst, src, n * sizeof(double));
+                    break;
+                }
+                case POINTWISE_OP_ADD:
+                {
+                    const double *x = registers[instruction->a];
+                    const double *y = registers[instruction->b];
+                    for (size_t t = 0; t < n; t++)
+                    {
+                        dst[t] = x[t] + y[t];
+                    }
+                    break;
+                }
+                case POINTWISE_OP_RELU:
+                {
+                    const double *x = registers[instruction->a];
+                    for (size_t t = 0; t < n; t++)
+                    {
+                        dst[t] = x[t] > 0 ? x[t] : 0;
+                    }
+                    break;
+                }
+                }
+            }
+
+            memcpy(out + i * cols + j0, registers[last], n * sizeof(double));
+        }
+    }
+}
+
+static void pointwise_interpret_f32(const struct pointwise_program *const program, const float *const *const in, float *const out, const size_t rows, const size_t cols)
+{
+    float registers[POINTWISE_PROGRAM_MAX_INSTRUCTIONS][POINTWISE_INTERPRETER_BLOCK_SIZE];
+    const size_t last = program->n_instructions - 1;
+
+    for (size_t i = 0; i < rows; i++)
+    {
+        for (size_t j0 = 0; j0 < cols; j0 += POINTWISE_INTERPRETER_BLOCK_SIZE)
+        {
+            const size_t n = cols - j0 < POINTWISE_INTERPRETER_BLOCK_SIZE ? cols - j0 : POINTWISE_INTERPRETER_BLOCK_SIZE;
+
+            for (size_t k = 0; k < program->n_instructions; k++)
+            {
+                const struct pointwise_instruction *instruction = &program->instructions[k];
+                float *restrict dst = registers[k];
+                switch (instruction->op)
+                {
+                case POINTWISE_OP_LOAD:
+                {
+                    const size_t a = instruction->a;
+                    const float *src = program->input_kinds[a] == POINTWISE_INPUT_FULL ? in[a] + i * cols + j0 : in[a] + j0;
+                    memcpy(dst, src, n * sizeof(float));
+                    break;
+                }
+                case POINTWISE_OP_ADD:
+                {
+                    const float *x = registers[instruction->a];
+                    const float *y = registers[instruction->b];
+                    for (size_t t = 0; t < n; t++)
+                    {
+                        dst[t] = x[t] + y[t];
+                    }
+                    break;
+                }
+                case POINTWISE_OP_RELU:
+                {
+                    const float *x = registers[instruction->a];
+                    for (size_t t = 0; t < n; t++)
+                    {
+                        dst[t] = x[t] > 0 ? x[t] : 0;
+                    }
+                    break;
+                }
+                }
+            }
+
+            memcpy(out + i * cols + j0, registers[last], n * sizeof(float));
+        }
+    }
+}
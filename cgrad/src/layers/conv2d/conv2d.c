@@ -98,12 +98,21 @@ cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, s
         return err;
     }
 
+    /**
+     * Every intermediate below has a single forward consumer, and is freed right after it runs. The
+     * graph keeps alive what backward needs, the allocator releases the data of the others.
+     */
+    struct tensor_allocator *tensor_alloc = layer->allocs->tensor_alloc;
+    tensor_allocator_free(tensor_alloc, reshaped_kernel);
+
     struct tensor *out_patches = NULL;
     err = tensor2d_mult(x_patches, kernel_trans, &out_patches, track_grad, layer->allocs);
     if (err != NO_ERROR)
     {
         return err;
     }
+    tensor_allocator_free(tensor_alloc, x_patches);
+    tensor_allocator_free(tensor_alloc, kernel_trans);
 
     struct tensor *out_patches_trans = NULL;
     err = tensor2d_trans(out_patches, &out_patches_trans, track_grad, layer->allocs);
@@ -111,6 +120,7 @@ cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, s
     {
         return err;
     }
+    tensor_allocator_free(tensor_alloc, out_patches);
 
     struct tensor *out_patches_trans_reshaped = NULL;
     const size_t OUT_PATCHES_NEW_SHAPE[] = {K, x->shape[0], H_out, W_out};
@@ -119,50 +129,93 @@ cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, s
     {
         return err;
     }
+    tensor_allocator_free(tensor_alloc, out_patches_trans);
 
     err = tensor_trans(out_patches_trans_reshaped, 0, 1, out, track_grad, layer->allocs);
     if (err != NO_ERROR)
     {
         return err;
     }
+    tensor_allocator_free(tensor_alloc, out_patches_trans_reshaped);
 
-    err = tensor_list_add(intermediates, x_patches);
-    if (err != NO_ERROR)
+    return NO_ERROR;
+}
+
+cgrad_error conv2d_capture(const struct conv2d *const layer, struct captured_graph *const graph, const captured_node_id x, const captured_node_id weight, captured_node_id *const out)
+{
+    if (!layer)
+    {
+        return CONV2D_NULL;
+    }
+    if (!graph)
+    {
+        return CAPTURED_GRAPH_NULL;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (x >= graph->n_nodes || weight >= graph->n_nodes)
+    {
+        return CAPTURED_GRAPH_INVALID_NODE;
+    }
+
+    const size_t *x_shape = graph->nodes[x].shape;
+    const size_t *kernel_shape = graph->nodes[weight].shape;
+    if (graph->nodes[x].shape_size != 4 || graph->nodes[weight].shape_size != 4)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+
+    const size_t H_out = x_shape[2] - kernel_shape[2] + 1;
+    const size_t W_out = x_shape[3] - kernel_shape[3] + 1;
+
+    size_t K = kernel_shape[0];
+    size_t C = kernel_shape[1];
+    size_t R = kernel_shape[2];
+    size_t S = kernel_shape[3];
+
+    cgrad_error err = NO_ERROR;
+
+    captured_node_id x_patches;
+    if ((err = captured_graph_im2row(graph, x, weight, &x_patches)) != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(intermediates, reshaped_kernel);
-    if (err != NO_ERROR)
+    const size_t KERNEL_NEW_SHAPE[] = {K, C * R * S};
+    captured_node_id reshaped_kernel;
+    if ((err = captured_graph_reshape(graph, weight, KERNEL_NEW_SHAPE, 2, &reshaped_kernel)) != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(intermediates, kernel_trans);
-    if (err != NO_ERROR)
+    captured_node_id kernel_trans;
+    if ((err = captured_graph_trans2d(graph, reshaped_kernel, &kernel_trans)) != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(intermediates, out_patches);
-    if (err != NO_ERROR)
+    captured_node_id out_patches;
+    if ((err = captured_graph_mult(graph, x_patches, kernel_trans, &out_patches)) != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(intermediates, out_patches_trans);
-    if (err != NO_ERROR)
+    captured_node_id out_patches_trans;
+    if ((err = captured_graph_trans2d(graph, out_patches, &out_patches_trans)) != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(intermediates, out_patches_trans_reshaped);
-    if (err != NO_ERROR)
+    const size_t OUT_PATCHES_NEW_SHAPE[] = {K, x_shape[0], H_out, W_out};
+    captured_node_id out_patches_trans_reshaped;
+    if ((err = captured_graph_reshape(graph, out_patches_trans, OUT_PATCHES_NEW_SHAPE, 4, &out_patches_trans_reshaped)) != NO_ERROR)
     {
         return err;
     }
 
-    return NO_ERROR;
+    return captured_graph_trans(graph, out_patches_trans_reshaped, 0, 1, out);
 }
 
 cgrad_error conv2d_xavier_init(struct conv2d *const layer)
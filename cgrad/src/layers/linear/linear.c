@@ -86,7 +86,31 @@ cgrad_error linear_forward(struct linear *const layer, struct tensor *const x, s
         return err;
     }
 
-    return tensor_list_add(intermediates, mult);
+    // The graph keeps XW alive for backward, which does not need its data: the allocator releases it
+    tensor_allocator_free(layer->allocs->tensor_alloc, mult);
+
+    return NO_ERROR;
+}
+
+cgrad_error linear_capture(const struct linear *const layer, struct captured_graph *const graph, const captured_node_id x, const captured_node_id weight, const captured_node_id bias, captured_node_id *const out)
+{
+    if (!layer)
+    {
+        return LINEAR_NULL;
+    }
+    if (!out)
+    {
+        return LINEAR_OUT_NULL;
+    }
+
+    captured_node_id mult;
+    cgrad_error err = captured_graph_mult(graph, x, weight, &mult);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return captured_graph_add_row_vector(graph, mult, bias, out);
 }
 
 cgrad_error linear_xavier_init(struct linear *const layer)
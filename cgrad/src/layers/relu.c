@@ -4,6 +4,7 @@
 #include "cgrad/utils/simd_support.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 #if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
 #include <immintrin.h>
@@ -14,11 +15,22 @@ typedef enum relu_layer_operand
     RELU_ONLY_OPERAND,
 } relu_layer_operand;
 
+typedef enum relu_layer_owned
+{
+    RELU_MASK,
+} relu_layer_owned;
+
+#define RELU_MASK_WORD_BITS 32
+
 static inline cgrad_error relu_forward_update_graph(struct tensor *const x, struct tensor **const out, struct allocators *const allocs);
 static cgrad_error relu_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error relu_backpropagate_f64(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error relu_backpropagate_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error relu_forward_dispatch(const struct tensor *const x, struct tensor *const out);
+static cgrad_error relu_mask_compute(const struct tensor *const x, struct tensor *const mask);
+static cgrad_error relu_mask_compute_f64(const struct tensor *const x, struct tensor *const mask);
+static cgrad_error relu_mask_compute_f32(const struct tensor *const x, struct tensor *const mask);
+static inline bool relu_mask_get(const uint32_t *const mask_data, const size_t i);
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
 static cgrad_error relu_forward_dispatch_avx_256(const struct tensor *const x, struct tensor *const out);
 static cgrad_error relu_forward_avx_256_f64(const struct tensor *const x, struct tensor *const out);
@@ -40,7 +52,8 @@ cgrad_error relu_forward(struct tensor *const x, struct tensor **const out, cons
         return TENSOR_DATA_NULL;
     }
 
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, x->shape, x->shape_size, x->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, x, NULL);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, x->shape, x->shape_size, x->dtype, is_tracked);
 
     cgrad_error err = relu_forward_dispatch(x, *out);
     if (err != NO_ERROR)
@@ -48,7 +61,7 @@ cgrad_error relu_forward(struct tensor *const x, struct tensor **const out, cons
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return relu_forward_update_graph(x, out, allocs);
     }
@@ -57,7 +70,97 @@ cgrad_error relu_forward(struct tensor *const x, struct tensor **const out, cons
 
 static inline cgrad_error relu_forward_update_graph(struct tensor *const x, struct tensor **const out, struct allocators *const allocs)
 {
-    return add_computational_graph_link(x, RELU_ONLY_OPERAND, *out, &relu_backpropagate, allocs);
+    cgrad_error err = add_computational_graph_link(x, RELU_ONLY_OPERAND, *out, &relu_backpropagate, allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    /**
+     * Backward only needs to know which inputs were positive. Instead of saving x, the context owns
+     * a mask with one bit per element, packed in 32-bit words, and x can be released right away.
+     */
+    struct backpropagation_context *ctx = computational_graph_link_context(*out, allocs);
+    if (!ctx)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL;
+    }
+
+    const size_t mask_shape[] = {(x->data_size + RELU_MASK_WORD_BITS - 1) / RELU_MASK_WORD_BITS};
+    struct tensor *mask = tensor_allocator_no_grad_alloc(ctx->owned_allocator, mask_shape, 1, DTYPE_INT32);
+    if (!mask)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    err = relu_mask_compute(x, mask);
+    if (err != NO_ERROR)
+    {
+        tensor_allocator_no_grad_free(ctx->owned_allocator, mask);
+        return err;
+    }
+
+    return context_set_owned(ctx, mask, RELU_MASK);
+}
+
+static cgrad_error relu_mask_compute(const struct tensor *const x, struct tensor *const mask)
+{
+    switch (x->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return relu_mask_compute_f64(x, mask);
+    case DTYPE_FLOAT32:
+        return relu_mask_compute_f32(x, mask);
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
+
+static cgrad_error relu_mask_compute_f64(const struct tensor *const x, struct tensor *const mask)
+{
+    double *x_data = (double *)x->data;
+    uint32_t *mask_data = (uint32_t *)mask->data;
+
+    for (size_t word = 0; word < mask->data_size; word++)
+    {
+        const size_t start = word * RELU_MASK_WORD_BITS;
+        const size_t end = start + RELU_MASK_WORD_BITS < x->data_size ? start + RELU_MASK_WORD_BITS : x->data_size;
+
+        uint32_t bits = 0;
+        for (size_t i = start; i < end; i++)
+        {
+            bits |= (uint32_t)(x_data[i] > 0) << (i - start);
+        }
+        mask_data[word] = bits;
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error relu_mask_compute_f32(const struct tensor *const x, struct tensor *const mask)
+{
+    float *x_data = (float *)x->data;
+    uint32_t *mask_data = (uint32_t *)mask->data;
+
+    for (size_t word = 0; word < mask->data_size; word++)
+    {
+        const size_t start = word * RELU_MASK_WORD_BITS;
+        const size_t end = start + RELU_MASK_WORD_BITS < x->data_size ? start + RELU_MASK_WORD_BITS : x->data_size;
+
+        uint32_t bits = 0;
+        for (size_t i = start; i < end; i++)
+        {
+            bits |= (uint32_t)(x_data[i] > 0) << (i - start);
+        }
+        mask_data[word] = bits;
+    }
+
+    return NO_ERROR;
+}
+
+static inline bool relu_mask_get(const uint32_t *const mask_data, const size_t i)
+{
+    return (mask_data[i / RELU_MASK_WORD_BITS] >> (i % RELU_MASK_WORD_BITS)) & 1u;
 }
 
 static cgrad_error relu_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -81,13 +184,13 @@ static cgrad_error relu_backpropagate(const struct backpropagation_context *cons
 
 static cgrad_error relu_backpropagate_f64(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
-    const struct tensor *const x = ctx->operands[RELU_ONLY_OPERAND];
-    if (!x)
+    const struct tensor *const mask = ctx->owned[RELU_MASK];
+    if (!mask)
     {
         return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
     }
 
-    double *x_data = (double *)x->data;
+    const uint32_t *mask_data = (const uint32_t *)mask->data;
     double *grad_wrt_operand_data = (double *)grad_wrt_operand->data;
     double *grad_wrt_out_data = (double *)grad_wrt_out->data;
     size_t grad_wrt_operand_data_size = grad_wrt_operand->data_size;
@@ -95,7 +198,7 @@ static cgrad_error relu_backpropagate_f64(const struct backpropagation_context *
     for (size_t i = 0; i < grad_wrt_operand_data_size; i++)
     {
         // Element wise product
-        grad_wrt_operand_data[i] = (x_data[i] > 0 ? 1 : 0) * grad_wrt_out_data[i];
+        grad_wrt_operand_data[i] = relu_mask_get(mask_data, i) ? grad_wrt_out_data[i] : 0;
     }
 
     return NO_ERROR;
@@ -103,13 +206,13 @@ static cgrad_error relu_backpropagate_f64(const struct backpropagation_context *
 
 static cgrad_error relu_backpropagate_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
-    const struct tensor *const x = ctx->operands[RELU_ONLY_OPERAND];
-    if (!x)
+    const struct tensor *const mask = ctx->owned[RELU_MASK];
+    if (!mask)
     {
         return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
     }
 
-    float *x_data = (float *)x->data;
+    const uint32_t *mask_data = (const uint32_t *)mask->data;
     float *grad_wrt_operand_data = (float *)grad_wrt_operand->data;
     float *grad_wrt_out_data = (float *)grad_wrt_out->data;
     size_t grad_wrt_operand_data_size = grad_wrt_operand->data_size;
@@ -117,7 +220,7 @@ static cgrad_error relu_backpropagate_f32(const struct backpropagation_context *
     for (size_t i = 0; i < grad_wrt_operand_data_size; i++)
     {
         // Element wise product
-        grad_wrt_operand_data[i] = (x_data[i] > 0 ? 1 : 0) * grad_wrt_out_data[i];
+        grad_wrt_operand_data[i] = relu_mask_get(mask_data, i) ? grad_wrt_out_data[i] : 0;
     }
 
     return NO_ERROR;
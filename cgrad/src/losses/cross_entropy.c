@@ -44,7 +44,8 @@ cgrad_error cross_entropy_loss(struct tensor *const logits, struct tensor *const
 
     const size_t shape[] = {1, 1};
     const size_t shape_size = 2;
-    (*z) = tensor_allocator_alloc(allocs->tensor_alloc, shape, shape_size, logits->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, logits, targets);
+    (*z) = tensor_allocator_result_alloc(allocs->tensor_alloc, shape, shape_size, logits->dtype, is_tracked);
 
     if (!(*z))
     {
@@ -57,7 +58,7 @@ cgrad_error cross_entropy_loss(struct tensor *const logits, struct tensor *const
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return cross_entropy_loss_update_graph(logits, targets, z, allocs);
     }
@@ -75,8 +76,15 @@ static inline cgrad_error cross_entropy_loss_update_graph(struct tensor *const l
         return err;
     }
 
+    struct backpropagation_context *ctx = computational_graph_link_context(*z, allocs);
+    err = context_save_operand(ctx, logits, CROSS_ENTROPY_PREDICTED);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
     // Setup operands manually, as the target was not added to the computational graph as node
-    return computational_graph_node_set_context_tensor((*z)->node, targets, CROSS_ENTROPY_TARGET);
+    return context_save_operand(ctx, targets, CROSS_ENTROPY_TARGET);
 }
 
 static cgrad_error cross_entropy_loss_dispatch(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z)
@@ -168,6 +176,7 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted_f64(const struct b
     double batch_size = logits->shape[0];
     size_t num_classes = logits->shape[1];
     double *grad_wrt_operand_data = (double *)grad_wrt_operand->data;
+    double upstream = ((double *)grad_wrt_out->data)[0];
 
     for (size_t i = 0; i < batch_size; i++)
     {
@@ -185,8 +194,8 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted_f64(const struct b
             double predicted = exp(logit) / softmax_normalization;
             double target = target_label == j ? 1 : 0;
 
-            // dL/dlogit_j = (predicted_j - target_j)
-            grad_wrt_operand_data[i * num_classes + j] = (predicted - target) / batch_size;
+            // dL/dlogit_j = (predicted_j - target_j), scaled by the upstream gradient
+            grad_wrt_operand_data[i * num_classes + j] = (predicted - target) * upstream / batch_size;
         }
     }
 
@@ -200,6 +209,7 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted_f32(const struct b
     float batch_size = logits->shape[0];
     size_t num_classes = logits->shape[1];
     float *grad_wrt_operand_data = (float *)grad_wrt_operand->data;
+    float upstream = ((float *)grad_wrt_out->data)[0];
 
     for (size_t i = 0; i < batch_size; i++)
     {
@@ -217,8 +227,8 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted_f32(const struct b
             float predicted = expf(logit) / softmax_normalization;
             float target = target_label == j ? 1 : 0;
 
-            // dL/dlogit_j = (predicted_j - target_j)
-            grad_wrt_operand_data[i * num_classes + j] = (predicted - target) / batch_size;
+            // dL/dlogit_j = (predicted_j - target_j), scaled by the upstream gradient
+            grad_wrt_operand_data[i * num_classes + j] = (predicted - target) * upstream / batch_size;
         }
     }
 
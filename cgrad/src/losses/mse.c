@@ -42,7 +42,8 @@ cgrad_error mse_loss(struct tensor *const y_pred, struct tensor *const y_target,
 
     const size_t shape[] = {1, 1};
     const size_t shape_size = 2;
-    (*z) = tensor_allocator_alloc(allocs->tensor_alloc, shape, shape_size, y_pred->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, y_pred, y_target);
+    (*z) = tensor_allocator_result_alloc(allocs->tensor_alloc, shape, shape_size, y_pred->dtype, is_tracked);
 
     if (!(*z))
     {
@@ -55,7 +56,7 @@ cgrad_error mse_loss(struct tensor *const y_pred, struct tensor *const y_target,
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return mse_loss_update_graph(y_pred, y_target, z, allocs);
     }
@@ -71,7 +72,21 @@ static inline cgrad_error mse_loss_update_graph(struct tensor *const y_pred, str
         return err;
     }
 
-    return add_computational_graph_link(y_target, MSE_TARGET, *z, &mse_loss_backpropagate_target, allocs);
+    err = add_computational_graph_link(y_target, MSE_TARGET, *z, &mse_loss_backpropagate_target, allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Both gradients are computed from the residual, hence both operands are needed
+    struct backpropagation_context *ctx = computational_graph_link_context(*z, allocs);
+    err = context_save_operand(ctx, y_pred, MSE_PREDICTED);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return context_save_operand(ctx, y_target, MSE_TARGET);
 }
 
 static cgrad_error mse_loss_dispatch(const struct tensor *const y_pred, const struct tensor *const y_target, struct tensor *const z)
@@ -149,10 +164,12 @@ static cgrad_error mse_loss_backpropagate_predicted_f64(const struct backpropaga
     double *predicted_data = (double *)predicted->data;
     double *target_data = (double *)target->data;
 
+    double upstream = ((double *)grad_wrt_out->data)[0];
+
     double batch_size = target->shape[0];
     for (size_t i = 0; i < batch_size; i++)
     {
-        grad_wrt_operand_data[i] = (predicted_data[i] - target_data[i]) / batch_size;
+        grad_wrt_operand_data[i] = (predicted_data[i] - target_data[i]) * upstream / batch_size;
     }
 
     return NO_ERROR;
@@ -167,10 +184,12 @@ static cgrad_error mse_loss_backpropagate_predicted_f32(const struct backpropaga
     float *predicted_data = (float *)predicted->data;
     float *target_data = (float *)target->data;
 
+    float upstream = ((float *)grad_wrt_out->data)[0];
+
     float batch_size = target->shape[0];
     for (size_t i = 0; i < batch_size; i++)
     {
-        grad_wrt_operand_data[i] = (predicted_data[i] - target_data[i]) / batch_size;
+        grad_wrt_operand_data[i] = (predicted_data[i] - target_data[i]) * upstream / batch_size;
     }
 
     return NO_ERROR;
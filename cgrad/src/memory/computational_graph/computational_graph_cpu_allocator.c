@@ -6,6 +6,12 @@ static struct computational_graph_node *computational_graph_cpu_alloc(void *pool
 
 static void computational_graph_cpu_free(void *pool, struct computational_graph_node *node);
 
+static struct computational_graph_edge *computational_graph_cpu_alloc_edge(void *pool);
+
+static struct backpropagation_context *computational_graph_cpu_alloc_context(void *pool);
+
+static void computational_graph_cpu_free_context(void *pool, struct backpropagation_context *ctx);
+
 cgrad_error computational_graph_cpu_allocator_init(struct computational_graph_allocator *const graph_allocator)
 {
     if (!graph_allocator)
@@ -27,6 +33,9 @@ cgrad_error computational_graph_cpu_allocator_init(struct computational_graph_al
 
     graph_allocator->alloc = computational_graph_cpu_alloc;
     graph_allocator->free = computational_graph_cpu_free;
+    graph_allocator->alloc_edge = computational_graph_cpu_alloc_edge;
+    graph_allocator->alloc_context = computational_graph_cpu_alloc_context;
+    graph_allocator->free_context = computational_graph_cpu_free_context;
     graph_allocator->pool = graph_pool;
 
     return NO_ERROR;
@@ -45,28 +54,31 @@ void computational_graph_cpu_allocator_cleanup(struct computational_graph_alloca
 
 static struct computational_graph_node *computational_graph_cpu_alloc(void *pool, struct tensor *t)
 { 
+    if (!t)
+    {
+        return NULL;
+    }
+
     struct computational_graph_cpu_pool *cpu_pool = (struct computational_graph_cpu_pool *)pool;
     struct computational_graph_node *node = computational_graph_cpu_pool_alloc(cpu_pool);
-    if (!node || !t)
+    if (!node)
     {
         return NULL;
     }
 
+    node->t = t;
+    node->children = NULL;
+    node->last_child = NULL;
+    node->ctx = NULL;
+    node->tensor_alloc = NULL;
     node->n_children = 0;
     node->n_parents = 0;
-    node->t = t;
-    t->node = node;
-    node->is_involved_in_backprop = false;
-    node->is_grad_computed = false;
     node->pushed_gradients_count = 0;
+    node->is_involved_in_backprop = false;
+    node->is_visited = false;
 
-    // Initialize arrays to prevent undefined behavior
-    memset(node->parents, 0, sizeof(node->parents));
-    memset(node->children, 0, sizeof(node->children));
-    // memset(node->parents_operands, 0, sizeof(node->parents_operands));
-    memset(node->children_operands, 0, sizeof(node->children_operands));
-    memset(node->function, 0, sizeof(node->function));
-    // context_init(&node->ctx, tensor_alloc); // Pointer is not NULL at this point
+    t->node = node;
+    t->ref_count++; // The node keeps its tensor alive until it is freed
 
     return node;
 }
@@ -75,11 +87,41 @@ static void computational_graph_cpu_free(void *pool, struct computational_graph_
 {
     struct computational_graph_cpu_pool *cpu_pool = (struct computational_graph_cpu_pool *)pool;
 
-    if (node->t->node)
+    struct tensor *t = node->t;
+    struct tensor_allocator *tensor_alloc = node->tensor_alloc;
+    t->node = NULL;
+
+    struct computational_graph_edge *edge = node->children;
+    while (edge)
     {
-        node->t->node = NULL;
+        struct computational_graph_edge *next = edge->next;
+        computational_graph_cpu_pool_edge_free(cpu_pool, edge);
+        edge = next;
     }
 
-    context_cleanup_owned(&node->ctx);
+    if (node->ctx)
+    {
+        context_release_saved(node->ctx);
+        context_cleanup_owned(node->ctx);
+        computational_graph_cpu_pool_context_free(cpu_pool, node->ctx);
+    }
     computational_graph_cpu_pool_free(cpu_pool, node);
-}
\ No newline at end of file
+
+    // Drop the reference taken at allocation, deallocating the tensor if its owner already freed it
+    tensor_allocator_release(tensor_alloc, t);
+}
+
+static struct computational_graph_edge *computational_graph_cpu_alloc_edge(void *pool)
+{
+    return computational_graph_cpu_pool_edge_alloc((struct computational_graph_cpu_pool *)pool);
+}
+
+static struct backpropagation_context *computational_graph_cpu_alloc_context(void *pool)
+{
+    return computational_graph_cpu_pool_context_alloc((struct computational_graph_cpu_pool *)pool);
+}
+
+static void computational_graph_cpu_free_context(void *pool, struct backpropagation_context *ctx)
+{
+    computational_graph_cpu_pool_context_free((struct computational_graph_cpu_pool *)pool, ctx);
+}
@@ -6,7 +6,12 @@
 #include <string.h>
 #include <assert.h>
 
-static void computational_graph_cpu_pool_init_chunks(struct computational_graph_cpu_pool *pool);
+_Static_assert(sizeof(struct computational_graph_node) <= MEMORY_GRAPH_NODE_ALIGNMENT, "computational_graph_node must fit in a cache line");
+
+static cgrad_error computational_graph_cpu_block_list_init(struct computational_graph_cpu_block_list *list, const size_t block_size, const size_t n_blocks, const size_t alignment);
+static void *computational_graph_cpu_block_list_alloc(struct computational_graph_cpu_block_list *list);
+static void computational_graph_cpu_block_list_free(struct computational_graph_cpu_block_list *list, void *ptr);
+static inline size_t round_up(const size_t size, const size_t alignment);
 
 cgrad_error computational_graph_cpu_pool_init(struct computational_graph_cpu_pool *pool)
 {
@@ -15,27 +20,34 @@ cgrad_error computational_graph_cpu_pool_init(struct computational_graph_cpu_poo
         return MEMORY_POOL_NULL;
     }
 
-    pool->memory = calloc(MEMORY_TENSOR_POOL_N_CHUNKS, sizeof(struct computational_graph_chunk));
-    if (!pool->memory)
+    cgrad_error err = NO_ERROR;
+    if ((err = computational_graph_cpu_block_list_init(&pool->nodes, sizeof(struct computational_graph_node), MEMORY_TENSOR_POOL_N_CHUNKS, MEMORY_GRAPH_NODE_ALIGNMENT)) != NO_ERROR)
     {
-        return MEMORY_POOL_CHUNK_ALLOCATION_FAILED;
+        return err;
+    }
+    if ((err = computational_graph_cpu_block_list_init(&pool->edges, sizeof(struct computational_graph_edge), MEMORY_GRAPH_POOL_N_EDGES, _Alignof(struct computational_graph_edge))) != NO_ERROR)
+    {
+        free(pool->nodes.memory);
+        return err;
+    }
+    if ((err = computational_graph_cpu_block_list_init(&pool->contexts, sizeof(struct backpropagation_context), MEMORY_GRAPH_POOL_N_CONTEXTS, _Alignof(struct backpropagation_context))) != NO_ERROR)
+    {
+        free(pool->nodes.memory);
+        free(pool->edges.memory);
+        return err;
     }
-    pool->chunk_head = (struct computational_graph_chunk *)pool->memory;
 
-    computational_graph_cpu_pool_init_chunks(pool);
     return NO_ERROR;
 }
 
 void *computational_graph_cpu_pool_alloc(struct computational_graph_cpu_pool *pool)
 {
-    if (!pool || !pool->chunk_head)
+    if (!pool)
     {
         return NULL;
     }
 
-    struct computational_graph_node *return_ptr = &pool->chunk_head->node;
-    pool->chunk_head = pool->chunk_head->next;
-    return return_ptr;
+    return computational_graph_cpu_block_list_alloc(&pool->nodes);
 }
 
 void computational_graph_cpu_pool_free(struct computational_graph_cpu_pool *pool, void *ptr)
@@ -45,21 +57,91 @@ void computational_graph_cpu_pool_free(struct computational_graph_cpu_pool *pool
         return;
     }
 
-    struct computational_graph_chunk *chunk = (struct computational_graph_chunk *)((char *)ptr - offsetof(struct computational_graph_chunk, node));
-    chunk->next = pool->chunk_head;
-    pool->chunk_head = chunk;
+    computational_graph_cpu_block_list_free(&pool->nodes, ptr);
+}
+
+void *computational_graph_cpu_pool_edge_alloc(struct computational_graph_cpu_pool *pool)
+{
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    return computational_graph_cpu_block_list_alloc(&pool->edges);
+}
+
+void computational_graph_cpu_pool_edge_free(struct computational_graph_cpu_pool *pool, void *ptr)
+{
+    if (!pool || !ptr)
+    {
+        return;
+    }
+
+    computational_graph_cpu_block_list_free(&pool->edges, ptr);
+}
+
+void *computational_graph_cpu_pool_context_alloc(struct computational_graph_cpu_pool *pool)
+{
+    if (!pool)
+    {
+        return NULL;
+    }
+
+    return computational_graph_cpu_block_list_alloc(&pool->contexts);
+}
+
+void computational_graph_cpu_pool_context_free(struct computational_graph_cpu_pool *pool, void *ptr)
+{
+    if (!pool || !ptr)
+    {
+        return;
+    }
+
+    computational_graph_cpu_block_list_free(&pool->contexts, ptr);
 }
 
-static void computational_graph_cpu_pool_init_chunks(struct computational_graph_cpu_pool *pool)
+static cgrad_error computational_graph_cpu_block_list_init(struct computational_graph_cpu_block_list *list, const size_t block_size, const size_t n_blocks, const size_t alignment)
 {
-    struct computational_graph_chunk *chunk_current = (struct computational_graph_chunk *) pool->memory;
+    const size_t stride = round_up(block_size, alignment);
 
-    for (size_t i = 0; i < MEMORY_TENSOR_POOL_N_CHUNKS - 1; i++)
+    list->memory = aligned_alloc(alignment, stride * n_blocks);
+    if (!list->memory)
     {
-        chunk_current->next = (struct computational_graph_chunk*)((char *)chunk_current + sizeof(struct computational_graph_chunk));
-        chunk_current = chunk_current->next;
+        return MEMORY_POOL_CHUNK_ALLOCATION_FAILED;
     }
 
-    // Set the last chunk's next pointer to NULL
-    chunk_current->next = NULL;
-}
\ No newline at end of file
+    // Chain every block to the following one, the last one ends the list
+    char *block = (char *)list->memory;
+    for (size_t i = 0; i < n_blocks - 1; i++)
+    {
+        *(void **)block = block + stride;
+        block += stride;
+    }
+    *(void **)block = NULL;
+
+    list->head = list->memory;
+    return NO_ERROR;
+}
+
+static void *computational_graph_cpu_block_list_alloc(struct computational_graph_cpu_block_list *list)
+{
+    void *block = list->head;
+    if (!block)
+    {
+        return NULL;
+    }
+
+    list->head = *(void **)block;
+    return block;
+}
+
+static void computational_graph_cpu_block_list_free(struct computational_graph_cpu_block_list *list, void *ptr)
+{
+    *(void **)ptr = list->head;
+    list->head = ptr;
+}
+
+static inline size_t round_up(const size_t size, const size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
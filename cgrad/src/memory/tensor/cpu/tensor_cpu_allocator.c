@@ -1,4 +1,5 @@
 #include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/config.h"
 #include <string.h>
 
 static struct tensor *tensor_cpu_alloc(void *pool, const size_t *const shape, const size_t shape_size, const cgrad_dtype dtype);
@@ -11,11 +12,20 @@ static void tensor_cpu_free(void *pool, struct tensor *t);
 
 static void tensor_cpu_no_grad_free(void *pool, struct tensor *t);
 
+static void tensor_cpu_free_data(void *pool, struct tensor *t);
+
+static cgrad_error tensor_cpu_alloc_data(void *pool, struct tensor *t);
+
 static struct tensor *tensor_cpu_clone(void *pool, const struct tensor *const src);
 
 static void compute_stride(size_t *const shape, size_t *const stride, size_t const shape_size);
 
 cgrad_error tensor_cpu_allocator_init(struct tensor_allocator *const tensor_alloc)
+{
+    return tensor_cpu_allocator_init_with_chunks(tensor_alloc, MEMORY_TENSOR_POOL_N_CHUNKS);
+}
+
+cgrad_error tensor_cpu_allocator_init_with_chunks(struct tensor_allocator *const tensor_alloc, const size_t n_chunks)
 {
     if (!tensor_alloc)
     {
@@ -28,9 +38,10 @@ cgrad_error tensor_cpu_allocator_init(struct tensor_allocator *const tensor_allo
         return TENSOR_POOL_ALLOCATION_FAILED;
     }
 
-    cgrad_error err = tensor_cpu_pool_init(tensor_pool);
+    cgrad_error err = tensor_cpu_pool_init_with_chunks(tensor_pool, n_chunks);
     if (err != NO_ERROR)
     {
+        free(tensor_pool);
         return err;
     }
 
@@ -39,8 +50,11 @@ cgrad_error tensor_cpu_allocator_init(struct tensor_allocator *const tensor_allo
     tensor_alloc->no_grad_zero_alloc = tensor_cpu_no_grad_zero_alloc,
     tensor_alloc->free = tensor_cpu_free,
     tensor_alloc->no_grad_free = tensor_cpu_no_grad_free,
+    tensor_alloc->free_data = tensor_cpu_free_data,
+    tensor_alloc->alloc_data = tensor_cpu_alloc_data,
     tensor_alloc->clone = tensor_cpu_clone,
     tensor_alloc->pool = tensor_pool;
+    tensor_alloc->spill = NULL;
 
     return NO_ERROR;
 }
@@ -66,7 +80,7 @@ static struct tensor *tensor_cpu_alloc(void *pool, const size_t *const shape, co
     }
 
     // Allocate gradient only for real value tensors
-    if (dtype == DTYPE_FLOAT32 || dtype == DTYPE_FLOAT64)
+    if (dtype == DTYPE_FLOAT32 || dtype == DTYPE_FLOAT64 || dtype == DTYPE_BFLOAT16)
     {
         t->grad = tensor_cpu_no_grad_zero_alloc(cpu_pool, shape, shape_size, dtype);
         if (!t->grad)
@@ -74,6 +88,7 @@ static struct tensor *tensor_cpu_alloc(void *pool, const size_t *const shape, co
             tensor_cpu_free(cpu_pool, t);
             return NULL;
         }
+        t->requires_grad = true;
     }
     else
     {
@@ -112,10 +127,16 @@ static struct tensor *tensor_cpu_no_grad_alloc(void *pool, const size_t *const s
 
     t->data = data;
     t->node = NULL;
+    t->is_recorded = false;
+    t->is_view = false;
+    t->n_grad_hooks = 0;
     t->data_size = data_size;
     t->shape_size = shape_size;
     t->grad = NULL;
     t->dtype = dtype;
+    t->saved_count = 0;
+    t->ref_count = 1;
+    t->requires_grad = false;
 
     return t;
 }
@@ -150,10 +171,16 @@ static struct tensor *tensor_cpu_no_grad_zero_alloc(void *pool, const size_t *co
 
     t->data = data;
     t->node = NULL;
+    t->is_recorded = false;
+    t->is_view = false;
+    t->n_grad_hooks = 0;
     t->data_size = data_size;
     t->shape_size = shape_size;
     t->grad = NULL;
     t->dtype = dtype;
+    t->saved_count = 0;
+    t->ref_count = 1;
+    t->requires_grad = false;
 
     return t;
 }
@@ -166,7 +193,26 @@ static void tensor_cpu_free(void *pool, struct tensor *t)
     }
 
     struct tensor_cpu_pool *cpu_pool = (struct tensor_cpu_pool *)pool;
-    tensor_cpu_pool_data_free(cpu_pool, t->data);
+
+    /**
+     * Freeing drops one reference. The tensor survives while its graph node, a tape or a backpropagation
+     * context still refers to it. When only the graph node or the tape is left, nobody will read the
+     * data anymore, so it is released right away while the gradient is kept for backward.
+     */
+    t->ref_count--;
+    if (t->ref_count > 0)
+    {
+        if (t->ref_count == 1 && (t->node || t->is_recorded) && t->saved_count == 0 && !t->is_view)
+        {
+            tensor_cpu_free_data(cpu_pool, t);
+        }
+        return;
+    }
+
+    if (!t->is_view)
+    {
+        tensor_cpu_pool_data_free(cpu_pool, t->data);
+    }
     t->data = NULL;
 
     if (t->grad)
@@ -175,17 +221,30 @@ static void tensor_cpu_free(void *pool, struct tensor *t)
         t->grad = NULL;
     }
 
-    if (t->node)
+    tensor_cpu_pool_tensor_free(cpu_pool, t);
+}
+
+static void tensor_cpu_no_grad_free(void *pool, struct tensor *t)
+{
+    if (!t)
     {
-        t->node = NULL; // The node will be freed separately
+        return;
     }
 
+    struct tensor_cpu_pool *cpu_pool = (struct tensor_cpu_pool *)pool;
+    if (!t->is_view)
+    {
+        tensor_cpu_pool_data_free(cpu_pool, t->data);
+    }
+    t->data = NULL;
+
     tensor_cpu_pool_tensor_free(cpu_pool, t);
 }
 
-static void tensor_cpu_no_grad_free(void *pool, struct tensor *t)
+static void tensor_cpu_free_data(void *pool, struct tensor *t)
 {
-    if (!t)
+    // The data of a view belongs to its buffer
+    if (!t || t->is_view)
     {
         return;
     }
@@ -193,8 +252,24 @@ static void tensor_cpu_no_grad_free(void *pool, struct tensor *t)
     struct tensor_cpu_pool *cpu_pool = (struct tensor_cpu_pool *)pool;
     tensor_cpu_pool_data_free(cpu_pool, t->data);
     t->data = NULL;
+}
 
-    tensor_cpu_pool_tensor_free(cpu_pool, t);
+static cgrad_error tensor_cpu_alloc_data(void *pool, struct tensor *t)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+
+    struct tensor_cpu_pool *cpu_pool = (struct tensor_cpu_pool *)pool;
+    void *data = tensor_cpu_pool_data_alloc(cpu_pool, t->data_size * dtype_sizeof(t->dtype));
+    if (!data)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    t->data = data;
+    return NO_ERROR;
 }
 
 static struct tensor *tensor_cpu_clone(void *pool, const struct tensor *const src)
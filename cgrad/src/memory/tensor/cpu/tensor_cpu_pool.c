@@ -7,16 +7,25 @@
 #include <string.h>
 #include <assert.h>
 
-static void tensor_cpu_pool_init_chunks(struct tensor_cpu_pool *pool);
+static void tensor_cpu_pool_init_chunks(struct tensor_cpu_pool *pool, const size_t n_chunks);
 
 cgrad_error tensor_cpu_pool_init(struct tensor_cpu_pool *pool)
+{
+    return tensor_cpu_pool_init_with_chunks(pool, MEMORY_TENSOR_POOL_N_CHUNKS);
+}
+
+cgrad_error tensor_cpu_pool_init_with_chunks(struct tensor_cpu_pool *pool, const size_t n_chunks)
 {
     if (!pool)
     {
         return MEMORY_POOL_NULL;
     }
+    if (n_chunks == 0)
+    {
+        return MEMORY_POOL_CHUNK_ALLOCATION_FAILED;
+    }
 
-    pool->tensor_memory= calloc(MEMORY_TENSOR_POOL_N_CHUNKS, sizeof(struct tensor_chunk));
+    pool->tensor_memory= calloc(n_chunks, sizeof(struct tensor_chunk));
     if (!pool->tensor_memory)
     {
         return MEMORY_POOL_CHUNK_ALLOCATION_FAILED;
@@ -29,9 +38,13 @@ cgrad_error tensor_cpu_pool_init(struct tensor_cpu_pool *pool)
      * Alloc data_memory 32-bytes aligned. Since sizeof(struct data_chunk) = 32, if MEMORY_TENSOR_POOL_DATA_CHUNK_SIZE
      * is a multiple of 32 bytes, then each data field of each chunk is 32-bytes aligned.
      */
-    pool->data_memory = aligned_alloc(TENSOR_CPU_POOL_DATA_ALIGNMENT, MEMORY_TENSOR_POOL_N_CHUNKS * DATA_CHUNK_SIZE);
+    pool->data_memory = aligned_alloc(TENSOR_CPU_POOL_DATA_ALIGNMENT, n_chunks * DATA_CHUNK_SIZE);
 
-    memset(pool->data_memory, 0, MEMORY_TENSOR_POOL_N_CHUNKS * DATA_CHUNK_SIZE);
+    /**
+     * The data region is not pre-touched: pages are only committed once a chunk is handed out, so the
+     * resident footprint follows the live tensors instead of the whole pool. Allocations needing zeroed
+     * memory go through tensor_cpu_pool_data_zero_alloc.
+     */
     if (!pool->data_memory)
     {
         free(pool->tensor_memory);
@@ -39,7 +52,7 @@ cgrad_error tensor_cpu_pool_init(struct tensor_cpu_pool *pool)
     }
     pool->data_chunk_head = (struct data_chunk *)pool->data_memory;
 
-    tensor_cpu_pool_init_chunks(pool);
+    tensor_cpu_pool_init_chunks(pool, n_chunks);
     return NO_ERROR;
 }
 
@@ -119,12 +132,12 @@ void tensor_cpu_pool_data_free(struct tensor_cpu_pool *pool, void *ptr)
     pool->data_chunk_head = chunk;
 }
 
-static void tensor_cpu_pool_init_chunks(struct tensor_cpu_pool *pool)
+static void tensor_cpu_pool_init_chunks(struct tensor_cpu_pool *pool, const size_t n_chunks)
 {
     struct tensor_chunk *tensor_chunk_current = (struct tensor_chunk *) pool->tensor_memory;
     struct data_chunk *data_chunk_current = (struct data_chunk *) pool->data_memory;
 
-    for (size_t i = 0; i < MEMORY_TENSOR_POOL_N_CHUNKS - 1; i++)
+    for (size_t i = 0; i < n_chunks - 1; i++)
     {
         tensor_chunk_current->next = (struct tensor_chunk *)((char *)tensor_chunk_current + sizeof(struct tensor_chunk));
         tensor_chunk_current = tensor_chunk_current->next;
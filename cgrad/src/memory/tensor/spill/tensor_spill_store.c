@@ -0,0 +1,342 @@
+#define _GNU_SOURCE
+#include "cgrad/memory/tensor/spill/tensor_spill_store.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static void *tensor_spill_store_worker(void *arg);
+static inline size_t tensor_spill_store_round_up(const struct tensor_spill_store *const store, const size_t bytes);
+static inline size_t tensor_spill_store_tensor_bytes(const struct tensor *const t);
+static bool tensor_spill_store_find(const struct tensor_spill_store *const store, const struct tensor *const t, size_t *const index);
+static void tensor_spill_store_prefetch(struct tensor_spill_store *const store, const size_t index);
+static void tensor_spill_store_remove(struct tensor_spill_store *const store, const size_t index);
+
+cgrad_error tensor_spill_store_init(struct tensor_spill_store *const store, const char *const dir, const size_t capacity, const size_t threshold)
+{
+    if (!store)
+    {
+        return TENSOR_SPILL_STORE_NULL;
+    }
+    if (!dir)
+    {
+        return TENSOR_SPILL_FILE_ERROR;
+    }
+
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/cgrad_spill_XXXXXX", dir) >= (int)sizeof(path))
+    {
+        return TENSOR_SPILL_FILE_ERROR;
+    }
+
+    store->fd = mkstemp(path);
+    if (store->fd < 0)
+    {
+        return TENSOR_SPILL_FILE_ERROR;
+    }
+
+    // Nobody else needs to reach the file, it is removed once closed
+    unlink(path);
+
+    store->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    store->capacity = tensor_spill_store_round_up(store, capacity);
+    if (ftruncate(store->fd, (off_t)store->capacity) != 0)
+    {
+        close(store->fd);
+        return TENSOR_SPILL_FILE_ERROR;
+    }
+
+    store->map = mmap(NULL, store->capacity, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+    if (store->map == MAP_FAILED)
+    {
+        close(store->fd);
+        return TENSOR_SPILL_FILE_ERROR;
+    }
+
+    store->used = 0;
+    store->threshold = threshold;
+    store->n_entries = 0;
+    store->jobs_head = 0;
+    store->jobs_size = 0;
+    store->pending = 0;
+    store->stop = false;
+
+    pthread_mutex_init(&store->lock, NULL);
+    pthread_cond_init(&store->cond, NULL);
+    if (pthread_create(&store->worker, NULL, tensor_spill_store_worker, store) != 0)
+    {
+        munmap(store->map, store->capacity);
+        close(store->fd);
+        return TENSOR_SPILL_FILE_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error tensor_spill_store_attach(struct tensor_spill_store *const store, struct tensor_allocator *const tensor_alloc)
+{
+    if (!store)
+    {
+        return TENSOR_SPILL_STORE_NULL;
+    }
+    if (!tensor_alloc)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+
+    tensor_alloc->spill = store;
+    return NO_ERROR;
+}
+
+void tensor_spill_store_on_free(struct tensor_spill_store *const store, struct tensor *const t, struct tensor_allocator *const tensor_alloc, const bool is_owner)
+{
+    // The last reference is going away: the tensor is freed, together with its spilled copy
+    if (t->ref_count == 1)
+    {
+        size_t index = 0;
+        pthread_mutex_lock(&store->lock);
+        if (!t->data && tensor_spill_store_find(store, t, &index))
+        {
+            tensor_spill_store_remove(store, index);
+        }
+        pthread_mutex_unlock(&store->lock);
+        return;
+    }
+
+    // The owner is done with the tensor: spill it if only backward needs its data
+    if (is_owner && t->saved_count > 0 && t->data && !t->is_view && tensor_spill_store_tensor_bytes(t) >= store->threshold)
+    {
+        // On failure the tensor simply stays in memory
+        tensor_spill_store_offload(store, t, tensor_alloc);
+    }
+}
+
+cgrad_error tensor_spill_store_offload(struct tensor_spill_store *const store, struct tensor *const t, struct tensor_allocator *const tensor_alloc)
+{
+    if (!store)
+    {
+        return TENSOR_SPILL_STORE_NULL;
+    }
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+
+    const size_t bytes = tensor_spill_store_tensor_bytes(t);
+    const size_t region = tensor_spill_store_round_up(store, bytes);
+
+    pthread_mutex_lock(&store->lock);
+
+    // Once every entry was restored and written back, the file is recycled from the start
+    if (store->n_entries == 0 && store->pending == 0)
+    {
+        store->used = 0;
+    }
+
+    if (store->n_entries == MEMORY_TENSOR_SPILL_MAX_ENTRIES || store->used + region > store->capacity)
+    {
+        pthread_mutex_unlock(&store->lock);
+        return TENSOR_SPILL_STORE_FULL;
+    }
+
+    const size_t offset = store->used;
+    store->used += region;
+
+    struct tensor_spill_entry *entry = &store->entries[store->n_entries++];
+    entry->t = t;
+    entry->offset = offset;
+    entry->bytes = bytes;
+
+    pthread_mutex_unlock(&store->lock);
+
+    // Copying dirties the page cache only, the disk write is left to the worker
+    memcpy(store->map + offset, t->data, bytes);
+    tensor_allocator_free_data(tensor_alloc, t);
+
+    pthread_mutex_lock(&store->lock);
+    const size_t tail = (store->jobs_head + store->jobs_size) % MEMORY_TENSOR_SPILL_MAX_ENTRIES;
+    store->jobs[tail].offset = offset;
+    store->jobs[tail].bytes = region;
+    store->jobs_size++;
+    store->pending++;
+    pthread_cond_broadcast(&store->cond);
+    pthread_mutex_unlock(&store->lock);
+
+    return NO_ERROR;
+}
+
+cgrad_error tensor_spill_store_restore(struct tensor_spill_store *const store, struct tensor *const t, struct tensor_allocator *const tensor_alloc)
+{
+    if (!store)
+    {
+        return TENSOR_SPILL_STORE_NULL;
+    }
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    size_t index = 0;
+    if (!tensor_spill_store_find(store, t, &index))
+    {
+        pthread_mutex_unlock(&store->lock);
+        return TENSOR_SPILL_ENTRY_NOT_FOUND;
+    }
+    const struct tensor_spill_entry entry = store->entries[index];
+    tensor_spill_store_prefetch(store, index);
+    pthread_mutex_unlock(&store->lock);
+
+    cgrad_error err = tensor_allocator_alloc_data(tensor_alloc, t);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Pages already dropped by the worker are read back from the file
+    memcpy(t->data, store->map + entry.offset, entry.bytes);
+
+    pthread_mutex_lock(&store->lock);
+    if (tensor_spill_store_find(store, t, &index))
+    {
+        tensor_spill_store_remove(store, index);
+    }
+    pthread_mutex_unlock(&store->lock);
+
+    return NO_ERROR;
+}
+
+cgrad_error tensor_spill_store_restore_context(struct tensor_spill_store *const store, const struct backpropagation_context *const ctx, struct tensor_allocator *const tensor_alloc)
+{
+    if (!store)
+    {
+        return TENSOR_SPILL_STORE_NULL;
+    }
+    if (!ctx)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL;
+    }
+
+    cgrad_error err = NO_ERROR;
+    for (size_t i = 0; i < AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE; i++)
+    {
+        struct tensor *t = ctx->operands[i];
+
+        // Saved tensors are never released, so a missing buffer means the tensor was offloaded
+        if (t && !t->data)
+        {
+            if ((err = tensor_spill_store_restore(store, t, tensor_alloc)) != NO_ERROR)
+            {
+                return err;
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+void tensor_spill_store_cleanup(struct tensor_spill_store *const store)
+{
+    if (!store)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    store->stop = true;
+    pthread_cond_broadcast(&store->cond);
+    pthread_mutex_unlock(&store->lock);
+    pthread_join(store->worker, NULL);
+
+    pthread_mutex_destroy(&store->lock);
+    pthread_cond_destroy(&store->cond);
+    munmap(store->map, store->capacity);
+    close(store->fd);
+    store->map = NULL;
+    store->fd = -1;
+}
+
+static void *tensor_spill_store_worker(void *arg)
+{
+    struct tensor_spill_store *store = (struct tensor_spill_store *)arg;
+
+    pthread_mutex_lock(&store->lock);
+    while (true)
+    {
+        while (!store->stop && store->jobs_size == 0)
+        {
+            pthread_cond_wait(&store->cond, &store->lock);
+        }
+        if (store->jobs_size == 0)
+        {
+            break;
+        }
+
+        const struct tensor_spill_job job = store->jobs[store->jobs_head];
+        store->jobs_head = (store->jobs_head + 1) % MEMORY_TENSOR_SPILL_MAX_ENTRIES;
+        store->jobs_size--;
+        pthread_mutex_unlock(&store->lock);
+
+        /**
+         * Write the region back and drop its pages, both from this mapping and from the page cache.
+         * The data is clean on disk at this point, so a later restore just faults it back in.
+         */
+        char *addr = store->map + job.offset;
+        msync(addr, job.bytes, MS_SYNC);
+        madvise(addr, job.bytes, MADV_DONTNEED);
+        posix_fadvise(store->fd, (off_t)job.offset, (off_t)job.bytes, POSIX_FADV_DONTNEED);
+
+        pthread_mutex_lock(&store->lock);
+        store->pending--;
+    }
+    pthread_mutex_unlock(&store->lock);
+
+    return NULL;
+}
+
+static inline size_t tensor_spill_store_round_up(const struct tensor_spill_store *const store, const size_t bytes)
+{
+    return (bytes + store->page_size - 1) / store->page_size * store->page_size;
+}
+
+static inline size_t tensor_spill_store_tensor_bytes(const struct tensor *const t)
+{
+    return t->data_size * dtype_sizeof(t->dtype);
+}
+
+static bool tensor_spill_store_find(const struct tensor_spill_store *const store, const struct tensor *const t, size_t *const index)
+{
+    // Backward restores the most recent entries first
+    for (size_t i = store->n_entries; i > 0; i--)
+    {
+        if (store->entries[i - 1].t == t)
+        {
+            *index = i - 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void tensor_spill_store_prefetch(struct tensor_spill_store *const store, const size_t index)
+{
+    const size_t depth = index < MEMORY_TENSOR_SPILL_PREFETCH_DEPTH ? index : MEMORY_TENSOR_SPILL_PREFETCH_DEPTH;
+    for (size_t i = 1; i <= depth; i++)
+    {
+        const struct tensor_spill_entry *entry = &store->entries[index - i];
+        madvise(store->map + entry->offset, tensor_spill_store_round_up(store, entry->bytes), MADV_WILLNEED);
+    }
+}
+
+static void tensor_spill_store_remove(struct tensor_spill_store *const store, const size_t index)
+{
+    memmove(&store->entries[index], &store->entries[index + 1], (store->n_entries - index - 1) * sizeof(struct tensor_spill_entry));
+    store->n_entries--;
+}
@@ -0,0 +1,482 @@
+#define _GNU_SOURCE
+#include "cgrad/model/model_checkpoint.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static inline size_t model_checkpoint_round_up(const size_t bytes);
+static inline size_t model_checkpoint_directory_end(const size_t n_tensors);
+static cgrad_error model_checkpoint_layout(struct tensor *const *const tensors, const size_t n_tensors, struct model_checkpoint_header *const header, struct model_checkpoint_entry *const entries);
+static int model_checkpoint_create_tmp(const char *const path, char *const tmp_path, const size_t file_size);
+static cgrad_error model_checkpoint_commit(const int fd, const bool is_written, const char *const tmp_path, const char *const path);
+static bool model_checkpoint_write_all(const int fd, const void *const buffer, const size_t size, const size_t offset);
+static bool model_checkpoint_sync_dir(const char *const path);
+static bool model_checkpoint_entry_is_valid(const struct model_checkpoint_entry *const entry, const size_t n_tensors, const size_t map_size);
+static bool model_checkpoint_entry_matches(const struct model_checkpoint_entry *const entry, const struct tensor *const t);
+
+cgrad_error model_checkpoint_save_tensors(struct tensor *const *const tensors, const size_t n_tensors, const char *const path)
+{
+    if (!tensors && n_tensors > 0)
+    {
+        return INPUT_NULL;
+    }
+    if (!path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    struct model_checkpoint_entry *entries = calloc(n_tensors > 0 ? n_tensors : 1, sizeof(struct model_checkpoint_entry));
+    if (!entries)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    struct model_checkpoint_header header;
+    cgrad_error err = model_checkpoint_layout(tensors, n_tensors, &header, entries);
+    if (err != NO_ERROR)
+    {
+        free(entries);
+        return err;
+    }
+
+    char tmp_path[MODEL_CHECKPOINT_MAX_PATH];
+    const int fd = model_checkpoint_create_tmp(path, tmp_path, header.file_size);
+    if (fd < 0)
+    {
+        free(entries);
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    // Payloads are written straight from the tensors, padding is never written and reads as zeros
+    bool is_written = model_checkpoint_write_all(fd, &header, sizeof(header), 0) &&
+                      model_checkpoint_write_all(fd, entries, n_tensors * sizeof(struct model_checkpoint_entry), sizeof(header));
+    for (size_t i = 0; is_written && i < n_tensors; i++)
+    {
+        const size_t bytes = entries[i].data_size * dtype_sizeof(tensors[i]->dtype);
+        is_written = model_checkpoint_write_all(fd, tensors[i]->data, bytes, entries[i].offset);
+    }
+    free(entries);
+
+    return model_checkpoint_commit(fd, is_written, tmp_path, path);
+}
+
+cgrad_error model_checkpoint_save(const struct model_params *const params, const char *const path)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+
+    return model_checkpoint_save_tensors(params->params, params->size, path);
+}
+
+cgrad_error model_checkpoint_image_size(struct tensor *const *const tensors, const size_t n_tensors, size_t *const size)
+{
+    if (!tensors && n_tensors > 0)
+    {
+        return INPUT_NULL;
+    }
+    if (!size)
+    {
+        return OUTPUT_NULL;
+    }
+
+    struct model_checkpoint_header header;
+    cgrad_error err = model_checkpoint_layout(tensors, n_tensors, &header, NULL);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    *size = header.file_size;
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_serialize(struct tensor *const *const tensors, const size_t n_tensors, void *const image, const size_t image_size)
+{
+    if (!tensors && n_tensors > 0)
+    {
+        return INPUT_NULL;
+    }
+    if (!image)
+    {
+        return OUTPUT_NULL;
+    }
+
+    // The directory is laid out in place, right after the header
+    char *bytes = (char *)image;
+    struct model_checkpoint_header header;
+    struct model_checkpoint_entry *entries = (struct model_checkpoint_entry *)(bytes + sizeof(header));
+    if (image_size < model_checkpoint_directory_end(n_tensors))
+    {
+        return MODEL_CHECKPOINT_MISMATCH;
+    }
+
+    cgrad_error err = model_checkpoint_layout(tensors, n_tensors, &header, entries);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if (image_size < header.file_size)
+    {
+        return MODEL_CHECKPOINT_MISMATCH;
+    }
+    memcpy(bytes, &header, sizeof(header));
+
+    size_t end = model_checkpoint_directory_end(n_tensors);
+    for (size_t i = 0; i < n_tensors; i++)
+    {
+        const size_t payload_bytes = entries[i].data_size * dtype_sizeof(tensors[i]->dtype);
+        memset(bytes + end, 0, entries[i].offset - end);
+        memcpy(bytes + entries[i].offset, tensors[i]->data, payload_bytes);
+        end = entries[i].offset + payload_bytes;
+    }
+    memset(bytes + end, 0, header.file_size - end);
+
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_write_image(const void *const image, const size_t image_size, const char *const path)
+{
+    if (!image)
+    {
+        return INPUT_NULL;
+    }
+    if (!path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    char tmp_path[MODEL_CHECKPOINT_MAX_PATH];
+    const int fd = model_checkpoint_create_tmp(path, tmp_path, image_size);
+    if (fd < 0)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    const bool is_written = model_checkpoint_write_all(fd, image, image_size, 0);
+    return model_checkpoint_commit(fd, is_written, tmp_path, path);
+}
+
+cgrad_error model_checkpoint_open(struct model_checkpoint *const ckpt, const char *const path, const bool is_writable)
+{
+    if (!ckpt)
+    {
+        return MODEL_CHECKPOINT_NULL;
+    }
+    if (!path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if ((size_t)st.st_size < sizeof(struct model_checkpoint_header))
+    {
+        close(fd);
+        return MODEL_CHECKPOINT_FORMAT_ERROR;
+    }
+
+    // Private mappings copy the pages written to, shared ones let processes share the page cache
+    const size_t map_size = (size_t)st.st_size;
+    const int prot = is_writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    const int flags = is_writable ? MAP_PRIVATE : MAP_SHARED;
+    void *map = mmap(NULL, map_size, prot, flags, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    const struct model_checkpoint_header *header = (const struct model_checkpoint_header *)map;
+    const bool is_valid_header = memcmp(header->magic, MODEL_CHECKPOINT_MAGIC, sizeof(header->magic)) == 0 &&
+                                 header->version == MODEL_CHECKPOINT_VERSION &&
+                                 header->file_size == map_size &&
+                                 model_checkpoint_directory_end(header->n_tensors) <= map_size;
+    if (!is_valid_header)
+    {
+        munmap(map, map_size);
+        return MODEL_CHECKPOINT_FORMAT_ERROR;
+    }
+
+    const struct model_checkpoint_entry *entries = (const struct model_checkpoint_entry *)((const char *)map + sizeof(struct model_checkpoint_header));
+    for (size_t i = 0; i < header->n_tensors; i++)
+    {
+        if (!model_checkpoint_entry_is_valid(&entries[i], header->n_tensors, map_size))
+        {
+            munmap(map, map_size);
+            return MODEL_CHECKPOINT_FORMAT_ERROR;
+        }
+    }
+
+    ckpt->map = map;
+    ckpt->map_size = map_size;
+    ckpt->n_tensors = header->n_tensors;
+    ckpt->entries = entries;
+
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_load(const struct model_checkpoint *const ckpt, struct model_params *const params, struct tensor_allocator *const tensor_alloc)
+{
+    if (!ckpt || !ckpt->map)
+    {
+        return MODEL_CHECKPOINT_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!tensor_alloc)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+    if (ckpt->n_tensors < params->size)
+    {
+        return MODEL_CHECKPOINT_MISMATCH;
+    }
+
+    // Nothing is touched unless every parameter matches
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (!model_checkpoint_entry_matches(&ckpt->entries[i], params->params[i]))
+        {
+            return MODEL_CHECKPOINT_MISMATCH;
+        }
+    }
+
+    const bool is_flat = model_params_is_flat(params);
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *param = params->params[i];
+        char *payload = (char *)ckpt->map + ckpt->entries[i].offset;
+
+        if (is_flat)
+        {
+            memcpy(param->data, payload, param->data_size * dtype_sizeof(param->dtype));
+            continue;
+        }
+
+        tensor_allocator_free_data(tensor_alloc, param);
+        param->data = payload;
+        param->is_view = true;
+    }
+
+    return NO_ERROR;
+}
+
+void model_checkpoint_close(struct model_checkpoint *const ckpt)
+{
+    if (!ckpt || !ckpt->map)
+    {
+        return;
+    }
+
+    munmap(ckpt->map, ckpt->map_size);
+    ckpt->map = NULL;
+    ckpt->map_size = 0;
+    ckpt->n_tensors = 0;
+    ckpt->entries = NULL;
+}
+
+static inline size_t model_checkpoint_round_up(const size_t bytes)
+{
+    return (bytes + MODEL_CHECKPOINT_ALIGNMENT - 1) / MODEL_CHECKPOINT_ALIGNMENT * MODEL_CHECKPOINT_ALIGNMENT;
+}
+
+static inline size_t model_checkpoint_directory_end(const size_t n_tensors)
+{
+    return sizeof(struct model_checkpoint_header) + n_tensors * sizeof(struct model_checkpoint_entry);
+}
+
+static cgrad_error model_checkpoint_layout(struct tensor *const *const tensors, const size_t n_tensors, struct model_checkpoint_header *const header, struct model_checkpoint_entry *const entries)
+{
+    size_t offset = model_checkpoint_round_up(model_checkpoint_directory_end(n_tensors));
+    for (size_t i = 0; i < n_tensors; i++)
+    {
+        const struct tensor *t = tensors[i];
+        if (!t)
+        {
+            return TENSOR_NULL;
+        }
+        if (!t->data)
+        {
+            return TENSOR_DATA_NULL;
+        }
+        if (dtype_sizeof(t->dtype) == 0)
+        {
+            return TENSOR_INVALID_DTYPE;
+        }
+
+        // Only sizes are needed without a directory to fill
+        if (entries)
+        {
+            struct model_checkpoint_entry *entry = &entries[i];
+            memset(entry, 0, sizeof(*entry));
+            entry->offset = offset;
+            entry->data_size = t->data_size;
+            entry->dtype = (uint32_t)t->dtype;
+            entry->shape_size = (uint32_t)t->shape_size;
+            for (size_t d = 0; d < t->shape_size; d++)
+            {
+                entry->shape[d] = t->shape[d];
+            }
+        }
+
+        offset += model_checkpoint_round_up(t->data_size * dtype_sizeof(t->dtype));
+    }
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, MODEL_CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->version = MODEL_CHECKPOINT_VERSION;
+    header->n_tensors = (uint32_t)n_tensors;
+    header->file_size = offset;
+
+    return NO_ERROR;
+}
+
+static int model_checkpoint_create_tmp(const char *const path, char *const tmp_path, const size_t file_size)
+{
+    // Checkpoints are written next to their path, which they replace once complete
+    if (snprintf(tmp_path, MODEL_CHECKPOINT_MAX_PATH, "%s.tmp", path) >= MODEL_CHECKPOINT_MAX_PATH)
+    {
+        return -1;
+    }
+
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (ftruncate(fd, (off_t)file_size) != 0)
+    {
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return fd;
+}
+
+static cgrad_error model_checkpoint_commit(const int fd, const bool is_written, const char *const tmp_path, const char *const path)
+{
+    // The new file replaces the previous one only once on disk
+    bool is_synced = is_written && fsync(fd) == 0;
+    is_synced = close(fd) == 0 && is_synced;
+    if (!is_synced || rename(tmp_path, path) != 0)
+    {
+        unlink(tmp_path);
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    return model_checkpoint_sync_dir(path) ? NO_ERROR : MODEL_CHECKPOINT_FILE_ERROR;
+}
+
+static bool model_checkpoint_write_all(const int fd, const void *const buffer, const size_t size, const size_t offset)
+{
+    const char *bytes = (const char *)buffer;
+    size_t written = 0;
+    while (written < size)
+    {
+        const ssize_t n = pwrite(fd, bytes + written, size - written, (off_t)(offset + written));
+        if (n < 0)
+        {
+            return false;
+        }
+        written += (size_t)n;
+    }
+
+    return true;
+}
+
+static bool model_checkpoint_sync_dir(const char *const path)
+{
+    // The rename is durable once the directory holding the file is synced
+    char dir[MODEL_CHECKPOINT_MAX_PATH];
+    const char *slash = strrchr(path, '/');
+    if (!slash)
+    {
+        strcpy(dir, ".");
+    }
+    else if (slash == path)
+    {
+        strcpy(dir, "/");
+    }
+    else if ((size_t)(slash - path) < sizeof(dir))
+    {
+        memcpy(dir, path, (size_t)(slash - path));
+        dir[slash - path] = '\0';
+    }
+    else
+    {
+        return false;
+    }
+
+    const int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool is_synced = fsync(fd) == 0;
+    close(fd);
+
+    return is_synced;
+}
+
+static bool model_checkpoint_entry_is_valid(const struct model_checkpoint_entry *const entry, const size_t n_tensors, const size_t map_size)
+{
+    const size_t dtype_size = dtype_sizeof((cgrad_dtype)entry->dtype);
+    if (dtype_size == 0 || entry->shape_size > TENSOR_MAX_SHAPE_SIZE)
+    {
+        return false;
+    }
+
+    size_t data_size = 1;
+    for (size_t d = 0; d < entry->shape_size; d++)
+    {
+        if (entry->shape[d] != 0 && data_size > SIZE_MAX / entry->shape[d])
+        {
+            return false;
+        }
+        data_size *= entry->shape[d];
+    }
+
+    // Payloads are aligned, past the directory and within the file
+    return data_size == entry->data_size &&
+           entry->offset % MODEL_CHECKPOINT_ALIGNMENT == 0 &&
+           entry->offset >= model_checkpoint_directory_end(n_tensors) &&
+           entry->offset <= map_size &&
+           entry->data_size <= (map_size - entry->offset) / dtype_size;
+}
+
+static bool model_checkpoint_entry_matches(const struct model_checkpoint_entry *const entry, const struct tensor *const t)
+{
+    if (!t || entry->dtype != (uint32_t)t->dtype || entry->shape_size != t->shape_size || entry->data_size != t->data_size)
+    {
+        return false;
+    }
+
+    for (size_t d = 0; d < t->shape_size; d++)
+    {
+        if (entry->shape[d] != t->shape[d])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
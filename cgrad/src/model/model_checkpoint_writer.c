@@ -0,0 +1,175 @@
+#include "cgrad/model/model_checkpoint_writer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void *model_checkpoint_writer_worker(void *arg);
+static cgrad_error model_checkpoint_writer_reserve(struct model_checkpoint_writer *const writer, const size_t size);
+
+cgrad_error model_checkpoint_writer_init(struct model_checkpoint_writer *const writer)
+{
+    if (!writer)
+    {
+        return MODEL_CHECKPOINT_WRITER_NULL;
+    }
+
+    writer->staging = NULL;
+    writer->staging_capacity = 0;
+    writer->staging_size = 0;
+    writer->path[0] = '\0';
+    writer->is_pending = false;
+    writer->stop = false;
+    writer->error = NO_ERROR;
+
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+    if (pthread_create(&writer->worker, NULL, model_checkpoint_writer_worker, writer) != 0)
+    {
+        pthread_cond_destroy(&writer->cond);
+        pthread_mutex_destroy(&writer->lock);
+        return MODEL_CHECKPOINT_ALLOCATION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_writer_snapshot(struct model_checkpoint_writer *const writer, struct tensor *const *const tensors, const size_t n_tensors, const char *const path)
+{
+    if (!writer)
+    {
+        return MODEL_CHECKPOINT_WRITER_NULL;
+    }
+    if (!path || strlen(path) >= MODEL_CHECKPOINT_MAX_PATH)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    size_t size = 0;
+    cgrad_error err = model_checkpoint_image_size(tensors, n_tensors, &size);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->is_pending)
+    {
+        pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    err = writer->error;
+    pthread_mutex_unlock(&writer->lock);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The worker is idle, the staging image is ours until handed over
+    if ((err = model_checkpoint_writer_reserve(writer, size)) != NO_ERROR ||
+        (err = model_checkpoint_serialize(tensors, n_tensors, writer->staging, size)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    writer->staging_size = size;
+    strcpy(writer->path, path);
+    writer->is_pending = true;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_writer_wait(struct model_checkpoint_writer *const writer)
+{
+    if (!writer)
+    {
+        return MODEL_CHECKPOINT_WRITER_NULL;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->is_pending)
+    {
+        pthread_cond_wait(&writer->cond, &writer->lock);
+    }
+    const cgrad_error err = writer->error;
+    writer->error = NO_ERROR;
+    pthread_mutex_unlock(&writer->lock);
+
+    return err;
+}
+
+void model_checkpoint_writer_cleanup(struct model_checkpoint_writer *const writer)
+{
+    if (!writer)
+    {
+        return;
+    }
+
+    // The worker writes the pending checkpoint, if any, before stopping
+    pthread_mutex_lock(&writer->lock);
+    writer->stop = true;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->worker, NULL);
+
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->lock);
+    free(writer->staging);
+    writer->staging = NULL;
+    writer->staging_capacity = 0;
+    writer->staging_size = 0;
+}
+
+static void *model_checkpoint_writer_worker(void *arg)
+{
+    struct model_checkpoint_writer *writer = (struct model_checkpoint_writer *)arg;
+
+    pthread_mutex_lock(&writer->lock);
+    while (true)
+    {
+        while (!writer->stop && !writer->is_pending)
+        {
+            pthread_cond_wait(&writer->cond, &writer->lock);
+        }
+        if (!writer->is_pending)
+        {
+            break;
+        }
+        pthread_mutex_unlock(&writer->lock);
+
+        // Training goes on meanwhile, it only touches the tensors, never the staging image
+        const cgrad_error err = model_checkpoint_write_image(writer->staging, writer->staging_size, writer->path);
+
+        pthread_mutex_lock(&writer->lock);
+        if (writer->error == NO_ERROR)
+        {
+            writer->error = err;
+        }
+        writer->is_pending = false;
+        pthread_cond_broadcast(&writer->cond);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    return NULL;
+}
+
+static cgrad_error model_checkpoint_writer_reserve(struct model_checkpoint_writer *const writer, const size_t size)
+{
+    if (size <= writer->staging_capacity)
+    {
+        return NO_ERROR;
+    }
+
+    // aligned_alloc requires a multiple of the alignment, checkpoint sizes always are
+    void *staging = aligned_alloc(MODEL_CHECKPOINT_ALIGNMENT, size);
+    if (!staging)
+    {
+        return MODEL_CHECKPOINT_ALLOCATION_FAILED;
+    }
+
+    free(writer->staging);
+    writer->staging = staging;
+    writer->staging_capacity = size;
+
+    return NO_ERROR;
+}
@@ -1,9 +1,15 @@
 #include "cgrad/model/model_params.h"
+#include <stdlib.h>
+
+static void *model_params_flat_alloc(const size_t size);
 
 void model_params_init(struct model_params *const params)
 {
     params->size = 0;
     memset(params->params, 0, params->size * sizeof(struct tensor *));
+    params->flat_data = NULL;
+    params->flat_grad = NULL;
+    params->flat_size = 0;
 }
 
 cgrad_error add_model_param(struct model_params *const params, struct tensor *const t)
@@ -13,9 +19,132 @@ cgrad_error add_model_param(struct model_params *const params, struct tensor *co
     {
         return MODEL_MAX_PARAMS_EXCEEDED;
     }
+    if (model_params_is_flat(params))
+    {
+        return MODEL_PARAMS_ALREADY_FLAT;
+    }
 
     params->params[size] = t;
     params->size++;
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
+
+cgrad_error model_params_flatten(struct model_params *const params, struct tensor_allocator *const tensor_alloc)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!tensor_alloc)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+    if (model_params_is_flat(params))
+    {
+        return MODEL_PARAMS_ALREADY_FLAT;
+    }
+    if (params->size == 0)
+    {
+        return NO_ERROR;
+    }
+
+    const cgrad_dtype dtype = params->params[0]->dtype;
+    const size_t dtype_size = dtype_sizeof(dtype);
+    const size_t alignment = MODEL_PARAMS_FLAT_ALIGNMENT / dtype_size;
+
+    // Every parameter starts on its own aligned boundary
+    size_t flat_size = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        if (param->dtype != dtype || (param->grad && param->grad->dtype != dtype))
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+        if (!param->data)
+        {
+            return TENSOR_DATA_NULL;
+        }
+        if (param->is_view)
+        {
+            return MODEL_PARAMS_ALREADY_FLAT;
+        }
+
+        params->flat_offsets[i] = flat_size;
+        flat_size += (param->data_size + alignment - 1) / alignment * alignment;
+    }
+
+    char *flat_data = model_params_flat_alloc(flat_size * dtype_size);
+    char *flat_grad = model_params_flat_alloc(flat_size * dtype_size);
+    if (!flat_data || !flat_grad)
+    {
+        free(flat_data);
+        free(flat_grad);
+        return MODEL_PARAMS_ALLOCATION_FAILED;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *param = params->params[i];
+        const size_t offset = params->flat_offsets[i] * dtype_size;
+
+        memcpy(flat_data + offset, param->data, param->data_size * dtype_size);
+        tensor_allocator_free_data(tensor_alloc, param);
+        param->data = flat_data + offset;
+        param->is_view = true;
+
+        struct tensor *grad = param->grad;
+        if (grad)
+        {
+            memcpy(flat_grad + offset, grad->data, grad->data_size * dtype_size);
+            tensor_allocator_free_data(tensor_alloc, grad);
+            grad->data = flat_grad + offset;
+            grad->is_view = true;
+        }
+    }
+
+    params->flat_data = flat_data;
+    params->flat_grad = flat_grad;
+    params->flat_size = flat_size;
+    params->flat_dtype = dtype;
+
+    return NO_ERROR;
+}
+
+void *model_params_alloc_flat_buffer(const struct model_params *const params, const cgrad_dtype dtype)
+{
+    if (!params || !model_params_is_flat(params))
+    {
+        return NULL;
+    }
+
+    return model_params_flat_alloc(params->flat_size * dtype_sizeof(dtype));
+}
+
+void model_params_cleanup(struct model_params *const params)
+{
+    if (!params)
+    {
+        return;
+    }
+
+    free(params->flat_data);
+    free(params->flat_grad);
+    params->flat_data = NULL;
+    params->flat_grad = NULL;
+    params->flat_size = 0;
+}
+
+static void *model_params_flat_alloc(const size_t size)
+{
+    // aligned_alloc requires a multiple of the alignment
+    const size_t rounded_size = (size + MODEL_PARAMS_FLAT_ALIGNMENT - 1) / MODEL_PARAMS_FLAT_ALIGNMENT * MODEL_PARAMS_FLAT_ALIGNMENT;
+    void *buffer = aligned_alloc(MODEL_PARAMS_FLAT_ALIGNMENT, rounded_size > 0 ? rounded_size : MODEL_PARAMS_FLAT_ALIGNMENT);
+    if (buffer)
+    {
+        memset(buffer, 0, rounded_size);
+    }
+
+    return buffer;
+}
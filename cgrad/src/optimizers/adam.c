@@ -0,0 +1,620 @@
+#include "cgrad/optimizers/adam.h"
+#include "cgrad/optimizers/multi_tensor.h"
+#include "cgrad/optimizers/quantized_state.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdlib.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+/**
+ * Coefficients of a step, shared by every kernel:
+ *   g <- grad_scale * grad + l2 * param
+ *   m <- beta1 * m + (1 - beta1) * g
+ *   v <- beta2 * v + (1 - beta2) * g^2
+ *   param <- decay * param - step_size * m / (sqrt(v) * inv_sqrt_correction2 + eps)
+ * where step_size folds the first bias correction into the learning rate.
+ */
+struct adam_step_args
+{
+    struct adam_optimizer *opt;
+    double grad_scale;
+    double l2;
+    double decay;
+    double beta1;
+    double beta2;
+    double eps;
+    double step_size;
+    double inv_sqrt_correction2;
+};
+
+static cgrad_error adam_optimizer_setup(struct adam_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator, const bool is_quantized);
+static cgrad_error add_moments(struct adam_optimizer *const opt, const struct tensor *const param, struct tensor *const first_moment, struct tensor *const second_moment, struct tensor *const master_param);
+static cgrad_dtype adam_state_dtype(const cgrad_dtype param_dtype);
+static void adam_step_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+static void adam_step_quantized_chunk(const struct adam_step_args *const args, const size_t param_index, const cgrad_dtype dtype, void *const param_data, const void *const grad_data, float *const master_data, const size_t start, const size_t end);
+static void adam_update_f64(double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct adam_step_args *const args);
+static void adam_update_f32(float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct adam_step_args *const args);
+static void adam_update_bf16(bfloat16 *restrict param, float *restrict master, float *restrict m, float *restrict v, const bfloat16 *restrict grad, const size_t size, const struct adam_step_args *const args);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void adam_update_avx_256_f64(double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct adam_step_args *const args);
+static void adam_update_avx_256_f32(float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct adam_step_args *const args);
+static void adam_update_avx_256_bf16(bfloat16 *restrict param, float *restrict master, float *restrict m, float *restrict v, const bfloat16 *restrict grad, const size_t size, const struct adam_step_args *const args);
+#endif
+
+cgrad_error adam_optimizer_init(struct adam_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator)
+{
+    return adam_optimizer_setup(opt, params, beta1, beta2, eps, allocator, false);
+}
+
+cgrad_error adam_optimizer_init_8bit(struct adam_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator)
+{
+    return adam_optimizer_setup(opt, params, beta1, beta2, eps, allocator, true);
+}
+
+static cgrad_error adam_optimizer_setup(struct adam_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator, const bool is_quantized)
+{
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!allocator)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+
+    opt->params = params;
+    opt->allocator = allocator;
+    opt->size = 0;
+    opt->beta1 = beta1;
+    opt->beta2 = beta2;
+    opt->eps = eps;
+    opt->weight_decay = 0;
+    opt->grad_scale = 1;
+    opt->decoupled_weight_decay = true;
+    opt->step_count = 0;
+    opt->flat_first_moment = NULL;
+    opt->flat_second_moment = NULL;
+    opt->flat_master_params = NULL;
+    opt->is_quantized = is_quantized;
+
+    // Flat parameters get flat moments, so that steps sweep single buffers
+    if (model_params_is_flat(params))
+    {
+        if (!is_quantized)
+        {
+            const cgrad_dtype state_dtype = adam_state_dtype(params->flat_dtype);
+            opt->flat_first_moment = model_params_alloc_flat_buffer(params, state_dtype);
+            opt->flat_second_moment = model_params_alloc_flat_buffer(params, state_dtype);
+            if (!opt->flat_first_moment || !opt->flat_second_moment)
+            {
+                return TENSOR_ALLOCATION_FAILED;
+            }
+        }
+
+        if (params->flat_dtype == DTYPE_BFLOAT16)
+        {
+            opt->flat_master_params = model_params_alloc_flat_buffer(params, DTYPE_FLOAT32);
+            if (!opt->flat_master_params)
+            {
+                return TENSOR_ALLOCATION_FAILED;
+            }
+            const bfloat16 *flat_data = (const bfloat16 *)params->flat_data;
+            for (size_t i = 0; i < params->flat_size; i++)
+            {
+                opt->flat_master_params[i] = bfloat16_to_float(flat_data[i]);
+            }
+        }
+
+        for (size_t i = 0; i < params->size; i++)
+        {
+            cgrad_error err = add_moments(opt, params->params[i], NULL, NULL, NULL);
+            if (err != NO_ERROR)
+            {
+                return err;
+            }
+        }
+        return NO_ERROR;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *param = params->params[i];
+        struct tensor *first_moment = NULL;
+        struct tensor *second_moment = NULL;
+        if (!is_quantized)
+        {
+            const cgrad_dtype state_dtype = adam_state_dtype(param->dtype);
+            first_moment = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, state_dtype);
+            second_moment = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, state_dtype);
+            if (!first_moment || !second_moment)
+            {
+                return TENSOR_ALLOCATION_FAILED;
+            }
+        }
+
+        struct tensor *master_param = NULL;
+        if (param->dtype == DTYPE_BFLOAT16)
+        {
+            master_param = tensor_allocator_no_grad_alloc(allocator, param->shape, param->shape_size, DTYPE_FLOAT32);
+            if (!master_param)
+            {
+                return TENSOR_ALLOCATION_FAILED;
+            }
+            const bfloat16 *param_data = (const bfloat16 *)param->data;
+            float *master_data = (float *)master_param->data;
+            for (size_t j = 0; j < param->data_size; j++)
+            {
+                master_data[j] = bfloat16_to_float(param_data[j]);
+            }
+        }
+
+        cgrad_error err = add_moments(opt, param, first_moment, second_moment, master_param);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error adam_optimizer_step(struct adam_optimizer *opt, double lr)
+{
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+
+    for (size_t i = 0; i < opt->params->size; i++)
+    {
+        const struct tensor *param = opt->params->params[i];
+        if (param->dtype != DTYPE_FLOAT64 && param->dtype != DTYPE_FLOAT32 && param->dtype != DTYPE_BFLOAT16)
+        {
+            return OPERATION_INVALID_TENSOR_DTYPE;
+        }
+        if (param->grad && param->grad->dtype != param->dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+    }
+
+    opt->step_count++;
+    const double correction1 = 1 - pow(opt->beta1, (double)opt->step_count);
+    const double correction2 = 1 - pow(opt->beta2, (double)opt->step_count);
+
+    struct adam_step_args args;
+    args.opt = opt;
+    args.grad_scale = opt->grad_scale;
+    args.l2 = opt->decoupled_weight_decay ? 0 : opt->weight_decay;
+    args.decay = opt->decoupled_weight_decay ? 1 - lr * opt->weight_decay : 1;
+    args.beta1 = opt->beta1;
+    args.beta2 = opt->beta2;
+    args.eps = opt->eps;
+    args.step_size = lr / correction1;
+    args.inv_sqrt_correction2 = 1 / sqrt(correction2);
+
+    // Frozen parameters are left untouched by the sweep. Quantized blocks must not straddle chunks
+    if (opt->is_quantized)
+    {
+        return multi_tensor_apply_per_param(opt->params, &adam_step_chunk, &args);
+    }
+    return multi_tensor_apply(opt->params, &adam_step_chunk, &args);
+}
+
+void adam_optimizer_cleanup(struct adam_optimizer *opt)
+{
+    if (!opt)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < opt->size; i++)
+    {
+        if (opt->first_moments[i])
+        {
+            tensor_allocator_free(opt->allocator, opt->first_moments[i]);
+        }
+        if (opt->second_moments[i])
+        {
+            tensor_allocator_free(opt->allocator, opt->second_moments[i]);
+        }
+        if (opt->master_params[i])
+        {
+            tensor_allocator_free(opt->allocator, opt->master_params[i]);
+        }
+        if (opt->is_quantized)
+        {
+            quantized_state_cleanup(&opt->quantized_first_moments[i]);
+            quantized_state_cleanup(&opt->quantized_second_moments[i]);
+        }
+    }
+    free(opt->flat_first_moment);
+    free(opt->flat_second_moment);
+    free(opt->flat_master_params);
+    opt->flat_first_moment = NULL;
+    opt->flat_second_moment = NULL;
+    opt->flat_master_params = NULL;
+}
+
+static cgrad_dtype adam_state_dtype(const cgrad_dtype param_dtype)
+{
+    return param_dtype == DTYPE_FLOAT64 ? DTYPE_FLOAT64 : DTYPE_FLOAT32;
+}
+
+static void adam_step_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    const struct adam_step_args *step_args = (const struct adam_step_args *)args;
+    struct adam_optimizer *opt = step_args->opt;
+    const struct model_params *params = opt->params;
+    const size_t size = end - start;
+
+    cgrad_dtype dtype;
+    void *param_data;
+    const void *grad_data;
+    void *m_data;
+    void *v_data;
+    float *master_data;
+    if (param_index == MULTI_TENSOR_FLAT)
+    {
+        dtype = params->flat_dtype;
+        param_data = params->flat_data;
+        grad_data = params->flat_grad;
+        m_data = opt->flat_first_moment;
+        v_data = opt->flat_second_moment;
+        master_data = opt->flat_master_params;
+    }
+    else
+    {
+        struct tensor *param = params->params[param_index];
+        dtype = param->dtype;
+        param_data = param->data;
+        grad_data = param->grad->data;
+        if (model_params_is_flat(params))
+        {
+            const size_t offset = params->flat_offsets[param_index];
+            const size_t state_size = dtype_sizeof(adam_state_dtype(dtype));
+            m_data = opt->flat_first_moment ? (char *)opt->flat_first_moment + offset * state_size : NULL;
+            v_data = opt->flat_second_moment ? (char *)opt->flat_second_moment + offset * state_size : NULL;
+            master_data = opt->flat_master_params ? opt->flat_master_params + offset : NULL;
+        }
+        else
+        {
+            m_data = opt->first_moments[param_index] ? opt->first_moments[param_index]->data : NULL;
+            v_data = opt->second_moments[param_index] ? opt->second_moments[param_index]->data : NULL;
+            master_data = opt->master_params[param_index] ? (float *)opt->master_params[param_index]->data : NULL;
+        }
+    }
+
+    if (opt->is_quantized)
+    {
+        adam_step_quantized_chunk(step_args, param_index, dtype, param_data, grad_data, master_data, start, end);
+        return;
+    }
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+    {
+        double *param_chunk = (double *)param_data + start;
+        double *m_chunk = (double *)m_data + start;
+        double *v_chunk = (double *)v_data + start;
+        const double *grad_chunk = (const double *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        adam_update_avx_256_f64(param_chunk, m_chunk, v_chunk, grad_chunk, size, step_args);
+#else
+        adam_update_f64(param_chunk, m_chunk, v_chunk, grad_chunk, size, step_args);
+#endif
+        break;
+    }
+    case DTYPE_FLOAT32:
+    {
+        float *param_chunk = (float *)param_data + start;
+        float *m_chunk = (float *)m_data + start;
+        float *v_chunk = (float *)v_data + start;
+        const float *grad_chunk = (const float *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        adam_update_avx_256_f32(param_chunk, m_chunk, v_chunk, grad_chunk, size, step_args);
+#else
+        adam_update_f32(param_chunk, m_chunk, v_chunk, grad_chunk, size, step_args);
+#endif
+        break;
+    }
+    case DTYPE_BFLOAT16:
+    {
+        bfloat16 *param_chunk = (bfloat16 *)param_data + start;
+        float *master_chunk = master_data + start;
+        float *m_chunk = (float *)m_data + start;
+        float *v_chunk = (float *)v_data + start;
+        const bfloat16 *grad_chunk = (const bfloat16 *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        adam_update_avx_256_bf16(param_chunk, master_chunk, m_chunk, v_chunk, grad_chunk, size, step_args);
+#else
+        adam_update_bf16(param_chunk, master_chunk, m_chunk, v_chunk, grad_chunk, size, step_args);
+#endif
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * Moments are decoded one block at a time into buffers that stay in cache, updated by the fused kernel
+ * of the dtype, and encoded back on the new scale of the block.
+ */
+static void adam_step_quantized_chunk(const struct adam_step_args *const args, const size_t param_index, const cgrad_dtype dtype, void *const param_data, const void *const grad_data, float *const master_data, const size_t start, const size_t end)
+{
+    struct quantized_state *first_moment = &args->opt->quantized_first_moments[param_index];
+    struct quantized_state *second_moment = &args->opt->quantized_second_moments[param_index];
+
+    for (size_t block_start = start; block_start < end; block_start += OPTIMIZER_STATE_BLOCK_SIZE)
+    {
+        const size_t size = end - block_start < OPTIMIZER_STATE_BLOCK_SIZE ? end - block_start : OPTIMIZER_STATE_BLOCK_SIZE;
+
+        if (dtype == DTYPE_FLOAT64)
+        {
+            double m[OPTIMIZER_STATE_BLOCK_SIZE];
+            double v[OPTIMIZER_STATE_BLOCK_SIZE];
+            quantized_state_load_block_f64(first_moment, block_start, size, m);
+            quantized_state_load_block_f64(second_moment, block_start, size, v);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+            adam_update_avx_256_f64((double *)param_data + block_start, m, v, (const double *)grad_data + block_start, size, args);
+#else
+            adam_update_f64((double *)param_data + block_start, m, v, (const double *)grad_data + block_start, size, args);
+#endif
+            quantized_state_store_block_f64(first_moment, block_start, size, m);
+            quantized_state_store_block_f64(second_moment, block_start, size, v);
+            continue;
+        }
+
+        float m[OPTIMIZER_STATE_BLOCK_SIZE];
+        float v[OPTIMIZER_STATE_BLOCK_SIZE];
+        quantized_state_load_block_f32(first_moment, block_start, size, m);
+        quantized_state_load_block_f32(second_moment, block_start, size, v);
+        if (dtype == DTYPE_FLOAT32)
+        {
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+            adam_update_avx_256_f32((float *)param_data + block_start, m, v, (const float *)grad_data + block_start, size, args);
+#else
+            adam_update_f32((float *)param_data + block_start, m, v, (const float *)grad_data + block_start, size, args);
+#endif
+        }
+        else if (dtype == DTYPE_BFLOAT16)
+        {
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+            adam_update_avx_256_bf16((bfloat16 *)param_data + block_start, master_data + block_start, m, v, (const bfloat16 *)grad_data + block_start, size, args);
+#else
+            adam_update_bf16((bfloat16 *)param_data + block_start, master_data + block_start, m, v, (const bfloat16 *)grad_data + block_start, size, args);
+#endif
+        }
+        quantized_state_store_block_f32(first_moment, block_start, size, m);
+        quantized_state_store_block_f32(second_moment, block_start, size, v);
+    }
+}
+
+static void adam_update_f64(double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct adam_step_args *const args)
+{
+    const double beta1 = args->beta1;
+    const double beta2 = args->beta2;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const double g = args->grad_scale * grad[i] + args->l2 * param[i];
+        const double m_i = beta1 * m[i] + (1 - beta1) * g;
+        const double v_i = beta2 * v[i] + (1 - beta2) * g * g;
+        m[i] = m_i;
+        v[i] = v_i;
+        param[i] = args->decay * param[i] - args->step_size * m_i / (sqrt(v_i) * args->inv_sqrt_correction2 + args->eps);
+    }
+}
+
+static void adam_update_f32(float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct adam_step_args *const args)
+{
+    const float grad_scale = args->grad_scale;
+    const float l2 = args->l2;
+    const float decay = args->decay;
+    const float beta1 = args->beta1;
+    const float beta2 = args->beta2;
+    const float eps = args->eps;
+    const float step_size = args->step_size;
+    const float inv_sqrt_correction2 = args->inv_sqrt_correction2;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const float g = grad_scale * grad[i] + l2 * param[i];
+        const float m_i = beta1 * m[i] + (1 - beta1) * g;
+        const float v_i = beta2 * v[i] + (1 - beta2) * g * g;
+        m[i] = m_i;
+        v[i] = v_i;
+        param[i] = decay * param[i] - step_size * m_i / (sqrtf(v_i) * inv_sqrt_correction2 + eps);
+    }
+}
+
+/**
+ * The update runs on the float32 master copy, which is then rounded into the parameter.
+ */
+static void adam_update_bf16(bfloat16 *restrict param, float *restrict master, float *restrict m, float *restrict v, const bfloat16 *restrict grad, const size_t size, const struct adam_step_args *const args)
+{
+    const float grad_scale = args->grad_scale;
+    const float l2 = args->l2;
+    const float decay = args->decay;
+    const float beta1 = args->beta1;
+    const float beta2 = args->beta2;
+    const float eps = args->eps;
+    const float step_size = args->step_size;
+    const float inv_sqrt_correction2 = args->inv_sqrt_correction2;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const float g = grad_scale * bfloat16_to_float(grad[i]) + l2 * master[i];
+        const float m_i = beta1 * m[i] + (1 - beta1) * g;
+        const float v_i = beta2 * v[i] + (1 - beta2) * g * g;
+        m[i] = m_i;
+        v[i] = v_i;
+        const float p = decay * master[i] - step_size * m_i / (sqrtf(v_i) * inv_sqrt_correction2 + eps);
+        master[i] = p;
+        param[i] = bfloat16_from_float(p);
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void adam_update_avx_256_f64(double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct adam_step_args *const args)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    const __m256d grad_scale_vals = _mm256_set1_pd(args->grad_scale);
+    const __m256d l2_vals = _mm256_set1_pd(args->l2);
+    const __m256d decay_vals = _mm256_set1_pd(args->decay);
+    const __m256d beta1_vals = _mm256_set1_pd(args->beta1);
+    const __m256d beta2_vals = _mm256_set1_pd(args->beta2);
+    const __m256d one_minus_beta1_vals = _mm256_set1_pd(1 - args->beta1);
+    const __m256d one_minus_beta2_vals = _mm256_set1_pd(1 - args->beta2);
+    const __m256d eps_vals = _mm256_set1_pd(args->eps);
+    const __m256d step_size_vals = _mm256_set1_pd(args->step_size);
+    const __m256d inv_sqrt_correction2_vals = _mm256_set1_pd(args->inv_sqrt_correction2);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d param_vals = _mm256_loadu_pd(&param[i]);
+        const __m256d g_vals = _mm256_add_pd(_mm256_mul_pd(grad_scale_vals, _mm256_loadu_pd(&grad[i])), _mm256_mul_pd(l2_vals, param_vals));
+        const __m256d m_vals = _mm256_add_pd(_mm256_mul_pd(beta1_vals, _mm256_loadu_pd(&m[i])), _mm256_mul_pd(one_minus_beta1_vals, g_vals));
+        const __m256d v_vals = _mm256_add_pd(_mm256_mul_pd(beta2_vals, _mm256_loadu_pd(&v[i])), _mm256_mul_pd(one_minus_beta2_vals, _mm256_mul_pd(g_vals, g_vals)));
+        _mm256_storeu_pd(&m[i], m_vals);
+        _mm256_storeu_pd(&v[i], v_vals);
+
+        const __m256d denom_vals = _mm256_add_pd(_mm256_mul_pd(_mm256_sqrt_pd(v_vals), inv_sqrt_correction2_vals), eps_vals);
+        const __m256d update_vals = _mm256_div_pd(_mm256_mul_pd(step_size_vals, m_vals), denom_vals);
+        _mm256_storeu_pd(&param[i], _mm256_sub_pd(_mm256_mul_pd(decay_vals, param_vals), update_vals));
+    }
+
+    // Handle remaining items
+    adam_update_f64(&param[i], &m[i], &v[i], &grad[i], size - i, args);
+}
+
+static void adam_update_avx_256_f32(float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct adam_step_args *const args)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 grad_scale_vals = _mm256_set1_ps(args->grad_scale);
+    const __m256 l2_vals = _mm256_set1_ps(args->l2);
+    const __m256 decay_vals = _mm256_set1_ps(args->decay);
+    const __m256 beta1_vals = _mm256_set1_ps(args->beta1);
+    const __m256 beta2_vals = _mm256_set1_ps(args->beta2);
+    const __m256 one_minus_beta1_vals = _mm256_set1_ps(1 - (float)args->beta1);
+    const __m256 one_minus_beta2_vals = _mm256_set1_ps(1 - (float)args->beta2);
+    const __m256 eps_vals = _mm256_set1_ps(args->eps);
+    const __m256 step_size_vals = _mm256_set1_ps(args->step_size);
+    const __m256 inv_sqrt_correction2_vals = _mm256_set1_ps(args->inv_sqrt_correction2);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 param_vals = _mm256_loadu_ps(&param[i]);
+        const __m256 g_vals = _mm256_add_ps(_mm256_mul_ps(grad_scale_vals, _mm256_loadu_ps(&grad[i])), _mm256_mul_ps(l2_vals, param_vals));
+        const __m256 m_vals = _mm256_add_ps(_mm256_mul_ps(beta1_vals, _mm256_loadu_ps(&m[i])), _mm256_mul_ps(one_minus_beta1_vals, g_vals));
+        const __m256 v_vals = _mm256_add_ps(_mm256_mul_ps(beta2_vals, _mm256_loadu_ps(&v[i])), _mm256_mul_ps(one_minus_beta2_vals, _mm256_mul_ps(g_vals, g_vals)));
+        _mm256_storeu_ps(&m[i], m_vals);
+        _mm256_storeu_ps(&v[i], v_vals);
+
+        const __m256 denom_vals = _mm256_add_ps(_mm256_mul_ps(_mm256_sqrt_ps(v_vals), inv_sqrt_correction2_vals), eps_vals);
+        const __m256 update_vals = _mm256_div_ps(_mm256_mul_ps(step_size_vals, m_vals), denom_vals);
+        _mm256_storeu_ps(&param[i], _mm256_sub_ps(_mm256_mul_ps(decay_vals, param_vals), update_vals));
+    }
+
+    // Handle remaining items
+    adam_update_f32(&param[i], &m[i], &v[i], &grad[i], size - i, args);
+}
+
+static void adam_update_avx_256_bf16(bfloat16 *restrict param, float *restrict master, float *restrict m, float *restrict v, const bfloat16 *restrict grad, const size_t size, const struct adam_step_args *const args)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 grad_scale_vals = _mm256_set1_ps(args->grad_scale);
+    const __m256 l2_vals = _mm256_set1_ps(args->l2);
+    const __m256 decay_vals = _mm256_set1_ps(args->decay);
+    const __m256 beta1_vals = _mm256_set1_ps(args->beta1);
+    const __m256 beta2_vals = _mm256_set1_ps(args->beta2);
+    const __m256 one_minus_beta1_vals = _mm256_set1_ps(1 - (float)args->beta1);
+    const __m256 one_minus_beta2_vals = _mm256_set1_ps(1 - (float)args->beta2);
+    const __m256 eps_vals = _mm256_set1_ps(args->eps);
+    const __m256 step_size_vals = _mm256_set1_ps(args->step_size);
+    const __m256 inv_sqrt_correction2_vals = _mm256_set1_ps(args->inv_sqrt_correction2);
+    const __m256i abs_mask = _mm256_set1_epi32(0x7fffffff);
+    const __m256i inf_bits = _mm256_set1_epi32(0x7f800000);
+    const __m256i rounding_bias = _mm256_set1_epi32(0x7fff);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i quiet_bit = _mm256_set1_epi32(0x0040);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        // bfloat16 are the upper halves of float32
+        const __m256i grad_bits = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&grad[i]));
+        const __m256 grad_vals = _mm256_castsi256_ps(_mm256_slli_epi32(grad_bits, 16));
+
+        const __m256 master_vals = _mm256_loadu_ps(&master[i]);
+        const __m256 g_vals = _mm256_add_ps(_mm256_mul_ps(grad_scale_vals, grad_vals), _mm256_mul_ps(l2_vals, master_vals));
+        const __m256 m_vals = _mm256_add_ps(_mm256_mul_ps(beta1_vals, _mm256_loadu_ps(&m[i])), _mm256_mul_ps(one_minus_beta1_vals, g_vals));
+        const __m256 v_vals = _mm256_add_ps(_mm256_mul_ps(beta2_vals, _mm256_loadu_ps(&v[i])), _mm256_mul_ps(one_minus_beta2_vals, _mm256_mul_ps(g_vals, g_vals)));
+        _mm256_storeu_ps(&m[i], m_vals);
+        _mm256_storeu_ps(&v[i], v_vals);
+
+        const __m256 denom_vals = _mm256_add_ps(_mm256_mul_ps(_mm256_sqrt_ps(v_vals), inv_sqrt_correction2_vals), eps_vals);
+        const __m256 update_vals = _mm256_div_ps(_mm256_mul_ps(step_size_vals, m_vals), denom_vals);
+        const __m256 p_vals = _mm256_sub_ps(_mm256_mul_ps(decay_vals, master_vals), update_vals);
+        _mm256_storeu_ps(&master[i], p_vals);
+
+        // Round to nearest even as bfloat16_from_float does, keeping NaNs quiet
+        const __m256i p_bits = _mm256_castps_si256(p_vals);
+        const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(p_bits, 16), one);
+        const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(p_bits, _mm256_add_epi32(rounding_bias, lsb)), 16);
+        const __m256i nan_mask = _mm256_cmpgt_epi32(_mm256_and_si256(p_bits, abs_mask), inf_bits);
+        const __m256i quiet = _mm256_or_si256(_mm256_srli_epi32(p_bits, 16), quiet_bit);
+        const __m256i halves = _mm256_blendv_epi8(rounded, quiet, nan_mask);
+
+        // Pack the low halves of the 32-bit lanes, then gather both 128-bit lanes
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(halves, halves), 0x08);
+        _mm_storeu_si128((__m128i *)&param[i], _mm256_castsi256_si128(packed));
+    }
+
+    // Handle remaining items
+    adam_update_bf16(&param[i], &master[i], &m[i], &v[i], &grad[i], size - i, args);
+}
+#endif
+
+static cgrad_error add_moments(struct adam_optimizer *const opt, const struct tensor *const param, struct tensor *const first_moment, struct tensor *const second_moment, struct tensor *const master_param)
+{
+    size_t const size = opt->size;
+    if (size >= MODEL_MAX_PARAMS)
+    {
+        return MODEL_MAX_PARAMS_EXCEEDED;
+    }
+
+    opt->first_moments[size] = first_moment;
+    opt->second_moments[size] = second_moment;
+    opt->master_params[size] = master_param;
+    opt->size++;
+
+    if (opt->is_quantized)
+    {
+        cgrad_error err = quantized_state_init(&opt->quantized_first_moments[size], param->data_size, true);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+        if ((err = quantized_state_init(&opt->quantized_second_moments[size], param->data_size, false)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
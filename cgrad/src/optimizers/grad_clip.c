@@ -0,0 +1,101 @@
+#include "cgrad/optimizers/grad_clip.h"
+#include "cgrad/optimizers/multi_tensor.h"
+#include "cgrad/tensor/tensor_norm.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Keeps the factor finite for tiny norms
+#define GRAD_CLIP_EPS 1e-6
+
+struct grad_norm_args
+{
+    const struct model_params *params;
+    struct multi_tensor_slots slots;
+    double *partial_sums;
+};
+
+static void grad_norm_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+
+cgrad_error model_params_grad_norm(const struct model_params *const params, double *const norm)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!norm)
+    {
+        return OUTPUT_NULL;
+    }
+
+    struct grad_norm_args args;
+    args.params = params;
+
+    multi_tensor_slots_init(&args.slots, params);
+    const size_t n_slots = args.slots.size;
+
+    args.partial_sums = calloc(n_slots > 0 ? n_slots : 1, sizeof(double));
+    if (!args.partial_sums)
+    {
+        return OPTIMIZER_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = multi_tensor_apply(params, &grad_norm_chunk, &args);
+    if (err != NO_ERROR)
+    {
+        free(args.partial_sums);
+        return err;
+    }
+
+    double squared_norm = 0;
+    for (size_t i = 0; i < n_slots; i++)
+    {
+        squared_norm += args.partial_sums[i];
+    }
+    free(args.partial_sums);
+
+    *norm = sqrt(squared_norm);
+    return NO_ERROR;
+}
+
+cgrad_error grad_clip_global_norm(const struct model_params *const params, const double max_norm, double *const scale, double *const norm)
+{
+    if (!scale)
+    {
+        return OUTPUT_NULL;
+    }
+
+    double grad_norm;
+    cgrad_error err = model_params_grad_norm(params, &grad_norm);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    *scale = grad_norm > max_norm ? max_norm / (grad_norm + GRAD_CLIP_EPS) : 1;
+    if (norm)
+    {
+        *norm = grad_norm;
+    }
+
+    return NO_ERROR;
+}
+
+static void grad_norm_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    struct grad_norm_args *norm_args = (struct grad_norm_args *)args;
+    const struct model_params *params = norm_args->params;
+
+    double *partial_sum = &norm_args->partial_sums[multi_tensor_slot(&norm_args->slots, param_index, start)];
+
+    // Padding of the flat gradients is zero, so that flat sweeps need no special care
+    if (param_index == MULTI_TENSOR_FLAT)
+    {
+        const char *grad_data = (const char *)params->flat_grad + start * dtype_sizeof(params->flat_dtype);
+        tensor_data_squared_norm(grad_data, end - start, params->flat_dtype, partial_sum);
+        return;
+    }
+
+    const struct tensor *grad = params->params[param_index]->grad;
+    const char *grad_data = (const char *)grad->data + start * dtype_sizeof(grad->dtype);
+    tensor_data_squared_norm(grad_data, end - start, grad->dtype, partial_sum);
+}
@@ -0,0 +1,553 @@
+#include "cgrad/optimizers/lamb.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdlib.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+// Squared norms of the weights and of the updates
+#define LAMB_SLOT_WIDTH 2
+
+/**
+ * Coefficients of a step, shared by every kernel:
+ *   g <- grad_scale * grad
+ *   m <- beta1 * m + (1 - beta1) * g
+ *   v <- beta2 * v + (1 - beta2) * g^2
+ *   r <- m * inv_correction1 / (sqrt(v) * inv_sqrt_correction2 + eps) + weight_decay * w
+ */
+struct lamb_step_args
+{
+    struct lamb_optimizer *opt;
+    double lr;
+    double grad_scale;
+    double beta1;
+    double beta2;
+    double eps;
+    double weight_decay;
+    double inv_correction1;
+    double inv_sqrt_correction2;
+};
+
+static cgrad_error add_moments(struct lamb_optimizer *const opt, struct tensor *const first_moment, struct tensor *const second_moment);
+static cgrad_error lamb_reserve_partial_sums(struct lamb_optimizer *const opt);
+static void lamb_chunk_data(const struct lamb_optimizer *const opt, const size_t param_index, cgrad_dtype *const dtype, void **const param_data, const void **const grad_data, void **const m_data, void **const v_data);
+static void lamb_moments_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+static void lamb_update_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+static void lamb_moments_f64(const double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out);
+static void lamb_moments_f32(const float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out);
+static void lamb_update_f64(double *restrict param, const double *restrict m, const double *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust);
+static void lamb_update_f32(float *restrict param, const float *restrict m, const float *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void lamb_moments_avx_256_f64(const double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out);
+static void lamb_moments_avx_256_f32(const float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out);
+static void lamb_update_avx_256_f64(double *restrict param, const double *restrict m, const double *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust);
+static void lamb_update_avx_256_f32(float *restrict param, const float *restrict m, const float *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust);
+static inline double lamb_reduce_avx_256(const __m256d acc);
+static inline __m256d lamb_accumulate_avx_256_ps(const __m256 vals, __m256d acc);
+#endif
+
+cgrad_error lamb_optimizer_init(struct lamb_optimizer *opt, struct model_params *const params, const double beta1, const double beta2, const double eps, struct tensor_allocator *allocator)
+{
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!allocator)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+
+    opt->params = params;
+    opt->allocator = allocator;
+    opt->size = 0;
+    opt->beta1 = beta1;
+    opt->beta2 = beta2;
+    opt->eps = eps;
+    opt->weight_decay = 0;
+    opt->grad_scale = 1;
+    opt->step_count = 0;
+    opt->flat_first_moment = NULL;
+    opt->flat_second_moment = NULL;
+    opt->partial_sums = NULL;
+    opt->partial_sums_capacity = 0;
+
+    cgrad_error err = lamb_reserve_partial_sums(opt);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Flat parameters get flat moments
+    if (model_params_is_flat(params))
+    {
+        opt->flat_first_moment = model_params_alloc_flat_buffer(params, params->flat_dtype);
+        opt->flat_second_moment = model_params_alloc_flat_buffer(params, params->flat_dtype);
+        if (!opt->flat_first_moment || !opt->flat_second_moment)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+        for (size_t i = 0; i < params->size; i++)
+        {
+            if ((err = add_moments(opt, NULL, NULL)) != NO_ERROR)
+            {
+                return err;
+            }
+        }
+        return NO_ERROR;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *param = params->params[i];
+        struct tensor *first_moment = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, param->dtype);
+        struct tensor *second_moment = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, param->dtype);
+        if (!first_moment || !second_moment)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+
+        if ((err = add_moments(opt, first_moment, second_moment)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error lamb_optimizer_step(struct lamb_optimizer *opt, double lr)
+{
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+
+    const struct model_params *params = opt->params;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        if (param->dtype != DTYPE_FLOAT64 && param->dtype != DTYPE_FLOAT32)
+        {
+            return OPERATION_INVALID_TENSOR_DTYPE;
+        }
+        if (param->grad && param->grad->dtype != param->dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+    }
+
+    cgrad_error err = lamb_reserve_partial_sums(opt);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    opt->step_count++;
+    struct lamb_step_args args;
+    args.opt = opt;
+    args.lr = lr;
+    args.grad_scale = opt->grad_scale;
+    args.beta1 = opt->beta1;
+    args.beta2 = opt->beta2;
+    args.eps = opt->eps;
+    args.weight_decay = opt->weight_decay;
+    args.inv_correction1 = 1 / (1 - pow(opt->beta1, (double)opt->step_count));
+    args.inv_sqrt_correction2 = 1 / sqrt(1 - pow(opt->beta2, (double)opt->step_count));
+
+    if ((err = multi_tensor_apply_per_param(params, &lamb_moments_chunk, &args)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    double norms[MODEL_MAX_PARAMS * LAMB_SLOT_WIDTH];
+    multi_tensor_slots_sum_per_param(&opt->slots, params, opt->partial_sums, LAMB_SLOT_WIDTH, norms);
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const double param_norm = sqrt(norms[i * LAMB_SLOT_WIDTH]);
+        const double update_norm = sqrt(norms[i * LAMB_SLOT_WIDTH + 1]);
+        opt->trust_ratios[i] = param_norm > 0 && update_norm > 0 ? param_norm / update_norm : 1;
+    }
+
+    // Frozen parameters are left untouched by the sweeps
+    return multi_tensor_apply_per_param(params, &lamb_update_chunk, &args);
+}
+
+void lamb_optimizer_cleanup(struct lamb_optimizer *opt)
+{
+    if (!opt)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < opt->size; i++)
+    {
+        if (opt->first_moments[i])
+        {
+            tensor_allocator_free(opt->allocator, opt->first_moments[i]);
+        }
+        if (opt->second_moments[i])
+        {
+            tensor_allocator_free(opt->allocator, opt->second_moments[i]);
+        }
+    }
+    free(opt->flat_first_moment);
+    free(opt->flat_second_moment);
+    free(opt->partial_sums);
+    opt->flat_first_moment = NULL;
+    opt->flat_second_moment = NULL;
+    opt->partial_sums = NULL;
+    opt->partial_sums_capacity = 0;
+}
+
+/**
+ * Slots follow the trainable parameters, which only grow if parameters are unfrozen after init.
+ */
+static cgrad_error lamb_reserve_partial_sums(struct lamb_optimizer *const opt)
+{
+    multi_tensor_slots_init(&opt->slots, opt->params);
+    const size_t capacity = (opt->slots.size > 0 ? opt->slots.size : 1) * LAMB_SLOT_WIDTH;
+    if (capacity <= opt->partial_sums_capacity)
+    {
+        return NO_ERROR;
+    }
+
+    double *partial_sums = realloc(opt->partial_sums, capacity * sizeof(double));
+    if (!partial_sums)
+    {
+        return OPTIMIZER_ALLOCATION_FAILED;
+    }
+    opt->partial_sums = partial_sums;
+    opt->partial_sums_capacity = capacity;
+
+    return NO_ERROR;
+}
+
+static void lamb_chunk_data(const struct lamb_optimizer *const opt, const size_t param_index, cgrad_dtype *const dtype, void **const param_data, const void **const grad_data, void **const m_data, void **const v_data)
+{
+    const struct model_params *params = opt->params;
+    struct tensor *param = params->params[param_index];
+
+    *dtype = param->dtype;
+    *param_data = param->data;
+    *grad_data = param->grad->data;
+    if (opt->flat_first_moment)
+    {
+        const size_t offset = params->flat_offsets[param_index] * dtype_sizeof(param->dtype);
+        *m_data = (char *)opt->flat_first_moment + offset;
+        *v_data = (char *)opt->flat_second_moment + offset;
+    }
+    else
+    {
+        *m_data = opt->first_moments[param_index]->data;
+        *v_data = opt->second_moments[param_index]->data;
+    }
+}
+
+static void lamb_moments_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    const struct lamb_step_args *step_args = (const struct lamb_step_args *)args;
+    struct lamb_optimizer *opt = step_args->opt;
+    double *out = &opt->partial_sums[multi_tensor_slot(&opt->slots, param_index, start) * LAMB_SLOT_WIDTH];
+    const size_t size = end - start;
+
+    cgrad_dtype dtype;
+    void *param_data;
+    const void *grad_data;
+    void *m_data;
+    void *v_data;
+    lamb_chunk_data(opt, param_index, &dtype, &param_data, &grad_data, &m_data, &v_data);
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lamb_moments_avx_256_f64((const double *)param_data + start, (double *)m_data + start, (double *)v_data + start, (const double *)grad_data + start, size, step_args, out);
+#else
+        lamb_moments_f64((const double *)param_data + start, (double *)m_data + start, (double *)v_data + start, (const double *)grad_data + start, size, step_args, out);
+#endif
+        break;
+    case DTYPE_FLOAT32:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lamb_moments_avx_256_f32((const float *)param_data + start, (float *)m_data + start, (float *)v_data + start, (const float *)grad_data + start, size, step_args, out);
+#else
+        lamb_moments_f32((const float *)param_data + start, (float *)m_data + start, (float *)v_data + start, (const float *)grad_data + start, size, step_args, out);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+static void lamb_update_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    const struct lamb_step_args *step_args = (const struct lamb_step_args *)args;
+    const struct lamb_optimizer *opt = step_args->opt;
+    const double trust = opt->trust_ratios[param_index];
+    const size_t size = end - start;
+
+    cgrad_dtype dtype;
+    void *param_data;
+    const void *grad_data;
+    void *m_data;
+    void *v_data;
+    lamb_chunk_data(opt, param_index, &dtype, &param_data, &grad_data, &m_data, &v_data);
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lamb_update_avx_256_f64((double *)param_data + start, (const double *)m_data + start, (const double *)v_data + start, size, step_args, trust);
+#else
+        lamb_update_f64((double *)param_data + start, (const double *)m_data + start, (const double *)v_data + start, size, step_args, trust);
+#endif
+        break;
+    case DTYPE_FLOAT32:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lamb_update_avx_256_f32((float *)param_data + start, (const float *)m_data + start, (const float *)v_data + start, size, step_args, trust);
+#else
+        lamb_update_f32((float *)param_data + start, (const float *)m_data + start, (const float *)v_data + start, size, step_args, trust);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+static void lamb_moments_f64(const double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out)
+{
+    double param_sum = 0;
+    double update_sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        const double g = args->grad_scale * grad[i];
+        const double m_i = args->beta1 * m[i] + (1 - args->beta1) * g;
+        const double v_i = args->beta2 * v[i] + (1 - args->beta2) * g * g;
+        m[i] = m_i;
+        v[i] = v_i;
+
+        const double r = m_i * args->inv_correction1 / (sqrt(v_i) * args->inv_sqrt_correction2 + args->eps) + args->weight_decay * param[i];
+        param_sum += param[i] * param[i];
+        update_sum += r * r;
+    }
+
+    out[0] = param_sum;
+    out[1] = update_sum;
+}
+
+static void lamb_moments_f32(const float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out)
+{
+    const float grad_scale = args->grad_scale;
+    const float beta1 = args->beta1;
+    const float beta2 = args->beta2;
+    const float eps = args->eps;
+    const float decay = args->weight_decay;
+    const float inv_correction1 = args->inv_correction1;
+    const float inv_sqrt_correction2 = args->inv_sqrt_correction2;
+
+    double param_sum = 0;
+    double update_sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        const float g = grad_scale * grad[i];
+        const float m_i = beta1 * m[i] + (1 - beta1) * g;
+        const float v_i = beta2 * v[i] + (1 - beta2) * g * g;
+        m[i] = m_i;
+        v[i] = v_i;
+
+        const double p = param[i];
+        const double r = m_i * inv_correction1 / (sqrtf(v_i) * inv_sqrt_correction2 + eps) + decay * param[i];
+        param_sum += p * p;
+        update_sum += r * r;
+    }
+
+    out[0] = param_sum;
+    out[1] = update_sum;
+}
+
+static void lamb_update_f64(double *restrict param, const double *restrict m, const double *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust)
+{
+    const double step_size = args->lr * trust;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const double r = m[i] * args->inv_correction1 / (sqrt(v[i]) * args->inv_sqrt_correction2 + args->eps) + args->weight_decay * param[i];
+        param[i] -= step_size * r;
+    }
+}
+
+static void lamb_update_f32(float *restrict param, const float *restrict m, const float *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust)
+{
+    const float step_size = args->lr * trust;
+    const float eps = args->eps;
+    const float decay = args->weight_decay;
+    const float inv_correction1 = args->inv_correction1;
+    const float inv_sqrt_correction2 = args->inv_sqrt_correction2;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const float r = m[i] * inv_correction1 / (sqrtf(v[i]) * inv_sqrt_correction2 + eps) + decay * param[i];
+        param[i] -= step_size * r;
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void lamb_moments_avx_256_f64(const double *restrict param, double *restrict m, double *restrict v, const double *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    const __m256d grad_scale_vals = _mm256_set1_pd(args->grad_scale);
+    const __m256d beta1_vals = _mm256_set1_pd(args->beta1);
+    const __m256d beta2_vals = _mm256_set1_pd(args->beta2);
+    const __m256d one_minus_beta1_vals = _mm256_set1_pd(1 - args->beta1);
+    const __m256d one_minus_beta2_vals = _mm256_set1_pd(1 - args->beta2);
+    const __m256d eps_vals = _mm256_set1_pd(args->eps);
+    const __m256d decay_vals = _mm256_set1_pd(args->weight_decay);
+    const __m256d inv_correction1_vals = _mm256_set1_pd(args->inv_correction1);
+    const __m256d inv_sqrt_correction2_vals = _mm256_set1_pd(args->inv_sqrt_correction2);
+
+    __m256d param_acc = _mm256_setzero_pd();
+    __m256d update_acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d param_vals = _mm256_loadu_pd(&param[i]);
+        const __m256d g_vals = _mm256_mul_pd(grad_scale_vals, _mm256_loadu_pd(&grad[i]));
+        const __m256d m_vals = _mm256_add_pd(_mm256_mul_pd(beta1_vals, _mm256_loadu_pd(&m[i])), _mm256_mul_pd(one_minus_beta1_vals, g_vals));
+        const __m256d v_vals = _mm256_add_pd(_mm256_mul_pd(beta2_vals, _mm256_loadu_pd(&v[i])), _mm256_mul_pd(one_minus_beta2_vals, _mm256_mul_pd(g_vals, g_vals)));
+        _mm256_storeu_pd(&m[i], m_vals);
+        _mm256_storeu_pd(&v[i], v_vals);
+
+        const __m256d denom_vals = _mm256_add_pd(_mm256_mul_pd(_mm256_sqrt_pd(v_vals), inv_sqrt_correction2_vals), eps_vals);
+        const __m256d r_vals = _mm256_add_pd(_mm256_div_pd(_mm256_mul_pd(m_vals, inv_correction1_vals), denom_vals), _mm256_mul_pd(decay_vals, param_vals));
+        param_acc = _mm256_add_pd(param_acc, _mm256_mul_pd(param_vals, param_vals));
+        update_acc = _mm256_add_pd(update_acc, _mm256_mul_pd(r_vals, r_vals));
+    }
+
+    // Handle remaining items
+    lamb_moments_f64(&param[i], &m[i], &v[i], &grad[i], size - i, args, out);
+    out[0] += lamb_reduce_avx_256(param_acc);
+    out[1] += lamb_reduce_avx_256(update_acc);
+}
+
+static void lamb_moments_avx_256_f32(const float *restrict param, float *restrict m, float *restrict v, const float *restrict grad, const size_t size, const struct lamb_step_args *const args, double *const out)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 grad_scale_vals = _mm256_set1_ps(args->grad_scale);
+    const __m256 beta1_vals = _mm256_set1_ps(args->beta1);
+    const __m256 beta2_vals = _mm256_set1_ps(args->beta2);
+    const __m256 one_minus_beta1_vals = _mm256_set1_ps(1 - (float)args->beta1);
+    const __m256 one_minus_beta2_vals = _mm256_set1_ps(1 - (float)args->beta2);
+    const __m256 eps_vals = _mm256_set1_ps(args->eps);
+    const __m256 decay_vals = _mm256_set1_ps(args->weight_decay);
+    const __m256 inv_correction1_vals = _mm256_set1_ps(args->inv_correction1);
+    const __m256 inv_sqrt_correction2_vals = _mm256_set1_ps(args->inv_sqrt_correction2);
+
+    // Squares are accumulated in double
+    __m256d param_acc = _mm256_setzero_pd();
+    __m256d update_acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 param_vals = _mm256_loadu_ps(&param[i]);
+        const __m256 g_vals = _mm256_mul_ps(grad_scale_vals, _mm256_loadu_ps(&grad[i]));
+        const __m256 m_vals = _mm256_add_ps(_mm256_mul_ps(beta1_vals, _mm256_loadu_ps(&m[i])), _mm256_mul_ps(one_minus_beta1_vals, g_vals));
+        const __m256 v_vals = _mm256_add_ps(_mm256_mul_ps(beta2_vals, _mm256_loadu_ps(&v[i])), _mm256_mul_ps(one_minus_beta2_vals, _mm256_mul_ps(g_vals, g_vals)));
+        _mm256_storeu_ps(&m[i], m_vals);
+        _mm256_storeu_ps(&v[i], v_vals);
+
+        const __m256 denom_vals = _mm256_add_ps(_mm256_mul_ps(_mm256_sqrt_ps(v_vals), inv_sqrt_correction2_vals), eps_vals);
+        const __m256 r_vals = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(m_vals, inv_correction1_vals), denom_vals), _mm256_mul_ps(decay_vals, param_vals));
+        param_acc = lamb_accumulate_avx_256_ps(param_vals, param_acc);
+        update_acc = lamb_accumulate_avx_256_ps(r_vals, update_acc);
+    }
+
+    // Handle remaining items
+    lamb_moments_f32(&param[i], &m[i], &v[i], &grad[i], size - i, args, out);
+    out[0] += lamb_reduce_avx_256(param_acc);
+    out[1] += lamb_reduce_avx_256(update_acc);
+}
+
+static void lamb_update_avx_256_f64(double *restrict param, const double *restrict m, const double *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    const __m256d step_size_vals = _mm256_set1_pd(args->lr * trust);
+    const __m256d eps_vals = _mm256_set1_pd(args->eps);
+    const __m256d decay_vals = _mm256_set1_pd(args->weight_decay);
+    const __m256d inv_correction1_vals = _mm256_set1_pd(args->inv_correction1);
+    const __m256d inv_sqrt_correction2_vals = _mm256_set1_pd(args->inv_sqrt_correction2);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d param_vals = _mm256_loadu_pd(&param[i]);
+        const __m256d denom_vals = _mm256_add_pd(_mm256_mul_pd(_mm256_sqrt_pd(_mm256_loadu_pd(&v[i])), inv_sqrt_correction2_vals), eps_vals);
+        const __m256d r_vals = _mm256_add_pd(_mm256_div_pd(_mm256_mul_pd(_mm256_loadu_pd(&m[i]), inv_correction1_vals), denom_vals), _mm256_mul_pd(decay_vals, param_vals));
+        _mm256_storeu_pd(&param[i], _mm256_sub_pd(param_vals, _mm256_mul_pd(step_size_vals, r_vals)));
+    }
+
+    // Handle remaining items
+    lamb_update_f64(&param[i], &m[i], &v[i], size - i, args, trust);
+}
+
+static void lamb_update_avx_256_f32(float *restrict param, const float *restrict m, const float *restrict v, const size_t size, const struct lamb_step_args *const args, const double trust)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 step_size_vals = _mm256_set1_ps(args->lr * trust);
+    const __m256 eps_vals = _mm256_set1_ps(args->eps);
+    const __m256 decay_vals = _mm256_set1_ps(args->weight_decay);
+    const __m256 inv_correction1_vals = _mm256_set1_ps(args->inv_correction1);
+    const __m256 inv_sqrt_correction2_vals = _mm256_set1_ps(args->inv_sqrt_correction2);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 param_vals = _mm256_loadu_ps(&param[i]);
+        const __m256 denom_vals = _mm256_add_ps(_mm256_mul_ps(_mm256_sqrt_ps(_mm256_loadu_ps(&v[i])), inv_sqrt_correction2_vals), eps_vals);
+        const __m256 r_vals = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_loadu_ps(&m[i]), inv_correction1_vals), denom_vals), _mm256_mul_ps(decay_vals, param_vals));
+        _mm256_storeu_ps(&param[i], _mm256_sub_ps(param_vals, _mm256_mul_ps(step_size_vals, r_vals)));
+    }
+
+    // Handle remaining items
+    lamb_update_f32(&param[i], &m[i], &v[i], size - i, args, trust);
+}
+
+static inline __m256d lamb_accumulate_avx_256_ps(const __m256 vals, __m256d acc)
+{
+    const __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(vals));
+    const __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(vals, 1));
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(low, low));
+    return _mm256_add_pd(acc, _mm256_mul_pd(high, high));
+}
+
+static inline double lamb_reduce_avx_256(const __m256d acc)
+{
+    const __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+#endif
+
+static cgrad_error add_moments(struct lamb_optimizer *const opt, struct tensor *const first_moment, struct tensor *const second_moment)
+{
+    size_t const size = opt->size;
+    if (size >= MODEL_MAX_PARAMS)
+    {
+        return MODEL_MAX_PARAMS_EXCEEDED;
+    }
+
+    opt->first_moments[size] = first_moment;
+    opt->second_moments[size] = second_moment;
+    opt->size++;
+
+    return NO_ERROR;
+}
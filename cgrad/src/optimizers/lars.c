@@ -0,0 +1,454 @@
+#include "cgrad/optimizers/lars.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdlib.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+// Squared norms of the weights and of the gradients
+#define LARS_SLOT_WIDTH 2
+
+struct lars_step_args
+{
+    struct lars_optimizer *opt;
+    double lr;
+    double momentum;
+};
+
+static cgrad_error add_momentum_buffer(struct lars_optimizer *const opt, struct tensor *const momentum_buffer);
+static cgrad_error lars_reserve_partial_sums(struct lars_optimizer *const opt);
+static void lars_chunk_data(const struct lars_optimizer *const opt, const size_t param_index, cgrad_dtype *const dtype, void **const param_data, const void **const grad_data, void **const buffer_data);
+static void lars_norms_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+static void lars_update_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+static void lars_norms_f64(const double *restrict param, const double *restrict grad, const size_t size, double *const out);
+static void lars_norms_f32(const float *restrict param, const float *restrict grad, const size_t size, double *const out);
+static void lars_update_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay);
+static void lars_update_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void lars_norms_avx_256_f64(const double *restrict param, const double *restrict grad, const size_t size, double *const out);
+static void lars_norms_avx_256_f32(const float *restrict param, const float *restrict grad, const size_t size, double *const out);
+static void lars_update_avx_256_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay);
+static void lars_update_avx_256_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay);
+static inline double lars_reduce_avx_256(const __m256d acc);
+#endif
+
+cgrad_error lars_optimizer_init(struct lars_optimizer *opt, struct model_params *const params, const double trust_coefficient, struct tensor_allocator *allocator)
+{
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!allocator)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+
+    opt->params = params;
+    opt->allocator = allocator;
+    opt->size = 0;
+    opt->trust_coefficient = trust_coefficient;
+    opt->weight_decay = 0;
+    opt->eps = 1e-8;
+    opt->grad_scale = 1;
+    opt->flat_momentum = NULL;
+    opt->partial_sums = NULL;
+    opt->partial_sums_capacity = 0;
+
+    cgrad_error err = lars_reserve_partial_sums(opt);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Flat parameters get a flat momentum
+    if (model_params_is_flat(params))
+    {
+        opt->flat_momentum = model_params_alloc_flat_buffer(params, params->flat_dtype);
+        if (!opt->flat_momentum)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+        for (size_t i = 0; i < params->size; i++)
+        {
+            if ((err = add_momentum_buffer(opt, NULL)) != NO_ERROR)
+            {
+                return err;
+            }
+        }
+        return NO_ERROR;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *param = params->params[i];
+        struct tensor *momentum_buffer = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, param->dtype);
+        if (!momentum_buffer)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+
+        if ((err = add_momentum_buffer(opt, momentum_buffer)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error lars_optimizer_step(struct lars_optimizer *opt, double lr, double momentum)
+{
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+
+    const struct model_params *params = opt->params;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        if (param->dtype != DTYPE_FLOAT64 && param->dtype != DTYPE_FLOAT32)
+        {
+            return OPERATION_INVALID_TENSOR_DTYPE;
+        }
+        if (param->grad && param->grad->dtype != param->dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+    }
+
+    cgrad_error err = lars_reserve_partial_sums(opt);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct lars_step_args args = {opt, lr, momentum};
+    if ((err = multi_tensor_apply_per_param(params, &lars_norms_chunk, &args)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    double norms[MODEL_MAX_PARAMS * LARS_SLOT_WIDTH];
+    multi_tensor_slots_sum_per_param(&opt->slots, params, opt->partial_sums, LARS_SLOT_WIDTH, norms);
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const double param_norm = sqrt(norms[i * LARS_SLOT_WIDTH]);
+        const double grad_norm = fabs(opt->grad_scale) * sqrt(norms[i * LARS_SLOT_WIDTH + 1]);
+        opt->trust_ratios[i] = param_norm > 0 && grad_norm > 0 ? opt->trust_coefficient * param_norm / (grad_norm + opt->weight_decay * param_norm + opt->eps) : 1;
+    }
+
+    // Frozen parameters are left untouched by the sweeps
+    return multi_tensor_apply_per_param(params, &lars_update_chunk, &args);
+}
+
+void lars_optimizer_cleanup(struct lars_optimizer *opt)
+{
+    if (!opt)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < opt->size; i++)
+    {
+        if (opt->momentum_buffers[i])
+        {
+            tensor_allocator_free(opt->allocator, opt->momentum_buffers[i]);
+        }
+    }
+    free(opt->flat_momentum);
+    free(opt->partial_sums);
+    opt->flat_momentum = NULL;
+    opt->partial_sums = NULL;
+    opt->partial_sums_capacity = 0;
+}
+
+/**
+ * Slots follow the trainable parameters, which only grow if parameters are unfrozen after init.
+ */
+static cgrad_error lars_reserve_partial_sums(struct lars_optimizer *const opt)
+{
+    multi_tensor_slots_init(&opt->slots, opt->params);
+    const size_t capacity = (opt->slots.size > 0 ? opt->slots.size : 1) * LARS_SLOT_WIDTH;
+    if (capacity <= opt->partial_sums_capacity)
+    {
+        return NO_ERROR;
+    }
+
+    double *partial_sums = realloc(opt->partial_sums, capacity * sizeof(double));
+    if (!partial_sums)
+    {
+        return OPTIMIZER_ALLOCATION_FAILED;
+    }
+    opt->partial_sums = partial_sums;
+    opt->partial_sums_capacity = capacity;
+
+    return NO_ERROR;
+}
+
+static void lars_chunk_data(const struct lars_optimizer *const opt, const size_t param_index, cgrad_dtype *const dtype, void **const param_data, const void **const grad_data, void **const buffer_data)
+{
+    const struct model_params *params = opt->params;
+    struct tensor *param = params->params[param_index];
+
+    *dtype = param->dtype;
+    *param_data = param->data;
+    *grad_data = param->grad->data;
+    *buffer_data = opt->flat_momentum ? (char *)opt->flat_momentum + params->flat_offsets[param_index] * dtype_sizeof(param->dtype) : opt->momentum_buffers[param_index]->data;
+}
+
+static void lars_norms_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    struct lars_optimizer *opt = ((const struct lars_step_args *)args)->opt;
+    double *out = &opt->partial_sums[multi_tensor_slot(&opt->slots, param_index, start) * LARS_SLOT_WIDTH];
+    const size_t size = end - start;
+
+    cgrad_dtype dtype;
+    void *param_data;
+    const void *grad_data;
+    void *buffer_data;
+    lars_chunk_data(opt, param_index, &dtype, &param_data, &grad_data, &buffer_data);
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lars_norms_avx_256_f64((const double *)param_data + start, (const double *)grad_data + start, size, out);
+#else
+        lars_norms_f64((const double *)param_data + start, (const double *)grad_data + start, size, out);
+#endif
+        break;
+    case DTYPE_FLOAT32:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lars_norms_avx_256_f32((const float *)param_data + start, (const float *)grad_data + start, size, out);
+#else
+        lars_norms_f32((const float *)param_data + start, (const float *)grad_data + start, size, out);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+static void lars_update_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    const struct lars_step_args *step_args = (const struct lars_step_args *)args;
+    const struct lars_optimizer *opt = step_args->opt;
+    const double trust = opt->trust_ratios[param_index];
+    const size_t size = end - start;
+
+    cgrad_dtype dtype;
+    void *param_data;
+    const void *grad_data;
+    void *buffer_data;
+    lars_chunk_data(opt, param_index, &dtype, &param_data, &grad_data, &buffer_data);
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+    {
+        double *param_chunk = (double *)param_data + start;
+        double *buffer_chunk = (double *)buffer_data + start;
+        const double *grad_chunk = (const double *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lars_update_avx_256_f64(param_chunk, buffer_chunk, grad_chunk, size, step_args->lr, step_args->momentum, trust, opt->grad_scale, opt->weight_decay);
+#else
+        lars_update_f64(param_chunk, buffer_chunk, grad_chunk, size, step_args->lr, step_args->momentum, trust, opt->grad_scale, opt->weight_decay);
+#endif
+        break;
+    }
+    case DTYPE_FLOAT32:
+    {
+        float *param_chunk = (float *)param_data + start;
+        float *buffer_chunk = (float *)buffer_data + start;
+        const float *grad_chunk = (const float *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        lars_update_avx_256_f32(param_chunk, buffer_chunk, grad_chunk, size, step_args->lr, step_args->momentum, trust, opt->grad_scale, opt->weight_decay);
+#else
+        lars_update_f32(param_chunk, buffer_chunk, grad_chunk, size, step_args->lr, step_args->momentum, trust, opt->grad_scale, opt->weight_decay);
+#endif
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void lars_norms_f64(const double *restrict param, const double *restrict grad, const size_t size, double *const out)
+{
+    double param_sum = 0;
+    double grad_sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        param_sum += param[i] * param[i];
+        grad_sum += grad[i] * grad[i];
+    }
+
+    out[0] = param_sum;
+    out[1] = grad_sum;
+}
+
+static void lars_norms_f32(const float *restrict param, const float *restrict grad, const size_t size, double *const out)
+{
+    double param_sum = 0;
+    double grad_sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        const double p = param[i];
+        const double g = grad[i];
+        param_sum += p * p;
+        grad_sum += g * g;
+    }
+
+    out[0] = param_sum;
+    out[1] = grad_sum;
+}
+
+static void lars_update_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        const double g = trust * (grad_scale * grad[i] + weight_decay * param[i]);
+        const double b = momentum * buffer[i] + g;
+        buffer[i] = b;
+        param[i] -= lr * b;
+    }
+}
+
+static void lars_update_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay)
+{
+    const float lr_f = lr;
+    const float momentum_f = momentum;
+    const float trust_f = trust;
+    const float grad_scale_f = grad_scale;
+    const float decay = weight_decay;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const float g = trust_f * (grad_scale_f * grad[i] + decay * param[i]);
+        const float b = momentum_f * buffer[i] + g;
+        buffer[i] = b;
+        param[i] -= lr_f * b;
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void lars_norms_avx_256_f64(const double *restrict param, const double *restrict grad, const size_t size, double *const out)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    __m256d param_acc = _mm256_setzero_pd();
+    __m256d grad_acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d param_vals = _mm256_loadu_pd(&param[i]);
+        const __m256d grad_vals = _mm256_loadu_pd(&grad[i]);
+        param_acc = _mm256_add_pd(param_acc, _mm256_mul_pd(param_vals, param_vals));
+        grad_acc = _mm256_add_pd(grad_acc, _mm256_mul_pd(grad_vals, grad_vals));
+    }
+
+    // Handle remaining items
+    lars_norms_f64(&param[i], &grad[i], size - i, out);
+    out[0] += lars_reduce_avx_256(param_acc);
+    out[1] += lars_reduce_avx_256(grad_acc);
+}
+
+static void lars_norms_avx_256_f32(const float *restrict param, const float *restrict grad, const size_t size, double *const out)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m128) / sizeof(float);
+
+    // Squares are accumulated in double, four elements at a time
+    __m256d param_acc = _mm256_setzero_pd();
+    __m256d grad_acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d param_vals = _mm256_cvtps_pd(_mm_loadu_ps(&param[i]));
+        const __m256d grad_vals = _mm256_cvtps_pd(_mm_loadu_ps(&grad[i]));
+        param_acc = _mm256_add_pd(param_acc, _mm256_mul_pd(param_vals, param_vals));
+        grad_acc = _mm256_add_pd(grad_acc, _mm256_mul_pd(grad_vals, grad_vals));
+    }
+
+    // Handle remaining items
+    lars_norms_f32(&param[i], &grad[i], size - i, out);
+    out[0] += lars_reduce_avx_256(param_acc);
+    out[1] += lars_reduce_avx_256(grad_acc);
+}
+
+static void lars_update_avx_256_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    const __m256d lr_vals = _mm256_set1_pd(lr);
+    const __m256d momentum_vals = _mm256_set1_pd(momentum);
+    const __m256d trust_vals = _mm256_set1_pd(trust);
+    const __m256d grad_scale_vals = _mm256_set1_pd(grad_scale);
+    const __m256d decay_vals = _mm256_set1_pd(weight_decay);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d param_vals = _mm256_loadu_pd(&param[i]);
+        const __m256d g_vals = _mm256_mul_pd(trust_vals, _mm256_add_pd(_mm256_mul_pd(grad_scale_vals, _mm256_loadu_pd(&grad[i])), _mm256_mul_pd(decay_vals, param_vals)));
+        const __m256d b_vals = _mm256_add_pd(_mm256_mul_pd(momentum_vals, _mm256_loadu_pd(&buffer[i])), g_vals);
+        _mm256_storeu_pd(&buffer[i], b_vals);
+        _mm256_storeu_pd(&param[i], _mm256_sub_pd(param_vals, _mm256_mul_pd(lr_vals, b_vals)));
+    }
+
+    // Handle remaining items
+    lars_update_f64(&param[i], &buffer[i], &grad[i], size - i, lr, momentum, trust, grad_scale, weight_decay);
+}
+
+static void lars_update_avx_256_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const double lr, const double momentum, const double trust, const double grad_scale, const double weight_decay)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 lr_vals = _mm256_set1_ps(lr);
+    const __m256 momentum_vals = _mm256_set1_ps(momentum);
+    const __m256 trust_vals = _mm256_set1_ps(trust);
+    const __m256 grad_scale_vals = _mm256_set1_ps(grad_scale);
+    const __m256 decay_vals = _mm256_set1_ps(weight_decay);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 param_vals = _mm256_loadu_ps(&param[i]);
+        const __m256 g_vals = _mm256_mul_ps(trust_vals, _mm256_add_ps(_mm256_mul_ps(grad_scale_vals, _mm256_loadu_ps(&grad[i])), _mm256_mul_ps(decay_vals, param_vals)));
+        const __m256 b_vals = _mm256_add_ps(_mm256_mul_ps(momentum_vals, _mm256_loadu_ps(&buffer[i])), g_vals);
+        _mm256_storeu_ps(&buffer[i], b_vals);
+        _mm256_storeu_ps(&param[i], _mm256_sub_ps(param_vals, _mm256_mul_ps(lr_vals, b_vals)));
+    }
+
+    // Handle remaining items
+    lars_update_f32(&param[i], &buffer[i], &grad[i], size - i, lr, momentum, trust, grad_scale, weight_decay);
+}
+
+static inline double lars_reduce_avx_256(const __m256d acc)
+{
+    const __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+#endif
+
+static cgrad_error add_momentum_buffer(struct lars_optimizer *const opt, struct tensor *const momentum_buffer)
+{
+    size_t const size = opt->size;
+    if (size >= MODEL_MAX_PARAMS)
+    {
+        return MODEL_MAX_PARAMS_EXCEEDED;
+    }
+
+    opt->momentum_buffers[size] = momentum_buffer;
+    opt->size++;
+
+    return NO_ERROR;
+}
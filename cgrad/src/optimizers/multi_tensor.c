@@ -0,0 +1,311 @@
+#include "cgrad/optimizers/multi_tensor.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+struct multi_tensor_worker
+{
+    const struct model_params *params;
+    multi_tensor_chunk_fn fn;
+    void *args;
+    size_t thread_index;
+    size_t n_threads;
+    bool is_flat;
+};
+
+/**
+ * Threads sweeping alongside the calling thread. They are started by the first parallel sweep and kept
+ * for the lifetime of the process, waiting for the next sweep, so that optimizer steps create no
+ * threads. A sweep holds the pool from start to finish, a concurrent sweep runs on its calling thread.
+ */
+struct multi_tensor_pool
+{
+    pthread_mutex_t sweep_mutex;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+    pthread_t threads[OPTIMIZER_MAX_THREADS];
+    struct multi_tensor_worker workers[OPTIMIZER_MAX_THREADS];
+    size_t generations[OPTIMIZER_MAX_THREADS]; /**< Last sweep seen by each thread. */
+    size_t n_started;                          /**< Threads of index 1 to n_started are running, 0 is the calling thread. */
+    size_t n_active;                           /**< Workers of the current sweep. */
+    size_t n_pending;                          /**< Threads of the current sweep still sweeping. */
+    size_t generation;
+};
+
+static struct multi_tensor_pool multi_tensor_pool = {
+    .sweep_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .start = PTHREAD_COND_INITIALIZER,
+    .finish = PTHREAD_COND_INITIALIZER,
+};
+static pthread_once_t multi_tensor_pool_once = PTHREAD_ONCE_INIT;
+
+static void multi_tensor_pool_register_fork_handler(void);
+static void multi_tensor_pool_reset_after_fork(void);
+static size_t multi_tensor_pool_grow(struct multi_tensor_pool *const pool, const size_t n_threads);
+static void *multi_tensor_pool_thread_run(void *arg);
+static void *multi_tensor_worker_run(void *arg);
+static inline bool multi_tensor_is_trainable(const struct tensor *const param);
+static void multi_tensor_sweep_range(const struct multi_tensor_worker *const worker, const size_t param_index, const size_t size, size_t *const chunk);
+static cgrad_error multi_tensor_sweep(const struct model_params *const params, const multi_tensor_chunk_fn fn, void *const args, const bool can_sweep_flat);
+
+cgrad_error multi_tensor_apply(const struct model_params *const params, const multi_tensor_chunk_fn fn, void *const args)
+{
+    return multi_tensor_sweep(params, fn, args, true);
+}
+
+cgrad_error multi_tensor_apply_per_param(const struct model_params *const params, const multi_tensor_chunk_fn fn, void *const args)
+{
+    return multi_tensor_sweep(params, fn, args, false);
+}
+
+static cgrad_error multi_tensor_sweep(const struct model_params *const params, const multi_tensor_chunk_fn fn, void *const args, const bool can_sweep_flat)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!fn)
+    {
+        return INPUT_NULL;
+    }
+
+    size_t total_size = 0;
+    size_t n_chunks = 0;
+    bool are_all_trainable = true;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        if (multi_tensor_is_trainable(param))
+        {
+            total_size += param->data_size;
+            n_chunks += (param->data_size + OPTIMIZER_CHUNK_SIZE - 1) / OPTIMIZER_CHUNK_SIZE;
+        }
+        else
+        {
+            are_all_trainable = false;
+        }
+    }
+
+    // Frozen parameters in the flat buffers must be skipped, one parameter at a time
+    const bool is_flat = can_sweep_flat && model_params_is_flat(params) && are_all_trainable;
+    if (is_flat)
+    {
+        total_size = params->flat_size;
+        n_chunks = (params->flat_size + OPTIMIZER_CHUNK_SIZE - 1) / OPTIMIZER_CHUNK_SIZE;
+    }
+
+    if (n_chunks == 0)
+    {
+        return NO_ERROR;
+    }
+
+    size_t n_threads = 1;
+    if (total_size >= OPTIMIZER_PARALLEL_MIN_SIZE)
+    {
+        const long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = n_cpus > 0 ? (size_t)n_cpus : 1;
+        n_threads = n_threads < OPTIMIZER_MAX_THREADS ? n_threads : OPTIMIZER_MAX_THREADS;
+        n_threads = n_threads < n_chunks ? n_threads : n_chunks;
+    }
+
+    // Below the threshold, or while another thread sweeps, the calling thread sweeps alone
+    struct multi_tensor_pool *pool = &multi_tensor_pool;
+    if (n_threads == 1 || pthread_mutex_trylock(&pool->sweep_mutex) != 0)
+    {
+        struct multi_tensor_worker worker = {params, fn, args, 0, 1, is_flat};
+        multi_tensor_worker_run(&worker);
+        return NO_ERROR;
+    }
+
+    // Threads that could not be started are left out, their share goes to the others
+    n_threads = multi_tensor_pool_grow(pool, n_threads);
+    for (size_t t = 0; t < n_threads; t++)
+    {
+        pool->workers[t] = (struct multi_tensor_worker){params, fn, args, t, n_threads, is_flat};
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->n_active = n_threads;
+    pool->n_pending = n_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->mutex);
+
+    // The calling thread takes the first share
+    multi_tensor_worker_run(&pool->workers[0]);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->n_pending > 0)
+    {
+        pthread_cond_wait(&pool->finish, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_unlock(&pool->sweep_mutex);
+    return NO_ERROR;
+}
+
+void multi_tensor_slots_init(struct multi_tensor_slots *const slots, const struct model_params *const params)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        slots->offsets[i] = size;
+        if (multi_tensor_is_trainable(param))
+        {
+            size += (param->data_size + OPTIMIZER_CHUNK_SIZE - 1) / OPTIMIZER_CHUNK_SIZE;
+        }
+    }
+
+    const size_t flat_size = (params->flat_size + OPTIMIZER_CHUNK_SIZE - 1) / OPTIMIZER_CHUNK_SIZE;
+    slots->size = size > flat_size ? size : flat_size;
+}
+
+void multi_tensor_slots_sum_per_param(const struct multi_tensor_slots *const slots, const struct model_params *const params, const double *const partial_sums, const size_t width, double *const out)
+{
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        for (size_t k = 0; k < width; k++)
+        {
+            out[i * width + k] = 0;
+        }
+        if (!multi_tensor_is_trainable(param))
+        {
+            continue;
+        }
+
+        const size_t n_chunks = (param->data_size + OPTIMIZER_CHUNK_SIZE - 1) / OPTIMIZER_CHUNK_SIZE;
+        for (size_t slot = slots->offsets[i]; slot < slots->offsets[i] + n_chunks; slot++)
+        {
+            for (size_t k = 0; k < width; k++)
+            {
+                out[i * width + k] += partial_sums[slot * width + k];
+            }
+        }
+    }
+}
+
+// Starts the missing threads of the pool, returns how many threads, the calling one included, may sweep
+static size_t multi_tensor_pool_grow(struct multi_tensor_pool *const pool, const size_t n_threads)
+{
+    pthread_once(&multi_tensor_pool_once, multi_tensor_pool_register_fork_handler);
+
+    while (pool->n_started + 1 < n_threads)
+    {
+        const size_t index = pool->n_started + 1;
+
+        // Set before the thread runs, so that it waits for the next sweep and not for the one after
+        pthread_mutex_lock(&pool->mutex);
+        pool->generations[index] = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (pthread_create(&pool->threads[index], NULL, multi_tensor_pool_thread_run, (void *)(uintptr_t)index) != 0)
+        {
+            break;
+        }
+        pthread_detach(pool->threads[index]);
+        pool->n_started++;
+    }
+
+    return pool->n_started + 1 < n_threads ? pool->n_started + 1 : n_threads;
+}
+
+static void *multi_tensor_pool_thread_run(void *arg)
+{
+    const size_t index = (size_t)(uintptr_t)arg;
+    struct multi_tensor_pool *pool = &multi_tensor_pool;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true)
+    {
+        // Spurious wake-ups leave the generation unchanged
+        while (pool->generations[index] == pool->generation)
+        {
+            pthread_cond_wait(&pool->start, &pool->mutex);
+        }
+        pool->generations[index] = pool->generation;
+
+        // Sweeps may use fewer threads than the pool has
+        const bool is_active = index < pool->n_active;
+        pthread_mutex_unlock(&pool->mutex);
+
+        if (is_active)
+        {
+            multi_tensor_worker_run(&pool->workers[index]);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        if (is_active && --pool->n_pending == 0)
+        {
+            pthread_cond_signal(&pool->finish);
+        }
+    }
+
+    return NULL;
+}
+
+static void multi_tensor_pool_register_fork_handler(void)
+{
+    pthread_atfork(NULL, NULL, multi_tensor_pool_reset_after_fork);
+}
+
+// Only the forking thread survives in the child, which starts its own threads on its first sweep
+static void multi_tensor_pool_reset_after_fork(void)
+{
+    struct multi_tensor_pool *pool = &multi_tensor_pool;
+    pthread_mutex_init(&pool->sweep_mutex, NULL);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finish, NULL);
+    pool->n_started = 0;
+    pool->n_active = 0;
+    pool->n_pending = 0;
+}
+
+static void *multi_tensor_worker_run(void *arg)
+{
+    const struct multi_tensor_worker *worker = (const struct multi_tensor_worker *)arg;
+    const struct model_params *params = worker->params;
+
+    size_t chunk = 0;
+    if (worker->is_flat)
+    {
+        multi_tensor_sweep_range(worker, MULTI_TENSOR_FLAT, params->flat_size, &chunk);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        if (multi_tensor_is_trainable(param))
+        {
+            multi_tensor_sweep_range(worker, i, param->data_size, &chunk);
+        }
+    }
+
+    return NULL;
+}
+
+static void multi_tensor_sweep_range(const struct multi_tensor_worker *const worker, const size_t param_index, const size_t size, size_t *const chunk)
+{
+    // Chunks are dealt round-robin, so that every thread gets a similar amount of elements
+    for (size_t start = 0; start < size; start += OPTIMIZER_CHUNK_SIZE, (*chunk)++)
+    {
+        if (*chunk % worker->n_threads != worker->thread_index)
+        {
+            continue;
+        }
+        const size_t end = start + OPTIMIZER_CHUNK_SIZE < size ? start + OPTIMIZER_CHUNK_SIZE : size;
+        worker->fn(worker->args, param_index, start, end);
+    }
+}
+
+static inline bool multi_tensor_is_trainable(const struct tensor *const param)
+{
+    return param->requires_grad && param->grad != NULL;
+}
@@ -0,0 +1,232 @@
+#include "cgrad/optimizers/quantized_state.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+#define QUANTIZED_STATE_SIGNED_LEVELS 127.0f
+#define QUANTIZED_STATE_UNSIGNED_LEVELS 255.0f
+
+static void quantized_state_decode_f32(const struct quantized_state *const state, const uint8_t *const codes, const float scale, const size_t size, float *const out);
+static void quantized_state_encode_f32(const struct quantized_state *const state, uint8_t *const codes, const float scale, const size_t size, const float *const in);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void quantized_state_decode_avx_256_f32(const struct quantized_state *const state, const uint8_t *const codes, const float scale, const size_t size, float *const out);
+static void quantized_state_encode_avx_256_f32(const struct quantized_state *const state, uint8_t *const codes, const float scale, const size_t size, const float *const in);
+#endif
+
+cgrad_error quantized_state_init(struct quantized_state *const state, const size_t size, const bool is_signed)
+{
+    if (!state)
+    {
+        return OPTIMIZER_NULL;
+    }
+
+    const size_t n_blocks = (size + OPTIMIZER_STATE_BLOCK_SIZE - 1) / OPTIMIZER_STATE_BLOCK_SIZE;
+    state->codes = calloc(size > 0 ? size : 1, sizeof(uint8_t));
+    state->scales = calloc(n_blocks > 0 ? n_blocks : 1, sizeof(float));
+    state->size = size;
+    state->is_signed = is_signed;
+    if (!state->codes || !state->scales)
+    {
+        quantized_state_cleanup(state);
+        return OPTIMIZER_STATE_ALLOCATION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+void quantized_state_cleanup(struct quantized_state *const state)
+{
+    if (!state)
+    {
+        return;
+    }
+
+    free(state->codes);
+    free(state->scales);
+    state->codes = NULL;
+    state->scales = NULL;
+    state->size = 0;
+}
+
+void quantized_state_load_block_f32(const struct quantized_state *const state, const size_t start, const size_t size, float *const out)
+{
+    const float scale = state->scales[start / OPTIMIZER_STATE_BLOCK_SIZE];
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    quantized_state_decode_avx_256_f32(state, &state->codes[start], scale, size, out);
+#else
+    quantized_state_decode_f32(state, &state->codes[start], scale, size, out);
+#endif
+}
+
+void quantized_state_load_block_f64(const struct quantized_state *const state, const size_t start, const size_t size, double *const out)
+{
+    float block[OPTIMIZER_STATE_BLOCK_SIZE];
+    quantized_state_load_block_f32(state, start, size, block);
+    for (size_t i = 0; i < size; i++)
+    {
+        out[i] = block[i];
+    }
+}
+
+void quantized_state_store_block_f32(struct quantized_state *const state, const size_t start, const size_t size, const float *const in)
+{
+    float scale = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        const float magnitude = fabsf(in[i]);
+        scale = magnitude > scale ? magnitude : scale;
+    }
+    state->scales[start / OPTIMIZER_STATE_BLOCK_SIZE] = scale;
+
+    if (scale == 0 || !isfinite(scale))
+    {
+        // Nothing to keep, or nothing sensible to keep
+        memset(&state->codes[start], 0, size);
+        return;
+    }
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    quantized_state_encode_avx_256_f32(state, &state->codes[start], scale, size, in);
+#else
+    quantized_state_encode_f32(state, &state->codes[start], scale, size, in);
+#endif
+}
+
+void quantized_state_store_block_f64(struct quantized_state *const state, const size_t start, const size_t size, const double *const in)
+{
+    float block[OPTIMIZER_STATE_BLOCK_SIZE];
+    for (size_t i = 0; i < size; i++)
+    {
+        block[i] = in[i];
+    }
+    quantized_state_store_block_f32(state, start, size, block);
+}
+
+static void quantized_state_decode_f32(const struct quantized_state *const state, const uint8_t *const codes, const float scale, const size_t size, float *const out)
+{
+    if (state->is_signed)
+    {
+        const int8_t *signed_codes = (const int8_t *)codes;
+        for (size_t i = 0; i < size; i++)
+        {
+            const float c = signed_codes[i] / QUANTIZED_STATE_SIGNED_LEVELS;
+            out[i] = scale * c * fabsf(c);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const float c = codes[i] / QUANTIZED_STATE_UNSIGNED_LEVELS;
+        const float c2 = c * c;
+        out[i] = scale * c2 * c2;
+    }
+}
+
+static void quantized_state_encode_f32(const struct quantized_state *const state, uint8_t *const codes, const float scale, const size_t size, const float *const in)
+{
+    const float inv_scale = 1.0f / scale;
+
+    if (state->is_signed)
+    {
+        int8_t *signed_codes = (int8_t *)codes;
+        for (size_t i = 0; i < size; i++)
+        {
+            const float c = sqrtf(fabsf(in[i]) * inv_scale) * QUANTIZED_STATE_SIGNED_LEVELS;
+            signed_codes[i] = (int8_t)lrintf(in[i] < 0 ? -c : c);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        // Negative values can only come from rounding errors
+        const float x = in[i] > 0 ? in[i] * inv_scale : 0;
+        codes[i] = (uint8_t)lrintf(sqrtf(sqrtf(x)) * QUANTIZED_STATE_UNSIGNED_LEVELS);
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void quantized_state_decode_avx_256_f32(const struct quantized_state *const state, const uint8_t *const codes, const float scale, const size_t size, float *const out)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 scale_vals = _mm256_set1_ps(scale);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    size_t i = 0;
+    if (state->is_signed)
+    {
+        const __m256 inv_levels = _mm256_set1_ps(1.0f / QUANTIZED_STATE_SIGNED_LEVELS);
+        for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+        {
+            const __m256i code_vals = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&codes[i]));
+            const __m256 c = _mm256_mul_ps(_mm256_cvtepi32_ps(code_vals), inv_levels);
+            _mm256_storeu_ps(&out[i], _mm256_mul_ps(scale_vals, _mm256_mul_ps(c, _mm256_and_ps(c, abs_mask))));
+        }
+    }
+    else
+    {
+        const __m256 inv_levels = _mm256_set1_ps(1.0f / QUANTIZED_STATE_UNSIGNED_LEVELS);
+        for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+        {
+            const __m256i code_vals = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&codes[i]));
+            const __m256 c = _mm256_mul_ps(_mm256_cvtepi32_ps(code_vals), inv_levels);
+            const __m256 c2 = _mm256_mul_ps(c, c);
+            _mm256_storeu_ps(&out[i], _mm256_mul_ps(scale_vals, _mm256_mul_ps(c2, c2)));
+        }
+    }
+
+    // Handle remaining items
+    quantized_state_decode_f32(state, &codes[i], scale, size - i, &out[i]);
+}
+
+static void quantized_state_encode_avx_256_f32(const struct quantized_state *const state, uint8_t *const codes, const float scale, const size_t size, const float *const in)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 inv_scale_vals = _mm256_set1_ps(1.0f / scale);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    // Gathers the low 32 bits of both 128-bit lanes once packed down to bytes
+    const __m256i gather_lanes = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+    size_t i = 0;
+    if (state->is_signed)
+    {
+        const __m256 levels = _mm256_set1_ps(QUANTIZED_STATE_SIGNED_LEVELS);
+        for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+        {
+            const __m256 x = _mm256_loadu_ps(&in[i]);
+            const __m256 c = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_mul_ps(_mm256_and_ps(x, abs_mask), inv_scale_vals)), levels);
+            const __m256i code_vals = _mm256_cvtps_epi32(_mm256_or_ps(c, _mm256_and_ps(x, sign_mask)));
+            const __m256i words = _mm256_packs_epi32(code_vals, code_vals);
+            const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(words, words), gather_lanes);
+            _mm_storel_epi64((__m128i *)&codes[i], _mm256_castsi256_si128(bytes));
+        }
+    }
+    else
+    {
+        const __m256 levels = _mm256_set1_ps(QUANTIZED_STATE_UNSIGNED_LEVELS);
+        const __m256 zero = _mm256_setzero_ps();
+        for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+        {
+            // Negative values can only come from rounding errors
+            const __m256 x = _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(&in[i]), inv_scale_vals), zero);
+            const __m256 c = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_sqrt_ps(x)), levels);
+            const __m256i code_vals = _mm256_cvtps_epi32(c);
+            const __m256i words = _mm256_packus_epi32(code_vals, code_vals);
+            const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words, words), gather_lanes);
+            _mm_storel_epi64((__m128i *)&codes[i], _mm256_castsi256_si128(bytes));
+        }
+    }
+
+    // Handle remaining items
+    quantized_state_encode_f32(state, &codes[i], scale, size - i, &in[i]);
+}
+#endif
@@ -1,11 +1,44 @@
 #include "cgrad/optimizers/sgd.h"
-#include "cgrad/tensor/tensor_add_inplace.h"
-#include "cgrad/tensor/tensor_scalar_mult_tensor_add.h"
-#include "cgrad/tensor/tensor_axpy.h"
+#include "cgrad/optimizers/multi_tensor.h"
+#include "cgrad/optimizers/quantized_state.h"
+#include "cgrad/utils/simd_support.h"
+#include <stdlib.h>
 
-static cgrad_error add_prev_b_t(struct sgd_optimizer *const opt, struct tensor *const prev_grad);
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+struct sgd_step_args
+{
+    struct sgd_optimizer *opt;
+    double lr;
+    double momentum;
+    bool nesterov;
+    double grad_scale;
+};
+
+static cgrad_error sgd_optimizer_setup(struct sgd_optimizer *opt, struct model_params *const params, struct tensor_allocator *allocator, const bool is_quantized);
+static cgrad_error add_momentum_buffer(struct sgd_optimizer *const opt, const struct tensor *const param, struct tensor *const momentum_buffer);
+static void sgd_step_chunk(void *args, const size_t param_index, const size_t start, const size_t end);
+static void sgd_step_quantized_chunk(const struct sgd_step_args *const args, const size_t param_index, const cgrad_dtype dtype, void *const param_data, const void *const grad_data, const size_t start, const size_t end);
+static void sgd_update_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay);
+static void sgd_update_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void sgd_update_avx_256_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay);
+static void sgd_update_avx_256_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay);
+#endif
 
 cgrad_error sgd_optimizer_init(struct sgd_optimizer *opt, struct model_params *const params, struct tensor_allocator *allocator)
+{
+    return sgd_optimizer_setup(opt, params, allocator, false);
+}
+
+cgrad_error sgd_optimizer_init_8bit(struct sgd_optimizer *opt, struct model_params *const params, struct tensor_allocator *allocator)
+{
+    return sgd_optimizer_setup(opt, params, allocator, true);
+}
+
+static cgrad_error sgd_optimizer_setup(struct sgd_optimizer *opt, struct model_params *const params, struct tensor_allocator *allocator, const bool is_quantized)
 {
     if (!opt)
     {
@@ -23,12 +56,43 @@ cgrad_error sgd_optimizer_init(struct sgd_optimizer *opt, struct model_params *c
     opt->params = params;
     opt->allocator = allocator;
     opt->size = 0;
+    opt->weight_decay = 0;
+    opt->grad_scale = 1;
+    opt->flat_momentum = NULL;
+    opt->is_quantized = is_quantized;
+
+    // Flat parameters get a flat momentum, so that steps sweep a single buffer. 8-bit momenta are per parameter
+    if (model_params_is_flat(params) || is_quantized)
+    {
+        if (!is_quantized)
+        {
+            opt->flat_momentum = model_params_alloc_flat_buffer(params, params->flat_dtype);
+            if (!opt->flat_momentum)
+            {
+                return TENSOR_ALLOCATION_FAILED;
+            }
+        }
+        for (size_t i = 0; i < params->size; i++)
+        {
+            cgrad_error err = add_momentum_buffer(opt, params->params[i], NULL);
+            if (err != NO_ERROR)
+            {
+                return err;
+            }
+        }
+        return NO_ERROR;
+    }
+
     for (size_t i = 0; i < params->size; i++)
     {
         struct tensor* param = params->params[i];
-        struct tensor* param_prev_grad = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, param->dtype);
+        struct tensor* momentum_buffer = tensor_allocator_no_grad_zero_alloc(allocator, param->shape, param->shape_size, param->dtype);
+        if (!momentum_buffer)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
 
-        cgrad_error err = add_prev_b_t(opt, param_prev_grad);
+        cgrad_error err = add_momentum_buffer(opt, param, momentum_buffer);
         if (err != NO_ERROR)
         {
             return err;
@@ -47,73 +111,282 @@ cgrad_error sgd_optimizer_step(struct sgd_optimizer* opt, double lr, double mome
 
     for (size_t i = 0; i < opt->params->size; i++)
     {
-        struct tensor* param = opt->params->params[i];
-        struct tensor_allocator *allocator = opt->allocator;
-        
-        struct tensor* prev_b_t = opt->prev_b_t[i];
-        struct tensor* b_t = tensor_allocator_no_grad_alloc(allocator, prev_b_t->shape, prev_b_t->shape_size, param->dtype);
+        const struct tensor *param = opt->params->params[i];
+        if (param->dtype != DTYPE_FLOAT64 && param->dtype != DTYPE_FLOAT32)
+        {
+            return OPERATION_INVALID_TENSOR_DTYPE;
+        }
+        if (param->grad && param->grad->dtype != param->dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+    }
+
+    // Frozen parameters are left untouched by the sweep. Quantized blocks must not straddle chunks
+    struct sgd_step_args args = {opt, lr, momentum, nesterov, opt->grad_scale};
+    if (opt->is_quantized)
+    {
+        return multi_tensor_apply_per_param(opt->params, &sgd_step_chunk, &args);
+    }
+    return multi_tensor_apply(opt->params, &sgd_step_chunk, &args);
+}
 
-        if (momentum != 0)
+void sgd_optimizer_cleanup(struct sgd_optimizer *opt)
+{
+    if (!opt)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < opt->size; i++)
+    {
+        if (opt->momentum_buffers[i])
         {
-            if (nesterov)
-            {
-                // b_t <- momentum * b_t-1 + g_t
-                struct tensor* g_t = tensor_allocator_clone(allocator, param->grad);
-                tensor_scalar_mult_tensor_add(prev_b_t, g_t, momentum, b_t);
+            tensor_allocator_free(opt->allocator, opt->momentum_buffers[i]);
+        }
+        if (opt->is_quantized)
+        {
+            quantized_state_cleanup(&opt->quantized_momentum_buffers[i]);
+        }
+    }
+    free(opt->flat_momentum);
+    opt->flat_momentum = NULL;
+}
+
+static void sgd_step_chunk(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    const struct sgd_step_args *step_args = (const struct sgd_step_args *)args;
+    struct sgd_optimizer *opt = step_args->opt;
+    const struct model_params *params = opt->params;
+    const size_t size = end - start;
+
+    cgrad_dtype dtype;
+    void *param_data;
+    void *buffer_data;
+    const void *grad_data;
+    if (param_index == MULTI_TENSOR_FLAT)
+    {
+        dtype = params->flat_dtype;
+        param_data = params->flat_data;
+        grad_data = params->flat_grad;
+        buffer_data = opt->flat_momentum;
+    }
+    else
+    {
+        struct tensor *param = params->params[param_index];
+        dtype = param->dtype;
+        param_data = param->data;
+        grad_data = param->grad->data;
+        if (opt->is_quantized)
+        {
+            sgd_step_quantized_chunk(step_args, param_index, dtype, param_data, grad_data, start, end);
+            return;
+        }
+        buffer_data = opt->flat_momentum ? (char *)opt->flat_momentum + params->flat_offsets[param_index] * dtype_sizeof(dtype) : opt->momentum_buffers[param_index]->data;
+    }
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+    {
+        double *param_chunk = (double *)param_data + start;
+        double *buffer_chunk = (double *)buffer_data + start;
+        const double *grad_chunk = (const double *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        sgd_update_avx_256_f64(param_chunk, buffer_chunk, grad_chunk, size, step_args, opt->weight_decay);
+#else
+        sgd_update_f64(param_chunk, buffer_chunk, grad_chunk, size, step_args, opt->weight_decay);
+#endif
+        break;
+    }
+    case DTYPE_FLOAT32:
+    {
+        float *param_chunk = (float *)param_data + start;
+        float *buffer_chunk = (float *)buffer_data + start;
+        const float *grad_chunk = (const float *)grad_data + start;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        sgd_update_avx_256_f32(param_chunk, buffer_chunk, grad_chunk, size, step_args, opt->weight_decay);
+#else
+        sgd_update_f32(param_chunk, buffer_chunk, grad_chunk, size, step_args, opt->weight_decay);
+#endif
+        break;
+    }
+    default:
+        break;
+    }
+}
 
-                // g_t <- g_t + momentum * b_t
-                tensor_axpy(b_t, g_t, momentum);
+/**
+ * The momentum is decoded one block at a time into a buffer that stays in cache, updated by the fused
+ * kernel of the dtype, and encoded back on the new scale of the block.
+ */
+static void sgd_step_quantized_chunk(const struct sgd_step_args *const args, const size_t param_index, const cgrad_dtype dtype, void *const param_data, const void *const grad_data, const size_t start, const size_t end)
+{
+    struct quantized_state *momentum_buffer = &args->opt->quantized_momentum_buffers[param_index];
+    const double weight_decay = args->opt->weight_decay;
+    const bool has_momentum = args->momentum != 0;
 
-                // SGD update using g_t, i.e.:
-                // param <- param - lr * g_t
-                tensor_axpy(g_t, param, -lr);
+    for (size_t block_start = start; block_start < end; block_start += OPTIMIZER_STATE_BLOCK_SIZE)
+    {
+        const size_t size = end - block_start < OPTIMIZER_STATE_BLOCK_SIZE ? end - block_start : OPTIMIZER_STATE_BLOCK_SIZE;
 
-                tensor_allocator_free(allocator, g_t);
+        if (dtype == DTYPE_FLOAT64)
+        {
+            double buffer[OPTIMIZER_STATE_BLOCK_SIZE];
+            if (has_momentum)
+            {
+                quantized_state_load_block_f64(momentum_buffer, block_start, size, buffer);
+            }
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+            sgd_update_avx_256_f64((double *)param_data + block_start, buffer, (const double *)grad_data + block_start, size, args, weight_decay);
+#else
+            sgd_update_f64((double *)param_data + block_start, buffer, (const double *)grad_data + block_start, size, args, weight_decay);
+#endif
+            if (has_momentum)
+            {
+                quantized_state_store_block_f64(momentum_buffer, block_start, size, buffer);
             }
-            else
+        }
+        else if (dtype == DTYPE_FLOAT32)
+        {
+            float buffer[OPTIMIZER_STATE_BLOCK_SIZE];
+            if (has_momentum)
             {
-                // No need to clone tensor as param->grad is not modified
-                // b_t <- momentum * b_t-1 + g_t
-                tensor_scalar_mult_tensor_add(prev_b_t, param->grad, momentum, b_t);
-
-                // SGD update using b_t, i.e.:
-                // g_t <- b_t
-                // param <- param - lr * g_t
-                tensor_axpy(b_t, param, -lr);
+                quantized_state_load_block_f32(momentum_buffer, block_start, size, buffer);
+            }
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+            sgd_update_avx_256_f32((float *)param_data + block_start, buffer, (const float *)grad_data + block_start, size, args, weight_decay);
+#else
+            sgd_update_f32((float *)param_data + block_start, buffer, (const float *)grad_data + block_start, size, args, weight_decay);
+#endif
+            if (has_momentum)
+            {
+                quantized_state_store_block_f32(momentum_buffer, block_start, size, buffer);
             }
         }
+    }
+}
 
-        // Free and setup next iteration b_ts
-        tensor_allocator_free(allocator, opt->prev_b_t[i]);
-        opt->prev_b_t[i] = b_t;
+/**
+ * For each element:
+ *   g <- grad_scale * grad + weight_decay * param
+ *   b <- momentum * b + g                    (if momentum != 0)
+ *   g <- nesterov ? g + momentum * b : b     (if momentum != 0)
+ *   param <- param - lr * g
+ */
+static void sgd_update_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay)
+{
+    const double lr = args->lr;
+    const double momentum = args->momentum;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        double g = args->grad_scale * grad[i] + weight_decay * param[i];
+        if (momentum != 0)
+        {
+            const double b = momentum * buffer[i] + g;
+            buffer[i] = b;
+            g = args->nesterov ? g + momentum * b : b;
+        }
+        param[i] -= lr * g;
     }
+}
 
-    return NO_ERROR;
+static void sgd_update_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay)
+{
+    const float lr = args->lr;
+    const float momentum = args->momentum;
+    const float decay = weight_decay;
+    const float grad_scale = args->grad_scale;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        float g = grad_scale * grad[i] + decay * param[i];
+        if (momentum != 0)
+        {
+            const float b = momentum * buffer[i] + g;
+            buffer[i] = b;
+            g = args->nesterov ? g + momentum * b : b;
+        }
+        param[i] -= lr * g;
+    }
 }
 
-void sgd_optimizer_cleanup(struct sgd_optimizer *opt)
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void sgd_update_avx_256_f64(double *restrict param, double *restrict buffer, const double *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay)
 {
-    if (!opt)
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    const __m256d lr_vals = _mm256_set1_pd(args->lr);
+    const __m256d momentum_vals = _mm256_set1_pd(args->momentum);
+    const __m256d decay_vals = _mm256_set1_pd(weight_decay);
+    const __m256d grad_scale_vals = _mm256_set1_pd(args->grad_scale);
+    const bool has_momentum = args->momentum != 0;
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
     {
-        return;
+        __m256d param_vals = _mm256_loadu_pd(&param[i]);
+        __m256d g_vals = _mm256_add_pd(_mm256_mul_pd(grad_scale_vals, _mm256_loadu_pd(&grad[i])), _mm256_mul_pd(decay_vals, param_vals));
+        if (has_momentum)
+        {
+            const __m256d b_vals = _mm256_add_pd(_mm256_mul_pd(momentum_vals, _mm256_loadu_pd(&buffer[i])), g_vals);
+            _mm256_storeu_pd(&buffer[i], b_vals);
+            g_vals = args->nesterov ? _mm256_add_pd(g_vals, _mm256_mul_pd(momentum_vals, b_vals)) : b_vals;
+        }
+        param_vals = _mm256_sub_pd(param_vals, _mm256_mul_pd(lr_vals, g_vals));
+        _mm256_storeu_pd(&param[i], param_vals);
     }
 
-    for (size_t i = 0; i < opt->size; i++)
+    // Handle remaining items
+    sgd_update_f64(&param[i], &buffer[i], &grad[i], size - i, args, weight_decay);
+}
+
+static void sgd_update_avx_256_f32(float *restrict param, float *restrict buffer, const float *restrict grad, const size_t size, const struct sgd_step_args *const args, const double weight_decay)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 lr_vals = _mm256_set1_ps(args->lr);
+    const __m256 momentum_vals = _mm256_set1_ps(args->momentum);
+    const __m256 decay_vals = _mm256_set1_ps(weight_decay);
+    const __m256 grad_scale_vals = _mm256_set1_ps(args->grad_scale);
+    const bool has_momentum = args->momentum != 0;
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
     {
-        tensor_allocator_free(opt->allocator, opt->prev_b_t[i]);
+        __m256 param_vals = _mm256_loadu_ps(&param[i]);
+        __m256 g_vals = _mm256_add_ps(_mm256_mul_ps(grad_scale_vals, _mm256_loadu_ps(&grad[i])), _mm256_mul_ps(decay_vals, param_vals));
+        if (has_momentum)
+        {
+            const __m256 b_vals = _mm256_add_ps(_mm256_mul_ps(momentum_vals, _mm256_loadu_ps(&buffer[i])), g_vals);
+            _mm256_storeu_ps(&buffer[i], b_vals);
+            g_vals = args->nesterov ? _mm256_add_ps(g_vals, _mm256_mul_ps(momentum_vals, b_vals)) : b_vals;
+        }
+        param_vals = _mm256_sub_ps(param_vals, _mm256_mul_ps(lr_vals, g_vals));
+        _mm256_storeu_ps(&param[i], param_vals);
     }
+
+    // Handle remaining items
+    sgd_update_f32(&param[i], &buffer[i], &grad[i], size - i, args, weight_decay);
 }
+#endif
 
-static cgrad_error add_prev_b_t(struct sgd_optimizer *const state, struct tensor *const prev_grad)
+static cgrad_error add_momentum_buffer(struct sgd_optimizer *const opt, const struct tensor *const param, struct tensor *const momentum_buffer)
 {
-    size_t const size = state->size;
+    size_t const size = opt->size;
     if (size >= MODEL_MAX_PARAMS)
     {
         return MODEL_MAX_PARAMS_EXCEEDED;
     }
 
-    state->prev_b_t[size] = prev_grad;
-    state->size++;
+    opt->momentum_buffers[size] = momentum_buffer;
+    opt->size++;
+
+    if (opt->is_quantized)
+    {
+        return quantized_state_init(&opt->quantized_momentum_buffers[size], param->data_size, true);
+    }
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
@@ -0,0 +1,220 @@
+#include "cgrad/parallel/communicator/communicator_shm.h"
+#include "cgrad/tensor/tensor_add_inplace.h"
+#include "cgrad/config.h"
+#include <fcntl.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Slots start on their own page, after the counters
+#define COMMUNICATOR_SHM_HEADER_SIZE 4096
+
+/**
+ * @struct communicator_shm_header
+ * @brief Counters at the start of the region, each on its own cache line.
+ */
+struct communicator_shm_header
+{
+    alignas(64) atomic_size_t n_attached;
+    alignas(64) atomic_size_t n_arrived;
+    alignas(64) atomic_size_t generation;
+};
+
+struct communicator_shm
+{
+    struct communicator_shm_header *header;
+    char *slots;
+    size_t map_size;
+    size_t rank;
+    size_t world_size;
+};
+
+static cgrad_error communicator_shm_all_reduce(void *state, void *const data, const size_t size, const cgrad_dtype dtype);
+static cgrad_error communicator_shm_all_gather(void *state, void *const data, const size_t size);
+static cgrad_error communicator_shm_barrier(void *state);
+static void communicator_shm_cleanup(void *state);
+static void communicator_shm_wait(struct communicator_shm *const shm);
+static inline char *communicator_shm_slot(const struct communicator_shm *const shm, const size_t rank);
+
+cgrad_error communicator_shm_init(struct communicator *const comm, const char *const name, const size_t rank, const size_t world_size)
+{
+    if (!comm)
+    {
+        return COMMUNICATOR_NULL;
+    }
+    if (!name)
+    {
+        return INPUT_NULL;
+    }
+    if (world_size == 0 || rank >= world_size)
+    {
+        return COMMUNICATOR_INVALID_RANK;
+    }
+
+    struct communicator_shm *shm = calloc(1, sizeof(struct communicator_shm));
+    if (!shm)
+    {
+        return COMMUNICATOR_ALLOCATION_FAILED;
+    }
+    shm->rank = rank;
+    shm->world_size = world_size;
+    shm->map_size = COMMUNICATOR_SHM_HEADER_SIZE + world_size * (size_t)COMMUNICATOR_CHUNK_SIZE;
+
+    // Whichever rank comes first creates the region, which starts zeroed
+    const int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        free(shm);
+        return COMMUNICATOR_SHARED_MEMORY_FAILED;
+    }
+    if (ftruncate(fd, shm->map_size) != 0)
+    {
+        close(fd);
+        free(shm);
+        return COMMUNICATOR_SHARED_MEMORY_FAILED;
+    }
+
+    void *region = mmap(NULL, shm->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED)
+    {
+        free(shm);
+        return COMMUNICATOR_SHARED_MEMORY_FAILED;
+    }
+    shm->header = (struct communicator_shm_header *)region;
+    shm->slots = (char *)region + COMMUNICATOR_SHM_HEADER_SIZE;
+
+    // Every rank holds a mapping once all of them are attached, the name is not needed anymore
+    atomic_fetch_add_explicit(&shm->header->n_attached, 1, memory_order_acq_rel);
+    while (atomic_load_explicit(&shm->header->n_attached, memory_order_acquire) < world_size)
+    {
+        sched_yield();
+    }
+    if (rank == 0)
+    {
+        shm_unlink(name);
+    }
+
+    comm->rank = rank;
+    comm->world_size = world_size;
+    comm->all_reduce = communicator_shm_all_reduce;
+    comm->all_gather = communicator_shm_all_gather;
+    comm->barrier = communicator_shm_barrier;
+    comm->cleanup = communicator_shm_cleanup;
+    comm->state = shm;
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_shm_all_reduce(void *state, void *const data, const size_t size, const cgrad_dtype dtype)
+{
+    struct communicator_shm *shm = (struct communicator_shm *)state;
+    if (!data)
+    {
+        return INPUT_NULL;
+    }
+    if (dtype != DTYPE_FLOAT32 && dtype != DTYPE_FLOAT64)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    const size_t dtype_size = dtype_sizeof(dtype);
+    const size_t chunk_size = COMMUNICATOR_CHUNK_SIZE / dtype_size;
+    const size_t world_size = shm->world_size;
+
+    for (size_t start = 0; start < size; start += chunk_size)
+    {
+        const size_t n = size - start < chunk_size ? size - start : chunk_size;
+        char *chunk = (char *)data + start * dtype_size;
+
+        memcpy(communicator_shm_slot(shm, shm->rank), chunk, n * dtype_size);
+        communicator_shm_wait(shm);
+
+        // Reduce-scatter: each rank sums its own segment of all the slots, in rank order, into slot 0
+        const size_t segment_start = n * shm->rank / world_size;
+        const size_t segment_end = n * (shm->rank + 1) / world_size;
+        char *segment = communicator_shm_slot(shm, 0) + segment_start * dtype_size;
+        for (size_t r = 1; r < world_size; r++)
+        {
+            tensor_data_add_inplace(segment, communicator_shm_slot(shm, r) + segment_start * dtype_size, segment_end - segment_start, dtype);
+        }
+        communicator_shm_wait(shm);
+
+        // All-gather, slots are overwritten by the next chunk only once every rank has its copy
+        memcpy(chunk, communicator_shm_slot(shm, 0), n * dtype_size);
+        communicator_shm_wait(shm);
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_shm_all_gather(void *state, void *const data, const size_t size)
+{
+    struct communicator_shm *shm = (struct communicator_shm *)state;
+    if (!data)
+    {
+        return INPUT_NULL;
+    }
+
+    char *blocks = (char *)data;
+    for (size_t start = 0; start < size; start += COMMUNICATOR_CHUNK_SIZE)
+    {
+        const size_t n = size - start < COMMUNICATOR_CHUNK_SIZE ? size - start : COMMUNICATOR_CHUNK_SIZE;
+
+        memcpy(communicator_shm_slot(shm, shm->rank), blocks + shm->rank * size + start, n);
+        communicator_shm_wait(shm);
+
+        for (size_t r = 0; r < shm->world_size; r++)
+        {
+            if (r != shm->rank)
+            {
+                memcpy(blocks + r * size + start, communicator_shm_slot(shm, r), n);
+            }
+        }
+        communicator_shm_wait(shm);
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_shm_barrier(void *state)
+{
+    communicator_shm_wait((struct communicator_shm *)state);
+    return NO_ERROR;
+}
+
+static void communicator_shm_cleanup(void *state)
+{
+    struct communicator_shm *shm = (struct communicator_shm *)state;
+    munmap(shm->header, shm->map_size);
+    free(shm);
+}
+
+static void communicator_shm_wait(struct communicator_shm *const shm)
+{
+    struct communicator_shm_header *header = shm->header;
+
+    const size_t generation = atomic_load_explicit(&header->generation, memory_order_acquire);
+    if (atomic_fetch_add_explicit(&header->n_arrived, 1, memory_order_acq_rel) + 1 == shm->world_size)
+    {
+        // The last rank to arrive releases the others
+        atomic_store_explicit(&header->n_arrived, 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&header->generation, 1, memory_order_release);
+        return;
+    }
+
+    // Ranks may outnumber the cores, waiting ones give theirs away
+    while (atomic_load_explicit(&header->generation, memory_order_acquire) == generation)
+    {
+        sched_yield();
+    }
+}
+
+static inline char *communicator_shm_slot(const struct communicator_shm *const shm, const size_t rank)
+{
+    return shm->slots + rank * (size_t)COMMUNICATOR_CHUNK_SIZE;
+}
@@ -0,0 +1,382 @@
+#include "cgrad/parallel/communicator/communicator_tcp.h"
+#include "cgrad/tensor/tensor_add_inplace.h"
+#include "cgrad/config.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+struct communicator_tcp
+{
+    int next_fd;    /**< Connection to the next rank, only sent to. */
+    int prev_fd;    /**< Connection from the previous rank, only received from. */
+    char *buffer;   /**< Segments received to be reduced, COMMUNICATOR_CHUNK_SIZE bytes. */
+    size_t rank;
+    size_t world_size;
+};
+
+static cgrad_error communicator_tcp_all_reduce(void *state, void *const data, const size_t size, const cgrad_dtype dtype);
+static cgrad_error communicator_tcp_all_reduce_chunk(struct communicator_tcp *const tcp, char *const chunk, const size_t n, const cgrad_dtype dtype);
+static cgrad_error communicator_tcp_all_gather(void *state, void *const data, const size_t size);
+static cgrad_error communicator_tcp_barrier(void *state);
+static void communicator_tcp_cleanup(void *state);
+static cgrad_error communicator_tcp_exchange(struct communicator_tcp *const tcp, const char *send_data, size_t send_size, char *recv_data, size_t recv_size);
+static cgrad_error communicator_tcp_connect(struct communicator_tcp *const tcp, const char *const host, const uint16_t base_port);
+static int communicator_tcp_connect_to(const struct sockaddr_in *const address);
+static cgrad_error communicator_tcp_configure(const int fd);
+static inline size_t communicator_tcp_segment_start(const size_t n, const size_t segment, const size_t world_size);
+
+cgrad_error communicator_tcp_init(struct communicator *const comm, const char *const host, const uint16_t base_port, const size_t rank, const size_t world_size)
+{
+    if (!comm)
+    {
+        return COMMUNICATOR_NULL;
+    }
+    if (!host)
+    {
+        return INPUT_NULL;
+    }
+    if (world_size == 0 || rank >= world_size)
+    {
+        return COMMUNICATOR_INVALID_RANK;
+    }
+
+    struct communicator_tcp *tcp = calloc(1, sizeof(struct communicator_tcp));
+    if (!tcp)
+    {
+        return COMMUNICATOR_ALLOCATION_FAILED;
+    }
+    tcp->next_fd = -1;
+    tcp->prev_fd = -1;
+    tcp->rank = rank;
+    tcp->world_size = world_size;
+
+    tcp->buffer = malloc(COMMUNICATOR_CHUNK_SIZE);
+    if (!tcp->buffer)
+    {
+        free(tcp);
+        return COMMUNICATOR_ALLOCATION_FAILED;
+    }
+
+    // A single rank has nobody to talk to
+    if (world_size > 1)
+    {
+        const cgrad_error err = communicator_tcp_connect(tcp, host, base_port);
+        if (err != NO_ERROR)
+        {
+            communicator_tcp_cleanup(tcp);
+            return err;
+        }
+    }
+
+    comm->rank = rank;
+    comm->world_size = world_size;
+    comm->all_reduce = communicator_tcp_all_reduce;
+    comm->all_gather = communicator_tcp_all_gather;
+    comm->barrier = communicator_tcp_barrier;
+    comm->cleanup = communicator_tcp_cleanup;
+    comm->state = tcp;
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_tcp_all_reduce(void *state, void *const data, const size_t size, const cgrad_dtype dtype)
+{
+    struct communicator_tcp *tcp = (struct communicator_tcp *)state;
+    if (!data)
+    {
+        return INPUT_NULL;
+    }
+    if (dtype != DTYPE_FLOAT32 && dtype != DTYPE_FLOAT64)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+    if (tcp->world_size == 1)
+    {
+        return NO_ERROR;
+    }
+
+    const size_t dtype_size = dtype_sizeof(dtype);
+    const size_t chunk_size = COMMUNICATOR_CHUNK_SIZE / dtype_size;
+    for (size_t start = 0; start < size; start += chunk_size)
+    {
+        const size_t n = size - start < chunk_size ? size - start : chunk_size;
+        const cgrad_error err = communicator_tcp_all_reduce_chunk(tcp, (char *)data + start * dtype_size, n, dtype);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_tcp_all_reduce_chunk(struct communicator_tcp *const tcp, char *const chunk, const size_t n, const cgrad_dtype dtype)
+{
+    const size_t dtype_size = dtype_sizeof(dtype);
+    const size_t world_size = tcp->world_size;
+    const size_t rank = tcp->rank;
+
+    cgrad_error err = NO_ERROR;
+
+    // Reduce-scatter: segment rank - step goes forward, and the rank adds its own part to the one received
+    for (size_t step = 0; step + 1 < world_size; step++)
+    {
+        const size_t send_segment = (rank + world_size - step) % world_size;
+        const size_t recv_segment = (rank + world_size - step - 1) % world_size;
+        const size_t send_start = communicator_tcp_segment_start(n, send_segment, world_size);
+        const size_t send_size = communicator_tcp_segment_start(n, send_segment + 1, world_size) - send_start;
+        const size_t recv_start = communicator_tcp_segment_start(n, recv_segment, world_size);
+        const size_t recv_size = communicator_tcp_segment_start(n, recv_segment + 1, world_size) - recv_start;
+
+        if ((err = communicator_tcp_exchange(tcp, chunk + send_start * dtype_size, send_size * dtype_size, tcp->buffer, recv_size * dtype_size)) != NO_ERROR)
+        {
+            return err;
+        }
+        tensor_data_add_inplace(chunk + recv_start * dtype_size, tcp->buffer, recv_size, dtype);
+    }
+
+    // All-gather: the rank now holds the whole sum of segment rank + 1, which goes around the ring
+    for (size_t step = 0; step + 1 < world_size; step++)
+    {
+        const size_t send_segment = (rank + 1 + world_size - step) % world_size;
+        const size_t recv_segment = (rank + world_size - step) % world_size;
+        const size_t send_start = communicator_tcp_segment_start(n, send_segment, world_size);
+        const size_t send_size = communicator_tcp_segment_start(n, send_segment + 1, world_size) - send_start;
+        const size_t recv_start = communicator_tcp_segment_start(n, recv_segment, world_size);
+        const size_t recv_size = communicator_tcp_segment_start(n, recv_segment + 1, world_size) - recv_start;
+
+        if ((err = communicator_tcp_exchange(tcp, chunk + send_start * dtype_size, send_size * dtype_size, chunk + recv_start * dtype_size, recv_size * dtype_size)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_tcp_all_gather(void *state, void *const data, const size_t size)
+{
+    struct communicator_tcp *tcp = (struct communicator_tcp *)state;
+    if (!data)
+    {
+        return INPUT_NULL;
+    }
+
+    // Block rank - step goes forward, so that after world_size - 1 steps every block went around the ring
+    char *blocks = (char *)data;
+    for (size_t step = 0; step + 1 < tcp->world_size; step++)
+    {
+        const size_t send_block = (tcp->rank + tcp->world_size - step) % tcp->world_size;
+        const size_t recv_block = (tcp->rank + tcp->world_size - step - 1) % tcp->world_size;
+
+        const cgrad_error err = communicator_tcp_exchange(tcp, blocks + send_block * size, size, blocks + recv_block * size, size);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_tcp_barrier(void *state)
+{
+    struct communicator_tcp *tcp = (struct communicator_tcp *)state;
+    if (tcp->world_size == 1)
+    {
+        return NO_ERROR;
+    }
+
+    /**
+     * A first token goes around the ring once every rank arrived, a second one tells every rank so.
+     * Rank 0 starts both tokens, the others forward them.
+     */
+    char token = 0;
+    cgrad_error err = NO_ERROR;
+    for (size_t round = 0; round < 2; round++)
+    {
+        if (tcp->rank == 0)
+        {
+            if ((err = communicator_tcp_exchange(tcp, &token, 1, NULL, 0)) != NO_ERROR ||
+                (err = communicator_tcp_exchange(tcp, NULL, 0, &token, 1)) != NO_ERROR)
+            {
+                return err;
+            }
+        }
+        else
+        {
+            if ((err = communicator_tcp_exchange(tcp, NULL, 0, &token, 1)) != NO_ERROR ||
+                (err = communicator_tcp_exchange(tcp, &token, 1, NULL, 0)) != NO_ERROR)
+            {
+                return err;
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static void communicator_tcp_cleanup(void *state)
+{
+    struct communicator_tcp *tcp = (struct communicator_tcp *)state;
+    if (tcp->next_fd >= 0)
+    {
+        close(tcp->next_fd);
+    }
+    if (tcp->prev_fd >= 0)
+    {
+        close(tcp->prev_fd);
+    }
+    free(tcp->buffer);
+    free(tcp);
+}
+
+static cgrad_error communicator_tcp_exchange(struct communicator_tcp *const tcp, const char *send_data, size_t send_size, char *recv_data, size_t recv_size)
+{
+    // Sending and receiving progress together, so that ranks sending to each other never wait on full buffers
+    while (send_size > 0 || recv_size > 0)
+    {
+        struct pollfd fds[2] = {
+            {tcp->next_fd, send_size > 0 ? POLLOUT : 0, 0},
+            {tcp->prev_fd, recv_size > 0 ? POLLIN : 0, 0},
+        };
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return COMMUNICATOR_TRANSFER_FAILED;
+        }
+
+        if (send_size > 0 && (fds[0].revents & (POLLOUT | POLLERR | POLLHUP)))
+        {
+            const ssize_t sent = send(tcp->next_fd, send_data, send_size, MSG_NOSIGNAL);
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                return COMMUNICATOR_TRANSFER_FAILED;
+            }
+            if (sent > 0)
+            {
+                send_data += sent;
+                send_size -= (size_t)sent;
+            }
+        }
+
+        if (recv_size > 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP)))
+        {
+            const ssize_t received = recv(tcp->prev_fd, recv_data, recv_size, 0);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                return COMMUNICATOR_TRANSFER_FAILED;
+            }
+            if (received > 0)
+            {
+                recv_data += received;
+                recv_size -= (size_t)received;
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error communicator_tcp_connect(struct communicator_tcp *const tcp, const char *const host, const uint16_t base_port)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+    {
+        return COMMUNICATOR_CONNECTION_FAILED;
+    }
+
+    const int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        return COMMUNICATOR_CONNECTION_FAILED;
+    }
+    const int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    address.sin_port = htons(base_port + tcp->rank);
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, 1) != 0)
+    {
+        close(listen_fd);
+        return COMMUNICATOR_CONNECTION_FAILED;
+    }
+
+    // Every rank listens before connecting, so that connecting only waits for the next rank to start
+    address.sin_port = htons(base_port + (tcp->rank + 1) % tcp->world_size);
+    tcp->next_fd = communicator_tcp_connect_to(&address);
+    if (tcp->next_fd >= 0)
+    {
+        tcp->prev_fd = accept(listen_fd, NULL, NULL);
+    }
+    close(listen_fd);
+
+    if (tcp->next_fd < 0 || tcp->prev_fd < 0)
+    {
+        return COMMUNICATOR_CONNECTION_FAILED;
+    }
+
+    cgrad_error err = NO_ERROR;
+    if ((err = communicator_tcp_configure(tcp->next_fd)) != NO_ERROR || (err = communicator_tcp_configure(tcp->prev_fd)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return NO_ERROR;
+}
+
+static int communicator_tcp_connect_to(const struct sockaddr_in *const address)
+{
+    const struct timespec delay = {0, COMMUNICATOR_TCP_RETRY_DELAY_MS * 1000000L};
+    for (size_t attempt = 0; attempt < COMMUNICATOR_TCP_CONNECT_RETRIES; attempt++)
+    {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        if (connect(fd, (const struct sockaddr *)address, sizeof(*address)) == 0)
+        {
+            return fd;
+        }
+        close(fd);
+        nanosleep(&delay, NULL);
+    }
+
+    return -1;
+}
+
+static cgrad_error communicator_tcp_configure(const int fd)
+{
+    // Segments are sent whole, there is nothing to gain from delaying small ones
+    const int enable = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) != 0)
+    {
+        return COMMUNICATOR_CONNECTION_FAILED;
+    }
+
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)
+    {
+        return COMMUNICATOR_CONNECTION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+static inline size_t communicator_tcp_segment_start(const size_t n, const size_t segment, const size_t world_size)
+{
+    return n * segment / world_size;
+}
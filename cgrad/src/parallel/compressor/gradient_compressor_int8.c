@@ -0,0 +1,296 @@
+#include "cgrad/parallel/compressor/gradient_compressor_int8.h"
+#include "cgrad/config.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+#define GRADIENT_COMPRESSOR_INT8_LEVELS 127.0f
+// Xorshift lanes, one per float of an AVX register
+#define GRADIENT_COMPRESSOR_INT8_RNG_LANES 8
+
+struct gradient_compressor_int8
+{
+    float *residual;
+    size_t size;
+    uint32_t rng[GRADIENT_COMPRESSOR_INT8_RNG_LANES];
+};
+
+static size_t gradient_compressor_int8_message_size(void *state, const size_t size);
+static cgrad_error gradient_compressor_int8_compress(void *state, const float *const grad, const size_t offset, const size_t size, void *const message);
+static void gradient_compressor_int8_decompress_add(void *state, const void *const message, const size_t size, float *const grad);
+static void gradient_compressor_int8_cleanup(void *state);
+static inline size_t gradient_compressor_int8_scales_size(const size_t size);
+static inline uint32_t gradient_compressor_int8_next(uint32_t *const x);
+static float gradient_compressor_int8_accumulate_f32(float *const residual, const float *const grad, const size_t size);
+static void gradient_compressor_int8_encode_f32(struct gradient_compressor_int8 *const int8, float *const residual, int8_t *const codes, const float scale, const size_t size);
+static void gradient_compressor_int8_decode_add_f32(const int8_t *const codes, const float scale, const size_t size, float *const grad);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static float gradient_compressor_int8_accumulate_avx_256_f32(float *const residual, const float *const grad, const size_t size);
+static void gradient_compressor_int8_encode_avx_256_f32(struct gradient_compressor_int8 *const int8, float *const residual, int8_t *const codes, const float scale, const size_t size);
+static void gradient_compressor_int8_decode_add_avx_256_f32(const int8_t *const codes, const float scale, const size_t size, float *const grad);
+#endif
+
+cgrad_error gradient_compressor_int8_init(struct gradient_compressor *const comp, const size_t size, const unsigned int seed)
+{
+    if (!comp)
+    {
+        return GRADIENT_COMPRESSOR_NULL;
+    }
+
+    struct gradient_compressor_int8 *int8 = calloc(1, sizeof(struct gradient_compressor_int8));
+    if (!int8)
+    {
+        return GRADIENT_COMPRESSOR_ALLOCATION_FAILED;
+    }
+    int8->residual = calloc(size > 0 ? size : 1, sizeof(float));
+    int8->size = size;
+    if (!int8->residual)
+    {
+        free(int8);
+        return GRADIENT_COMPRESSOR_ALLOCATION_FAILED;
+    }
+
+    // Xorshift never leaves zero, lanes are spread by an odd multiplier
+    for (size_t l = 0; l < GRADIENT_COMPRESSOR_INT8_RNG_LANES; l++)
+    {
+        int8->rng[l] = (uint32_t)(seed * GRADIENT_COMPRESSOR_INT8_RNG_LANES + l + 1) * 2654435761u;
+        int8->rng[l] = int8->rng[l] ? int8->rng[l] : 1;
+    }
+
+    comp->message_size = gradient_compressor_int8_message_size;
+    comp->compress = gradient_compressor_int8_compress;
+    comp->decompress_add = gradient_compressor_int8_decompress_add;
+    comp->cleanup = gradient_compressor_int8_cleanup;
+    comp->state = int8;
+
+    return NO_ERROR;
+}
+
+static size_t gradient_compressor_int8_message_size(void *state, const size_t size)
+{
+    (void)state;
+
+    // Scales, then codes, padded so that the scales of the next message stay aligned
+    const size_t message_size = gradient_compressor_int8_scales_size(size) + size;
+    return (message_size + sizeof(float) - 1) / sizeof(float) * sizeof(float);
+}
+
+static cgrad_error gradient_compressor_int8_compress(void *state, const float *const grad, const size_t offset, const size_t size, void *const message)
+{
+    struct gradient_compressor_int8 *int8 = (struct gradient_compressor_int8 *)state;
+    if (!grad || !message)
+    {
+        return INPUT_NULL;
+    }
+    if (offset > int8->size || size > int8->size - offset)
+    {
+        return GRADIENT_COMPRESSOR_OUT_OF_RANGE;
+    }
+
+    float *scales = (float *)message;
+    int8_t *codes = (int8_t *)message + gradient_compressor_int8_scales_size(size);
+    memset(codes + size, 0, gradient_compressor_int8_message_size(state, size) - gradient_compressor_int8_scales_size(size) - size);
+
+    for (size_t start = 0; start < size; start += GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE)
+    {
+        const size_t n = size - start < GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE ? size - start : GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE;
+        float *residual = &int8->residual[offset + start];
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        const float scale = gradient_compressor_int8_accumulate_avx_256_f32(residual, &grad[start], n);
+#else
+        const float scale = gradient_compressor_int8_accumulate_f32(residual, &grad[start], n);
+#endif
+
+        if (scale == 0 || !isfinite(scale))
+        {
+            // Nothing to send, or nothing sensible to send
+            scales[start / GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE] = 0;
+            memset(&codes[start], 0, n);
+            continue;
+        }
+        scales[start / GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE] = scale;
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        gradient_compressor_int8_encode_avx_256_f32(int8, residual, &codes[start], scale, n);
+#else
+        gradient_compressor_int8_encode_f32(int8, residual, &codes[start], scale, n);
+#endif
+    }
+
+    return NO_ERROR;
+}
+
+static void gradient_compressor_int8_decompress_add(void *state, const void *const message, const size_t size, float *const grad)
+{
+    (void)state;
+
+    const float *scales = (const float *)message;
+    const int8_t *codes = (const int8_t *)message + gradient_compressor_int8_scales_size(size);
+
+    for (size_t start = 0; start < size; start += GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE)
+    {
+        const size_t n = size - start < GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE ? size - start : GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE;
+        const float scale = scales[start / GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE];
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        gradient_compressor_int8_decode_add_avx_256_f32(&codes[start], scale, n, &grad[start]);
+#else
+        gradient_compressor_int8_decode_add_f32(&codes[start], scale, n, &grad[start]);
+#endif
+    }
+}
+
+static void gradient_compressor_int8_cleanup(void *state)
+{
+    struct gradient_compressor_int8 *int8 = (struct gradient_compressor_int8 *)state;
+    free(int8->residual);
+    free(int8);
+}
+
+static inline size_t gradient_compressor_int8_scales_size(const size_t size)
+{
+    return (size + GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE - 1) / GRADIENT_COMPRESSOR_INT8_BLOCK_SIZE * sizeof(float);
+}
+
+static inline uint32_t gradient_compressor_int8_next(uint32_t *const x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+// Adds the gradient to the residual, and returns the largest magnitude of the sum
+static float gradient_compressor_int8_accumulate_f32(float *const residual, const float *const grad, const size_t size)
+{
+    float scale = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        residual[i] += grad[i];
+        const float magnitude = fabsf(residual[i]);
+        scale = magnitude > scale ? magnitude : scale;
+    }
+
+    return scale;
+}
+
+// Rounds residual / scale * 127 down or up with probability its distance to the other level, and keeps the error
+static void gradient_compressor_int8_encode_f32(struct gradient_compressor_int8 *const int8, float *const residual, int8_t *const codes, const float scale, const size_t size)
+{
+    const float to_levels = GRADIENT_COMPRESSOR_INT8_LEVELS / scale;
+    const float to_values = scale / GRADIENT_COMPRESSOR_INT8_LEVELS;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const float u = (gradient_compressor_int8_next(&int8->rng[0]) >> 8) * (1.0f / (1 << 24));
+        float code = floorf(residual[i] * to_levels + u);
+        code = code > GRADIENT_COMPRESSOR_INT8_LEVELS ? GRADIENT_COMPRESSOR_INT8_LEVELS : code;
+        code = code < -GRADIENT_COMPRESSOR_INT8_LEVELS ? -GRADIENT_COMPRESSOR_INT8_LEVELS : code;
+
+        codes[i] = (int8_t)code;
+        residual[i] -= code * to_values;
+    }
+}
+
+static void gradient_compressor_int8_decode_add_f32(const int8_t *const codes, const float scale, const size_t size, float *const grad)
+{
+    const float to_values = scale / GRADIENT_COMPRESSOR_INT8_LEVELS;
+    for (size_t i = 0; i < size; i++)
+    {
+        grad[i] += codes[i] * to_values;
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static float gradient_compressor_int8_accumulate_avx_256_f32(float *const residual, const float *const grad, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 scale_vals = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 v = _mm256_add_ps(_mm256_loadu_ps(&residual[i]), _mm256_loadu_ps(&grad[i]));
+        _mm256_storeu_ps(&residual[i], v);
+        scale_vals = _mm256_max_ps(scale_vals, _mm256_and_ps(v, abs_mask));
+    }
+
+    float lanes[8];
+    _mm256_storeu_ps(lanes, scale_vals);
+
+    // Handle remaining items
+    float scale = gradient_compressor_int8_accumulate_f32(&residual[i], &grad[i], size - i);
+    for (size_t l = 0; l < PARALLELIZED_ITEMS; l++)
+    {
+        scale = lanes[l] > scale ? lanes[l] : scale;
+    }
+
+    return scale;
+}
+
+static void gradient_compressor_int8_encode_avx_256_f32(struct gradient_compressor_int8 *const int8, float *const residual, int8_t *const codes, const float scale, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 to_levels = _mm256_set1_ps(GRADIENT_COMPRESSOR_INT8_LEVELS / scale);
+    const __m256 to_values = _mm256_set1_ps(scale / GRADIENT_COMPRESSOR_INT8_LEVELS);
+    const __m256 max_level = _mm256_set1_ps(GRADIENT_COMPRESSOR_INT8_LEVELS);
+    const __m256 min_level = _mm256_set1_ps(-GRADIENT_COMPRESSOR_INT8_LEVELS);
+    const __m256 to_unit = _mm256_set1_ps(1.0f / (1 << 24));
+    // Gathers the low 32 bits of both 128-bit lanes once packed down to bytes
+    const __m256i gather_lanes = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+    __m256i rng = _mm256_loadu_si256((const __m256i *)int8->rng);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        rng = _mm256_xor_si256(rng, _mm256_slli_epi32(rng, 13));
+        rng = _mm256_xor_si256(rng, _mm256_srli_epi32(rng, 17));
+        rng = _mm256_xor_si256(rng, _mm256_slli_epi32(rng, 5));
+        const __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(rng, 8)), to_unit);
+
+        const __m256 v = _mm256_loadu_ps(&residual[i]);
+        __m256 code = _mm256_floor_ps(_mm256_add_ps(_mm256_mul_ps(v, to_levels), u));
+        code = _mm256_max_ps(_mm256_min_ps(code, max_level), min_level);
+
+        const __m256i code_vals = _mm256_cvtps_epi32(code);
+        const __m256i words = _mm256_packs_epi32(code_vals, code_vals);
+        const __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(words, words), gather_lanes);
+        _mm_storel_epi64((__m128i *)&codes[i], _mm256_castsi256_si128(bytes));
+
+        _mm256_storeu_ps(&residual[i], _mm256_sub_ps(v, _mm256_mul_ps(code, to_values)));
+    }
+
+    _mm256_storeu_si256((__m256i *)int8->rng, rng);
+
+    // Handle remaining items
+    gradient_compressor_int8_encode_f32(int8, &residual[i], &codes[i], scale, size - i);
+}
+
+static void gradient_compressor_int8_decode_add_avx_256_f32(const int8_t *const codes, const float scale, const size_t size, float *const grad)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 to_values = _mm256_set1_ps(scale / GRADIENT_COMPRESSOR_INT8_LEVELS);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256i code_vals = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)&codes[i]));
+        const __m256 values = _mm256_mul_ps(_mm256_cvtepi32_ps(code_vals), to_values);
+        _mm256_storeu_ps(&grad[i], _mm256_add_ps(_mm256_loadu_ps(&grad[i]), values));
+    }
+
+    // Handle remaining items
+    gradient_compressor_int8_decode_add_f32(&codes[i], scale, size - i, &grad[i]);
+}
+#endif
@@ -0,0 +1,245 @@
+#include "cgrad/parallel/compressor/gradient_compressor_topk.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+struct gradient_compressor_topk
+{
+    float *residual;
+    float *magnitudes;  /**< Scratch copy of the magnitudes of a range, reordered by selection. */
+    size_t size;
+    double ratio;
+};
+
+static size_t gradient_compressor_topk_message_size(void *state, const size_t size);
+static cgrad_error gradient_compressor_topk_compress(void *state, const float *const grad, const size_t offset, const size_t size, void *const message);
+static void gradient_compressor_topk_decompress_add(void *state, const void *const message, const size_t size, float *const grad);
+static void gradient_compressor_topk_cleanup(void *state);
+static inline size_t gradient_compressor_topk_k(const struct gradient_compressor_topk *const topk, const size_t size);
+static float gradient_compressor_topk_select(float *const values, const size_t size, const size_t kth);
+static void gradient_compressor_topk_accumulate_f32(float *const residual, const float *const grad, float *const magnitudes, const size_t size);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void gradient_compressor_topk_accumulate_avx_256_f32(float *const residual, const float *const grad, float *const magnitudes, const size_t size);
+#endif
+
+cgrad_error gradient_compressor_topk_init(struct gradient_compressor *const comp, const size_t size, const double ratio)
+{
+    if (!comp)
+    {
+        return GRADIENT_COMPRESSOR_NULL;
+    }
+    if (!(ratio > 0 && ratio <= 1))
+    {
+        return GRADIENT_COMPRESSOR_INVALID_RATIO;
+    }
+
+    struct gradient_compressor_topk *topk = calloc(1, sizeof(struct gradient_compressor_topk));
+    if (!topk)
+    {
+        return GRADIENT_COMPRESSOR_ALLOCATION_FAILED;
+    }
+    topk->residual = calloc(size > 0 ? size : 1, sizeof(float));
+    topk->magnitudes = malloc((size > 0 ? size : 1) * sizeof(float));
+    topk->size = size;
+    topk->ratio = ratio;
+    if (!topk->residual || !topk->magnitudes)
+    {
+        gradient_compressor_topk_cleanup(topk);
+        return GRADIENT_COMPRESSOR_ALLOCATION_FAILED;
+    }
+
+    comp->message_size = gradient_compressor_topk_message_size;
+    comp->compress = gradient_compressor_topk_compress;
+    comp->decompress_add = gradient_compressor_topk_decompress_add;
+    comp->cleanup = gradient_compressor_topk_cleanup;
+    comp->state = topk;
+
+    return NO_ERROR;
+}
+
+static size_t gradient_compressor_topk_message_size(void *state, const size_t size)
+{
+    // Indices, then values
+    return gradient_compressor_topk_k((struct gradient_compressor_topk *)state, size) * (sizeof(uint32_t) + sizeof(float));
+}
+
+static cgrad_error gradient_compressor_topk_compress(void *state, const float *const grad, const size_t offset, const size_t size, void *const message)
+{
+    struct gradient_compressor_topk *topk = (struct gradient_compressor_topk *)state;
+    if (!grad || !message)
+    {
+        return INPUT_NULL;
+    }
+    if (offset > topk->size || size > topk->size - offset || size > UINT32_MAX)
+    {
+        return GRADIENT_COMPRESSOR_OUT_OF_RANGE;
+    }
+
+    const size_t k = gradient_compressor_topk_k(topk, size);
+    if (k == 0)
+    {
+        return NO_ERROR;
+    }
+
+    float *residual = &topk->residual[offset];
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    gradient_compressor_topk_accumulate_avx_256_f32(residual, grad, topk->magnitudes, size);
+#else
+    gradient_compressor_topk_accumulate_f32(residual, grad, topk->magnitudes, size);
+#endif
+
+    const float threshold = gradient_compressor_topk_select(topk->magnitudes, size, size - k);
+
+    uint32_t *indices = (uint32_t *)message;
+    float *values = (float *)(indices + k);
+
+    // Fewer than k elements are above the threshold, the first ones equal to it make up for the rest
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        if (fabsf(residual[i]) > threshold)
+        {
+            indices[n] = (uint32_t)i;
+            values[n] = residual[i];
+            residual[i] = 0;
+            n++;
+        }
+    }
+    for (size_t i = 0; i < size && n < k; i++)
+    {
+        if (fabsf(residual[i]) == threshold)
+        {
+            indices[n] = (uint32_t)i;
+            values[n] = residual[i];
+            residual[i] = 0;
+            n++;
+        }
+    }
+
+    // Only reachable with NaNs, which compare to nothing
+    for (; n < k; n++)
+    {
+        indices[n] = 0;
+        values[n] = 0;
+    }
+
+    return NO_ERROR;
+}
+
+static void gradient_compressor_topk_decompress_add(void *state, const void *const message, const size_t size, float *const grad)
+{
+    const size_t k = gradient_compressor_topk_k((struct gradient_compressor_topk *)state, size);
+    const uint32_t *indices = (const uint32_t *)message;
+    const float *values = (const float *)(indices + k);
+
+    for (size_t i = 0; i < k; i++)
+    {
+        grad[indices[i]] += values[i];
+    }
+}
+
+static void gradient_compressor_topk_cleanup(void *state)
+{
+    struct gradient_compressor_topk *topk = (struct gradient_compressor_topk *)state;
+    free(topk->residual);
+    free(topk->magnitudes);
+    free(topk);
+}
+
+static inline size_t gradient_compressor_topk_k(const struct gradient_compressor_topk *const topk, const size_t size)
+{
+    const size_t k = (size_t)ceil(topk->ratio * size);
+    return k < size ? k : size;
+}
+
+/**
+ * Returns the element that would be at index kth if values were sorted, partially reordering them
+ * (quickselect with Hoare partitions around a median of three).
+ */
+static float gradient_compressor_topk_select(float *const values, const size_t size, const size_t kth)
+{
+    ptrdiff_t lo = 0;
+    ptrdiff_t hi = (ptrdiff_t)size - 1;
+    const ptrdiff_t target = (ptrdiff_t)kth;
+
+    while (lo < hi)
+    {
+        const float a = values[lo];
+        const float b = values[lo + (hi - lo) / 2];
+        const float c = values[hi];
+        const float pivot = a < b ? (b < c ? b : (a < c ? c : a)) : (a < c ? a : (b < c ? c : b));
+
+        ptrdiff_t i = lo;
+        ptrdiff_t j = hi;
+        while (i <= j)
+        {
+            while (values[i] < pivot)
+            {
+                i++;
+            }
+            while (values[j] > pivot)
+            {
+                j--;
+            }
+            if (i <= j)
+            {
+                const float tmp = values[i];
+                values[i] = values[j];
+                values[j] = tmp;
+                i++;
+                j--;
+            }
+        }
+
+        // [lo, j] holds no element above the pivot, [i, hi] none below, and anything between equals it
+        if (target <= j)
+        {
+            hi = j;
+        }
+        else if (target >= i)
+        {
+            lo = i;
+        }
+        else
+        {
+            return values[target];
+        }
+    }
+
+    return values[target];
+}
+
+static void gradient_compressor_topk_accumulate_f32(float *const residual, const float *const grad, float *const magnitudes, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        residual[i] += grad[i];
+        magnitudes[i] = fabsf(residual[i]);
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void gradient_compressor_topk_accumulate_avx_256_f32(float *const residual, const float *const grad, float *const magnitudes, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 v = _mm256_add_ps(_mm256_loadu_ps(&residual[i]), _mm256_loadu_ps(&grad[i]));
+        _mm256_storeu_ps(&residual[i], v);
+        _mm256_storeu_ps(&magnitudes[i], _mm256_and_ps(v, abs_mask));
+    }
+
+    // Handle remaining items
+    gradient_compressor_topk_accumulate_f32(&residual[i], &grad[i], &magnitudes[i], size - i);
+}
+#endif
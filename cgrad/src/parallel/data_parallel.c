@@ -0,0 +1,684 @@
+#include "cgrad/parallel/data_parallel.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/tensor/tensor_add_inplace.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/simd_support.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+static void *data_parallel_thread_run(void *arg);
+static void data_parallel_worker_run(struct data_parallel_worker *const worker);
+static void data_parallel_hogwild_run(struct data_parallel_worker *const worker);
+static void data_parallel_hogwild_update(const struct data_parallel_trainer *const trainer, struct data_parallel_worker *const worker);
+static void data_parallel_reduce_share(struct data_parallel_trainer *const trainer, const size_t worker_index, const size_t n_active);
+static void data_parallel_reduce_chunk(struct data_parallel_trainer *const trainer, const size_t param_index, const size_t start, const size_t end, const size_t n_active);
+static cgrad_error data_parallel_worker_init(struct data_parallel_trainer *const trainer, struct data_parallel_worker *const worker, const size_t index);
+static void data_parallel_worker_cleanup(struct data_parallel_worker *const worker);
+static void data_parallel_stop(struct data_parallel_trainer *const trainer, const size_t n_threads);
+static void *data_parallel_grad_alloc(const size_t size);
+static inline bool data_parallel_is_trainable(const struct tensor *const param);
+static cgrad_error data_parallel_barrier_init(struct data_parallel_barrier *const barrier, const size_t count);
+static void data_parallel_barrier_wait(struct data_parallel_barrier *const barrier);
+static void data_parallel_barrier_set_count(struct data_parallel_barrier *const barrier, const size_t count);
+static void data_parallel_barrier_cleanup(struct data_parallel_barrier *const barrier);
+static inline void data_parallel_sgd(void *const param, void *const grad, const size_t size, const double lr, const cgrad_dtype dtype);
+static void data_parallel_sgd_f64(double *const param, double *const grad, const size_t size, const double lr);
+static void data_parallel_sgd_f32(float *const param, float *const grad, const size_t size, const double lr);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void data_parallel_sgd_avx_256_f64(double *const param, double *const grad, const size_t size, const double lr);
+static void data_parallel_sgd_avx_256_f32(float *const param, float *const grad, const size_t size, const double lr);
+#endif
+
+cgrad_error data_parallel_init(struct data_parallel_trainer *trainer, struct model_params *const params, const size_t n_workers)
+{
+    if (!trainer)
+    {
+        return DATA_PARALLEL_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (n_workers == 0 || n_workers > DATA_PARALLEL_MAX_WORKERS)
+    {
+        return DATA_PARALLEL_INVALID_WORKERS;
+    }
+
+    trainer->params = params;
+    trainer->n_workers = n_workers;
+    trainer->loss = 0;
+    trainer->fn = NULL;
+    trainer->args = NULL;
+    trainer->batch_size = 0;
+    trainer->sample_fn = NULL;
+    trainer->n_steps = 0;
+    trainer->lr = 0;
+    atomic_init(&trainer->next_step, 0);
+    atomic_init(&trainer->has_failed, false);
+    trainer->is_hogwild = false;
+    trainer->is_stopping = false;
+
+    // Gradients of each worker are laid out as a flat buffer, every trainable parameter on its own aligned boundary
+    bool has_dtype = false;
+    cgrad_dtype dtype = DTYPE_FLOAT32;
+    size_t grad_size = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        trainer->grad_offsets[i] = grad_size;
+        if (!data_parallel_is_trainable(param))
+        {
+            continue;
+        }
+
+        if (!has_dtype)
+        {
+            dtype = param->dtype;
+            has_dtype = true;
+        }
+        if (param->dtype != dtype || param->grad->dtype != dtype || (dtype != DTYPE_FLOAT32 && dtype != DTYPE_FLOAT64))
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+
+        const size_t alignment = MODEL_PARAMS_FLAT_ALIGNMENT / dtype_sizeof(dtype);
+        grad_size += (param->data_size + alignment - 1) / alignment * alignment;
+    }
+    trainer->grad_size = grad_size;
+    trainer->dtype = dtype;
+
+    cgrad_error err = NO_ERROR;
+    for (size_t w = 0; w < n_workers; w++)
+    {
+        if ((err = data_parallel_worker_init(trainer, &trainer->workers[w], w)) != NO_ERROR)
+        {
+            for (size_t k = 0; k < w; k++)
+            {
+                data_parallel_worker_cleanup(&trainer->workers[k]);
+            }
+            return err;
+        }
+    }
+
+    if ((err = data_parallel_barrier_init(&trainer->barrier, n_workers)) != NO_ERROR)
+    {
+        for (size_t w = 0; w < n_workers; w++)
+        {
+            data_parallel_worker_cleanup(&trainer->workers[w]);
+        }
+        return err;
+    }
+
+    // The calling thread is worker 0
+    for (size_t w = 1; w < n_workers; w++)
+    {
+        if (pthread_create(&trainer->threads[w], NULL, data_parallel_thread_run, &trainer->workers[w]) != 0)
+        {
+            data_parallel_stop(trainer, w);
+            for (size_t k = 0; k < n_workers; k++)
+            {
+                data_parallel_worker_cleanup(&trainer->workers[k]);
+            }
+            data_parallel_barrier_cleanup(&trainer->barrier);
+            return DATA_PARALLEL_THREAD_CREATION_FAILED;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error data_parallel_step(struct data_parallel_trainer *trainer, const size_t batch_size, const data_parallel_shard_fn fn, void *const args)
+{
+    if (!trainer)
+    {
+        return DATA_PARALLEL_NULL;
+    }
+    if (!fn)
+    {
+        return INPUT_NULL;
+    }
+    if (batch_size == 0)
+    {
+        return INVALID_BATCH_SIZE;
+    }
+
+    trainer->fn = fn;
+    trainer->args = args;
+    trainer->batch_size = batch_size;
+    trainer->is_hogwild = false;
+
+    // Shards differ by at most one sample, workers beyond the batch size get none
+    const size_t n_workers = trainer->n_workers;
+    const size_t shard_size = batch_size / n_workers;
+    const size_t remainder = batch_size % n_workers;
+    size_t start = 0;
+    for (size_t w = 0; w < n_workers; w++)
+    {
+        struct data_parallel_worker *worker = &trainer->workers[w];
+        worker->shard_start = start;
+        worker->shard_end = start + shard_size + (w < remainder ? 1 : 0);
+        worker->loss = 0;
+        worker->error = NO_ERROR;
+        start = worker->shard_end;
+    }
+
+    // Releases the workers, which are done with the reduction when the calling thread is
+    data_parallel_barrier_wait(&trainer->barrier);
+    data_parallel_worker_run(&trainer->workers[0]);
+
+    trainer->loss = 0;
+    for (size_t w = 0; w < n_workers; w++)
+    {
+        const struct data_parallel_worker *worker = &trainer->workers[w];
+        if (worker->error != NO_ERROR)
+        {
+            return worker->error;
+        }
+        trainer->loss += worker->loss * (worker->shard_end - worker->shard_start) / batch_size;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error data_parallel_hogwild(struct data_parallel_trainer *trainer, const size_t n_steps, const double lr, const data_parallel_sample_fn fn, void *const args)
+{
+    if (!trainer)
+    {
+        return DATA_PARALLEL_NULL;
+    }
+    if (!fn)
+    {
+        return INPUT_NULL;
+    }
+
+    trainer->sample_fn = fn;
+    trainer->args = args;
+    trainer->n_steps = n_steps;
+    trainer->lr = lr;
+    atomic_store_explicit(&trainer->next_step, 0, memory_order_relaxed);
+    atomic_store_explicit(&trainer->has_failed, false, memory_order_relaxed);
+    trainer->is_hogwild = true;
+
+    for (size_t w = 0; w < trainer->n_workers; w++)
+    {
+        struct data_parallel_worker *worker = &trainer->workers[w];
+        worker->loss = 0;
+        worker->n_steps = 0;
+        worker->error = NO_ERROR;
+    }
+
+    data_parallel_barrier_wait(&trainer->barrier);
+    data_parallel_hogwild_run(&trainer->workers[0]);
+
+    trainer->loss = 0;
+    size_t n_reporting = 0;
+    for (size_t w = 0; w < trainer->n_workers; w++)
+    {
+        const struct data_parallel_worker *worker = &trainer->workers[w];
+        if (worker->error != NO_ERROR)
+        {
+            return worker->error;
+        }
+        if (worker->n_steps > 0)
+        {
+            trainer->loss += worker->loss;
+            n_reporting++;
+        }
+    }
+    trainer->loss = n_reporting > 0 ? trainer->loss / n_reporting : 0;
+
+    return NO_ERROR;
+}
+
+struct tensor *data_parallel_worker_replica(const struct data_parallel_worker *const worker, const struct tensor *const param)
+{
+    if (!worker || !param)
+    {
+        return NULL;
+    }
+
+    const struct model_params *params = worker->trainer->params;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (params->params[i] == param)
+        {
+            return worker->replicas[i];
+        }
+    }
+
+    return NULL;
+}
+
+cgrad_error data_parallel_worker_backward(struct data_parallel_worker *const worker, struct tensor *const loss)
+{
+    if (!worker)
+    {
+        return DATA_PARALLEL_NULL;
+    }
+    if (!loss)
+    {
+        return TENSOR_NULL;
+    }
+
+    // Mean losses of the shards, weighted by their share, add up to the mean loss of the batch
+    const double weight = (double)(worker->shard_end - worker->shard_start) / worker->trainer->batch_size;
+
+    return backward_scaled(loss, weight, &worker->allocs);
+}
+
+void data_parallel_cleanup(struct data_parallel_trainer *trainer)
+{
+    if (!trainer)
+    {
+        return;
+    }
+
+    data_parallel_stop(trainer, trainer->n_workers);
+    for (size_t w = 0; w < trainer->n_workers; w++)
+    {
+        data_parallel_worker_cleanup(&trainer->workers[w]);
+    }
+    data_parallel_barrier_cleanup(&trainer->barrier);
+}
+
+static void *data_parallel_thread_run(void *arg)
+{
+    struct data_parallel_worker *worker = (struct data_parallel_worker *)arg;
+    struct data_parallel_trainer *trainer = worker->trainer;
+
+    while (true)
+    {
+        data_parallel_barrier_wait(&trainer->barrier);
+        if (trainer->is_stopping)
+        {
+            break;
+        }
+
+        if (trainer->is_hogwild)
+        {
+            data_parallel_hogwild_run(worker);
+        }
+        else
+        {
+            data_parallel_worker_run(worker);
+        }
+    }
+
+    return NULL;
+}
+
+static void data_parallel_worker_run(struct data_parallel_worker *const worker)
+{
+    struct data_parallel_trainer *trainer = worker->trainer;
+    const size_t n_active = trainer->batch_size < trainer->n_workers ? trainer->batch_size : trainer->n_workers;
+
+    if (worker->index < n_active)
+    {
+        // Zeroed by the worker itself, so that its buffer starts in its own caches
+        memset(worker->grad_buffer, 0, trainer->grad_size * dtype_sizeof(trainer->dtype));
+        worker->error = trainer->fn(worker, worker->shard_start, worker->shard_end, trainer->args);
+    }
+    data_parallel_barrier_wait(&trainer->barrier);
+
+    // Every worker sees the same errors after the barrier, and all of them skip the reduction alike
+    bool has_error = false;
+    for (size_t w = 0; w < n_active; w++)
+    {
+        has_error = has_error || trainer->workers[w].error != NO_ERROR;
+    }
+    if (!has_error)
+    {
+        data_parallel_reduce_share(trainer, worker->index, n_active);
+    }
+    data_parallel_barrier_wait(&trainer->barrier);
+}
+
+static void data_parallel_hogwild_run(struct data_parallel_worker *const worker)
+{
+    struct data_parallel_trainer *trainer = worker->trainer;
+
+    // Kept zero between steps by the update, which clears the gradients it consumed
+    memset(worker->grad_buffer, 0, trainer->grad_size * dtype_sizeof(trainer->dtype));
+
+    // Steps are claimed one at a time, so that faster workers take more of them
+    while (!atomic_load_explicit(&trainer->has_failed, memory_order_relaxed))
+    {
+        const size_t step = atomic_fetch_add_explicit(&trainer->next_step, 1, memory_order_relaxed);
+        if (step >= trainer->n_steps)
+        {
+            break;
+        }
+
+        if ((worker->error = trainer->sample_fn(worker, step, trainer->args)) != NO_ERROR)
+        {
+            atomic_store_explicit(&trainer->has_failed, true, memory_order_relaxed);
+            break;
+        }
+        data_parallel_hogwild_update(trainer, worker);
+        worker->n_steps++;
+    }
+
+    data_parallel_barrier_wait(&trainer->barrier);
+}
+
+static void data_parallel_hogwild_update(const struct data_parallel_trainer *const trainer, struct data_parallel_worker *const worker)
+{
+    const struct model_params *params = trainer->params;
+    const size_t dtype_size = dtype_sizeof(trainer->dtype);
+
+    // Racy on purpose: other workers read and update the same parameters meanwhile
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (!worker->replicas[i]->grad)
+        {
+            continue;
+        }
+
+        struct tensor *param = params->params[i];
+        char *grad_data = (char *)worker->grad_buffer + trainer->grad_offsets[i] * dtype_size;
+        data_parallel_sgd(param->data, grad_data, param->data_size, trainer->lr, trainer->dtype);
+    }
+}
+
+static void data_parallel_reduce_share(struct data_parallel_trainer *const trainer, const size_t worker_index, const size_t n_active)
+{
+    const struct model_params *params = trainer->params;
+
+    // Chunks are dealt round-robin, so that every worker, with or without a shard, sums a similar amount of elements
+    size_t chunk = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (!trainer->workers[0].replicas[i]->grad)
+        {
+            continue;
+        }
+
+        const size_t size = params->params[i]->data_size;
+        for (size_t start = 0; start < size; start += DATA_PARALLEL_REDUCE_CHUNK_SIZE, chunk++)
+        {
+            if (chunk % trainer->n_workers != worker_index)
+            {
+                continue;
+            }
+            const size_t end = start + DATA_PARALLEL_REDUCE_CHUNK_SIZE < size ? start + DATA_PARALLEL_REDUCE_CHUNK_SIZE : size;
+            data_parallel_reduce_chunk(trainer, i, start, end, n_active);
+        }
+    }
+}
+
+static void data_parallel_reduce_chunk(struct data_parallel_trainer *const trainer, const size_t param_index, const size_t start, const size_t end, const size_t n_active)
+{
+    const cgrad_dtype dtype = trainer->dtype;
+    const size_t dtype_size = dtype_sizeof(dtype);
+    const size_t offset = (trainer->grad_offsets[param_index] + start) * dtype_size;
+    const size_t size = end - start;
+
+    // Pairwise tree: at each level, every other remaining buffer gets the next one added
+    for (size_t stride = 1; stride < n_active; stride *= 2)
+    {
+        for (size_t w = 0; w + stride < n_active; w += 2 * stride)
+        {
+            char *dst = (char *)trainer->workers[w].grad_buffer + offset;
+            const char *src = (const char *)trainer->workers[w + stride].grad_buffer + offset;
+            tensor_data_add_inplace(dst, src, size, dtype);
+        }
+    }
+
+    struct tensor *grad = trainer->params->params[param_index]->grad;
+    tensor_data_add_inplace((char *)grad->data + start * dtype_size, (const char *)trainer->workers[0].grad_buffer + offset, size, dtype);
+}
+
+static cgrad_error data_parallel_worker_init(struct data_parallel_trainer *const trainer, struct data_parallel_worker *const worker, const size_t index)
+{
+    worker->index = index;
+    worker->trainer = trainer;
+    worker->grad_buffer = NULL;
+    worker->shard_start = 0;
+    worker->shard_end = 0;
+    worker->loss = 0;
+    worker->n_steps = 0;
+    worker->error = NO_ERROR;
+    memset(worker->replicas, 0, sizeof(worker->replicas));
+
+    // Workers split the chunks of a single pool, so that the address space reserved does not grow with their number
+    const size_t n_pool_chunks = MEMORY_TENSOR_POOL_N_CHUNKS / trainer->n_workers;
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_cpu_allocator_init_with_chunks(&worker->tensor_alloc, n_pool_chunks > DATA_PARALLEL_MIN_WORKER_POOL_CHUNKS ? n_pool_chunks : DATA_PARALLEL_MIN_WORKER_POOL_CHUNKS)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = computational_graph_cpu_allocator_init(&worker->graph_alloc)) != NO_ERROR)
+    {
+        tensor_cpu_allocator_cleanup(&worker->tensor_alloc);
+        return err;
+    }
+    worker->allocs = (struct allocators){.tensor_alloc = &worker->tensor_alloc, .graph_alloc = &worker->graph_alloc, .tape = NULL};
+
+    const size_t dtype_size = dtype_sizeof(trainer->dtype);
+    worker->grad_buffer = data_parallel_grad_alloc(trainer->grad_size * dtype_size);
+    if (!worker->grad_buffer)
+    {
+        data_parallel_worker_cleanup(worker);
+        return DATA_PARALLEL_ALLOCATION_FAILED;
+    }
+
+    const struct model_params *params = trainer->params;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        const bool is_trainable = data_parallel_is_trainable(param);
+
+        struct tensor *replica = is_trainable
+            ? tensor_allocator_alloc(&worker->tensor_alloc, param->shape, param->shape_size, param->dtype)
+            : tensor_allocator_no_grad_alloc(&worker->tensor_alloc, param->shape, param->shape_size, param->dtype);
+        if (!replica)
+        {
+            data_parallel_worker_cleanup(worker);
+            return TENSOR_ALLOCATION_FAILED;
+        }
+        worker->replicas[i] = replica;
+
+        // Replicas read the data of the shared parameter in place
+        tensor_allocator_free_data(&worker->tensor_alloc, replica);
+        replica->data = param->data;
+        replica->is_view = true;
+        replica->requires_grad = is_trainable;
+
+        if (is_trainable)
+        {
+            struct tensor *grad = replica->grad;
+            tensor_allocator_free_data(&worker->tensor_alloc, grad);
+            grad->data = (char *)worker->grad_buffer + trainer->grad_offsets[i] * dtype_size;
+            grad->is_view = true;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static void data_parallel_worker_cleanup(struct data_parallel_worker *const worker)
+{
+    for (size_t i = 0; i < MODEL_MAX_PARAMS; i++)
+    {
+        if (worker->replicas[i])
+        {
+            tensor_allocator_free(&worker->tensor_alloc, worker->replicas[i]);
+            worker->replicas[i] = NULL;
+        }
+    }
+
+    free(worker->grad_buffer);
+    worker->grad_buffer = NULL;
+
+    computational_graph_cpu_allocator_cleanup(&worker->graph_alloc);
+    tensor_cpu_allocator_cleanup(&worker->tensor_alloc);
+}
+
+static void data_parallel_stop(struct data_parallel_trainer *const trainer, const size_t n_threads)
+{
+    // Threads that never started cannot reach the barrier, the calling thread completes it alone
+    trainer->is_stopping = true;
+    data_parallel_barrier_set_count(&trainer->barrier, n_threads);
+    data_parallel_barrier_wait(&trainer->barrier);
+
+    for (size_t w = 1; w < n_threads; w++)
+    {
+        pthread_join(trainer->threads[w], NULL);
+    }
+}
+
+static void *data_parallel_grad_alloc(const size_t size)
+{
+    // aligned_alloc requires a multiple of the alignment
+    const size_t rounded_size = (size + MODEL_PARAMS_FLAT_ALIGNMENT - 1) / MODEL_PARAMS_FLAT_ALIGNMENT * MODEL_PARAMS_FLAT_ALIGNMENT;
+    return aligned_alloc(MODEL_PARAMS_FLAT_ALIGNMENT, rounded_size > 0 ? rounded_size : MODEL_PARAMS_FLAT_ALIGNMENT);
+}
+
+static inline bool data_parallel_is_trainable(const struct tensor *const param)
+{
+    return param->requires_grad && param->grad != NULL;
+}
+
+static cgrad_error data_parallel_barrier_init(struct data_parallel_barrier *const barrier, const size_t count)
+{
+    if (pthread_mutex_init(&barrier->mutex, NULL) != 0)
+    {
+        return DATA_PARALLEL_ALLOCATION_FAILED;
+    }
+    if (pthread_cond_init(&barrier->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&barrier->mutex);
+        return DATA_PARALLEL_ALLOCATION_FAILED;
+    }
+
+    barrier->count = count;
+    barrier->waiting = 0;
+    barrier->generation = 0;
+
+    return NO_ERROR;
+}
+
+static void data_parallel_barrier_wait(struct data_parallel_barrier *const barrier)
+{
+    pthread_mutex_lock(&barrier->mutex);
+
+    const size_t generation = barrier->generation;
+    barrier->waiting++;
+    if (barrier->waiting == barrier->count)
+    {
+        // The last thread to arrive releases the others
+        barrier->waiting = 0;
+        barrier->generation++;
+        pthread_cond_broadcast(&barrier->cond);
+    }
+    else
+    {
+        // Spurious wake-ups leave the generation unchanged
+        while (generation == barrier->generation)
+        {
+            pthread_cond_wait(&barrier->cond, &barrier->mutex);
+        }
+    }
+
+    pthread_mutex_unlock(&barrier->mutex);
+}
+
+static void data_parallel_barrier_set_count(struct data_parallel_barrier *const barrier, const size_t count)
+{
+    pthread_mutex_lock(&barrier->mutex);
+    barrier->count = count;
+    pthread_mutex_unlock(&barrier->mutex);
+}
+
+static void data_parallel_barrier_cleanup(struct data_parallel_barrier *const barrier)
+{
+    pthread_cond_destroy(&barrier->cond);
+    pthread_mutex_destroy(&barrier->mutex);
+}
+
+static inline void data_parallel_sgd(void *const param, void *const grad, const size_t size, const double lr, const cgrad_dtype dtype)
+{
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        data_parallel_sgd_avx_256_f64((double *)param, (double *)grad, size, lr);
+#else
+        data_parallel_sgd_f64((double *)param, (double *)grad, size, lr);
+#endif
+        break;
+    case DTYPE_FLOAT32:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        data_parallel_sgd_avx_256_f32((float *)param, (float *)grad, size, lr);
+#else
+        data_parallel_sgd_f32((float *)param, (float *)grad, size, lr);
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+// Updates the parameters and clears the gradients in the same pass
+static void data_parallel_sgd_f64(double *const param, double *const grad, const size_t size, const double lr)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        param[i] -= lr * grad[i];
+        grad[i] = 0;
+    }
+}
+
+static void data_parallel_sgd_f32(float *const param, float *const grad, const size_t size, const double lr)
+{
+    const float lr_f32 = (float)lr;
+    for (size_t i = 0; i < size; i++)
+    {
+        param[i] -= lr_f32 * grad[i];
+        grad[i] = 0;
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void data_parallel_sgd_avx_256_f64(double *const param, double *const grad, const size_t size, const double lr)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+    const __m256d lr_vec = _mm256_set1_pd(lr);
+    const __m256d zero = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d updated = _mm256_sub_pd(_mm256_loadu_pd(&param[i]), _mm256_mul_pd(lr_vec, _mm256_loadu_pd(&grad[i])));
+        _mm256_storeu_pd(&param[i], updated);
+        _mm256_storeu_pd(&grad[i], zero);
+    }
+
+    // Handle remaining items
+    data_parallel_sgd_f64(&param[i], &grad[i], size - i, lr);
+}
+
+static void data_parallel_sgd_avx_256_f32(float *const param, float *const grad, const size_t size, const double lr)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+    const __m256 lr_vec = _mm256_set1_ps((float)lr);
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 updated = _mm256_sub_ps(_mm256_loadu_ps(&param[i]), _mm256_mul_ps(lr_vec, _mm256_loadu_ps(&grad[i])));
+        _mm256_storeu_ps(&param[i], updated);
+        _mm256_storeu_ps(&grad[i], zero);
+    }
+
+    // Handle remaining items
+    data_parallel_sgd_f32(&param[i], &grad[i], size - i, lr);
+}
+#endif
@@ -0,0 +1,345 @@
+#include "cgrad/parallel/distributed.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void *distributed_thread_run(void *arg);
+static void distributed_grad_ready(struct tensor *const t, void *args);
+static void distributed_remove_hooks(struct distributed_trainer *const dist);
+static void distributed_mark_ready(struct distributed_trainer *const dist, const size_t param_index);
+static void distributed_build_buckets(struct distributed_trainer *const dist);
+static cgrad_error distributed_exchange(struct distributed_trainer *const dist, const struct distributed_bucket *const bucket);
+static cgrad_error distributed_exchange_compressed(struct distributed_trainer *const dist, const struct distributed_bucket *const bucket);
+
+cgrad_error distributed_init(struct distributed_trainer *dist, struct model_params *const params, struct communicator *const comm)
+{
+    if (!dist)
+    {
+        return DISTRIBUTED_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!comm)
+    {
+        return COMMUNICATOR_NULL;
+    }
+    if (!model_params_is_flat(params))
+    {
+        return DISTRIBUTED_PARAMS_NOT_FLAT;
+    }
+    if (params->flat_dtype != DTYPE_FLOAT32 && params->flat_dtype != DTYPE_FLOAT64)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    memset(dist, 0, sizeof(struct distributed_trainer));
+    dist->params = params;
+    dist->comm = comm;
+    distributed_build_buckets(dist);
+
+    // Buckets are sent as soon as backward finalizes the gradients of all of their parameters
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if (!dist->is_trainable[i])
+        {
+            continue;
+        }
+
+        const cgrad_error err = backward_register_grad_hook(params->params[i], distributed_grad_ready, dist);
+        if (err != NO_ERROR)
+        {
+            distributed_remove_hooks(dist);
+            return err;
+        }
+    }
+
+    // Nothing is pending until the first backward
+    dist->n_reduced = dist->n_buckets;
+
+    if (pthread_mutex_init(&dist->mutex, NULL) != 0)
+    {
+        distributed_remove_hooks(dist);
+        return DISTRIBUTED_THREAD_CREATION_FAILED;
+    }
+    if (pthread_cond_init(&dist->ready_cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&dist->mutex);
+        distributed_remove_hooks(dist);
+        return DISTRIBUTED_THREAD_CREATION_FAILED;
+    }
+    if (pthread_cond_init(&dist->done_cond, NULL) != 0)
+    {
+        pthread_cond_destroy(&dist->ready_cond);
+        pthread_mutex_destroy(&dist->mutex);
+        distributed_remove_hooks(dist);
+        return DISTRIBUTED_THREAD_CREATION_FAILED;
+    }
+    if (pthread_create(&dist->thread, NULL, distributed_thread_run, dist) != 0)
+    {
+        pthread_cond_destroy(&dist->done_cond);
+        pthread_cond_destroy(&dist->ready_cond);
+        pthread_mutex_destroy(&dist->mutex);
+        distributed_remove_hooks(dist);
+        return DISTRIBUTED_THREAD_CREATION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error distributed_set_compressor(struct distributed_trainer *dist, struct gradient_compressor *const compressor)
+{
+    if (!dist)
+    {
+        return DISTRIBUTED_NULL;
+    }
+
+    free(dist->messages);
+    dist->messages = NULL;
+    dist->compressor = NULL;
+    if (!compressor)
+    {
+        return NO_ERROR;
+    }
+    if (dist->params->flat_dtype != DTYPE_FLOAT32)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    // Room for the largest bucket
+    size_t message_size = 0;
+    for (size_t b = 0; b < dist->n_buckets; b++)
+    {
+        const size_t size = gradient_compressor_message_size(compressor, dist->buckets[b].size);
+        message_size = size > message_size ? size : message_size;
+    }
+
+    dist->messages = malloc((message_size > 0 ? message_size : 1) * dist->comm->world_size);
+    if (!dist->messages)
+    {
+        return DISTRIBUTED_ALLOCATION_FAILED;
+    }
+    dist->compressor = compressor;
+
+    return NO_ERROR;
+}
+
+cgrad_error distributed_backward(struct distributed_trainer *dist, struct tensor *const loss, const double loss_scale, struct allocators *allocs)
+{
+    if (!dist)
+    {
+        return DISTRIBUTED_NULL;
+    }
+
+    pthread_mutex_lock(&dist->mutex);
+    for (size_t b = 0; b < dist->n_buckets; b++)
+    {
+        dist->buckets[b].n_ready = 0;
+    }
+    memset(dist->is_ready, 0, sizeof(dist->is_ready));
+    dist->n_reduced = 0;
+    dist->error = NO_ERROR;
+    pthread_mutex_unlock(&dist->mutex);
+
+    // Buckets without trainable parameters are ready at once
+    pthread_cond_signal(&dist->ready_cond);
+
+    cgrad_error err = NO_ERROR;
+    if (loss)
+    {
+        err = backward_scaled(loss, loss_scale, allocs);
+    }
+
+    // Gradients that backward did not reach are final as they are, and every rank must send them anyway
+    for (size_t i = 0; i < dist->params->size; i++)
+    {
+        if (dist->is_trainable[i] && !dist->is_ready[i])
+        {
+            distributed_mark_ready(dist, i);
+        }
+    }
+
+    pthread_mutex_lock(&dist->mutex);
+    while (dist->n_reduced < dist->n_buckets)
+    {
+        pthread_cond_wait(&dist->done_cond, &dist->mutex);
+    }
+    const cgrad_error comm_err = dist->error;
+    pthread_mutex_unlock(&dist->mutex);
+
+    return err != NO_ERROR ? err : comm_err;
+}
+
+void distributed_cleanup(struct distributed_trainer *dist)
+{
+    if (!dist || !dist->params)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&dist->mutex);
+    dist->is_stopping = true;
+    pthread_mutex_unlock(&dist->mutex);
+    pthread_cond_signal(&dist->ready_cond);
+    pthread_join(dist->thread, NULL);
+
+    pthread_cond_destroy(&dist->done_cond);
+    pthread_cond_destroy(&dist->ready_cond);
+    pthread_mutex_destroy(&dist->mutex);
+    distributed_remove_hooks(dist);
+    free(dist->messages);
+    dist->messages = NULL;
+    dist->params = NULL;
+}
+
+static void *distributed_thread_run(void *arg)
+{
+    struct distributed_trainer *dist = (struct distributed_trainer *)arg;
+    pthread_mutex_lock(&dist->mutex);
+    while (true)
+    {
+        while (!dist->is_stopping &&
+               (dist->n_reduced == dist->n_buckets || dist->buckets[dist->n_reduced].n_ready < dist->buckets[dist->n_reduced].n_params))
+        {
+            pthread_cond_wait(&dist->ready_cond, &dist->mutex);
+        }
+        if (dist->is_stopping)
+        {
+            break;
+        }
+
+        const struct distributed_bucket bucket = dist->buckets[dist->n_reduced];
+        const bool has_failed = dist->error != NO_ERROR;
+        pthread_mutex_unlock(&dist->mutex);
+
+        // Backward no longer writes to the bucket, and reads nothing from it
+        cgrad_error err = NO_ERROR;
+        if (!has_failed)
+        {
+            err = dist->compressor ? distributed_exchange_compressed(dist, &bucket) : distributed_exchange(dist, &bucket);
+        }
+
+        pthread_mutex_lock(&dist->mutex);
+        if (err != NO_ERROR && dist->error == NO_ERROR)
+        {
+            dist->error = err;
+        }
+        dist->n_reduced++;
+        if (dist->n_reduced == dist->n_buckets)
+        {
+            pthread_cond_signal(&dist->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&dist->mutex);
+
+    return NULL;
+}
+
+static cgrad_error distributed_exchange(struct distributed_trainer *const dist, const struct distributed_bucket *const bucket)
+{
+    struct model_params *params = dist->params;
+    const size_t dtype_size = dtype_sizeof(params->flat_dtype);
+
+    dist->payload_bytes += bucket->size * dtype_size;
+    return communicator_all_reduce(dist->comm, (char *)params->flat_grad + bucket->offset * dtype_size, bucket->size, params->flat_dtype);
+}
+
+static cgrad_error distributed_exchange_compressed(struct distributed_trainer *const dist, const struct distributed_bucket *const bucket)
+{
+    struct gradient_compressor *compressor = dist->compressor;
+    float *grad = (float *)dist->params->flat_grad + bucket->offset;
+
+    const size_t message_size = gradient_compressor_message_size(compressor, bucket->size);
+    char *messages = (char *)dist->messages;
+
+    cgrad_error err = NO_ERROR;
+    if ((err = gradient_compressor_compress(compressor, grad, bucket->offset, bucket->size, messages + dist->comm->rank * message_size)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    dist->payload_bytes += message_size;
+    if ((err = communicator_all_gather(dist->comm, messages, message_size)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Same messages in the same order, every rank gets the same bits
+    memset(grad, 0, bucket->size * sizeof(float));
+    for (size_t r = 0; r < dist->comm->world_size; r++)
+    {
+        gradient_compressor_decompress_add(compressor, messages + r * message_size, bucket->size, grad);
+    }
+
+    return NO_ERROR;
+}
+
+static void distributed_grad_ready(struct tensor *const t, void *args)
+{
+    struct distributed_trainer *dist = (struct distributed_trainer *)args;
+    for (size_t i = 0; i < dist->params->size; i++)
+    {
+        if (dist->params->params[i] == t)
+        {
+            if (dist->is_trainable[i] && !dist->is_ready[i])
+            {
+                distributed_mark_ready(dist, i);
+            }
+            return;
+        }
+    }
+}
+
+static void distributed_remove_hooks(struct distributed_trainer *const dist)
+{
+    for (size_t i = 0; i < dist->params->size; i++)
+    {
+        // Parameters whose registration failed have no hook to remove
+        backward_remove_grad_hook(dist->params->params[i], distributed_grad_ready, dist);
+    }
+}
+
+static void distributed_mark_ready(struct distributed_trainer *const dist, const size_t param_index)
+{
+    dist->is_ready[param_index] = true;
+
+    pthread_mutex_lock(&dist->mutex);
+    struct distributed_bucket *bucket = &dist->buckets[dist->param_buckets[param_index]];
+    bucket->n_ready++;
+    const bool is_bucket_ready = bucket->n_ready == bucket->n_params;
+    pthread_mutex_unlock(&dist->mutex);
+
+    if (is_bucket_ready)
+    {
+        pthread_cond_signal(&dist->ready_cond);
+    }
+}
+
+static void distributed_build_buckets(struct distributed_trainer *const dist)
+{
+    struct model_params *params = dist->params;
+
+    // Last parameters first, their gradients are final first
+    size_t end = 0;
+    for (size_t i = params->size; i-- > 0;)
+    {
+        const struct tensor *param = params->params[i];
+        const size_t offset = params->flat_offsets[i];
+        dist->is_trainable[i] = param->requires_grad && param->grad != NULL;
+
+        struct distributed_bucket *bucket = &dist->buckets[dist->n_buckets > 0 ? dist->n_buckets - 1 : 0];
+        const bool is_full = dist->n_buckets > 0 && end - offset > DISTRIBUTED_BUCKET_SIZE;
+        if (dist->n_buckets == 0 || is_full)
+        {
+            bucket = &dist->buckets[dist->n_buckets++];
+            end = offset + param->data_size;
+        }
+
+        bucket->offset = offset;
+        bucket->size = end - offset;
+        bucket->n_params += dist->is_trainable[i];
+        dist->param_buckets[i] = dist->n_buckets - 1;
+    }
+}
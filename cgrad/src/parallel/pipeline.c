@@ -0,0 +1,566 @@
+#define _GNU_SOURCE
+#include "cgrad/parallel/pipeline.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Copy of a tensor crossing a stage boundary, so that each stage only ever allocates and frees tensors
+ * of its own allocators.
+ */
+struct pipeline_message
+{
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    size_t shape_size;
+    cgrad_dtype dtype;
+    size_t data_size;
+    max_align_t data[];
+};
+
+static void *pipeline_thread_run(void *arg);
+static void pipeline_stage_run(struct pipeline_stage *const stage);
+static cgrad_error pipeline_stage_forward(struct pipeline_stage *const stage, const size_t micro);
+static cgrad_error pipeline_stage_backward(struct pipeline_stage *const stage, const size_t micro);
+static void pipeline_stage_release(struct pipeline_stage *const stage, const size_t slot);
+static void pipeline_stage_pin(const struct pipeline_stage *const stage);
+static cgrad_error pipeline_stage_init(struct pipeline *const pipe, struct pipeline_stage *const stage, const size_t index, const pipeline_stage_fn fn, void *const args);
+static void pipeline_stage_cleanup(struct pipeline_stage *const stage);
+static void pipeline_stop(struct pipeline *const pipe, const size_t n_threads);
+static void pipeline_drain(struct pipeline *const pipe);
+static void pipeline_find_cpus(struct pipeline *const pipe);
+static inline void pipeline_micro_range(const struct pipeline *const pipe, const size_t micro, size_t *const start, size_t *const end);
+static cgrad_error pipeline_send(struct pipeline *const pipe, struct spsc_queue *const queue, const struct tensor *const t);
+static cgrad_error pipeline_receive(struct pipeline_stage *const stage, struct spsc_queue *const queue, const bool requires_grad, struct tensor **const t);
+
+cgrad_error pipeline_init(struct pipeline *pipe, const size_t n_stages, const pipeline_stage_fn *const fns, void *const *const args)
+{
+    if (!pipe)
+    {
+        return PIPELINE_NULL;
+    }
+    if (!fns)
+    {
+        return INPUT_NULL;
+    }
+    if (n_stages == 0 || n_stages > PIPELINE_MAX_STAGES)
+    {
+        return PIPELINE_INVALID_STAGES;
+    }
+    for (size_t s = 0; s < n_stages; s++)
+    {
+        if (!fns[s])
+        {
+            return INPUT_NULL;
+        }
+    }
+
+    pipe->n_stages = n_stages;
+    pipe->generation = 0;
+    pipe->n_done = 0;
+    pipe->batch_size = 0;
+    pipe->n_micro_batches = 0;
+    pipe->loss = 0;
+    atomic_init(&pipe->has_failed, false);
+    pipe->is_stopping = false;
+    for (size_t s = 0; s < n_stages; s++)
+    {
+        spsc_queue_init(&pipe->forward_queues[s]);
+        spsc_queue_init(&pipe->backward_queues[s]);
+    }
+    pipeline_find_cpus(pipe);
+
+    cgrad_error err = NO_ERROR;
+    for (size_t s = 0; s < n_stages; s++)
+    {
+        if ((err = pipeline_stage_init(pipe, &pipe->stages[s], s, fns[s], args ? args[s] : NULL)) != NO_ERROR)
+        {
+            for (size_t k = 0; k < s; k++)
+            {
+                pipeline_stage_cleanup(&pipe->stages[k]);
+            }
+            free(pipe->cpus);
+            return err;
+        }
+    }
+
+    pthread_mutex_init(&pipe->mutex, NULL);
+    pthread_cond_init(&pipe->start_cond, NULL);
+    pthread_cond_init(&pipe->done_cond, NULL);
+
+    for (size_t s = 0; s < n_stages; s++)
+    {
+        if (pthread_create(&pipe->threads[s], NULL, pipeline_thread_run, &pipe->stages[s]) != 0)
+        {
+            pipeline_stop(pipe, s);
+            for (size_t k = 0; k < n_stages; k++)
+            {
+                pipeline_stage_cleanup(&pipe->stages[k]);
+            }
+            pthread_mutex_destroy(&pipe->mutex);
+            pthread_cond_destroy(&pipe->start_cond);
+            pthread_cond_destroy(&pipe->done_cond);
+            free(pipe->cpus);
+            return PIPELINE_THREAD_CREATION_FAILED;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error pipeline_step(struct pipeline *pipe, const size_t batch_size, const size_t n_micro_batches)
+{
+    if (!pipe)
+    {
+        return PIPELINE_NULL;
+    }
+    if (batch_size == 0)
+    {
+        return INVALID_BATCH_SIZE;
+    }
+    if (n_micro_batches == 0 || n_micro_batches > batch_size)
+    {
+        return PIPELINE_INVALID_MICRO_BATCHES;
+    }
+
+    pipe->batch_size = batch_size;
+    pipe->n_micro_batches = n_micro_batches;
+    pipe->loss = 0;
+    atomic_store_explicit(&pipe->has_failed, false, memory_order_relaxed);
+    for (size_t s = 0; s < pipe->n_stages; s++)
+    {
+        pipe->stages[s].error = NO_ERROR;
+    }
+
+    pthread_mutex_lock(&pipe->mutex);
+    pipe->n_done = 0;
+    pipe->generation++;
+    pthread_cond_broadcast(&pipe->start_cond);
+    while (pipe->n_done < pipe->n_stages)
+    {
+        pthread_cond_wait(&pipe->done_cond, &pipe->mutex);
+    }
+    pthread_mutex_unlock(&pipe->mutex);
+
+    if (!atomic_load_explicit(&pipe->has_failed, memory_order_relaxed))
+    {
+        return NO_ERROR;
+    }
+
+    // Messages of the micro-batches abandoned midway are left in the queues
+    pipeline_drain(pipe);
+
+    // Stages that gave up because of another one report PIPELINE_ABORTED, the cause is the other error
+    for (size_t s = 0; s < pipe->n_stages; s++)
+    {
+        const cgrad_error stage_err = pipe->stages[s].error;
+        if (stage_err != NO_ERROR && stage_err != PIPELINE_ABORTED)
+        {
+            return stage_err;
+        }
+    }
+
+    return PIPELINE_ABORTED;
+}
+
+void pipeline_cleanup(struct pipeline *pipe)
+{
+    if (!pipe)
+    {
+        return;
+    }
+
+    pipeline_stop(pipe, pipe->n_stages);
+    for (size_t s = 0; s < pipe->n_stages; s++)
+    {
+        pipeline_stage_cleanup(&pipe->stages[s]);
+    }
+    pthread_mutex_destroy(&pipe->mutex);
+    pthread_cond_destroy(&pipe->start_cond);
+    pthread_cond_destroy(&pipe->done_cond);
+    free(pipe->cpus);
+}
+
+static void *pipeline_thread_run(void *arg)
+{
+    struct pipeline_stage *stage = (struct pipeline_stage *)arg;
+    struct pipeline *pipe = stage->pipe;
+
+    pipeline_stage_pin(stage);
+
+    size_t generation = 0;
+    while (true)
+    {
+        pthread_mutex_lock(&pipe->mutex);
+        while (pipe->generation == generation && !pipe->is_stopping)
+        {
+            pthread_cond_wait(&pipe->start_cond, &pipe->mutex);
+        }
+        generation = pipe->generation;
+        const bool is_stopping = pipe->is_stopping;
+        pthread_mutex_unlock(&pipe->mutex);
+
+        if (is_stopping)
+        {
+            break;
+        }
+
+        pipeline_stage_run(stage);
+
+        pthread_mutex_lock(&pipe->mutex);
+        pipe->n_done++;
+        pthread_cond_signal(&pipe->done_cond);
+        pthread_mutex_unlock(&pipe->mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * One-forward-one-backward schedule. Stage s runs n_stages - s - 1 forwards ahead, the number of
+ * micro-batches downstream stages need to fill up, so that the backward of the first micro-batch
+ * reaches it when it is done with them.
+ */
+static void pipeline_stage_run(struct pipeline_stage *const stage)
+{
+    struct pipeline *pipe = stage->pipe;
+    const size_t n_micro_batches = pipe->n_micro_batches;
+    const size_t n_ahead = pipe->n_stages - stage->index - 1;
+    const size_t n_warmup = n_ahead < n_micro_batches ? n_ahead : n_micro_batches;
+
+    size_t n_forwards = 0;
+    size_t n_backwards = 0;
+    cgrad_error err = NO_ERROR;
+
+    while (n_forwards < n_warmup && err == NO_ERROR)
+    {
+        err = pipeline_stage_forward(stage, n_forwards++);
+    }
+    while (n_forwards < n_micro_batches && err == NO_ERROR)
+    {
+        if ((err = pipeline_stage_forward(stage, n_forwards++)) == NO_ERROR)
+        {
+            err = pipeline_stage_backward(stage, n_backwards++);
+        }
+    }
+    while (n_backwards < n_micro_batches && err == NO_ERROR)
+    {
+        err = pipeline_stage_backward(stage, n_backwards++);
+    }
+
+    if (err != NO_ERROR)
+    {
+        stage->error = err;
+        atomic_store_explicit(&pipe->has_failed, true, memory_order_relaxed);
+
+        // Micro-batches in flight are abandoned, their graphs go with the allocators at cleanup
+        for (size_t slot = 0; slot < PIPELINE_MAX_STAGES; slot++)
+        {
+            pipeline_stage_release(stage, slot);
+        }
+    }
+}
+
+static cgrad_error pipeline_stage_forward(struct pipeline_stage *const stage, const size_t micro)
+{
+    struct pipeline *pipe = stage->pipe;
+    const size_t slot = micro % PIPELINE_MAX_STAGES;
+    const bool is_last = stage->index == pipe->n_stages - 1;
+
+    size_t start = 0;
+    size_t end = 0;
+    pipeline_micro_range(pipe, micro, &start, &end);
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *input = NULL;
+    if (stage->index > 0 && (err = pipeline_receive(stage, &pipe->forward_queues[stage->index - 1], true, &input)) != NO_ERROR)
+    {
+        return err;
+    }
+    stage->inputs[slot] = input;
+
+    struct tensor *output = NULL;
+    if ((err = stage->fn(stage, start, end, input, &output, stage->args)) != NO_ERROR)
+    {
+        return err;
+    }
+    stage->outputs[slot] = output;
+    if (!output || (is_last && output->data_size != 1))
+    {
+        return PIPELINE_INVALID_OUTPUT;
+    }
+
+    if (!is_last)
+    {
+        return pipeline_send(pipe, &pipe->forward_queues[stage->index], output);
+    }
+
+    double loss = 0;
+    switch (output->dtype)
+    {
+    case DTYPE_FLOAT64:
+        loss = ((double *)output->data)[0];
+        break;
+    case DTYPE_FLOAT32:
+        loss = ((float *)output->data)[0];
+        break;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+    pipe->loss += loss * (end - start) / pipe->batch_size;
+
+    return NO_ERROR;
+}
+
+static cgrad_error pipeline_stage_backward(struct pipeline_stage *const stage, const size_t micro)
+{
+    struct pipeline *pipe = stage->pipe;
+    const size_t slot = micro % PIPELINE_MAX_STAGES;
+    const bool is_last = stage->index == pipe->n_stages - 1;
+
+    cgrad_error err = NO_ERROR;
+    if (is_last)
+    {
+        // Mean losses of the micro-batches, weighted by their share, add up to the mean loss of the batch
+        size_t start = 0;
+        size_t end = 0;
+        pipeline_micro_range(pipe, micro, &start, &end);
+        err = backward_scaled(stage->outputs[slot], (double)(end - start) / pipe->batch_size, &stage->allocs);
+    }
+    else
+    {
+        struct tensor *grad = NULL;
+        if ((err = pipeline_receive(stage, &pipe->backward_queues[stage->index], false, &grad)) != NO_ERROR)
+        {
+            return err;
+        }
+        err = backward_with_gradient(stage->outputs[slot], grad, &stage->allocs);
+        tensor_allocator_no_grad_free(&stage->tensor_alloc, grad);
+    }
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The input is a leaf of the graph of the stage, so it holds its whole gradient after backward
+    struct tensor *input = stage->inputs[slot];
+    if (input && (err = pipeline_send(pipe, &pipe->backward_queues[stage->index - 1], input->grad)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    pipeline_stage_release(stage, slot);
+    return NO_ERROR;
+}
+
+static void pipeline_stage_release(struct pipeline_stage *const stage, const size_t slot)
+{
+    if (stage->inputs[slot])
+    {
+        tensor_allocator_free(&stage->tensor_alloc, stage->inputs[slot]);
+        stage->inputs[slot] = NULL;
+    }
+    if (stage->outputs[slot])
+    {
+        tensor_allocator_free(&stage->tensor_alloc, stage->outputs[slot]);
+        stage->outputs[slot] = NULL;
+    }
+}
+
+static void pipeline_stage_pin(const struct pipeline_stage *const stage)
+{
+#ifdef __linux__
+    const struct pipeline *pipe = stage->pipe;
+    if (stage->n_cpus == 0)
+    {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = stage->first_cpu; i < stage->first_cpu + stage->n_cpus; i++)
+    {
+        CPU_SET(pipe->cpus[i], &set);
+    }
+
+    // Best effort, the stage still runs wherever the scheduler puts it
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)stage;
+#endif
+}
+
+static cgrad_error pipeline_stage_init(struct pipeline *const pipe, struct pipeline_stage *const stage, const size_t index, const pipeline_stage_fn fn, void *const args)
+{
+    stage->index = index;
+    stage->pipe = pipe;
+    stage->fn = fn;
+    stage->args = args;
+    stage->error = NO_ERROR;
+    memset(stage->inputs, 0, sizeof(stage->inputs));
+    memset(stage->outputs, 0, sizeof(stage->outputs));
+
+    // Groups of consecutive cores, or a core shared round-robin when there are fewer cores than stages
+    const size_t n_stages = pipe->n_stages;
+    const size_t n_cpus = pipe->n_cpus;
+    if (n_cpus >= n_stages)
+    {
+        stage->first_cpu = index * n_cpus / n_stages;
+        stage->n_cpus = (index + 1) * n_cpus / n_stages - stage->first_cpu;
+    }
+    else
+    {
+        stage->first_cpu = n_cpus > 0 ? index % n_cpus : 0;
+        stage->n_cpus = n_cpus > 0 ? 1 : 0;
+    }
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_cpu_allocator_init(&stage->tensor_alloc)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = computational_graph_cpu_allocator_init(&stage->graph_alloc)) != NO_ERROR)
+    {
+        tensor_cpu_allocator_cleanup(&stage->tensor_alloc);
+        return err;
+    }
+    stage->allocs = (struct allocators){.tensor_alloc = &stage->tensor_alloc, .graph_alloc = &stage->graph_alloc, .tape = NULL};
+
+    return NO_ERROR;
+}
+
+static void pipeline_stage_cleanup(struct pipeline_stage *const stage)
+{
+    for (size_t slot = 0; slot < PIPELINE_MAX_STAGES; slot++)
+    {
+        pipeline_stage_release(stage, slot);
+    }
+    tensor_cpu_allocator_cleanup(&stage->tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&stage->graph_alloc);
+}
+
+static void pipeline_stop(struct pipeline *const pipe, const size_t n_threads)
+{
+    pthread_mutex_lock(&pipe->mutex);
+    pipe->is_stopping = true;
+    pthread_cond_broadcast(&pipe->start_cond);
+    pthread_mutex_unlock(&pipe->mutex);
+
+    for (size_t s = 0; s < n_threads; s++)
+    {
+        pthread_join(pipe->threads[s], NULL);
+    }
+}
+
+static void pipeline_drain(struct pipeline *const pipe)
+{
+    void *message = NULL;
+    for (size_t s = 0; s < pipe->n_stages; s++)
+    {
+        while (spsc_queue_pop(&pipe->forward_queues[s], &message))
+        {
+            free(message);
+        }
+        while (spsc_queue_pop(&pipe->backward_queues[s], &message))
+        {
+            free(message);
+        }
+    }
+}
+
+static void pipeline_find_cpus(struct pipeline *const pipe)
+{
+    pipe->cpus = NULL;
+    pipe->n_cpus = 0;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    {
+        return;
+    }
+
+    const int count = CPU_COUNT(&set);
+    pipe->cpus = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!pipe->cpus)
+    {
+        return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE && pipe->n_cpus < (size_t)count; cpu++)
+    {
+        if (CPU_ISSET(cpu, &set))
+        {
+            pipe->cpus[pipe->n_cpus++] = cpu;
+        }
+    }
+#endif
+}
+
+static inline void pipeline_micro_range(const struct pipeline *const pipe, const size_t micro, size_t *const start, size_t *const end)
+{
+    *start = micro * pipe->batch_size / pipe->n_micro_batches;
+    *end = (micro + 1) * pipe->batch_size / pipe->n_micro_batches;
+}
+
+static cgrad_error pipeline_send(struct pipeline *const pipe, struct spsc_queue *const queue, const struct tensor *const t)
+{
+    const size_t data_bytes = t->data_size * dtype_sizeof(t->dtype);
+    struct pipeline_message *message = malloc(sizeof(struct pipeline_message) + data_bytes);
+    if (!message)
+    {
+        return PIPELINE_ALLOCATION_FAILED;
+    }
+
+    memcpy(message->shape, t->shape, t->shape_size * sizeof(size_t));
+    message->shape_size = t->shape_size;
+    message->dtype = t->dtype;
+    message->data_size = t->data_size;
+    memcpy(message->data, t->data, data_bytes);
+
+    // Queues hold more messages than micro-batches in flight, a full queue only waits for a slow consumer
+    while (!spsc_queue_push(queue, message))
+    {
+        if (atomic_load_explicit(&pipe->has_failed, memory_order_relaxed))
+        {
+            free(message);
+            return PIPELINE_ABORTED;
+        }
+        sched_yield();
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error pipeline_receive(struct pipeline_stage *const stage, struct spsc_queue *const queue, const bool requires_grad, struct tensor **const t)
+{
+    struct pipeline *pipe = stage->pipe;
+
+    void *item = NULL;
+    while (!spsc_queue_pop(queue, &item))
+    {
+        if (atomic_load_explicit(&pipe->has_failed, memory_order_relaxed))
+        {
+            return PIPELINE_ABORTED;
+        }
+        sched_yield();
+    }
+    struct pipeline_message *message = (struct pipeline_message *)item;
+
+    struct tensor *received = requires_grad
+        ? tensor_allocator_alloc(&stage->tensor_alloc, message->shape, message->shape_size, message->dtype)
+        : tensor_allocator_no_grad_alloc(&stage->tensor_alloc, message->shape, message->shape_size, message->dtype);
+    if (!received)
+    {
+        free(message);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    memcpy(received->data, message->data, message->data_size * dtype_sizeof(message->dtype));
+    free(message);
+
+    *t = received;
+    return NO_ERROR;
+}
@@ -58,7 +58,8 @@ cgrad_error tensor2d_add_row_vector(struct tensor *const t, struct tensor *const
         return TENSOR_DTYPE_MISMATCH;
     }
 
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, t->shape, t->shape_size, t->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, t, v);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, t->shape, t->shape_size, t->dtype, is_tracked);
 
     if (!(*out))
     {
@@ -71,7 +72,7 @@ cgrad_error tensor2d_add_row_vector(struct tensor *const t, struct tensor *const
         return NO_ERROR;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor2d_add_row_vector_update_graph(t, v, out, allocs);
     }
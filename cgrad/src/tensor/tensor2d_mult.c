@@ -3,6 +3,8 @@
 #include "cgrad/tensor/tensor2d_mult_rhs_trans.h"
 #include "cgrad/tensor/tensor2d_mult_lhs_trans.h"
 #include "cgrad/tensor/tensor2d_trans.h"
+#include "cgrad/tensor/tensor_cast.h"
+#include "cgrad/config.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
 #include <cblas.h>
@@ -20,6 +22,12 @@ static cgrad_error tensor2d_mult_f64(const struct tensor *const x, const struct
 static cgrad_error tensor2d_mult_f32(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
 static cgrad_error tensor2d_mult_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error tensor2d_mult_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static inline cgrad_error tensor2d_mult_save_lhs(struct backpropagation_context *const ctx, struct tensor *const x);
+static cgrad_error tensor2d_mult_accumulate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor2d_mult_accumulate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor2d_mult_gradient_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand, const bool is_accumulating);
+static cgrad_error tensor2d_mult_gradient_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand, const bool is_accumulating);
+static cgrad_error tensor2d_mult_gradient_rhs_stashed(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand, const bool is_accumulating);
 
 cgrad_error tensor2d_mult(struct tensor *const x, struct tensor *const y, struct tensor **const out, const bool track_grad, struct allocators *const allocs)
 {
@@ -42,7 +50,8 @@ cgrad_error tensor2d_mult(struct tensor *const x, struct tensor *const y, struct
 
     const size_t shape[] = {x->shape[0], y->shape[1]};
     const size_t shape_size = 2;
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, shape, shape_size, x->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, x, y);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, shape, shape_size, x->dtype, is_tracked);
 
     if (!(*out))
     {
@@ -55,7 +64,7 @@ cgrad_error tensor2d_mult(struct tensor *const x, struct tensor *const y, struct
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor2d_mult_update_graph(x, y, out, allocs);
     }
@@ -65,15 +74,57 @@ cgrad_error tensor2d_mult(struct tensor *const x, struct tensor *const y, struct
 
 static inline cgrad_error tensor2d_mult_update_graph(struct tensor *const x, struct tensor *const y, struct tensor **const out, struct allocators *const allocs)
 {
-    cgrad_error err = add_computational_graph_link(x, LHS_TENSOR, *out, &tensor2d_mult_backpropagate_lhs, allocs);
+    cgrad_error err = add_computational_graph_accumulating_link(x, LHS_TENSOR, *out, &tensor2d_mult_backpropagate_lhs, &tensor2d_mult_accumulate_lhs, allocs);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = add_computational_graph_link(y, RHS_TENSOR, *out, &tensor2d_mult_backpropagate_rhs, allocs);
+    err = add_computational_graph_accumulating_link(y, RHS_TENSOR, *out, &tensor2d_mult_backpropagate_rhs, &tensor2d_mult_accumulate_rhs, allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
 
-    return err;
+    // Each gradient needs the other operand: dz/dA = dz/dC * B^T and dz/dB = A^T * dz/dC
+    struct backpropagation_context *ctx = computational_graph_link_context(*out, allocs);
+    err = tensor2d_mult_save_lhs(ctx, x);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return context_save_operand(ctx, y, RHS_TENSOR);
+}
+
+static inline cgrad_error tensor2d_mult_save_lhs(struct backpropagation_context *const ctx, struct tensor *const x)
+{
+#if AUTOGRAD_GEMM_STASH_BF16
+    /**
+     * The left operand is usually an activation and is only read by the weight gradient, which
+     * tolerates reduced precision. A bfloat16 copy is owned by the context, so that x itself is
+     * not saved and can be released as soon as the forward pass is done with it.
+     */
+    if (ctx && x->dtype == DTYPE_FLOAT32)
+    {
+        struct tensor *stash = tensor_allocator_no_grad_alloc(ctx->owned_allocator, x->shape, x->shape_size, DTYPE_BFLOAT16);
+        if (!stash)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+
+        cgrad_error err = tensor_cast_into(x, stash);
+        if (err != NO_ERROR)
+        {
+            tensor_allocator_no_grad_free(ctx->owned_allocator, stash);
+            return err;
+        }
+
+        return context_set_owned(ctx, stash, LHS_TENSOR);
+    }
+#endif
+
+    return context_save_operand(ctx, x, LHS_TENSOR);
 }
 
 cgrad_error tensor2d_mult_into(const struct tensor *const x, const struct tensor *const y, struct tensor *const out)
@@ -156,6 +207,26 @@ static cgrad_error tensor2d_mult_f32(const struct tensor *const x, const struct
 }
 
 static cgrad_error tensor2d_mult_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    return tensor2d_mult_gradient_lhs(ctx, grad_wrt_out, grad_wrt_operand, false);
+}
+
+static cgrad_error tensor2d_mult_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    return tensor2d_mult_gradient_rhs(ctx, grad_wrt_out, grad_wrt_operand, false);
+}
+
+static cgrad_error tensor2d_mult_accumulate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    return tensor2d_mult_gradient_lhs(ctx, grad_wrt_out, grad_wrt_operand, true);
+}
+
+static cgrad_error tensor2d_mult_accumulate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    return tensor2d_mult_gradient_rhs(ctx, grad_wrt_out, grad_wrt_operand, true);
+}
+
+static cgrad_error tensor2d_mult_gradient_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand, const bool is_accumulating)
 {
     const struct tensor *rhs = ctx->operands[RHS_TENSOR];
     if (!rhs)
@@ -167,20 +238,51 @@ static cgrad_error tensor2d_mult_backpropagate_lhs(const struct backpropagation_
      * If C = A*B, then
      * dz/dA = dz/dC * B^T, hence the trans
      */
-    return tensor2d_mult_rhs_trans_into(grad_wrt_out, rhs, grad_wrt_operand);
+    return is_accumulating
+        ? tensor2d_mult_rhs_trans_acc_into(grad_wrt_out, rhs, grad_wrt_operand)
+        : tensor2d_mult_rhs_trans_into(grad_wrt_out, rhs, grad_wrt_operand);
 }
 
-static cgrad_error tensor2d_mult_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+static cgrad_error tensor2d_mult_gradient_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand, const bool is_accumulating)
 {
     const struct tensor *lhs = ctx->operands[LHS_TENSOR];
     if (!lhs)
     {
-        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+        return tensor2d_mult_gradient_rhs_stashed(ctx, grad_wrt_out, grad_wrt_operand, is_accumulating);
     }
 
     /**
      * If C = A*B, then
      * dz/dB = A^T * dz/dC, hence the trans
      */
-    return tensor2d_mult_lhs_trans_into(lhs, grad_wrt_out, grad_wrt_operand);
-}
\ No newline at end of file
+    return is_accumulating
+        ? tensor2d_mult_lhs_trans_acc_into(lhs, grad_wrt_out, grad_wrt_operand)
+        : tensor2d_mult_lhs_trans_into(lhs, grad_wrt_out, grad_wrt_operand);
+}
+
+static cgrad_error tensor2d_mult_gradient_rhs_stashed(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand, const bool is_accumulating)
+{
+    const struct tensor *stash = ctx->owned[LHS_TENSOR];
+    if (!stash)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    // Upcast the bfloat16 copy of the left operand for the duration of the product
+    struct tensor *lhs = tensor_allocator_no_grad_alloc(ctx->owned_allocator, stash->shape, stash->shape_size, grad_wrt_operand->dtype);
+    if (!lhs)
+    {
+        return AUTOGRAD_BACKPROPAGATION_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_cast_into(stash, lhs);
+    if (err == NO_ERROR)
+    {
+        err = is_accumulating
+            ? tensor2d_mult_lhs_trans_acc_into(lhs, grad_wrt_out, grad_wrt_operand)
+            : tensor2d_mult_lhs_trans_into(lhs, grad_wrt_out, grad_wrt_operand);
+    }
+
+    tensor_allocator_no_grad_free(ctx->owned_allocator, lhs);
+    return err;
+}
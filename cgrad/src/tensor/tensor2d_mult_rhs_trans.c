@@ -1,16 +1,106 @@
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor2d_mult_rhs_trans.h"
+#include "cgrad/tensor/tensor2d_mult_lhs_trans.h"
 #include "cgrad/tensor/tensor2d_trans.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
 #include <cblas.h>
 #include <stdlib.h>
 
-static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out);
-static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out);
-static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out);
+typedef enum tensor2d_mult_rhs_trans_operand
+{
+    LHS_TENSOR,
+    RHS_TRANS_TENSOR,
+} tensor2d_mult_rhs_trans_operand;
+
+static inline cgrad_error tensor2d_mult_rhs_trans_update_graph(struct tensor *const x, struct tensor *const y_trans, struct tensor **const out, struct allocators *const allocs);
+static cgrad_error tensor2d_mult_rhs_trans_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor2d_mult_rhs_trans_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor2d_mult_rhs_trans_into_beta(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta);
+static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta);
+static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta);
+static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta);
+
+cgrad_error tensor2d_mult_rhs_trans(struct tensor *const x, struct tensor *const y_trans, struct tensor **const out, const bool track_grad, struct allocators *const allocs)
+{
+    if (!x || !y_trans)
+    {
+        return TENSOR_NULL;
+    }
+    if (!x->data || !y_trans->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (x->shape[1] != y_trans->shape[1])
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+    if (x->dtype != y_trans->dtype)
+    {
+        return TENSOR_DTYPE_MISMATCH;
+    }
+
+    const size_t shape[] = {x->shape[0], y_trans->shape[0]};
+    const size_t shape_size = 2;
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, x, y_trans);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, shape, shape_size, x->dtype, is_tracked);
+
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor2d_mult_rhs_trans_dispatch(x, y_trans, *out, 0.0);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (is_tracked)
+    {
+        return tensor2d_mult_rhs_trans_update_graph(x, y_trans, out, allocs);
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error tensor2d_mult_rhs_trans_update_graph(struct tensor *const x, struct tensor *const y_trans, struct tensor **const out, struct allocators *const allocs)
+{
+    cgrad_error err = add_computational_graph_link(x, LHS_TENSOR, *out, &tensor2d_mult_rhs_trans_backpropagate_lhs, allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = add_computational_graph_link(y_trans, RHS_TRANS_TENSOR, *out, &tensor2d_mult_rhs_trans_backpropagate_rhs, allocs);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Each gradient needs the other operand: dz/dA = dz/dC * B and dz/dB = dz/dC^T * A
+    struct backpropagation_context *ctx = computational_graph_link_context(*out, allocs);
+    err = context_save_operand(ctx, x, LHS_TENSOR);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return context_save_operand(ctx, y_trans, RHS_TRANS_TENSOR);
+}
 
 cgrad_error tensor2d_mult_rhs_trans_into(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+{
+    return tensor2d_mult_rhs_trans_into_beta(x, y_trans, out, 0.0);
+}
+
+cgrad_error tensor2d_mult_rhs_trans_acc_into(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+{
+    return tensor2d_mult_rhs_trans_into_beta(x, y_trans, out, 1.0);
+}
+
+static cgrad_error tensor2d_mult_rhs_trans_into_beta(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta)
 {
     if (!x || !y_trans || !out)
     {
@@ -29,23 +119,23 @@ cgrad_error tensor2d_mult_rhs_trans_into(const struct tensor *const x, const str
         return TENSOR_DTYPE_MISMATCH;
     }
 
-    return tensor2d_mult_rhs_trans_dispatch(x, y_trans, out);
+    return tensor2d_mult_rhs_trans_dispatch(x, y_trans, out, beta);
 }
 
-static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta)
 {
     switch (x->dtype)
     {
     case DTYPE_FLOAT64:
-        return tensor2d_mult_rhs_trans_f64(x, y_trans, out);
+        return tensor2d_mult_rhs_trans_f64(x, y_trans, out, beta);
     case DTYPE_FLOAT32:
-        return tensor2d_mult_rhs_trans_f32(x, y_trans, out);
+        return tensor2d_mult_rhs_trans_f32(x, y_trans, out, beta);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta)
 {
     cblas_dgemm(
         CblasRowMajor,
@@ -58,8 +148,8 @@ static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, con
         (double *)x->data,
         x->shape[1], 
         y_trans->data,
-        y_trans->shape[0], 
-        0.0,
+        y_trans->shape[1],
+        beta,
         (double *)out->data,
         out->shape[1]
     );
@@ -67,7 +157,7 @@ static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, con
     return NO_ERROR;
 }
 
-static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, const double beta)
 {
     cblas_sgemm(
         CblasRowMajor,
@@ -81,10 +171,40 @@ static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, con
         x->shape[1],
         y_trans->data,
         y_trans->shape[1],
-        0.0,
+        beta,
         (float *)out->data,
         out->shape[1]
     );
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
+
+static cgrad_error tensor2d_mult_rhs_trans_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *rhs_trans = ctx->operands[RHS_TRANS_TENSOR];
+    if (!rhs_trans)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    /**
+     * If C = A*B^T, then
+     * dz/dA = dz/dC * B
+     */
+    return tensor2d_mult_into(grad_wrt_out, rhs_trans, grad_wrt_operand);
+}
+
+static cgrad_error tensor2d_mult_rhs_trans_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *lhs = ctx->operands[LHS_TENSOR];
+    if (!lhs)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    /**
+     * If C = A*B^T, then
+     * dz/dB = dz/dC^T * A, hence the trans
+     */
+    return tensor2d_mult_lhs_trans_into(grad_wrt_out, lhs, grad_wrt_operand);
+}
@@ -30,7 +30,8 @@ cgrad_error tensor2d_trans(struct tensor *const t, struct tensor **const out, co
     
     const size_t shape[] = {t->shape[1], t->shape[0]};
     const size_t shape_size = 2;
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, shape, shape_size, t->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, t, NULL);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, shape, shape_size, t->dtype, is_tracked);
     if (!(*out))
     {
         return TENSOR_ALLOCATION_FAILED;
@@ -42,7 +43,7 @@ cgrad_error tensor2d_trans(struct tensor *const t, struct tensor **const out, co
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor2d_trans_update_graph(t, out, allocs);
     }
@@ -2,6 +2,7 @@
 #include "cgrad/tensor/tensor_copy.h"
 #include "cgrad/tensor/tensor_helpers.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
 
 typedef enum tensor_add_operand
 {
@@ -42,7 +43,8 @@ cgrad_error tensor_add(struct tensor *const x, struct tensor *const y, struct te
         return TENSOR_DTYPE_MISMATCH;
     }
 
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, x->shape, x->shape_size, x->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, x, y);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, x->shape, x->shape_size, x->dtype, is_tracked);
 
     cgrad_error err = tensor_add_dispatch(x, y, *out);
     if (err != NO_ERROR)
@@ -50,7 +52,7 @@ cgrad_error tensor_add(struct tensor *const x, struct tensor *const y, struct te
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor_add_update_graph(x, y, out, allocs);
     }
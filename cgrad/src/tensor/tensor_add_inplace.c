@@ -1,6 +1,18 @@
 #include "cgrad/tensor/tensor_add_inplace.h"
 #include "cgrad/tensor/tensor_axpy.h"
 #include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/utils/simd_support.h"
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
+
+static void tensor_data_add_inplace_f64(double *const dst, const double *const src, const size_t size);
+static void tensor_data_add_inplace_f32(float *const dst, const float *const src, const size_t size);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void tensor_data_add_inplace_avx_256_f64(double *const dst, const double *const src, const size_t size);
+static void tensor_data_add_inplace_avx_256_f32(float *const dst, const float *const src, const size_t size);
+#endif
 
 cgrad_error tensor_add_inplace(struct tensor *A, const struct tensor *const B)
 {
@@ -22,4 +34,80 @@ cgrad_error tensor_add_inplace(struct tensor *A, const struct tensor *const B)
     }
 
     return tensor_axpy(B, A, 1.0);
-}
\ No newline at end of file
+}
+
+cgrad_error tensor_data_add_inplace(void *const dst, const void *const src, const size_t size, const cgrad_dtype dtype)
+{
+    if (!dst || !src)
+    {
+        return TENSOR_DATA_NULL;
+    }
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        tensor_data_add_inplace_avx_256_f64((double *)dst, (const double *)src, size);
+#else
+        tensor_data_add_inplace_f64((double *)dst, (const double *)src, size);
+#endif
+        return NO_ERROR;
+    case DTYPE_FLOAT32:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        tensor_data_add_inplace_avx_256_f32((float *)dst, (const float *)src, size);
+#else
+        tensor_data_add_inplace_f32((float *)dst, (const float *)src, size);
+#endif
+        return NO_ERROR;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
+
+static void tensor_data_add_inplace_f64(double *const dst, const double *const src, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        dst[i] += src[i];
+    }
+}
+
+static void tensor_data_add_inplace_f32(float *const dst, const float *const src, const size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        dst[i] += src[i];
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static void tensor_data_add_inplace_avx_256_f64(double *const dst, const double *const src, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256d sum = _mm256_add_pd(_mm256_loadu_pd(&dst[i]), _mm256_loadu_pd(&src[i]));
+        _mm256_storeu_pd(&dst[i], sum);
+    }
+
+    // Handle remaining items
+    tensor_data_add_inplace_f64(&dst[i], &src[i], size - i);
+}
+
+static void tensor_data_add_inplace_avx_256_f32(float *const dst, const float *const src, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        const __m256 sum = _mm256_add_ps(_mm256_loadu_ps(&dst[i]), _mm256_loadu_ps(&src[i]));
+        _mm256_storeu_ps(&dst[i], sum);
+    }
+
+    // Handle remaining items
+    tensor_data_add_inplace_f32(&dst[i], &src[i], size - i);
+}
+#endif
@@ -0,0 +1,56 @@
+#include "cgrad/tensor/tensor_cast.h"
+#include "cgrad/tensor/tensor_helpers.h"
+
+static cgrad_error tensor_cast_f32_to_bf16(const struct tensor *const src, struct tensor *const dest);
+static cgrad_error tensor_cast_bf16_to_f32(const struct tensor *const src, struct tensor *const dest);
+
+cgrad_error tensor_cast_into(const struct tensor *const src, struct tensor *const dest)
+{
+    if (!src || !dest)
+    {
+        return TENSOR_NULL;
+    }
+    if (!src->data || !dest->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!tensor_same_shape(src, dest))
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    if (src->dtype == DTYPE_FLOAT32 && dest->dtype == DTYPE_BFLOAT16)
+    {
+        return tensor_cast_f32_to_bf16(src, dest);
+    }
+    if (src->dtype == DTYPE_BFLOAT16 && dest->dtype == DTYPE_FLOAT32)
+    {
+        return tensor_cast_bf16_to_f32(src, dest);
+    }
+
+    return OPERATION_INVALID_TENSOR_DTYPE;
+}
+
+static cgrad_error tensor_cast_f32_to_bf16(const struct tensor *const src, struct tensor *const dest)
+{
+    const float *src_data = (const float *)src->data;
+    bfloat16 *dest_data = (bfloat16 *)dest->data;
+    for (size_t i = 0; i < src->data_size; i++)
+    {
+        dest_data[i] = bfloat16_from_float(src_data[i]);
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error tensor_cast_bf16_to_f32(const struct tensor *const src, struct tensor *const dest)
+{
+    const bfloat16 *src_data = (const bfloat16 *)src->data;
+    float *dest_data = (float *)dest->data;
+    for (size_t i = 0; i < src->data_size; i++)
+    {
+        dest_data[i] = bfloat16_to_float(src_data[i]);
+    }
+
+    return NO_ERROR;
+}
@@ -14,8 +14,8 @@ typedef enum tensor_im2row_owned
 } tensor_im2row_owned;
 
 static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, struct tensor *const out, struct tensor *const origin_idxs, struct allocators *allocs);
-static inline cgrad_error tensor_im2row_dispatch(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct allocators *const allocs);
-static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct allocators *const allocs);
+static inline cgrad_error tensor_im2row_dispatch(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, const bool requires_grad, struct allocators *const allocs);
+static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, const bool requires_grad, struct allocators *const allocs);
 static cgrad_error tensor_im2row_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error tensor_im2row_backpropagate_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
@@ -23,14 +23,17 @@ cgrad_error tensor_im2row(struct tensor *t, const struct tensor *kernel, struct
 {
     // checks
 
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, t, NULL);
     struct tensor *origin_idxs = NULL;
-    tensor_im2row_dispatch(t, kernel, out, &origin_idxs, allocs);
+    tensor_im2row_dispatch(t, kernel, out, &origin_idxs, is_tracked, allocs);
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor_im2row_update_graph(t, *out, origin_idxs, allocs);
     }
 
+    // Source indexes are only needed by backward
+    tensor_allocator_free(allocs->tensor_alloc, origin_idxs);
     return NO_ERROR;
 }
 
@@ -42,21 +45,21 @@ static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, str
         return err;
     }
 
-    return context_set_owned(&out->node->ctx, origin_idxs, ORIGIN_IDXS);
+    return context_set_owned(computational_graph_link_context(out, allocs), origin_idxs, ORIGIN_IDXS);
 }
 
-static inline cgrad_error tensor_im2row_dispatch(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct allocators *const allocs)
+static inline cgrad_error tensor_im2row_dispatch(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, const bool requires_grad, struct allocators *const allocs)
 {
     switch (t->dtype)
     {
     case DTYPE_FLOAT32:
-        return tensor_im2row_f32(t, kernel, out, origin_idxs, allocs);
+        return tensor_im2row_f32(t, kernel, out, origin_idxs, requires_grad, allocs);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct allocators *const allocs)
+static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, const bool requires_grad, struct allocators *const allocs)
 {
     float *t_data = (float *)t->data;
 
@@ -69,8 +72,8 @@ static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kern
     size_t S = kernel->shape[3];
 
     const size_t out_shape[] = {H_out * W_out * t->shape[0], C * R * S};
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, out_shape, 2, t->dtype);
-    (*origin_idxs) = tensor_allocator_alloc(allocs->tensor_alloc, out_shape, 2, t->dtype);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, out_shape, 2, t->dtype, requires_grad);
+    (*origin_idxs) = tensor_allocator_no_grad_alloc(allocs->tensor_alloc, out_shape, 2, t->dtype);
     float *out_data = (float *)(*out)->data;
     float *origin_idxs_data = (float *)(*origin_idxs)->data;
 
@@ -1,37 +1,180 @@
 #include "cgrad/tensor/tensor_norm.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
 
-static inline cgrad_error tensor_norm_dispatch(const struct tensor *const t, double *const out);
-static inline cgrad_error tensor_norm_f32(const struct tensor *const t, double *const out);
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0
+#include <immintrin.h>
+#endif
 
-static inline cgrad_error tensor_norm(const struct tensor *const t, double *const out)
+static double tensor_squared_norm_f64(const double *const data, const size_t size);
+static double tensor_squared_norm_f32(const float *const data, const size_t size);
+static double tensor_squared_norm_bf16(const bfloat16 *const data, const size_t size);
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static double tensor_squared_norm_avx_256_f64(const double *const data, const size_t size);
+static double tensor_squared_norm_avx_256_f32(const float *const data, const size_t size);
+static double tensor_squared_norm_avx_256_bf16(const bfloat16 *const data, const size_t size);
+static inline double tensor_squared_norm_avx_256_reduce(const __m256d acc);
+static inline __m256d tensor_squared_norm_avx_256_accumulate_ps(const __m256 vals, __m256d acc);
+#endif
+
+cgrad_error tensor_norm(const struct tensor *const t, double *const out)
 {
     if (!t)
     {
         return TENSOR_NULL;
     }
 
-    return tensor_norm_dispatch(t, out);
+    double squared_norm;
+    cgrad_error err = tensor_data_squared_norm(t->data, t->data_size, t->dtype, &squared_norm);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    *out = sqrt(squared_norm);
+    return NO_ERROR;
 }
 
-static inline cgrad_error tensor_norm_dispatch(const struct tensor *const t, double *const out)
+cgrad_error tensor_data_squared_norm(const void *const data, const size_t size, const cgrad_dtype dtype, double *const out)
 {
-    switch (t->dtype)
+    if (!data)
     {
-        case DTYPE_FLOAT32:
-            return tensor_norm_f32(t, out);
-        default:
-            return OPERATION_INVALID_TENSOR_DTYPE;
+        return TENSOR_DATA_NULL;
+    }
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        *out = tensor_squared_norm_avx_256_f64((const double *)data, size);
+#else
+        *out = tensor_squared_norm_f64((const double *)data, size);
+#endif
+        return NO_ERROR;
+    case DTYPE_FLOAT32:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        *out = tensor_squared_norm_avx_256_f32((const float *)data, size);
+#else
+        *out = tensor_squared_norm_f32((const float *)data, size);
+#endif
+        return NO_ERROR;
+    case DTYPE_BFLOAT16:
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+        *out = tensor_squared_norm_avx_256_bf16((const bfloat16 *)data, size);
+#else
+        *out = tensor_squared_norm_bf16((const bfloat16 *)data, size);
+#endif
+        return NO_ERROR;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static inline cgrad_error tensor_norm_f32(const struct tensor *const t, double *const out)
+static double tensor_squared_norm_f64(const double *const data, const size_t size)
 {
-    *out = 0.0f;
-    float* t_data = (float*)t->data;
-    for (size_t i = 0;  i < t->data_size; i++)
+    double sum = 0;
+    for (size_t i = 0; i < size; i++)
     {
-        *out += (t_data[i] * t_data[i]);
+        sum += data[i] * data[i];
     }
 
-    return NO_ERROR;
-}
\ No newline at end of file
+    return sum;
+}
+
+static double tensor_squared_norm_f32(const float *const data, const size_t size)
+{
+    double sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        const double x = data[i];
+        sum += x * x;
+    }
+
+    return sum;
+}
+
+static double tensor_squared_norm_bf16(const bfloat16 *const data, const size_t size)
+{
+    double sum = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        const double x = bfloat16_to_float(data[i]);
+        sum += x * x;
+    }
+
+    return sum;
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static double tensor_squared_norm_avx_256_f64(const double *const data, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256d) / sizeof(double);
+
+    // Two accumulators hide the latency of the additions
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + 2 * PARALLELIZED_ITEMS - 1 < size; i += 2 * PARALLELIZED_ITEMS)
+    {
+        const __m256d vals0 = _mm256_loadu_pd(&data[i]);
+        const __m256d vals1 = _mm256_loadu_pd(&data[i + PARALLELIZED_ITEMS]);
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(vals0, vals0));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(vals1, vals1));
+    }
+
+    // Handle remaining items
+    return tensor_squared_norm_avx_256_reduce(_mm256_add_pd(acc0, acc1)) + tensor_squared_norm_f64(&data[i], size - i);
+}
+
+static double tensor_squared_norm_avx_256_f32(const float *const data, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    __m256d acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        acc = tensor_squared_norm_avx_256_accumulate_ps(_mm256_loadu_ps(&data[i]), acc);
+    }
+
+    // Handle remaining items
+    return tensor_squared_norm_avx_256_reduce(acc) + tensor_squared_norm_f32(&data[i], size - i);
+}
+
+static double tensor_squared_norm_avx_256_bf16(const bfloat16 *const data, const size_t size)
+{
+    const size_t PARALLELIZED_ITEMS = sizeof(__m256) / sizeof(float);
+
+    __m256d acc = _mm256_setzero_pd();
+
+    size_t i = 0;
+    for (; i + PARALLELIZED_ITEMS - 1 < size; i += PARALLELIZED_ITEMS)
+    {
+        // bfloat16 are the upper halves of float32
+        const __m256i bits = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&data[i]));
+        acc = tensor_squared_norm_avx_256_accumulate_ps(_mm256_castsi256_ps(_mm256_slli_epi32(bits, 16)), acc);
+    }
+
+    // Handle remaining items
+    return tensor_squared_norm_avx_256_reduce(acc) + tensor_squared_norm_bf16(&data[i], size - i);
+}
+
+/**
+ * Squares are accumulated in double, so that large tensors do not lose their small elements.
+ */
+static inline __m256d tensor_squared_norm_avx_256_accumulate_ps(const __m256 vals, __m256d acc)
+{
+    const __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(vals));
+    const __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(vals, 1));
+    acc = _mm256_add_pd(acc, _mm256_mul_pd(low, low));
+    return _mm256_add_pd(acc, _mm256_mul_pd(high, high));
+}
+
+static inline double tensor_squared_norm_avx_256_reduce(const __m256d acc)
+{
+    const __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+#endif
@@ -40,7 +40,8 @@ cgrad_error tensor_reshape(struct tensor *const t, const size_t *shape, const si
         return TENSOR_RESHAPE_INVALID_SHAPE;
     }
     
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, shape, shape_size, t->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, t, NULL);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, shape, shape_size, t->dtype, is_tracked);
     if (!(*out))
     {
         return TENSOR_ALLOCATION_FAILED;
@@ -52,7 +53,7 @@ cgrad_error tensor_reshape(struct tensor *const t, const size_t *shape, const si
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor_reshape_update_graph(t, shape, shape_size, *out, allocs);
     }
@@ -79,7 +80,8 @@ static inline cgrad_error tensor_reshape_update_graph(struct tensor *const t, co
      * to perform the inverse operation during backprop, that is
      * reshaping the gradient to the original shape.
      */
-    err = context_set_operand_size_t(&out->node->ctx, t->shape_size, OLD_SHAPE_SIZE);
+    struct backpropagation_context *ctx = computational_graph_link_context(out, allocs);
+    err = context_set_operand_size_t(ctx, t->shape_size, OLD_SHAPE_SIZE);
     if (err != NO_ERROR)
     {
         return err;
@@ -88,7 +90,7 @@ static inline cgrad_error tensor_reshape_update_graph(struct tensor *const t, co
     for (size_t i = 0; i < t->shape_size; i++)
     {
         // Save contiguously after OLD_SHAPE_START_POS
-        err = context_set_operand_size_t(&out->node->ctx, t->shape[i], OLD_SHAPE_START_POS + i);
+        err = context_set_operand_size_t(ctx, t->shape[i], OLD_SHAPE_START_POS + i);
         if (err != NO_ERROR)
         {
             return err;
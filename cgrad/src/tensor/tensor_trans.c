@@ -38,7 +38,8 @@ cgrad_error tensor_trans(struct tensor *const t, const size_t axis_1, const size
     trans_shape[axis_1] = trans_shape[axis_2];
     trans_shape[axis_2] = temp;
 
-    (*out) = tensor_allocator_alloc(allocs->tensor_alloc, trans_shape, t->shape_size, t->dtype);
+    const bool is_tracked = computational_graph_link_is_needed(track_grad, t, NULL);
+    (*out) = tensor_allocator_result_alloc(allocs->tensor_alloc, trans_shape, t->shape_size, t->dtype, is_tracked);
     if (!(*out))
     {
         return TENSOR_ALLOCATION_FAILED;
@@ -50,7 +51,7 @@ cgrad_error tensor_trans(struct tensor *const t, const size_t axis_1, const size
         return err;
     }
 
-    if (track_grad)
+    if (is_tracked)
     {
         return tensor_trans_update_graph(t, axis_1, axis_2, out, allocs);
     }
@@ -71,13 +72,14 @@ static inline cgrad_error tensor_trans_update_graph(struct tensor *const t, cons
      * to perform the inverse operation during backprop, that is
      * transposing the gradient to the original shape.
      */
-    err = context_set_operand_size_t(&(*out)->node->ctx, axis_1, AXIS_1);
+    struct backpropagation_context *ctx = computational_graph_link_context(*out, allocs);
+    err = context_set_operand_size_t(ctx, axis_1, AXIS_1);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    return context_set_operand_size_t(&(*out)->node->ctx, axis_2, AXIS_2);
+    return context_set_operand_size_t(ctx, axis_2, AXIS_2);
 }
 
 cgrad_error tensor_trans_into(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out)
@@ -3,6 +3,9 @@
 #include "cgrad/layers/relu.h"
 #include "cgrad/losses/cross_entropy.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/checkpoint/checkpoint.h"
+#include "cgrad/graph/captured_graph.h"
+#include "cgrad/graph/captured_graph_passes.h"
 #include "cgrad/memory/allocators.h"
 #include "cgrad/model/model_params.h"
 #include "cgrad/tensor/tensor.h"
@@ -15,19 +18,102 @@
 #include "cgrad/dataset/indexes_permutation.h"
 #include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
 #include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/memory/tensor/spill/tensor_spill_store.h"
 #include "cgrad/utils/random.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #define OUTPUT_ITERATION_FREQ 25
 
+struct conv_block
+{
+    struct conv2d *conv1;
+    struct conv2d *conv2;
+    struct allocators *allocs;
+    struct captured_graph graph;
+    bool is_captured;
+};
+
+static cgrad_error conv_block_capture(struct conv_block *const block, const struct tensor *const x)
+{
+    struct captured_graph *graph = &block->graph;
+    cgrad_error err = NO_ERROR;
+    if ((err = captured_graph_init(graph)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Inputs are bound in this order by conv_block_forward
+    captured_node_id x_id, weight1_id, weight2_id;
+    if ((err = captured_graph_input(graph, x->shape, x->shape_size, &x_id)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = captured_graph_input(graph, block->conv1->weight->shape, block->conv1->weight->shape_size, &weight1_id)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = captured_graph_input(graph, block->conv2->weight->shape, block->conv2->weight->shape_size, &weight2_id)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    captured_node_id h1, h2, out;
+    if ((err = conv2d_capture(block->conv1, graph, x_id, weight1_id, &h1)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = captured_graph_relu(graph, h1, &h2)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = conv2d_capture(block->conv2, graph, h2, weight2_id, &out)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = captured_graph_mark_output(graph, out)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct captured_graph_report report;
+    if ((err = captured_graph_optimize(graph, &report)) != NO_ERROR)
+    {
+        return err;
+    }
+    captured_graph_print_report(&report);
+
+    block->is_captured = true;
+    return NO_ERROR;
+}
+
+// conv1 -> relu -> conv2, recomputed during backward instead of keeping its activations
+static cgrad_error conv_block_forward(void *args, struct tensor *const x, struct tensor **const out, struct tensor_list *const intermediates, const bool track_grad)
+{
+    struct conv_block *block = (struct conv_block *)args;
+    cgrad_error err = NO_ERROR;
+
+    // Captured once, and again only if the shape of the batch changes
+    const struct captured_node *x_node = &block->graph.nodes[0];
+    const bool is_same_shape = block->is_captured && x_node->shape_size == x->shape_size &&
+                               memcmp(x_node->shape, x->shape, x->shape_size * sizeof(size_t)) == 0;
+    if (!is_same_shape && (err = conv_block_capture(block, x)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *inputs[] = {x, block->conv1->weight, block->conv2->weight};
+    return captured_graph_run(&block->graph, inputs, out, intermediates, track_grad, block->allocs);
+}
+
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [<spill_dir>]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -49,7 +135,22 @@ int main(int argc, char **argv)
     struct computational_graph_allocator graph_alloc;
     computational_graph_cpu_allocator_init(&graph_alloc);
 
-    struct allocators allocs = {&tensor_alloc, &graph_alloc};
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    // Optionally offload activations saved for backward to a scratch file in the given directory
+    struct tensor_spill_store spill;
+    const bool use_spill = argc == 3;
+    if (use_spill)
+    {
+        const size_t SPILL_CAPACITY = (size_t)256 * 1024 * 1024;
+        const size_t SPILL_THRESHOLD = 64 * 1024;
+        if (tensor_spill_store_init(&spill, argv[2], SPILL_CAPACITY, SPILL_THRESHOLD) != NO_ERROR)
+        {
+            fprintf(stderr, "Error while trying to create a spill file in %s.\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        tensor_spill_store_attach(&spill, &tensor_alloc);
+    }
 
     const size_t INTERMEDIATES_CAPACITY = 20;
     struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
@@ -96,6 +197,14 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    struct conv_block block = {.conv1 = &conv1, .conv2 = &conv2, .allocs = &allocs, .is_captured = false};
+    struct checkpoint block_checkpoint;
+    const size_t BLOCK_INTERMEDIATES_CAPACITY = 16;
+    if (checkpoint_init(&block_checkpoint, &conv_block_forward, &block, BLOCK_INTERMEDIATES_CAPACITY, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
     struct linear linear1;
     const size_t LINEAR1_IN = 2304;
     if (linear_init(&linear1, LINEAR1_IN, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
@@ -175,23 +284,15 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
 
-            struct tensor *h1 = NULL;
-            if (conv2d_forward(&conv1, x_reshaped, &h1, intermediates, true) != NO_ERROR)
-            {
-                return EXIT_FAILURE;
-            }
-
-            struct tensor *h2 = NULL;
-            if (relu_forward(h1, &h2, true, &allocs) != NO_ERROR)
-            {
-                return EXIT_FAILURE;
-            }
+            // Activations are dropped as soon as their consumer has run, backward keeps what it saved
+            tensor_allocator_free(&tensor_alloc, x);
 
             struct tensor *h3 = NULL;
-            if (conv2d_forward(&conv2, h2, &h3, intermediates, true) != NO_ERROR)
+            if (checkpoint_forward(&block_checkpoint, x_reshaped, &h3, true) != NO_ERROR)
             {
                 return EXIT_FAILURE;
             }
+            tensor_allocator_free(&tensor_alloc, x_reshaped);
 
             struct tensor *h3_flattened = NULL;
             size_t h3_flattened_shape[] = {iter_batch_size, 2304};
@@ -199,6 +300,7 @@ int main(int argc, char **argv)
             {
                 return EXIT_FAILURE;
             }
+            tensor_allocator_free(&tensor_alloc, h3);
 
             struct tensor *h4 = NULL;
             if (linear_forward(&linear1, h3_flattened, &h4, intermediates, true) != NO_ERROR)
@@ -219,22 +321,18 @@ int main(int argc, char **argv)
                 printf("epoch %02ld, iteration %04ld - loss: %f\n", epoch, iteration, loss);
             }
 
+            // Clear iteration allocations, the graph keeps alive what backward needs
+            tensor_list_free_all(intermediates, &tensor_alloc);
+            tensor_allocator_free(&tensor_alloc, y);
+            tensor_allocator_free(&tensor_alloc, h3_flattened);
+            tensor_allocator_free(&tensor_alloc, h4);
+
             // ------------- Backward -------------
             zero_grad(&params);
             backward(z, &allocs);
 
             sgd_optimizer_step(&opt, lr, momentum, false);
 
-            // Clear iteration allocations
-            tensor_list_free_all(intermediates, &tensor_alloc);
-            tensor_allocator_free(&tensor_alloc, x);
-            tensor_allocator_free(&tensor_alloc, x_reshaped);
-            tensor_allocator_free(&tensor_alloc, y);
-            tensor_allocator_free(&tensor_alloc, h1);
-            tensor_allocator_free(&tensor_alloc, h2);
-            tensor_allocator_free(&tensor_alloc, h3);
-            tensor_allocator_free(&tensor_alloc, h3_flattened);
-            tensor_allocator_free(&tensor_alloc, h4);
             tensor_allocator_free(&tensor_alloc, z);
 
             index_permutation_update(permutation, iter_batch_size);
@@ -244,9 +342,14 @@ int main(int argc, char **argv)
 
     // Cleanup
     sgd_optimizer_cleanup(&opt);
+    checkpoint_cleanup(&block_checkpoint);
     conv2d_cleanup(&conv1);
     conv2d_cleanup(&conv2);
     indexes_batch_free(ixs_batch);
+    if (use_spill)
+    {
+        tensor_spill_store_cleanup(&spill);
+    }
     tensor_cpu_allocator_cleanup(&tensor_alloc);
     computational_graph_cpu_allocator_cleanup(&graph_alloc);
     return EXIT_SUCCESS;
@@ -0,0 +1,327 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/conv2d.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/parallel/pipeline.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_reshape.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+#define INTERMEDIATES_CAPACITY 20
+#define N_STAGES 3
+
+/**
+ * Layers of a stage, with the samples of the batch. Layers are copied with the allocators of the
+ * stage, since each stage builds its graphs on its own.
+ */
+struct conv_stage_args
+{
+    const struct csv_dataset *train_set;
+    struct indexes_batch *ixs_batch;
+    cgrad_dtype dtype;
+    struct conv2d conv;
+    struct linear linear;
+    struct tensor_list *intermediates;
+};
+
+// Samples the micro-batch, then conv1 -> relu
+static cgrad_error conv_stage_0(struct pipeline_stage *stage, const size_t start, const size_t end, struct tensor *const input, struct tensor **const output, void *args)
+{
+    (void)input;
+    struct conv_stage_args *stage_args = (struct conv_stage_args *)args;
+    struct tensor_allocator *tensor_alloc = &stage->tensor_alloc;
+    struct indexes_batch micro_batch = {stage_args->ixs_batch->indexes + start, end - start, end - start};
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *x = NULL;
+    struct tensor *y = NULL;
+    if ((err = csv_dataset_sample_batch(stage_args->train_set, &x, &y, &micro_batch, stage_args->dtype, tensor_alloc)) != NO_ERROR)
+    {
+        return err;
+    }
+    tensor_allocator_free(tensor_alloc, y);
+
+    struct tensor *x_reshaped = NULL;
+    size_t img_shape[] = {end - start, 1, 28, 28};
+    err = tensor_reshape(x, img_shape, 4, &x_reshaped, true, &stage->allocs);
+    tensor_allocator_free(tensor_alloc, x);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *h1 = NULL;
+    err = conv2d_forward(&stage_args->conv, x_reshaped, &h1, stage_args->intermediates, true);
+    tensor_allocator_free(tensor_alloc, x_reshaped);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Activations are dropped as soon as their consumer has run, backward keeps what it saved
+    err = relu_forward(h1, output, true, &stage->allocs);
+    tensor_allocator_free(tensor_alloc, h1);
+    tensor_list_free_all(stage_args->intermediates, tensor_alloc);
+
+    return err;
+}
+
+// conv2, flattened for the classifier
+static cgrad_error conv_stage_1(struct pipeline_stage *stage, const size_t start, const size_t end, struct tensor *const input, struct tensor **const output, void *args)
+{
+    struct conv_stage_args *stage_args = (struct conv_stage_args *)args;
+    struct tensor_allocator *tensor_alloc = &stage->tensor_alloc;
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *h2 = NULL;
+    if ((err = conv2d_forward(&stage_args->conv, input, &h2, stage_args->intermediates, true)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    size_t flattened_shape[] = {end - start, 2304};
+    err = tensor_reshape(h2, flattened_shape, 2, output, true, &stage->allocs);
+    tensor_allocator_free(tensor_alloc, h2);
+    tensor_list_free_all(stage_args->intermediates, tensor_alloc);
+
+    return err;
+}
+
+// linear1, then the loss against the labels of the micro-batch
+static cgrad_error conv_stage_2(struct pipeline_stage *stage, const size_t start, const size_t end, struct tensor *const input, struct tensor **const output, void *args)
+{
+    struct conv_stage_args *stage_args = (struct conv_stage_args *)args;
+    struct tensor_allocator *tensor_alloc = &stage->tensor_alloc;
+    struct indexes_batch micro_batch = {stage_args->ixs_batch->indexes + start, end - start, end - start};
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *x = NULL;
+    struct tensor *y = NULL;
+    if ((err = csv_dataset_sample_batch(stage_args->train_set, &x, &y, &micro_batch, stage_args->dtype, tensor_alloc)) != NO_ERROR)
+    {
+        return err;
+    }
+    tensor_allocator_free(tensor_alloc, x);
+
+    struct tensor *h3 = NULL;
+    if ((err = linear_forward(&stage_args->linear, input, &h3, stage_args->intermediates, true)) == NO_ERROR)
+    {
+        err = cross_entropy_loss(h3, y, output, true, &stage->allocs);
+        tensor_allocator_free(tensor_alloc, h3);
+    }
+    tensor_allocator_free(tensor_alloc, y);
+    tensor_list_free_all(stage_args->intermediates, tensor_alloc);
+
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [n_micro_batches]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t n_micro_batches = argc == 3 ? strtoul(argv[2], NULL, 10) : 4;
+
+    const int SEED = 42;
+    init_random_seed(SEED);
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    // Allocator initialization
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    const size_t BATCH_SIZE = 64;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct conv2d conv1;
+    const size_t CONV1_IN_CHANNELS = 1;
+    const size_t CONV1_OUT_CHANNELS = 4;
+    const size_t CONV1_KERNEL_SIZE = 3;
+    if (conv2d_init(&conv1, CONV1_IN_CHANNELS, CONV1_OUT_CHANNELS, CONV1_KERNEL_SIZE, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (conv2d_xavier_init(&conv1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct conv2d conv2;
+    const size_t CONV2_OUT_CHANNELS = 4;
+    const size_t CONV2_KERNEL_SIZE = 3;
+    if (conv2d_init(&conv2, CONV1_OUT_CHANNELS, CONV2_OUT_CHANNELS, CONV2_KERNEL_SIZE, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (conv2d_xavier_init(&conv2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear1;
+    const size_t LINEAR1_IN = 2304;
+    if (linear_init(&linear1, LINEAR1_IN, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, conv1.weight);
+    add_model_param(&params, conv2.weight);
+    add_model_param(&params, linear1.weight);
+
+    // Setup optimizer
+    struct sgd_optimizer opt;
+    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    double lr = 3e-4;
+    double momentum = 0.9;
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // conv1 -> relu | conv2 -> flatten | linear1 -> loss, the layers of each stage on its allocators
+    struct conv_stage_args stage_args[N_STAGES];
+    for (size_t s = 0; s < N_STAGES; s++)
+    {
+        stage_args[s] = (struct conv_stage_args){.train_set = train_set, .ixs_batch = ixs_batch, .dtype = DTYPE};
+        stage_args[s].intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
+        if (!stage_args[s].intermediates)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    stage_args[0].conv = conv1;
+    stage_args[1].conv = conv2;
+    stage_args[2].linear = linear1;
+
+    const pipeline_stage_fn stage_fns[N_STAGES] = {conv_stage_0, conv_stage_1, conv_stage_2};
+    void *stage_fn_args[N_STAGES] = {&stage_args[0], &stage_args[1], &stage_args[2]};
+
+    // Keep BLAS single-threaded, e.g. OPENBLAS_NUM_THREADS=1, so that stages stay on their cores
+    struct pipeline pipe;
+    if (pipeline_init(&pipe, N_STAGES, stage_fns, stage_fn_args) != NO_ERROR)
+    {
+        fprintf(stderr, "Cannot start %d pipeline stages.\n", N_STAGES);
+        return EXIT_FAILURE;
+    }
+    stage_args[0].conv.allocs = &pipe.stages[0].allocs;
+    stage_args[1].conv.allocs = &pipe.stages[1].allocs;
+    stage_args[2].linear.allocs = &pipe.stages[2].allocs;
+
+    struct timespec begin, finish;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    size_t n_samples = 0;
+    size_t epochs = 2;
+    for (size_t epoch = 0; epoch < epochs; epoch++)
+    {
+        struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+        if (!permutation)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (indexes_permutation_init(permutation) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        size_t iteration = 0;
+        while (!index_permutation_is_terminated(permutation))
+        {
+            size_t remaining = index_permutation_get_remaining(permutation);
+            size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+            if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            // Micro-batches flow through the stages, each stage accumulating the gradients of its layers
+            const size_t iter_micro_batches = n_micro_batches < iter_batch_size ? n_micro_batches : iter_batch_size;
+            zero_grad(&params);
+            if (pipeline_step(&pipe, iter_batch_size, iter_micro_batches) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            if (iteration % OUTPUT_ITERATION_FREQ == 0)
+            {
+                printf("epoch %02ld, iteration %04ld - loss: %f\n", epoch, iteration, pipe.loss);
+            }
+
+            sgd_optimizer_step(&opt, lr, momentum, false);
+
+            n_samples += iter_batch_size;
+            index_permutation_update(permutation, iter_batch_size);
+            iteration++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    const double elapsed = (finish.tv_sec - begin.tv_sec) + (finish.tv_nsec - begin.tv_nsec) * 1e-9;
+    printf("%d stages, %zu micro-batches: %.0f samples/s\n", N_STAGES, n_micro_batches, n_samples / elapsed);
+
+    // Cleanup
+    pipeline_cleanup(&pipe);
+    for (size_t s = 0; s < N_STAGES; s++)
+    {
+        free(stage_args[s].intermediates->data);
+        free(stage_args[s].intermediates);
+    }
+    sgd_optimizer_cleanup(&opt);
+    conv2d_cleanup(&conv1);
+    conv2d_cleanup(&conv2);
+    linear_cleanup(&linear1);
+    model_params_cleanup(&params);
+    indexes_batch_free(ixs_batch);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/tensor/tensor_get.h"
 #include "cgrad/optimizers/sgd.h"
+#include "cgrad/optimizers/grad_clip.h"
 #include "cgrad/dataset/csv_dataset.h"
 #include "cgrad/dataset/indexes_permutation.h"
 #include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
@@ -20,12 +21,15 @@
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [max_grad_norm]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
+    // Gradients are only clipped on request, e.g. 5.0
+    const double max_grad_norm = argc == 3 ? strtod(argv[2], NULL) : 0;
+
     const int SEED = 42;
     init_random_seed(SEED);
 
@@ -44,7 +48,7 @@ int main(int argc, char **argv)
     struct computational_graph_allocator graph_alloc;
     computational_graph_cpu_allocator_init(&graph_alloc);
 
-    struct allocators allocs = {&tensor_alloc, &graph_alloc};
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
 
     const size_t INTERMEDIATES_CAPACITY = 20;
     struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
@@ -164,6 +168,11 @@ int main(int argc, char **argv)
             zero_grad(&params);
             backward(z, &allocs);
 
+            // The clipping factor is applied by the update itself, the gradients are not rescaled
+            if (max_grad_norm > 0 && grad_clip_global_norm(&params, max_grad_norm, &opt.grad_scale, NULL) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
             sgd_optimizer_step(&opt, lr, momentum, false);
 
             // Clear iteration allocations
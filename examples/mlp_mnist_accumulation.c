@@ -0,0 +1,233 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/accumulation/gradient_accumulation.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+
+struct mlp_micro_batch_args
+{
+    const struct csv_dataset *train_set;
+    struct indexes_batch *ixs_batch;
+    struct linear *linear1;
+    struct linear *linear2;
+    cgrad_dtype dtype;
+    struct tensor_list *intermediates;
+    struct allocators *allocs;
+};
+
+// Forward of the samples [start, end) of the batch, leaving alive only the loss and its graph
+static cgrad_error mlp_micro_batch(const size_t start, const size_t end, struct tensor **const loss, void *args)
+{
+    struct mlp_micro_batch_args *micro_args = (struct mlp_micro_batch_args *)args;
+    struct tensor_allocator *tensor_alloc = micro_args->allocs->tensor_alloc;
+    struct tensor_list *intermediates = micro_args->intermediates;
+
+    struct indexes_batch micro_batch = {micro_args->ixs_batch->indexes + start, end - start, end - start};
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *x = NULL;
+    struct tensor *y = NULL;
+    if ((err = csv_dataset_sample_batch(micro_args->train_set, &x, &y, &micro_batch, micro_args->dtype, tensor_alloc)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *h1 = NULL;
+    struct tensor *h2 = NULL;
+    struct tensor *h3 = NULL;
+    if ((err = linear_forward(micro_args->linear1, x, &h1, intermediates, true)) != NO_ERROR ||
+        (err = relu_forward(h1, &h2, true, micro_args->allocs)) != NO_ERROR ||
+        (err = linear_forward(micro_args->linear2, h2, &h3, intermediates, true)) != NO_ERROR ||
+        (err = cross_entropy_loss(h3, y, loss, true, micro_args->allocs)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Clear micro-batch allocations, the graph keeps alive what backward needs
+    tensor_list_free_all(intermediates, tensor_alloc);
+    tensor_allocator_free(tensor_alloc, x);
+    tensor_allocator_free(tensor_alloc, y);
+    tensor_allocator_free(tensor_alloc, h1);
+    tensor_allocator_free(tensor_alloc, h2);
+    tensor_allocator_free(tensor_alloc, h3);
+    intermediates->size = 0;
+
+    return NO_ERROR;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [n_micro_batches]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t n_micro_batches = argc == 3 ? strtoul(argv[2], NULL, 10) : 4;
+
+    const int SEED = 42;
+    init_random_seed(SEED);
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    // Allocator initialization
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct linear linear1;
+    if (linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear2;
+    if (linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, linear1.weight);
+    add_model_param(&params, linear1.bias);
+    add_model_param(&params, linear2.weight);
+    add_model_param(&params, linear2.bias);
+
+    if (model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup optimizer
+    struct sgd_optimizer opt;
+    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    double lr = 3e-4;
+    double momentum = 0.9;
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct mlp_micro_batch_args micro_args = {train_set, ixs_batch, &linear1, &linear2, DTYPE, intermediates, &allocs};
+
+    struct timespec begin, finish;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    size_t n_samples = 0;
+    size_t epochs = 1;
+    for (size_t epoch = 0; epoch < epochs; epoch++)
+    {
+        struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+        if (!permutation)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (indexes_permutation_init(permutation) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        size_t iteration = 0;
+        while (!index_permutation_is_terminated(permutation))
+        {
+            size_t remaining = index_permutation_get_remaining(permutation);
+            size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+            if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            // Gradients of the micro-batches add up to those of the batch, then a single step
+            const size_t iter_micro_batches = n_micro_batches < iter_batch_size ? n_micro_batches : iter_batch_size;
+            double loss = 0;
+            zero_grad(&params);
+            if (gradient_accumulation_step(iter_batch_size, iter_micro_batches, mlp_micro_batch, &micro_args, &allocs, &loss) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            if (iteration % OUTPUT_ITERATION_FREQ == 0)
+            {
+                printf("epoch %02ld, iteration %04ld - loss: %f\n", epoch, iteration, loss);
+            }
+
+            sgd_optimizer_step(&opt, lr, momentum, false);
+
+            n_samples += iter_batch_size;
+            index_permutation_update(permutation, iter_batch_size);
+            iteration++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    const double elapsed = (finish.tv_sec - begin.tv_sec) + (finish.tv_nsec - begin.tv_nsec) * 1e-9;
+    printf("%zu micro-batches: %.0f samples/s\n", n_micro_batches, n_samples / elapsed);
+
+    // Cleanup
+    free(intermediates->data);
+    free(intermediates);
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    model_params_cleanup(&params);
+    indexes_batch_free(ixs_batch);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
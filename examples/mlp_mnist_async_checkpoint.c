@@ -0,0 +1,324 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/model/model_checkpoint.h"
+#include "cgrad/model/model_checkpoint_writer.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+
+enum checkpoint_mode
+{
+    CHECKPOINT_NONE,
+    CHECKPOINT_SYNC,
+    CHECKPOINT_ASYNC,
+};
+
+static double elapsed_ms(const struct timespec *const begin, const struct timespec *const finish)
+{
+    return (finish->tv_sec - begin->tv_sec) * 1e3 + (finish->tv_nsec - begin->tv_nsec) * 1e-6;
+}
+
+// Whether the checkpoint at path holds exactly the data of the tensors
+static bool checkpoint_matches(const char *const path, struct tensor *const *const tensors, const size_t n_tensors)
+{
+    struct model_checkpoint ckpt;
+    if (model_checkpoint_open(&ckpt, path, false) != NO_ERROR)
+    {
+        return false;
+    }
+
+    bool is_matching = ckpt.n_tensors == n_tensors;
+    for (size_t i = 0; is_matching && i < n_tensors; i++)
+    {
+        const struct model_checkpoint_entry *entry = &ckpt.entries[i];
+        is_matching = entry->data_size == tensors[i]->data_size &&
+                      memcmp((char *)ckpt.map + entry->offset, tensors[i]->data, tensors[i]->data_size * dtype_sizeof(tensors[i]->dtype)) == 0;
+    }
+    model_checkpoint_close(&ckpt);
+
+    return is_matching;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 5)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> <checkpoint_path> [none|sync|async] [checkpoint_interval]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    enum checkpoint_mode mode = CHECKPOINT_ASYNC;
+    if (argc >= 4)
+    {
+        if (strcmp(argv[3], "none") == 0)
+        {
+            mode = CHECKPOINT_NONE;
+        }
+        else if (strcmp(argv[3], "sync") == 0)
+        {
+            mode = CHECKPOINT_SYNC;
+        }
+        else if (strcmp(argv[3], "async") != 0)
+        {
+            fprintf(stderr, "Unknown checkpoint mode %s.\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+    }
+    const size_t checkpoint_interval = argc == 5 ? strtoul(argv[4], NULL, 10) : 10;
+    if (checkpoint_interval == 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const int SEED = 42;
+    init_random_seed(SEED);
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    // Allocator initialization
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct linear linear1;
+    if (linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear2;
+    if (linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, linear1.weight);
+    add_model_param(&params, linear1.bias);
+    add_model_param(&params, linear2.weight);
+    add_model_param(&params, linear2.bias);
+
+    if (model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup optimizer
+    struct sgd_optimizer opt;
+    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    double lr = 3e-4;
+    double momentum = 0.9;
+
+    // Checkpoints hold the parameters, then the momentum as a view on the flat buffer of the optimizer
+    struct tensor *checkpoint_tensors[MODEL_MAX_PARAMS + 1];
+    for (size_t i = 0; i < params.size; i++)
+    {
+        checkpoint_tensors[i] = params.params[i];
+    }
+    struct tensor *momentum_state = tensor_allocator_no_grad_alloc(&tensor_alloc, &params.flat_size, 1, params.flat_dtype);
+    if (!momentum_state)
+    {
+        return EXIT_FAILURE;
+    }
+    tensor_allocator_free_data(&tensor_alloc, momentum_state);
+    momentum_state->data = opt.flat_momentum;
+    momentum_state->is_view = true;
+    checkpoint_tensors[params.size] = momentum_state;
+    const size_t n_checkpoint_tensors = params.size + 1;
+
+    struct model_checkpoint_writer writer;
+    if (model_checkpoint_writer_init(&writer) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+    if (!permutation)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (indexes_permutation_init(permutation) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // ------------- Training, one epoch -------------
+    double total_step_ms = 0;
+    double max_step_ms = 0;
+    double total_checkpoint_step_ms = 0;
+    size_t n_checkpoints = 0;
+    size_t iteration = 0;
+    while (!index_permutation_is_terminated(permutation))
+    {
+        struct timespec begin, finish;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+
+        size_t remaining = index_permutation_get_remaining(permutation);
+        size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+        if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE, &tensor_alloc) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *h1 = NULL;
+        struct tensor *h2 = NULL;
+        struct tensor *h3 = NULL;
+        struct tensor *z = NULL;
+        if (linear_forward(&linear1, x, &h1, intermediates, true) != NO_ERROR ||
+            relu_forward(h1, &h2, true, &allocs) != NO_ERROR ||
+            linear_forward(&linear2, h2, &h3, intermediates, true) != NO_ERROR ||
+            cross_entropy_loss(h3, y, &z, true, &allocs) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (iteration % OUTPUT_ITERATION_FREQ == 0)
+        {
+            float loss;
+            tensor2d_get(z, 0, 0, &loss);
+            printf("iteration %04ld - loss: %f\n", iteration, loss);
+        }
+
+        // Clear iteration allocations, the graph keeps alive what backward needs
+        tensor_list_free_all(intermediates, &tensor_alloc);
+        tensor_allocator_free(&tensor_alloc, x);
+        tensor_allocator_free(&tensor_alloc, y);
+        tensor_allocator_free(&tensor_alloc, h1);
+        tensor_allocator_free(&tensor_alloc, h2);
+        tensor_allocator_free(&tensor_alloc, h3);
+        intermediates->size = 0;
+
+        zero_grad(&params);
+        backward(z, &allocs);
+        sgd_optimizer_step(&opt, lr, momentum, false);
+        tensor_allocator_free(&tensor_alloc, z);
+
+        // Checkpoints are taken between steps, when parameters and momentum are consistent
+        const bool is_checkpoint_step = (iteration + 1) % checkpoint_interval == 0 && mode != CHECKPOINT_NONE;
+        if (is_checkpoint_step)
+        {
+            const cgrad_error err = mode == CHECKPOINT_SYNC
+                ? model_checkpoint_save_tensors(checkpoint_tensors, n_checkpoint_tensors, argv[2])
+                : model_checkpoint_writer_snapshot(&writer, checkpoint_tensors, n_checkpoint_tensors, argv[2]);
+            if (err != NO_ERROR)
+            {
+                fprintf(stderr, "Error while trying to save %s.\n", argv[2]);
+                return EXIT_FAILURE;
+            }
+            n_checkpoints++;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &finish);
+        const double step_ms = elapsed_ms(&begin, &finish);
+        total_step_ms += step_ms;
+        max_step_ms = step_ms > max_step_ms ? step_ms : max_step_ms;
+        total_checkpoint_step_ms += is_checkpoint_step ? step_ms : 0;
+
+        index_permutation_update(permutation, iter_batch_size);
+        iteration++;
+    }
+
+    const char *mode_names[] = {"none", "sync", "async"};
+    printf("%s checkpoints: %zu, mean step %.3f ms, max step %.3f ms", mode_names[mode], n_checkpoints, total_step_ms / iteration, max_step_ms);
+    if (n_checkpoints > 0)
+    {
+        printf(", mean checkpointing step %.3f ms", total_checkpoint_step_ms / n_checkpoints);
+    }
+    printf("\n");
+
+    // The last checkpoint must hold the state once training is over
+    if (mode != CHECKPOINT_NONE)
+    {
+        if (model_checkpoint_writer_snapshot(&writer, checkpoint_tensors, n_checkpoint_tensors, argv[2]) != NO_ERROR ||
+            model_checkpoint_writer_wait(&writer) != NO_ERROR)
+        {
+            fprintf(stderr, "Error while trying to save %s.\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        printf("last checkpoint matches: %s\n", checkpoint_matches(argv[2], checkpoint_tensors, n_checkpoint_tensors) ? "yes" : "no");
+    }
+
+    // Cleanup
+    free(intermediates->data);
+    free(intermediates);
+    model_checkpoint_writer_cleanup(&writer);
+    tensor_allocator_free(&tensor_alloc, momentum_state);
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    model_params_cleanup(&params);
+    indexes_batch_free(ixs_batch);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,319 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/model/model_checkpoint.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+
+// Mean loss and accuracy over the whole dataset, in order
+static cgrad_error mlp_evaluate(const struct csv_dataset *const train_set, struct linear *const linear1, struct linear *const linear2, struct indexes_batch *const ixs_batch,
+                                struct tensor_list *const intermediates, struct allocators *const allocs, double *const loss, double *const accuracy)
+{
+    struct tensor_allocator *tensor_alloc = allocs->tensor_alloc;
+    const size_t num_classes = linear2->weight->shape[1];
+
+    double total_loss = 0;
+    size_t correct = 0;
+    for (size_t start = 0; start < train_set->rows; start += ixs_batch->capacity)
+    {
+        const size_t remaining = train_set->rows - start;
+        ixs_batch->size = remaining < ixs_batch->capacity ? remaining : ixs_batch->capacity;
+        for (size_t i = 0; i < ixs_batch->size; i++)
+        {
+            ixs_batch->indexes[i] = start + i;
+        }
+
+        cgrad_error err = NO_ERROR;
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if ((err = csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, linear1->weight->dtype, tensor_alloc)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        struct tensor *h1 = NULL;
+        struct tensor *h2 = NULL;
+        struct tensor *h3 = NULL;
+        struct tensor *z = NULL;
+        if ((err = linear_forward(linear1, x, &h1, intermediates, false)) != NO_ERROR ||
+            (err = relu_forward(h1, &h2, false, allocs)) != NO_ERROR ||
+            (err = linear_forward(linear2, h2, &h3, intermediates, false)) != NO_ERROR ||
+            (err = cross_entropy_loss(h3, y, &z, false, allocs)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        float batch_loss;
+        tensor2d_get(z, 0, 0, &batch_loss);
+        total_loss += batch_loss * ixs_batch->size;
+
+        for (size_t i = 0; i < ixs_batch->size; i++)
+        {
+            size_t predicted = 0;
+            float best_logit, logit, label;
+            tensor2d_get(h3, i, 0, &best_logit);
+            for (size_t j = 1; j < num_classes; j++)
+            {
+                tensor2d_get(h3, i, j, &logit);
+                if (logit > best_logit)
+                {
+                    best_logit = logit;
+                    predicted = j;
+                }
+            }
+            tensor2d_get(y, i, 0, &label);
+            correct += predicted == (size_t)label;
+        }
+
+        tensor_list_free_all(intermediates, tensor_alloc);
+        tensor_allocator_free(tensor_alloc, x);
+        tensor_allocator_free(tensor_alloc, y);
+        tensor_allocator_free(tensor_alloc, h1);
+        tensor_allocator_free(tensor_alloc, h2);
+        tensor_allocator_free(tensor_alloc, h3);
+        tensor_allocator_free(tensor_alloc, z);
+        intermediates->size = 0;
+    }
+
+    *loss = total_loss / train_set->rows;
+    *accuracy = (double)correct / train_set->rows;
+
+    return NO_ERROR;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> <checkpoint_path>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const int SEED = 42;
+    init_random_seed(SEED);
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    // Allocator initialization
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct linear linear1;
+    if (linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear2;
+    if (linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, linear1.weight);
+    add_model_param(&params, linear1.bias);
+    add_model_param(&params, linear2.weight);
+    add_model_param(&params, linear2.bias);
+
+    // Setup optimizer
+    struct sgd_optimizer opt;
+    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    double lr = 3e-4;
+    double momentum = 0.9;
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+    if (!permutation)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (indexes_permutation_init(permutation) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // ------------- Training, one epoch -------------
+    size_t iteration = 0;
+    while (!index_permutation_is_terminated(permutation))
+    {
+        size_t remaining = index_permutation_get_remaining(permutation);
+        size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+        if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE, &tensor_alloc) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *h1 = NULL;
+        struct tensor *h2 = NULL;
+        struct tensor *h3 = NULL;
+        struct tensor *z = NULL;
+        if (linear_forward(&linear1, x, &h1, intermediates, true) != NO_ERROR ||
+            relu_forward(h1, &h2, true, &allocs) != NO_ERROR ||
+            linear_forward(&linear2, h2, &h3, intermediates, true) != NO_ERROR ||
+            cross_entropy_loss(h3, y, &z, true, &allocs) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (iteration % OUTPUT_ITERATION_FREQ == 0)
+        {
+            float loss;
+            tensor2d_get(z, 0, 0, &loss);
+            printf("iteration %04ld - loss: %f\n", iteration, loss);
+        }
+
+        // Clear iteration allocations, the graph keeps alive what backward needs
+        tensor_list_free_all(intermediates, &tensor_alloc);
+        tensor_allocator_free(&tensor_alloc, x);
+        tensor_allocator_free(&tensor_alloc, y);
+        tensor_allocator_free(&tensor_alloc, h1);
+        tensor_allocator_free(&tensor_alloc, h2);
+        tensor_allocator_free(&tensor_alloc, h3);
+        intermediates->size = 0;
+
+        zero_grad(&params);
+        backward(z, &allocs);
+        sgd_optimizer_step(&opt, lr, momentum, false);
+        tensor_allocator_free(&tensor_alloc, z);
+
+        index_permutation_update(permutation, iter_batch_size);
+        iteration++;
+    }
+
+    double loss, accuracy;
+    if (mlp_evaluate(train_set, &linear1, &linear2, ixs_batch, intermediates, &allocs, &loss, &accuracy) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("trained model - loss: %f, accuracy: %f\n", loss, accuracy);
+
+    if (model_checkpoint_save(&params, argv[2]) != NO_ERROR)
+    {
+        fprintf(stderr, "Error while trying to save %s.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    // ------------- Loading into a fresh model -------------
+    struct linear loaded1;
+    struct linear loaded2;
+    if (linear_init(&loaded1, INPUT_DIM, HIDDEN_DIM, DTYPE, &allocs) != NO_ERROR ||
+        linear_init(&loaded2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct model_params loaded_params;
+    model_params_init(&loaded_params);
+    add_model_param(&loaded_params, loaded1.weight);
+    add_model_param(&loaded_params, loaded1.bias);
+    add_model_param(&loaded_params, loaded2.weight);
+    add_model_param(&loaded_params, loaded2.bias);
+
+    // Parameters are views on the mapped file, only the pages touched are ever read
+    struct timespec begin, finish;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    struct model_checkpoint ckpt;
+    if (model_checkpoint_open(&ckpt, argv[2], false) != NO_ERROR ||
+        model_checkpoint_load(&ckpt, &loaded_params, &tensor_alloc) != NO_ERROR)
+    {
+        fprintf(stderr, "Error while trying to load %s.\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    const double elapsed = (finish.tv_sec - begin.tv_sec) + (finish.tv_nsec - begin.tv_nsec) * 1e-9;
+    printf("loaded %zu tensors (%zu bytes) in %.3f ms\n", ckpt.n_tensors, ckpt.map_size, elapsed * 1e3);
+
+    if (mlp_evaluate(train_set, &loaded1, &loaded2, ixs_batch, intermediates, &allocs, &loss, &accuracy) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("loaded model - loss: %f, accuracy: %f\n", loss, accuracy);
+
+    // Cleanup
+    free(intermediates->data);
+    free(intermediates);
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    linear_cleanup(&loaded1);
+    linear_cleanup(&loaded2);
+    model_checkpoint_close(&ckpt);
+    model_params_cleanup(&params);
+    model_params_cleanup(&loaded_params);
+    indexes_batch_free(ixs_batch);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
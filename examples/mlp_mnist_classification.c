@@ -2,6 +2,9 @@
 #include "cgrad/layers/relu.h"
 #include "cgrad/losses/cross_entropy.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/tape/autograd_tape.h"
+#include "cgrad/graph/captured_graph.h"
+#include "cgrad/graph/captured_graph_passes.h"
 #include "cgrad/memory/allocators.h"
 #include "cgrad/model/model_params.h"
 #include "cgrad/tensor/tensor.h"
@@ -14,18 +17,53 @@
 #include "cgrad/utils/random.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 
 #define OUTPUT_ITERATION_FREQ 25
 
+// linear1 -> relu -> linear2, for inference on batches of batch_size samples
+static cgrad_error mlp_capture(struct captured_graph *const graph, const struct linear *const linear1, const struct linear *const linear2, const size_t batch_size)
+{
+    cgrad_error err = NO_ERROR;
+    if ((err = captured_graph_init(graph)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Inputs are bound in this order when running the graph
+    const size_t x_shape[] = {batch_size, linear1->in_dim};
+    captured_node_id x, w1, b1, w2, b2;
+    if ((err = captured_graph_input(graph, x_shape, 2, &x)) != NO_ERROR ||
+        (err = captured_graph_input(graph, linear1->weight->shape, 2, &w1)) != NO_ERROR ||
+        (err = captured_graph_input(graph, linear1->bias->shape, 2, &b1)) != NO_ERROR ||
+        (err = captured_graph_input(graph, linear2->weight->shape, 2, &w2)) != NO_ERROR ||
+        (err = captured_graph_input(graph, linear2->bias->shape, 2, &b2)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    captured_node_id h1, h2, h3;
+    if ((err = linear_capture(linear1, graph, x, w1, b1, &h1)) != NO_ERROR ||
+        (err = captured_graph_relu(graph, h1, &h2)) != NO_ERROR ||
+        (err = linear_capture(linear2, graph, h2, w2, b2, &h3)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return captured_graph_mark_output(graph, h3);
+}
+
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "8bit") == 0))
     {
-        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [8bit]\n", argv[0]);
         return EXIT_FAILURE;
     }
+    // Keeps the momentum on 8 bits per element, for a convergence comparison with the full precision run
+    const bool is_8bit = argc == 3;
 
     const int SEED = 42;
     init_random_seed(SEED);
@@ -45,7 +83,14 @@ int main(int argc, char **argv)
     struct computational_graph_allocator graph_alloc;
     computational_graph_cpu_allocator_init(&graph_alloc);
 
-    struct allocators allocs = {&tensor_alloc, &graph_alloc};
+    // Operations are recorded on a tape rather than linked in a graph
+    struct autograd_tape tape;
+    if (autograd_tape_init(&tape, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = &tape};
 
     const size_t INTERMEDIATES_CAPACITY = 20;
     struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
@@ -97,9 +142,15 @@ int main(int argc, char **argv)
     add_model_param(&params, linear2.weight);
     add_model_param(&params, linear2.bias);
 
+    // Parameters and gradients live in two contiguous buffers, zeroed and updated in one sweep
+    if (model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
     // Setup optimizer
     struct sgd_optimizer opt;
-    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    if ((is_8bit ? sgd_optimizer_init_8bit : sgd_optimizer_init)(&opt, &params, &tensor_alloc) != NO_ERROR)
     {
         return EXIT_FAILURE;
     }
@@ -186,32 +237,106 @@ int main(int argc, char **argv)
                 printf("epoch %02ld, iteration %04ld - loss: %f\n", epoch, iteration, loss);
             }
 
-            // ------------- Backward -------------
-            zero_grad(&params);
-            backward(z, &allocs);
-
-            sgd_optimizer_step(&opt, lr, momentum, false);
-
-            // Clear iteration allocations
+            // Clear iteration allocations, the tape keeps alive what backward needs
             tensor_list_free_all(intermediates, &tensor_alloc);
             tensor_allocator_free(&tensor_alloc, x);
             tensor_allocator_free(&tensor_alloc, y);
             tensor_allocator_free(&tensor_alloc, h1);
             tensor_allocator_free(&tensor_alloc, h2);
             tensor_allocator_free(&tensor_alloc, h3);
-            tensor_allocator_free(&tensor_alloc, z);
             intermediates->size = 0;
 
+            // ------------- Backward -------------
+            zero_grad(&params);
+            backward(z, &allocs);
+
+            sgd_optimizer_step(&opt, lr, momentum, false);
+
+            tensor_allocator_free(&tensor_alloc, z);
+
             index_permutation_update(permutation, iter_batch_size);
             iteration++;
         }
     }
 
+    // ------------- Evaluation -------------
+    // Untracked runs compute the bias addition and the ReLU of linear1 with a single kernel
+    struct captured_graph eval_graph;
+    if (mlp_capture(&eval_graph, &linear1, &linear2, BATCH_SIZE) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    const size_t n_fused = captured_graph_fuse_pointwise(&eval_graph, NULL);
+    const bool is_compiled = eval_graph.n_fusions > 0 && pointwise_kernel_is_compiled(&eval_graph.fusions[0].kernel);
+    printf("fused %zu pointwise nodes into %zu kernels (%s)\n", n_fused, eval_graph.n_fusions, is_compiled ? "compiled" : "interpreted");
+
+    struct indexes_permutation *eval_permutation = indexes_permutation_alloc(train_set->rows);
+    if (!eval_permutation || indexes_permutation_init(eval_permutation) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Shapes are fixed at capture, the last incomplete batch is left out
+    size_t correct = 0;
+    size_t evaluated = 0;
+    while (index_permutation_get_remaining(eval_permutation) >= BATCH_SIZE)
+    {
+        if (indexes_permutation_sample_index_batch(eval_permutation, ixs_batch, BATCH_SIZE) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE, &tensor_alloc) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *inputs[] = {x, linear1.weight, linear1.bias, linear2.weight, linear2.bias};
+        struct tensor *logits = NULL;
+        if (captured_graph_run(&eval_graph, inputs, &logits, intermediates, false, &allocs) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        for (size_t i = 0; i < BATCH_SIZE; i++)
+        {
+            size_t predicted = 0;
+            float best_logit, logit, label;
+            tensor2d_get(logits, i, 0, &best_logit);
+            for (size_t j = 1; j < NUM_CLASSES; j++)
+            {
+                tensor2d_get(logits, i, j, &logit);
+                if (logit > best_logit)
+                {
+                    best_logit = logit;
+                    predicted = j;
+                }
+            }
+            tensor2d_get(y, i, 0, &label);
+            correct += predicted == (size_t)label;
+        }
+        evaluated += BATCH_SIZE;
+
+        tensor_list_free_all(intermediates, &tensor_alloc);
+        tensor_allocator_free(&tensor_alloc, x);
+        tensor_allocator_free(&tensor_alloc, y);
+        tensor_allocator_free(&tensor_alloc, logits);
+        intermediates->size = 0;
+
+        index_permutation_update(eval_permutation, BATCH_SIZE);
+    }
+    printf("train accuracy: %f\n", (double)correct / evaluated);
+
     // Cleanup
+    captured_graph_cleanup(&eval_graph);
     sgd_optimizer_cleanup(&opt);
     linear_cleanup(&linear1);
     linear_cleanup(&linear2);
+    model_params_cleanup(&params);
     indexes_batch_free(ixs_batch);
+    autograd_tape_cleanup(&tape);
     tensor_cpu_allocator_cleanup(&tensor_alloc);
     computational_graph_cpu_allocator_cleanup(&graph_alloc);
     return EXIT_SUCCESS;
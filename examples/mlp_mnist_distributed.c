@@ -0,0 +1,407 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/parallel/distributed.h"
+#include "cgrad/parallel/communicator/communicator_shm.h"
+#include "cgrad/parallel/communicator/communicator_tcp.h"
+#include "cgrad/parallel/compressor/gradient_compressor_int8.h"
+#include "cgrad/parallel/compressor/gradient_compressor_topk.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+#define INTERMEDIATES_CAPACITY 20
+#define TCP_BASE_PORT 29500
+/**
+ * Share of the gradient sent by topk. Top-k trades accuracy for traffic, mostly on short runs, before
+ * the residuals catch up. Train accuracy after one epoch of mnist_synth.csv on 2 shm ranks, against
+ * 0.493 with none (26.05 MB sent per rank) and int8 (6.61 MB):
+ *   ratio 0.01: 0.194 (0.52 MB)
+ *   ratio 0.05: 0.353 (2.61 MB)
+ *   ratio 0.1:  0.426 (5.21 MB)
+ *   ratio 0.25: 0.479 (13.03 MB)
+ */
+#define TOPK_RATIO 0.1
+
+/**
+ * Trains the MLP of mlp_mnist_classification over world_size processes, each computing the gradient of
+ * its shard of every batch, optionally exchanging compressed gradients. Prints the bytes each rank
+ * handed to the exchanges and the train accuracy, to weigh traffic against accuracy.
+ */
+
+static int train(const char *const path, struct communicator *const comm, const char *const compression);
+static double mlp_accuracy(const struct csv_dataset *train_set, struct linear *linear1, struct linear *linear2, struct indexes_batch *ixs_batch, struct tensor_list *intermediates, struct allocators *allocs);
+
+int main(int argc, char **argv)
+{
+    if (argc < 3 || argc > 5)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> <world_size> [shm|tcp] [none|topk|int8]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t world_size = strtoul(argv[2], NULL, 10);
+    const bool is_tcp = argc >= 4 && strcmp(argv[3], "tcp") == 0;
+    const char *compression = argc == 5 ? argv[4] : "none";
+    if (world_size == 0)
+    {
+        fprintf(stderr, "World size must be positive.\n");
+        return EXIT_FAILURE;
+    }
+
+    // The launcher is rank 0, and forks the other ranks
+    char shm_name[64];
+    snprintf(shm_name, sizeof(shm_name), "/cgrad_mlp_%ld", (long)getpid());
+    size_t rank = 0;
+    for (size_t r = 1; r < world_size; r++)
+    {
+        const pid_t pid = fork();
+        if (pid < 0)
+        {
+            fprintf(stderr, "Cannot start rank %zu.\n", r);
+            return EXIT_FAILURE;
+        }
+        if (pid == 0)
+        {
+            rank = r;
+            break;
+        }
+    }
+
+    struct communicator comm;
+    const cgrad_error err = is_tcp ? communicator_tcp_init(&comm, "127.0.0.1", TCP_BASE_PORT, rank, world_size)
+                                   : communicator_shm_init(&comm, shm_name, rank, world_size);
+    if (err != NO_ERROR)
+    {
+        fprintf(stderr, "Rank %zu cannot join the others.\n", rank);
+        return EXIT_FAILURE;
+    }
+
+    int status = train(argv[1], &comm, compression);
+    communicator_cleanup(&comm);
+
+    if (rank == 0)
+    {
+        for (size_t r = 1; r < world_size; r++)
+        {
+            int rank_status;
+            if (wait(&rank_status) < 0 || !WIFEXITED(rank_status) || WEXITSTATUS(rank_status) != EXIT_SUCCESS)
+            {
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    return status;
+}
+
+// Every rank builds the same model from the same seed, and samples the same batches, of which it takes its own shard
+static int train(const char *const path, struct communicator *const comm, const char *const compression)
+{
+    const size_t rank = comm->rank;
+    const size_t world_size = comm->world_size;
+
+    const int SEED = 42;
+    init_random_seed(SEED);
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    // Allocator initialization
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(path);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", path);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct linear linear1;
+    if (linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear2;
+    if (linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, linear1.weight);
+    add_model_param(&params, linear1.bias);
+    add_model_param(&params, linear2.weight);
+    add_model_param(&params, linear2.bias);
+
+    if (model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Buckets are ranges of the flat gradients, so they are set up once the parameters found their final place
+    struct distributed_trainer dist;
+    if (distributed_init(&dist, &params, comm) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Residuals span the flat gradients, each rank rounds with its own seed
+    struct gradient_compressor compressor = {0};
+    cgrad_error err = NO_ERROR;
+    if (strcmp(compression, "topk") == 0)
+    {
+        err = gradient_compressor_topk_init(&compressor, params.flat_size, TOPK_RATIO);
+    }
+    else if (strcmp(compression, "int8") == 0)
+    {
+        err = gradient_compressor_int8_init(&compressor, params.flat_size, SEED + rank);
+    }
+    if (err != NO_ERROR || (compressor.state && distributed_set_compressor(&dist, &compressor) != NO_ERROR))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup optimizer
+    struct sgd_optimizer opt;
+    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    double lr = 3e-4;
+    double momentum = 0.9;
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
+    if (!intermediates)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct timespec begin, finish;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    size_t n_samples = 0;
+    size_t epochs = 1;
+    for (size_t epoch = 0; epoch < epochs; epoch++)
+    {
+        struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+        if (!permutation)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (indexes_permutation_init(permutation) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        size_t iteration = 0;
+        while (!index_permutation_is_terminated(permutation))
+        {
+            size_t remaining = index_permutation_get_remaining(permutation);
+            size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+            if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            const size_t start = iter_batch_size * rank / world_size;
+            const size_t end = iter_batch_size * (rank + 1) / world_size;
+            const double share = (double)(end - start) / iter_batch_size;
+
+            zero_grad(&params);
+
+            // A rank without samples only takes part in the all-reduce
+            double loss = 0;
+            struct tensor *z = NULL;
+            if (end > start)
+            {
+                struct indexes_batch shard = {ixs_batch->indexes + start, end - start, end - start};
+
+                struct tensor *x = NULL;
+                struct tensor *y = NULL;
+                if (csv_dataset_sample_batch(train_set, &x, &y, &shard, DTYPE, &tensor_alloc) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+
+                struct tensor *h1 = NULL;
+                struct tensor *h2 = NULL;
+                struct tensor *h3 = NULL;
+                if (linear_forward(&linear1, x, &h1, intermediates, true) != NO_ERROR ||
+                    relu_forward(h1, &h2, true, &allocs) != NO_ERROR ||
+                    linear_forward(&linear2, h2, &h3, intermediates, true) != NO_ERROR ||
+                    cross_entropy_loss(h3, y, &z, true, &allocs) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+
+                float shard_loss;
+                tensor2d_get(z, 0, 0, &shard_loss);
+                loss = shard_loss * share;
+
+                // Clear iteration allocations, the graph keeps alive what backward needs
+                tensor_list_free_all(intermediates, &tensor_alloc);
+                tensor_allocator_free(&tensor_alloc, x);
+                tensor_allocator_free(&tensor_alloc, y);
+                tensor_allocator_free(&tensor_alloc, h1);
+                tensor_allocator_free(&tensor_alloc, h2);
+                tensor_allocator_free(&tensor_alloc, h3);
+                intermediates->size = 0;
+            }
+
+            // Gradients of the shards, weighted by their share, add up over the ranks to the gradient of the batch
+            if (distributed_backward(&dist, z, share, &allocs) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+            if (z)
+            {
+                tensor_allocator_free(&tensor_alloc, z);
+            }
+
+            if (communicator_all_reduce(comm, &loss, 1, DTYPE_FLOAT64) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            if (rank == 0 && iteration % OUTPUT_ITERATION_FREQ == 0)
+            {
+                printf("epoch %02ld, iteration %04ld - loss: %f\n", epoch, iteration, loss);
+            }
+
+            sgd_optimizer_step(&opt, lr, momentum, false);
+
+            n_samples += iter_batch_size;
+            index_permutation_update(permutation, iter_batch_size);
+            iteration++;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    const double elapsed = (finish.tv_sec - begin.tv_sec) + (finish.tv_nsec - begin.tv_nsec) * 1e-9;
+    const double accuracy = mlp_accuracy(train_set, &linear1, &linear2, ixs_batch, intermediates, &allocs);
+    if (rank == 0)
+    {
+        printf("%zu ranks, %s: %.0f samples/s, %.2f MB sent per rank, train accuracy %f\n", world_size, compression, n_samples / elapsed, dist.payload_bytes / 1e6, accuracy);
+    }
+
+    // Cleanup
+    free(intermediates->data);
+    free(intermediates);
+    distributed_cleanup(&dist);
+    gradient_compressor_cleanup(&compressor);
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    model_params_cleanup(&params);
+    indexes_batch_free(ixs_batch);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
+
+static double mlp_accuracy(const struct csv_dataset *train_set, struct linear *linear1, struct linear *linear2, struct indexes_batch *ixs_batch, struct tensor_list *intermediates, struct allocators *allocs)
+{
+    struct tensor_allocator *tensor_alloc = allocs->tensor_alloc;
+    size_t correct = 0;
+    for (size_t start = 0; start < train_set->rows; start += ixs_batch->capacity)
+    {
+        const size_t size = train_set->rows - start < ixs_batch->capacity ? train_set->rows - start : ixs_batch->capacity;
+        for (size_t i = 0; i < size; i++)
+        {
+            ixs_batch->indexes[i] = start + i;
+        }
+        ixs_batch->size = size;
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        struct tensor *h1 = NULL;
+        struct tensor *h2 = NULL;
+        struct tensor *logits = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE_FLOAT32, tensor_alloc) != NO_ERROR ||
+            linear_forward(linear1, x, &h1, intermediates, false) != NO_ERROR ||
+            relu_forward(h1, &h2, false, allocs) != NO_ERROR ||
+            linear_forward(linear2, h2, &logits, intermediates, false) != NO_ERROR)
+        {
+            return -1;
+        }
+
+        for (size_t i = 0; i < size; i++)
+        {
+            size_t predicted = 0;
+            float best_logit, logit, label;
+            tensor2d_get(logits, i, 0, &best_logit);
+            for (size_t j = 1; j < linear2->out_dim; j++)
+            {
+                tensor2d_get(logits, i, j, &logit);
+                if (logit > best_logit)
+                {
+                    best_logit = logit;
+                    predicted = j;
+                }
+            }
+            tensor2d_get(y, i, 0, &label);
+            correct += predicted == (size_t)label;
+        }
+
+        tensor_list_free_all(intermediates, tensor_alloc);
+        tensor_allocator_free(tensor_alloc, x);
+        tensor_allocator_free(tensor_alloc, y);
+        tensor_allocator_free(tensor_alloc, h1);
+        tensor_allocator_free(tensor_alloc, h2);
+        tensor_allocator_free(tensor_alloc, logits);
+        intermediates->size = 0;
+    }
+
+    return (double)correct / train_set->rows;
+}
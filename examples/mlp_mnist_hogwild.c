@@ -0,0 +1,335 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/parallel/data_parallel.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define INTERMEDIATES_CAPACITY 20
+
+/**
+ * Trains the same MLP for one epoch twice, from the same initial weights, with plain SGD: first
+ * synchronously, each batch split across the workers, then with Hogwild, each worker updating the
+ * shared weights with its own batches. Prints the throughput and the train accuracy of both.
+ */
+
+struct mlp_args
+{
+    const struct csv_dataset *train_set;
+    struct indexes_batch *ixs_batch;         /**< Batch of the synchronous step. */
+    const struct indexes_permutation *permutation;
+    size_t batch_size;
+    const struct linear *linear1;
+    const struct linear *linear2;
+    cgrad_dtype dtype;
+    struct tensor_list *intermediates[DATA_PARALLEL_MAX_WORKERS];
+};
+
+static cgrad_error mlp_forward_backward(struct data_parallel_worker *worker, struct mlp_args *args, struct indexes_batch *batch, const bool is_shard)
+{
+    struct tensor_allocator *tensor_alloc = &worker->tensor_alloc;
+    struct tensor_list *intermediates = args->intermediates[worker->index];
+
+    struct linear linear1 = *args->linear1;
+    linear1.weight = data_parallel_worker_replica(worker, linear1.weight);
+    linear1.bias = data_parallel_worker_replica(worker, linear1.bias);
+    linear1.allocs = &worker->allocs;
+
+    struct linear linear2 = *args->linear2;
+    linear2.weight = data_parallel_worker_replica(worker, linear2.weight);
+    linear2.bias = data_parallel_worker_replica(worker, linear2.bias);
+    linear2.allocs = &worker->allocs;
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *x = NULL;
+    struct tensor *y = NULL;
+    if ((err = csv_dataset_sample_batch(args->train_set, &x, &y, batch, args->dtype, tensor_alloc)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *h1 = NULL;
+    struct tensor *h2 = NULL;
+    struct tensor *h3 = NULL;
+    struct tensor *z = NULL;
+    if ((err = linear_forward(&linear1, x, &h1, intermediates, true)) != NO_ERROR ||
+        (err = relu_forward(h1, &h2, true, &worker->allocs)) != NO_ERROR ||
+        (err = linear_forward(&linear2, h2, &h3, intermediates, true)) != NO_ERROR ||
+        (err = cross_entropy_loss(h3, y, &z, true, &worker->allocs)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    float loss;
+    tensor2d_get(z, 0, 0, &loss);
+    worker->loss = loss;
+
+    tensor_list_free_all(intermediates, tensor_alloc);
+    tensor_allocator_free(tensor_alloc, x);
+    tensor_allocator_free(tensor_alloc, y);
+    tensor_allocator_free(tensor_alloc, h1);
+    tensor_allocator_free(tensor_alloc, h2);
+    tensor_allocator_free(tensor_alloc, h3);
+    intermediates->size = 0;
+
+    // Shards of a synchronous step are weighted by their share of the batch
+    err = is_shard ? data_parallel_worker_backward(worker, z) : backward(z, &worker->allocs);
+    tensor_allocator_free(tensor_alloc, z);
+
+    return err;
+}
+
+static cgrad_error mlp_shard(struct data_parallel_worker *worker, const size_t start, const size_t end, void *args)
+{
+    struct mlp_args *mlp_args = (struct mlp_args *)args;
+    struct indexes_batch shard = {mlp_args->ixs_batch->indexes + start, end - start, end - start};
+    return mlp_forward_backward(worker, mlp_args, &shard, true);
+}
+
+// Batches of Hogwild steps are consecutive slices of the permutation
+static cgrad_error mlp_sample(struct data_parallel_worker *worker, const size_t step, void *args)
+{
+    struct mlp_args *mlp_args = (struct mlp_args *)args;
+    const size_t start = step * mlp_args->batch_size;
+    const size_t remaining = mlp_args->permutation->size - start;
+    const size_t size = remaining < mlp_args->batch_size ? remaining : mlp_args->batch_size;
+
+    struct indexes_batch batch = {mlp_args->permutation->indexes + start, size, size};
+    return mlp_forward_backward(worker, mlp_args, &batch, false);
+}
+
+static double mlp_accuracy(const struct csv_dataset *train_set, struct linear *linear1, struct linear *linear2, struct indexes_batch *ixs_batch, struct tensor_list *intermediates, struct allocators *allocs)
+{
+    struct tensor_allocator *tensor_alloc = allocs->tensor_alloc;
+    size_t correct = 0;
+    for (size_t start = 0; start < train_set->rows; start += ixs_batch->capacity)
+    {
+        const size_t size = train_set->rows - start < ixs_batch->capacity ? train_set->rows - start : ixs_batch->capacity;
+        for (size_t i = 0; i < size; i++)
+        {
+            ixs_batch->indexes[i] = start + i;
+        }
+        ixs_batch->size = size;
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        struct tensor *h1 = NULL;
+        struct tensor *h2 = NULL;
+        struct tensor *logits = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE_FLOAT32, tensor_alloc) != NO_ERROR ||
+            linear_forward(linear1, x, &h1, intermediates, false) != NO_ERROR ||
+            relu_forward(h1, &h2, false, allocs) != NO_ERROR ||
+            linear_forward(linear2, h2, &logits, intermediates, false) != NO_ERROR)
+        {
+            return -1;
+        }
+
+        for (size_t i = 0; i < size; i++)
+        {
+            size_t predicted = 0;
+            float best_logit, logit, label;
+            tensor2d_get(logits, i, 0, &best_logit);
+            for (size_t j = 1; j < linear2->out_dim; j++)
+            {
+                tensor2d_get(logits, i, j, &logit);
+                if (logit > best_logit)
+                {
+                    best_logit = logit;
+                    predicted = j;
+                }
+            }
+            tensor2d_get(y, i, 0, &label);
+            correct += predicted == (size_t)label;
+        }
+
+        tensor_list_free_all(intermediates, tensor_alloc);
+        tensor_allocator_free(tensor_alloc, x);
+        tensor_allocator_free(tensor_alloc, y);
+        tensor_allocator_free(tensor_alloc, h1);
+        tensor_allocator_free(tensor_alloc, h2);
+        tensor_allocator_free(tensor_alloc, logits);
+        intermediates->size = 0;
+    }
+
+    return (double)correct / train_set->rows;
+}
+
+static double elapsed_seconds(const struct timespec *begin)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - begin->tv_sec) + (now.tv_nsec - begin->tv_nsec) * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [n_workers]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const size_t n_workers = argc == 3 ? strtoul(argv[2], NULL, 10) : 4;
+
+    const int SEED = 42;
+    init_random_seed(SEED);
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+    struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear1;
+    struct linear linear2;
+    if (linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &allocs) != NO_ERROR ||
+        linear_xavier_init(&linear1) != NO_ERROR ||
+        linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &allocs) != NO_ERROR ||
+        linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, linear1.weight);
+    add_model_param(&params, linear1.bias);
+    add_model_param(&params, linear2.weight);
+    add_model_param(&params, linear2.bias);
+
+    if (model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Both runs start from these weights
+    const size_t flat_bytes = params.flat_size * dtype_sizeof(params.flat_dtype);
+    void *initial_weights = malloc(flat_bytes);
+    if (!initial_weights)
+    {
+        return EXIT_FAILURE;
+    }
+    memcpy(initial_weights, params.flat_data, flat_bytes);
+
+    struct data_parallel_trainer trainer;
+    if (data_parallel_init(&trainer, &params, n_workers) != NO_ERROR)
+    {
+        fprintf(stderr, "Cannot start %zu workers.\n", n_workers);
+        return EXIT_FAILURE;
+    }
+
+    struct sgd_optimizer opt;
+    if (sgd_optimizer_init(&opt, &params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const double lr = 3e-3;
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+    if (!ixs_batch || !permutation || indexes_permutation_init(permutation) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct mlp_args args = {train_set, ixs_batch, permutation, BATCH_SIZE, &linear1, &linear2, DTYPE, {NULL}};
+    for (size_t w = 0; w < n_workers; w++)
+    {
+        if (!(args.intermediates[w] = tensor_list_alloc(INTERMEDIATES_CAPACITY)))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // ------------- Synchronous -------------
+    struct timespec begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    while (!index_permutation_is_terminated(permutation))
+    {
+        size_t remaining = index_permutation_get_remaining(permutation);
+        size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+        if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        zero_grad(&params);
+        if (data_parallel_step(&trainer, iter_batch_size, mlp_shard, &args) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+        sgd_optimizer_step(&opt, lr, 0, false);
+
+        index_permutation_update(permutation, iter_batch_size);
+    }
+    const double sync_seconds = elapsed_seconds(&begin);
+    const double sync_accuracy = mlp_accuracy(train_set, &linear1, &linear2, ixs_batch, intermediates, &allocs);
+    printf("synchronous, %zu workers: %.0f samples/s, last loss %f, train accuracy %f\n", n_workers, train_set->rows / sync_seconds, trainer.loss, sync_accuracy);
+
+    // ------------- Hogwild -------------
+    memcpy(params.flat_data, initial_weights, flat_bytes);
+    const size_t n_steps = (train_set->rows + BATCH_SIZE - 1) / BATCH_SIZE;
+
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    if (data_parallel_hogwild(&trainer, n_steps, lr, mlp_sample, &args) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    const double hogwild_seconds = elapsed_seconds(&begin);
+    const double hogwild_accuracy = mlp_accuracy(train_set, &linear1, &linear2, ixs_batch, intermediates, &allocs);
+    printf("hogwild,     %zu workers: %.0f samples/s, last loss %f, train accuracy %f\n", n_workers, train_set->rows / hogwild_seconds, trainer.loss, hogwild_accuracy);
+
+    // Cleanup
+    for (size_t w = 0; w < n_workers; w++)
+    {
+        free(args.intermediates[w]->data);
+        free(args.intermediates[w]);
+    }
+    free(initial_weights);
+    data_parallel_cleanup(&trainer);
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    model_params_cleanup(&params);
+    indexes_batch_free(ixs_batch);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
@@ -40,18 +40,19 @@ int main()
     struct computational_graph_allocator graph_alloc;
     computational_graph_cpu_allocator_init(&graph_alloc);
 
-    struct allocators allocs = {&tensor_alloc, &graph_alloc};
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
 
     const size_t INTERMEDIATES_CAPACITY = 20;
     struct tensor_list *intermediates = tensor_list_alloc(INTERMEDIATES_CAPACITY);
 
     size_t x_shape[] = {BATCH_SIZE, INPUT_DIM};
     size_t x_shape_size = 2;
-    struct tensor *x = tensor_allocator_alloc(&tensor_alloc, x_shape, x_shape_size, DTYPE);
+    // Data tensors need no gradient
+    struct tensor *x = tensor_allocator_no_grad_alloc(&tensor_alloc, x_shape, x_shape_size, DTYPE);
 
     size_t y_shape[] = {BATCH_SIZE, 1};
     size_t y_shape_size = 2;
-    struct tensor *y_target = tensor_allocator_alloc(&tensor_alloc, y_shape, y_shape_size, DTYPE);
+    struct tensor *y_target = tensor_allocator_no_grad_alloc(&tensor_alloc, y_shape, y_shape_size, DTYPE);
     if (!x || !y_target)
     {
         tensor_allocator_free(&tensor_alloc, x);
@@ -0,0 +1,198 @@
+#include "cgrad/optimizers/adam.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * A few Adam and AdamW steps against the closed form, computed in double:
+ *   g <- grad_scale * grad + l2 * w
+ *   m <- beta1 * m + (1 - beta1) * g
+ *   v <- beta2 * v + (1 - beta2) * g^2
+ *   w <- decay * w - lr * m_hat / (sqrt(v_hat) + eps)
+ * for float64, float32 and bfloat16 parameters, one tensor at a time and flattened. A frozen parameter
+ * must be left untouched.
+ */
+
+#define N_PARAMS 2
+#define N_STEPS 3
+#define MAX_PARAM_SIZE 40
+
+struct adam_case
+{
+    const char *name;
+    cgrad_dtype dtype;
+    bool is_flat;
+    bool is_decoupled;
+    double tolerance;
+};
+
+static double value_get(const struct tensor *const t, const size_t i)
+{
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return ((const double *)t->data)[i];
+    case DTYPE_BFLOAT16:
+        return bfloat16_to_float(((const bfloat16 *)t->data)[i]);
+    default:
+        return ((const float *)t->data)[i];
+    }
+}
+
+static void value_set(struct tensor *const t, const size_t i, const double value)
+{
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+        ((double *)t->data)[i] = value;
+        break;
+    case DTYPE_BFLOAT16:
+        ((bfloat16 *)t->data)[i] = bfloat16_from_float((float)value);
+        break;
+    default:
+        ((float *)t->data)[i] = (float)value;
+        break;
+    }
+}
+
+// Gradients change sign and magnitude from one step to the next, so that both moments matter
+static double gradient_at(const size_t param, const size_t i, const size_t step)
+{
+    return sin(0.7 * (double)(i + 1) + 1.3 * (double)step + (double)param) * (1.0 + 0.5 * (double)step);
+}
+
+static bool run_case(const struct adam_case *const c)
+{
+    const double lr = 1e-2;
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    const double eps = 1e-8;
+    const double weight_decay = 0.1;
+    const double grad_scale = 0.5;
+
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    const size_t shapes[N_PARAMS][2] = {{5, 8}, {1, 7}};
+    struct model_params params;
+    model_params_init(&params);
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        struct tensor *param = tensor_allocator_alloc(&tensor_alloc, shapes[p], 2, c->dtype);
+        if (!param || add_model_param(&params, param) != NO_ERROR)
+        {
+            return false;
+        }
+    }
+    if (c->is_flat && model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return false;
+    }
+
+    // Reference state, starting from the parameters as rounded to their dtype
+    double w[N_PARAMS][MAX_PARAM_SIZE];
+    double m[N_PARAMS][MAX_PARAM_SIZE] = {{0}};
+    double v[N_PARAMS][MAX_PARAM_SIZE] = {{0}};
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        for (size_t i = 0; i < params.params[p]->data_size; i++)
+        {
+            value_set(params.params[p], i, cos(0.3 * (double)i + (double)p));
+            w[p][i] = value_get(params.params[p], i);
+        }
+    }
+
+    // Not flattened, the second parameter is frozen
+    const size_t n_trainable = c->is_flat ? N_PARAMS : 1;
+    if (!c->is_flat)
+    {
+        params.params[1]->requires_grad = false;
+    }
+
+    struct adam_optimizer opt;
+    if (adam_optimizer_init(&opt, &params, beta1, beta2, eps, &tensor_alloc) != NO_ERROR)
+    {
+        return false;
+    }
+    opt.weight_decay = weight_decay;
+    opt.decoupled_weight_decay = c->is_decoupled;
+    opt.grad_scale = grad_scale;
+
+    const double l2 = c->is_decoupled ? 0 : weight_decay;
+    const double decay = c->is_decoupled ? 1 - lr * weight_decay : 1;
+    for (size_t step = 1; step <= N_STEPS; step++)
+    {
+        for (size_t p = 0; p < N_PARAMS; p++)
+        {
+            for (size_t i = 0; i < params.params[p]->data_size; i++)
+            {
+                value_set(params.params[p]->grad, i, gradient_at(p, i, step));
+            }
+        }
+
+        if (adam_optimizer_step(&opt, lr) != NO_ERROR)
+        {
+            return false;
+        }
+
+        const double correction1 = 1 - pow(beta1, (double)step);
+        const double correction2 = 1 - pow(beta2, (double)step);
+        for (size_t p = 0; p < n_trainable; p++)
+        {
+            for (size_t i = 0; i < params.params[p]->data_size; i++)
+            {
+                const double g = grad_scale * value_get(params.params[p]->grad, i) + l2 * w[p][i];
+                m[p][i] = beta1 * m[p][i] + (1 - beta1) * g;
+                v[p][i] = beta2 * v[p][i] + (1 - beta2) * g * g;
+                w[p][i] = decay * w[p][i] - lr * (m[p][i] / correction1) / (sqrt(v[p][i] / correction2) + eps);
+            }
+        }
+    }
+
+    bool is_correct = true;
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        for (size_t i = 0; i < params.params[p]->data_size; i++)
+        {
+            const double actual = value_get(params.params[p], i);
+            if (fabs(actual - w[p][i]) > c->tolerance * (1.0 + fabs(w[p][i])))
+            {
+                fprintf(stderr, "%s: parameter %zu element %zu is %.9g instead of %.9g\n", c->name, p, i, actual, w[p][i]);
+                is_correct = false;
+                break;
+            }
+        }
+    }
+
+    adam_optimizer_cleanup(&opt);
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        tensor_allocator_free(&tensor_alloc, params.params[p]);
+    }
+    model_params_cleanup(&params);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    return is_correct;
+}
+
+int main(void)
+{
+    // bfloat16 parameters are only the rounding of the float32 master copy
+    const struct adam_case cases[] = {
+        {"adam f64", DTYPE_FLOAT64, false, false, 1e-12},
+        {"adamw f64", DTYPE_FLOAT64, false, true, 1e-12},
+        {"adam f32", DTYPE_FLOAT32, false, false, 1e-5},
+        {"adamw f32", DTYPE_FLOAT32, false, true, 1e-5},
+        {"adamw f32 flat", DTYPE_FLOAT32, true, true, 1e-5},
+        {"adamw bf16", DTYPE_BFLOAT16, false, true, 1e-2},
+        {"adamw bf16 flat", DTYPE_BFLOAT16, true, true, 1e-2},
+    };
+
+    bool is_correct = true;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        is_correct = run_case(&cases[c]) && is_correct;
+    }
+
+    return is_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,175 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/losses/mse.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/checkpoint/checkpoint.h"
+#include "cgrad/autograd/tape/autograd_tape.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * A checkpointed segment fed straight with a no-grad batch, which has no gradient buffer: backward must
+ * still reach the parameters of the segment, with the gradients of the segment run without checkpoint,
+ * both when building the graph and when recording on a tape.
+ */
+
+#define BATCH_SIZE 5
+#define IN_DIM 4
+#define OUT_DIM 3
+
+static cgrad_error linear_segment(void *args, struct tensor *const x, struct tensor **const out, struct tensor_list *const intermediates, const bool track_grad)
+{
+    return linear_forward((struct linear *)args, x, out, intermediates, track_grad);
+}
+
+// Gradients of the parameters for the loss of the segment, run either checkpointed or not
+static cgrad_error segment_gradients(struct linear *const layer, struct checkpoint *const ckpt, struct tensor *const x, struct tensor *const y,
+                                     struct tensor_list *const intermediates, struct allocators *const allocs)
+{
+    cgrad_error err = NO_ERROR;
+    struct tensor *out = NULL;
+    if (ckpt)
+    {
+        err = checkpoint_forward(ckpt, x, &out, true);
+    }
+    else
+    {
+        err = linear_forward(layer, x, &out, intermediates, true);
+    }
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *z = NULL;
+    if ((err = mse_loss(out, y, &z, true, allocs)) != NO_ERROR)
+    {
+        return err;
+    }
+    tensor_allocator_free(allocs->tensor_alloc, out);
+
+    err = backward(z, allocs);
+    tensor_allocator_free(allocs->tensor_alloc, z);
+    tensor_list_free_all(intermediates, allocs->tensor_alloc);
+    intermediates->size = 0;
+
+    return err;
+}
+
+static bool grads_match(const struct tensor *const t, const float *const expected)
+{
+    const float *grad = (const float *)t->grad->data;
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        if (fabsf(grad[i] - expected[i]) > 1e-5f * (1.0f + fabsf(expected[i])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(void)
+{
+    init_random_seed(42);
+
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+    struct tensor_list *intermediates = tensor_list_alloc(8);
+
+    struct linear layer;
+    if (linear_init(&layer, IN_DIM, OUT_DIM, DTYPE_FLOAT32, &allocs) != NO_ERROR || linear_xavier_init(&layer) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, layer.weight);
+    add_model_param(&params, layer.bias);
+
+    // Input batches come without gradient
+    const size_t x_shape[] = {BATCH_SIZE, IN_DIM};
+    const size_t y_shape[] = {BATCH_SIZE, OUT_DIM};
+    struct tensor *x = tensor_allocator_no_grad_alloc(&tensor_alloc, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *y = tensor_allocator_no_grad_alloc(&tensor_alloc, y_shape, 2, DTYPE_FLOAT32);
+    if (!x || !y || x->grad)
+    {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        ((float *)x->data)[i] = (float)i / x->data_size - 0.5f;
+    }
+    for (size_t i = 0; i < y->data_size; i++)
+    {
+        ((float *)y->data)[i] = (float)(i % OUT_DIM) - 1.0f;
+    }
+
+    // Reference gradients, without checkpoint
+    zero_grad(&params);
+    if (segment_gradients(&layer, NULL, x, y, intermediates, &allocs) != NO_ERROR)
+    {
+        fprintf(stderr, "backward without checkpoint failed\n");
+        return EXIT_FAILURE;
+    }
+    float weight_grad[IN_DIM * OUT_DIM];
+    float bias_grad[OUT_DIM];
+    memcpy(weight_grad, layer.weight->grad->data, sizeof(weight_grad));
+    memcpy(bias_grad, layer.bias->grad->data, sizeof(bias_grad));
+
+    struct checkpoint ckpt;
+    if (checkpoint_init(&ckpt, &linear_segment, &layer, 8, &allocs) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct autograd_tape tape;
+    if (autograd_tape_init(&tape, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const char *modes[] = {"graph", "tape"};
+    for (size_t m = 0; m < 2; m++)
+    {
+        allocs.tape = m == 1 ? &tape : NULL;
+
+        zero_grad(&params);
+        cgrad_error err = segment_gradients(&layer, &ckpt, x, y, intermediates, &allocs);
+        if (err != NO_ERROR)
+        {
+            fprintf(stderr, "%s: backward through the checkpoint failed with error %d\n", modes[m], err);
+            return EXIT_FAILURE;
+        }
+        if (!grads_match(layer.weight, weight_grad) || !grads_match(layer.bias, bias_grad))
+        {
+            fprintf(stderr, "%s: checkpointed gradients differ from the reference\n", modes[m]);
+            return EXIT_FAILURE;
+        }
+    }
+    allocs.tape = NULL;
+    autograd_tape_cleanup(&tape);
+
+    checkpoint_cleanup(&ckpt);
+    tensor_allocator_free(&tensor_alloc, x);
+    tensor_allocator_free(&tensor_alloc, y);
+    linear_cleanup(&layer);
+    model_params_cleanup(&params);
+    free(intermediates->data);
+    free(intermediates);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
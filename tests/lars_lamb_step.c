@@ -0,0 +1,265 @@
+#include "cgrad/optimizers/lars.h"
+#include "cgrad/optimizers/lamb.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * A few LARS and LAMB steps against the closed form, computed in double, with one trust ratio per
+ * parameter:
+ *   LARS: trust = coef * ||w|| / (||grad_scale * grad|| + wd * ||w|| + eps)
+ *         b <- momentum * b + trust * (grad_scale * grad + wd * w), w <- w - lr * b
+ *   LAMB: r = m_hat / (sqrt(v_hat) + eps) + wd * w, trust = ||w|| / ||r||
+ *         w <- w - lr * trust * r
+ * for float64 and float32 parameters, one tensor at a time and flattened. A frozen parameter must be
+ * left untouched.
+ */
+
+#define N_PARAMS 2
+#define N_STEPS 3
+#define MAX_PARAM_SIZE 40
+
+enum layerwise_optimizer
+{
+    LARS,
+    LAMB,
+};
+
+struct layerwise_case
+{
+    const char *name;
+    enum layerwise_optimizer optimizer;
+    cgrad_dtype dtype;
+    bool is_flat;
+    double tolerance;
+};
+
+struct layerwise_state
+{
+    double w[N_PARAMS][MAX_PARAM_SIZE];
+    double m[N_PARAMS][MAX_PARAM_SIZE];
+    double v[N_PARAMS][MAX_PARAM_SIZE];
+};
+
+static const double lr = 1e-2;
+static const double momentum = 0.9;
+static const double trust_coefficient = 0.02;
+static const double beta1 = 0.9;
+static const double beta2 = 0.999;
+static const double eps = 1e-8;
+static const double weight_decay = 0.1;
+static const double grad_scale = 0.5;
+
+static double value_get(const struct tensor *const t, const size_t i)
+{
+    return t->dtype == DTYPE_FLOAT64 ? ((const double *)t->data)[i] : ((const float *)t->data)[i];
+}
+
+static void value_set(struct tensor *const t, const size_t i, const double value)
+{
+    if (t->dtype == DTYPE_FLOAT64)
+    {
+        ((double *)t->data)[i] = value;
+    }
+    else
+    {
+        ((float *)t->data)[i] = (float)value;
+    }
+}
+
+// Gradients change sign and magnitude from one step to the next, so that the state matters
+static double gradient_at(const size_t param, const size_t i, const size_t step)
+{
+    return sin(0.7 * (double)(i + 1) + 1.3 * (double)step + (double)param) * (1.0 + 0.5 * (double)step);
+}
+
+static void lars_reference_step(struct layerwise_state *const s, const struct tensor *const param, const size_t p)
+{
+    double param_sum = 0;
+    double grad_sum = 0;
+    for (size_t i = 0; i < param->data_size; i++)
+    {
+        const double g = grad_scale * value_get(param->grad, i);
+        param_sum += s->w[p][i] * s->w[p][i];
+        grad_sum += g * g;
+    }
+    const double param_norm = sqrt(param_sum);
+    const double grad_norm = sqrt(grad_sum);
+    const double trust = param_norm > 0 && grad_norm > 0 ? trust_coefficient * param_norm / (grad_norm + weight_decay * param_norm + eps) : 1;
+
+    for (size_t i = 0; i < param->data_size; i++)
+    {
+        const double g = trust * (grad_scale * value_get(param->grad, i) + weight_decay * s->w[p][i]);
+        s->m[p][i] = momentum * s->m[p][i] + g;
+        s->w[p][i] -= lr * s->m[p][i];
+    }
+}
+
+static void lamb_reference_step(struct layerwise_state *const s, const struct tensor *const param, const size_t p, const size_t step)
+{
+    const double correction1 = 1 - pow(beta1, (double)step);
+    const double correction2 = 1 - pow(beta2, (double)step);
+
+    double r[MAX_PARAM_SIZE];
+    double param_sum = 0;
+    double update_sum = 0;
+    for (size_t i = 0; i < param->data_size; i++)
+    {
+        const double g = grad_scale * value_get(param->grad, i);
+        s->m[p][i] = beta1 * s->m[p][i] + (1 - beta1) * g;
+        s->v[p][i] = beta2 * s->v[p][i] + (1 - beta2) * g * g;
+        r[i] = (s->m[p][i] / correction1) / (sqrt(s->v[p][i] / correction2) + eps) + weight_decay * s->w[p][i];
+        param_sum += s->w[p][i] * s->w[p][i];
+        update_sum += r[i] * r[i];
+    }
+    const double trust = param_sum > 0 && update_sum > 0 ? sqrt(param_sum) / sqrt(update_sum) : 1;
+
+    for (size_t i = 0; i < param->data_size; i++)
+    {
+        s->w[p][i] -= lr * trust * r[i];
+    }
+}
+
+static bool run_case(const struct layerwise_case *const c)
+{
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    const size_t shapes[N_PARAMS][2] = {{5, 8}, {1, 7}};
+    struct model_params params;
+    model_params_init(&params);
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        struct tensor *param = tensor_allocator_alloc(&tensor_alloc, shapes[p], 2, c->dtype);
+        if (!param || add_model_param(&params, param) != NO_ERROR)
+        {
+            return false;
+        }
+    }
+    if (c->is_flat && model_params_flatten(&params, &tensor_alloc) != NO_ERROR)
+    {
+        return false;
+    }
+
+    // Reference state, starting from the parameters as rounded to their dtype
+    struct layerwise_state s = {{{0}}, {{0}}, {{0}}};
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        for (size_t i = 0; i < params.params[p]->data_size; i++)
+        {
+            value_set(params.params[p], i, cos(0.3 * (double)i + (double)p));
+            s.w[p][i] = value_get(params.params[p], i);
+        }
+    }
+
+    // Not flattened, the second parameter is frozen
+    const size_t n_trainable = c->is_flat ? N_PARAMS : 1;
+    if (!c->is_flat)
+    {
+        params.params[1]->requires_grad = false;
+    }
+
+    struct lars_optimizer lars;
+    struct lamb_optimizer lamb;
+    if (c->optimizer == LARS)
+    {
+        if (lars_optimizer_init(&lars, &params, trust_coefficient, &tensor_alloc) != NO_ERROR)
+        {
+            return false;
+        }
+        lars.weight_decay = weight_decay;
+        lars.eps = eps;
+        lars.grad_scale = grad_scale;
+    }
+    else
+    {
+        if (lamb_optimizer_init(&lamb, &params, beta1, beta2, eps, &tensor_alloc) != NO_ERROR)
+        {
+            return false;
+        }
+        lamb.weight_decay = weight_decay;
+        lamb.grad_scale = grad_scale;
+    }
+
+    for (size_t step = 1; step <= N_STEPS; step++)
+    {
+        for (size_t p = 0; p < N_PARAMS; p++)
+        {
+            for (size_t i = 0; i < params.params[p]->data_size; i++)
+            {
+                value_set(params.params[p]->grad, i, gradient_at(p, i, step));
+            }
+        }
+
+        cgrad_error err = c->optimizer == LARS ? lars_optimizer_step(&lars, lr, momentum) : lamb_optimizer_step(&lamb, lr);
+        if (err != NO_ERROR)
+        {
+            fprintf(stderr, "%s: step %zu failed with error %d\n", c->name, step, err);
+            return false;
+        }
+
+        for (size_t p = 0; p < n_trainable; p++)
+        {
+            if (c->optimizer == LARS)
+            {
+                lars_reference_step(&s, params.params[p], p);
+            }
+            else
+            {
+                lamb_reference_step(&s, params.params[p], p, step);
+            }
+        }
+    }
+
+    bool is_correct = true;
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        for (size_t i = 0; i < params.params[p]->data_size; i++)
+        {
+            const double actual = value_get(params.params[p], i);
+            if (fabs(actual - s.w[p][i]) > c->tolerance * (1.0 + fabs(s.w[p][i])))
+            {
+                fprintf(stderr, "%s: parameter %zu element %zu is %.9g instead of %.9g\n", c->name, p, i, actual, s.w[p][i]);
+                is_correct = false;
+                break;
+            }
+        }
+    }
+
+    if (c->optimizer == LARS)
+    {
+        lars_optimizer_cleanup(&lars);
+    }
+    else
+    {
+        lamb_optimizer_cleanup(&lamb);
+    }
+    for (size_t p = 0; p < N_PARAMS; p++)
+    {
+        tensor_allocator_free(&tensor_alloc, params.params[p]);
+    }
+    model_params_cleanup(&params);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    return is_correct;
+}
+
+int main(void)
+{
+    const struct layerwise_case cases[] = {
+        {"lars f64", LARS, DTYPE_FLOAT64, false, 1e-12},
+        {"lars f32", LARS, DTYPE_FLOAT32, false, 1e-5},
+        {"lars f32 flat", LARS, DTYPE_FLOAT32, true, 1e-5},
+        {"lamb f64", LAMB, DTYPE_FLOAT64, false, 1e-12},
+        {"lamb f32", LAMB, DTYPE_FLOAT32, false, 1e-5},
+        {"lamb f32 flat", LAMB, DTYPE_FLOAT32, true, 1e-5},
+    };
+
+    bool is_correct = true;
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        is_correct = run_case(&cases[c]) && is_correct;
+    }
+
+    return is_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,94 @@
+#include "cgrad/optimizers/multi_tensor.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Repeated sweeps, which reuse the same threads, must visit every element of every trainable parameter
+ * exactly once per sweep, and per-parameter sweeps must start their chunks on chunk boundaries.
+ */
+
+#define N_SWEEPS 20
+
+struct visits
+{
+    unsigned char *counts[2];
+    atomic_bool is_misaligned;
+};
+
+static void count_visits(void *args, const size_t param_index, const size_t start, const size_t end)
+{
+    struct visits *visits = args;
+    if (start % OPTIMIZER_CHUNK_SIZE != 0)
+    {
+        atomic_store(&visits->is_misaligned, true);
+    }
+    for (size_t i = start; i < end; i++)
+    {
+        visits->counts[param_index][i]++;
+    }
+}
+
+int main(void)
+{
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    // Large enough for parallel sweeps, with a partial last chunk
+    const size_t shapes[2][2] = {{600, 512}, {3, 1000}};
+    struct model_params params;
+    model_params_init(&params);
+
+    struct visits visits;
+    atomic_init(&visits.is_misaligned, false);
+    for (size_t i = 0; i < 2; i++)
+    {
+        struct tensor *param = tensor_allocator_alloc(&tensor_alloc, shapes[i], 2, DTYPE_FLOAT32);
+        if (!param || add_model_param(&params, param) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+        visits.counts[i] = calloc(param->data_size, 1);
+        if (!visits.counts[i])
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (size_t sweep = 0; sweep < N_SWEEPS; sweep++)
+    {
+        cgrad_error err = sweep % 2 == 0 ? multi_tensor_apply(&params, count_visits, &visits) : multi_tensor_apply_per_param(&params, count_visits, &visits);
+        if (err != NO_ERROR)
+        {
+            fprintf(stderr, "sweep %zu failed with error %d\n", sweep, err);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (atomic_load(&visits.is_misaligned))
+    {
+        fprintf(stderr, "a chunk does not start on a chunk boundary\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < 2; i++)
+    {
+        for (size_t j = 0; j < params.params[i]->data_size; j++)
+        {
+            if (visits.counts[i][j] != N_SWEEPS)
+            {
+                fprintf(stderr, "element %zu of parameter %zu visited %d times instead of %d\n", j, i, visits.counts[i][j], N_SWEEPS);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        tensor_allocator_free(&tensor_alloc, params.params[i]);
+        free(visits.counts[i]);
+    }
+    model_params_cleanup(&params);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    return EXIT_SUCCESS;
+}
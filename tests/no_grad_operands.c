@@ -0,0 +1,127 @@
+#include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor2d_add_row_vector.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Tracked operations whose operands need no gradient, e.g. preprocessing of an input batch, must
+ * produce results without gradient buffer and without graph node. As soon as one operand needs a
+ * gradient, the result gets both. Backward from such a result fails cleanly, and backward from a
+ * leaf has nothing to propagate.
+ */
+
+static bool is_untracked(const struct tensor *const t)
+{
+    return t && !t->grad && !t->node && !t->requires_grad;
+}
+
+static bool is_tracked(const struct tensor *const t)
+{
+    return t && t->grad && t->node && t->requires_grad;
+}
+
+static void fill(struct tensor *const t)
+{
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        ((float *)t->data)[i] = (float)i / t->data_size - 0.5f;
+    }
+}
+
+int main(void)
+{
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    const size_t x_shape[] = {3, 4};
+    const size_t w_shape[] = {4, 2};
+    const size_t b_shape[] = {1, 2};
+    struct tensor *x = tensor_allocator_no_grad_alloc(&tensor_alloc, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *data_w = tensor_allocator_no_grad_alloc(&tensor_alloc, w_shape, 2, DTYPE_FLOAT32);
+    struct tensor *w = tensor_allocator_alloc(&tensor_alloc, w_shape, 2, DTYPE_FLOAT32);
+    struct tensor *b = tensor_allocator_no_grad_alloc(&tensor_alloc, b_shape, 2, DTYPE_FLOAT32);
+    if (!x || !data_w || !w || !b)
+    {
+        return EXIT_FAILURE;
+    }
+    fill(x);
+    fill(data_w);
+    fill(w);
+    fill(b);
+
+    // Only data involved: neither gradient nor node, even though the operations are tracked
+    struct tensor *data_prod = NULL;
+    struct tensor *data_shifted = NULL;
+    struct tensor *data_act = NULL;
+    if (tensor2d_mult(x, data_w, &data_prod, true, &allocs) != NO_ERROR ||
+        tensor2d_add_row_vector(data_prod, b, &data_shifted, true, &allocs) != NO_ERROR ||
+        relu_forward(data_shifted, &data_act, true, &allocs) != NO_ERROR)
+    {
+        fprintf(stderr, "operations on data failed\n");
+        return EXIT_FAILURE;
+    }
+    if (!is_untracked(data_prod) || !is_untracked(data_shifted) || !is_untracked(data_act))
+    {
+        fprintf(stderr, "results of operations on data have a gradient or a node\n");
+        return EXIT_FAILURE;
+    }
+
+    // Nothing to backpropagate from, nor through
+    if (backward(data_act, &allocs) != TENSOR_GRAD_NULL)
+    {
+        fprintf(stderr, "backward from a result without gradient did not fail with TENSOR_GRAD_NULL\n");
+        return EXIT_FAILURE;
+    }
+    if (backward(w, &allocs) != NO_ERROR)
+    {
+        fprintf(stderr, "backward from a leaf failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // A parameter involved: the results are part of the graph
+    struct tensor *prod = NULL;
+    struct tensor *shifted = NULL;
+    if (tensor2d_mult(x, w, &prod, true, &allocs) != NO_ERROR ||
+        tensor2d_add_row_vector(prod, b, &shifted, true, &allocs) != NO_ERROR)
+    {
+        fprintf(stderr, "operations on a parameter failed\n");
+        return EXIT_FAILURE;
+    }
+    if (!is_tracked(prod) || !is_tracked(shifted))
+    {
+        fprintf(stderr, "results of operations on a parameter are not tracked\n");
+        return EXIT_FAILURE;
+    }
+
+    // Untracked operations on a parameter, e.g. evaluation, need no gradient either
+    struct tensor *eval_prod = NULL;
+    if (tensor2d_mult(x, w, &eval_prod, false, &allocs) != NO_ERROR || !is_untracked(eval_prod))
+    {
+        fprintf(stderr, "result of an untracked operation has a gradient or a node\n");
+        return EXIT_FAILURE;
+    }
+
+    tensor_allocator_free(&tensor_alloc, eval_prod);
+    tensor_allocator_free(&tensor_alloc, shifted);
+    tensor_allocator_free(&tensor_alloc, prod);
+    tensor_allocator_free(&tensor_alloc, data_act);
+    tensor_allocator_free(&tensor_alloc, data_shifted);
+    tensor_allocator_free(&tensor_alloc, data_prod);
+    tensor_allocator_free(&tensor_alloc, b);
+    tensor_allocator_free(&tensor_alloc, w);
+    tensor_allocator_free(&tensor_alloc, data_w);
+    tensor_allocator_free(&tensor_alloc, x);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}
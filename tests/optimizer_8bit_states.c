@@ -0,0 +1,192 @@
+#include "cgrad/optimizers/adam.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/optimizers/quantized_state.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * 8-bit optimizer states: blocks must decode within one quantization step of what was stored, and
+ * 8-bit Adam and SGD with momentum must follow their float32 counterparts closely over a few steps,
+ * on a parameter spanning several blocks, the last one partial.
+ */
+
+#define PARAM_ROWS 3
+#define PARAM_COLS 200
+#define PARAM_SIZE (PARAM_ROWS * PARAM_COLS)
+#define N_STEPS 5
+#define MAX_RELATIVE_DEVIATION 0.05
+
+static double value_at(const size_t i, const double phase)
+{
+    return sin(0.37 * (double)i + phase) * (1.0 + (double)(i % 7));
+}
+
+static bool check_round_trip(const bool is_signed)
+{
+    struct quantized_state state;
+    if (quantized_state_init(&state, PARAM_SIZE, is_signed) != NO_ERROR)
+    {
+        return false;
+    }
+
+    float in[PARAM_SIZE];
+    for (size_t i = 0; i < PARAM_SIZE; i++)
+    {
+        const double value = value_at(i, 0.1);
+        in[i] = (float)(is_signed ? value : value * value);
+    }
+
+    bool is_correct = true;
+    for (size_t start = 0; start < PARAM_SIZE; start += OPTIMIZER_STATE_BLOCK_SIZE)
+    {
+        const size_t size = PARAM_SIZE - start < OPTIMIZER_STATE_BLOCK_SIZE ? PARAM_SIZE - start : OPTIMIZER_STATE_BLOCK_SIZE;
+        float out[OPTIMIZER_STATE_BLOCK_SIZE];
+        quantized_state_store_block_f32(&state, start, size, &in[start]);
+        quantized_state_load_block_f32(&state, start, size, out);
+
+        // Half a code step of c, through the derivative of the companding: 2|c| for signed, 4c^3 for unsigned
+        float scale = 0;
+        for (size_t i = 0; i < size; i++)
+        {
+            scale = fabsf(in[start + i]) > scale ? fabsf(in[start + i]) : scale;
+        }
+        const double max_error = is_signed ? scale / 127.0 : 2.0 * scale / 255.0;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (fabs((double)out[i] - in[start + i]) > max_error * 1.01 + 1e-6)
+            {
+                fprintf(stderr, "%s state: element %zu decodes to %g instead of %g\n", is_signed ? "signed" : "unsigned", start + i, out[i], in[start + i]);
+                is_correct = false;
+                break;
+            }
+        }
+    }
+
+    quantized_state_cleanup(&state);
+    return is_correct;
+}
+
+struct model
+{
+    struct model_params params;
+    struct tensor *param;
+};
+
+static bool model_init(struct model *const model, struct tensor_allocator *const tensor_alloc)
+{
+    const size_t shape[] = {PARAM_ROWS, PARAM_COLS};
+    model->param = tensor_allocator_alloc(tensor_alloc, shape, 2, DTYPE_FLOAT32);
+    model_params_init(&model->params);
+    if (!model->param || add_model_param(&model->params, model->param) != NO_ERROR)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < PARAM_SIZE; i++)
+    {
+        ((float *)model->param->data)[i] = (float)(0.1 * value_at(i, 0.5));
+    }
+    return true;
+}
+
+static void model_set_grad(struct model *const model, const size_t step)
+{
+    for (size_t i = 0; i < PARAM_SIZE; i++)
+    {
+        ((float *)model->param->grad->data)[i] = (float)value_at(i, 1.3 * (double)step);
+    }
+}
+
+static double max_deviation(const struct model *const lhs, const struct model *const rhs)
+{
+    double deviation = 0;
+    for (size_t i = 0; i < PARAM_SIZE; i++)
+    {
+        const double diff = fabs((double)((float *)lhs->param->data)[i] - ((float *)rhs->param->data)[i]);
+        deviation = diff > deviation ? diff : deviation;
+    }
+    return deviation;
+}
+
+// Largest distance travelled by a parameter since its initialization
+static double max_displacement(const struct model *const model)
+{
+    double displacement = 0;
+    for (size_t i = 0; i < PARAM_SIZE; i++)
+    {
+        const double diff = fabs((double)((float *)model->param->data)[i] - 0.1 * value_at(i, 0.5));
+        displacement = diff > displacement ? diff : displacement;
+    }
+    return displacement;
+}
+
+int main(void)
+{
+    bool is_correct = check_round_trip(true) && check_round_trip(false);
+
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    const double lr = 1e-2;
+
+    struct model adam_model, adam_8bit_model, sgd_model, sgd_8bit_model;
+    if (!model_init(&adam_model, &tensor_alloc) || !model_init(&adam_8bit_model, &tensor_alloc) ||
+        !model_init(&sgd_model, &tensor_alloc) || !model_init(&sgd_8bit_model, &tensor_alloc))
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct adam_optimizer adam, adam_8bit;
+    struct sgd_optimizer sgd, sgd_8bit;
+    if (adam_optimizer_init(&adam, &adam_model.params, 0.9, 0.999, 1e-8, &tensor_alloc) != NO_ERROR ||
+        adam_optimizer_init_8bit(&adam_8bit, &adam_8bit_model.params, 0.9, 0.999, 1e-8, &tensor_alloc) != NO_ERROR ||
+        sgd_optimizer_init(&sgd, &sgd_model.params, &tensor_alloc) != NO_ERROR ||
+        sgd_optimizer_init_8bit(&sgd_8bit, &sgd_8bit_model.params, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (size_t step = 1; step <= N_STEPS; step++)
+    {
+        model_set_grad(&adam_model, step);
+        model_set_grad(&adam_8bit_model, step);
+        model_set_grad(&sgd_model, step);
+        model_set_grad(&sgd_8bit_model, step);
+        if (adam_optimizer_step(&adam, lr) != NO_ERROR || adam_optimizer_step(&adam_8bit, lr) != NO_ERROR ||
+            sgd_optimizer_step(&sgd, lr, 0.9, false) != NO_ERROR || sgd_optimizer_step(&sgd_8bit, lr, 0.9, false) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // 8-bit states may only perturb a small part of the distance travelled with float32 states
+    const double adam_deviation = max_deviation(&adam_model, &adam_8bit_model);
+    const double sgd_deviation = max_deviation(&sgd_model, &sgd_8bit_model);
+    const double max_adam_deviation = MAX_RELATIVE_DEVIATION * max_displacement(&adam_model);
+    const double max_sgd_deviation = MAX_RELATIVE_DEVIATION * max_displacement(&sgd_model);
+    if (adam_deviation > max_adam_deviation)
+    {
+        fprintf(stderr, "8-bit Adam deviates by %g from float32 Adam, more than %g\n", adam_deviation, max_adam_deviation);
+        is_correct = false;
+    }
+    if (sgd_deviation > max_sgd_deviation)
+    {
+        fprintf(stderr, "8-bit SGD deviates by %g from float32 SGD, more than %g\n", sgd_deviation, max_sgd_deviation);
+        is_correct = false;
+    }
+
+    adam_optimizer_cleanup(&adam);
+    adam_optimizer_cleanup(&adam_8bit);
+    sgd_optimizer_cleanup(&sgd);
+    sgd_optimizer_cleanup(&sgd_8bit);
+    struct model *models[] = {&adam_model, &adam_8bit_model, &sgd_model, &sgd_8bit_model};
+    for (size_t m = 0; m < 4; m++)
+    {
+        tensor_allocator_free(&tensor_alloc, models[m]->param);
+        model_params_cleanup(&models[m]->params);
+    }
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    return is_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,152 @@
+#include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/mse.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/tensor/spill/tensor_spill_store.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A weight saved by the two products of y = relu(x w) w is only spilled when its owner frees it. While
+ * the owner keeps it, backward must leave its buffer in place, even when the first context that saved
+ * it is released. Once the owner freed it, it is spilled and restored for both contexts. Either way,
+ * the gradients match those computed without spilling.
+ */
+
+#define BATCH_SIZE 2
+#define DIM 64
+#define SPILL_CAPACITY (1024 * 1024)
+
+enum spill_mode
+{
+    NO_SPILL,
+    SPILL_KEEP_WEIGHT,
+    SPILL_FREE_WEIGHT,
+};
+
+struct run_result
+{
+    float x_grad[BATCH_SIZE * DIM];
+    size_t used_after_forward;
+    size_t used_after_backward;
+    bool is_weight_moved;
+};
+
+static bool run(const enum spill_mode mode, struct run_result *const result)
+{
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+
+    // Only the weight is large enough to be spilled
+    struct tensor_spill_store spill;
+    if (mode != NO_SPILL)
+    {
+        const char *dir = getenv("TMPDIR");
+        if (tensor_spill_store_init(&spill, dir ? dir : "/tmp", SPILL_CAPACITY, DIM * DIM * sizeof(float)) != NO_ERROR)
+        {
+            return false;
+        }
+        tensor_spill_store_attach(&spill, &tensor_alloc);
+    }
+
+    const size_t x_shape[] = {BATCH_SIZE, DIM};
+    const size_t w_shape[] = {DIM, DIM};
+    struct tensor *x = tensor_allocator_alloc(&tensor_alloc, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *w = tensor_allocator_alloc(&tensor_alloc, w_shape, 2, DTYPE_FLOAT32);
+    struct tensor *target = tensor_allocator_no_grad_alloc(&tensor_alloc, x_shape, 2, DTYPE_FLOAT32);
+    if (!x || !w || !target)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        ((float *)x->data)[i] = (float)(i % 13) / 13.0f - 0.4f;
+        ((float *)target->data)[i] = (float)(i % 5) / 5.0f;
+    }
+    for (size_t i = 0; i < w->data_size; i++)
+    {
+        ((float *)w->data)[i] = (float)(i % 17) / 170.0f - 0.04f;
+    }
+    const void *w_data = w->data;
+
+    struct tensor *h1 = NULL;
+    struct tensor *h2 = NULL;
+    struct tensor *h3 = NULL;
+    struct tensor *z = NULL;
+    if (tensor2d_mult(x, w, &h1, true, &allocs) != NO_ERROR ||
+        relu_forward(h1, &h2, true, &allocs) != NO_ERROR ||
+        tensor2d_mult(h2, w, &h3, true, &allocs) != NO_ERROR ||
+        mse_loss(h3, target, &z, true, &allocs) != NO_ERROR)
+    {
+        return false;
+    }
+    tensor_allocator_free(&tensor_alloc, h1);
+    tensor_allocator_free(&tensor_alloc, h2);
+    tensor_allocator_free(&tensor_alloc, h3);
+    if (mode == SPILL_FREE_WEIGHT)
+    {
+        tensor_allocator_free(&tensor_alloc, w);
+    }
+
+    result->used_after_forward = mode != NO_SPILL ? spill.used : 0;
+    if (backward(z, &allocs) != NO_ERROR)
+    {
+        return false;
+    }
+    result->used_after_backward = mode != NO_SPILL ? spill.used : 0;
+    result->is_weight_moved = mode != SPILL_FREE_WEIGHT && w->data != w_data;
+    memcpy(result->x_grad, x->grad->data, sizeof(result->x_grad));
+
+    tensor_allocator_free(&tensor_alloc, z);
+    if (mode != SPILL_FREE_WEIGHT)
+    {
+        tensor_allocator_free(&tensor_alloc, w);
+    }
+    tensor_allocator_free(&tensor_alloc, x);
+    tensor_allocator_free(&tensor_alloc, target);
+    if (mode != NO_SPILL)
+    {
+        tensor_spill_store_cleanup(&spill);
+    }
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    return true;
+}
+
+int main(void)
+{
+    struct run_result reference, kept, freed;
+    if (!run(NO_SPILL, &reference) || !run(SPILL_KEEP_WEIGHT, &kept) || !run(SPILL_FREE_WEIGHT, &freed))
+    {
+        fprintf(stderr, "a run failed\n");
+        return EXIT_FAILURE;
+    }
+
+    if (kept.used_after_backward != 0 || kept.is_weight_moved)
+    {
+        fprintf(stderr, "the weight kept by its owner was spilled during backward\n");
+        return EXIT_FAILURE;
+    }
+    if (freed.used_after_forward == 0 || freed.used_after_backward != freed.used_after_forward)
+    {
+        fprintf(stderr, "the weight freed by its owner was spilled %s\n", freed.used_after_forward == 0 ? "not at all" : "again during backward");
+        return EXIT_FAILURE;
+    }
+    if (memcmp(kept.x_grad, reference.x_grad, sizeof(reference.x_grad)) != 0 ||
+        memcmp(freed.x_grad, reference.x_grad, sizeof(reference.x_grad)) != 0)
+    {
+        fprintf(stderr, "gradients differ from those computed without spilling\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/mse.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/tape/autograd_tape.h"
+#include "cgrad/memory/allocators.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
+#include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Grad hooks of the parameters of a two layer network must fire exactly once per backward, with the
+ * final gradient of their parameter, both when building the graph and when recording on a tape.
+ */
+
+#define BATCH_SIZE 5
+#define IN_DIM 4
+#define HIDDEN_DIM 6
+#define OUT_DIM 3
+#define N_PARAMS 4
+#define MAX_PARAM_SIZE (IN_DIM * HIDDEN_DIM)
+
+struct hook_record
+{
+    size_t n_calls;
+    float grad[MAX_PARAM_SIZE];
+};
+
+static void record_grad(struct tensor *const t, void *const args)
+{
+    struct hook_record *record = args;
+    record->n_calls++;
+    memcpy(record->grad, t->grad->data, t->data_size * sizeof(float));
+}
+
+static cgrad_error forward_backward(struct linear *const linear1, struct linear *const linear2, struct tensor *const x, struct tensor *const y,
+                                    struct tensor_list *const intermediates, struct allocators *const allocs)
+{
+    cgrad_error err = NO_ERROR;
+    struct tensor *h1 = NULL;
+    struct tensor *h2 = NULL;
+    struct tensor *h3 = NULL;
+    struct tensor *z = NULL;
+    if ((err = linear_forward(linear1, x, &h1, intermediates, true)) != NO_ERROR ||
+        (err = relu_forward(h1, &h2, true, allocs)) != NO_ERROR ||
+        (err = linear_forward(linear2, h2, &h3, intermediates, true)) != NO_ERROR ||
+        (err = mse_loss(h3, y, &z, true, allocs)) != NO_ERROR)
+    {
+        return err;
+    }
+    tensor_allocator_free(allocs->tensor_alloc, h1);
+    tensor_allocator_free(allocs->tensor_alloc, h2);
+    tensor_allocator_free(allocs->tensor_alloc, h3);
+
+    err = backward(z, allocs);
+    tensor_allocator_free(allocs->tensor_alloc, z);
+    tensor_list_free_all(intermediates, allocs->tensor_alloc);
+    intermediates->size = 0;
+
+    return err;
+}
+
+int main(void)
+{
+    init_random_seed(42);
+
+    struct tensor_allocator tensor_alloc;
+    tensor_cpu_allocator_init(&tensor_alloc);
+
+    struct computational_graph_allocator graph_alloc;
+    computational_graph_cpu_allocator_init(&graph_alloc);
+
+    struct allocators allocs = {.tensor_alloc = &tensor_alloc, .graph_alloc = &graph_alloc, .tape = NULL};
+    struct tensor_list *intermediates = tensor_list_alloc(8);
+
+    struct linear linear1;
+    struct linear linear2;
+    if (linear_init(&linear1, IN_DIM, HIDDEN_DIM, DTYPE_FLOAT32, &allocs) != NO_ERROR || linear_xavier_init(&linear1) != NO_ERROR ||
+        linear_init(&linear2, HIDDEN_DIM, OUT_DIM, DTYPE_FLOAT32, &allocs) != NO_ERROR || linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct model_params params;
+    model_params_init(&params);
+    add_model_param(&params, linear1.weight);
+    add_model_param(&params, linear1.bias);
+    add_model_param(&params, linear2.weight);
+    add_model_param(&params, linear2.bias);
+
+    struct hook_record records[N_PARAMS];
+    for (size_t i = 0; i < N_PARAMS; i++)
+    {
+        if (backward_register_grad_hook(params.params[i], record_grad, &records[i]) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    const size_t x_shape[] = {BATCH_SIZE, IN_DIM};
+    const size_t y_shape[] = {BATCH_SIZE, OUT_DIM};
+    struct tensor *x = tensor_allocator_no_grad_alloc(&tensor_alloc, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *y = tensor_allocator_no_grad_alloc(&tensor_alloc, y_shape, 2, DTYPE_FLOAT32);
+    if (!x || !y)
+    {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        ((float *)x->data)[i] = (float)i / x->data_size - 0.5f;
+    }
+    for (size_t i = 0; i < y->data_size; i++)
+    {
+        ((float *)y->data)[i] = (float)(i % OUT_DIM) - 1.0f;
+    }
+
+    struct autograd_tape tape;
+    if (autograd_tape_init(&tape, &tensor_alloc) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const char *modes[] = {"graph", "tape"};
+    for (size_t m = 0; m < 2; m++)
+    {
+        allocs.tape = m == 1 ? &tape : NULL;
+        memset(records, 0, sizeof(records));
+
+        zero_grad(&params);
+        cgrad_error err = forward_backward(&linear1, &linear2, x, y, intermediates, &allocs);
+        if (err != NO_ERROR)
+        {
+            fprintf(stderr, "%s: backward failed with error %d\n", modes[m], err);
+            return EXIT_FAILURE;
+        }
+
+        for (size_t i = 0; i < N_PARAMS; i++)
+        {
+            const struct tensor *param = params.params[i];
+            if (records[i].n_calls != 1)
+            {
+                fprintf(stderr, "%s: hook of parameter %zu called %zu times\n", modes[m], i, records[i].n_calls);
+                return EXIT_FAILURE;
+            }
+            if (memcmp(records[i].grad, param->grad->data, param->data_size * sizeof(float)) != 0)
+            {
+                fprintf(stderr, "%s: hook of parameter %zu saw a partial gradient\n", modes[m], i);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    allocs.tape = NULL;
+    autograd_tape_cleanup(&tape);
+
+    tensor_allocator_free(&tensor_alloc, x);
+    tensor_allocator_free(&tensor_alloc, y);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    model_params_cleanup(&params);
+    free(intermediates->data);
+    free(intermediates);
+    tensor_cpu_allocator_cleanup(&tensor_alloc);
+    computational_graph_cpu_allocator_cleanup(&graph_alloc);
+    return EXIT_SUCCESS;
+}